@@ -0,0 +1,107 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Memory per row and top-k time of each node layout.
+ *
+ *   bench_layouts [rows] [queries]
+ *
+ * Builds int8 tables (384, 768 and 1024 dims) and float tables (768 dims) in
+ * every layout they take, then prints the node bytes each row costs and the
+ * mean single-threaded top-10 time over the queries.
+ */
+
+#include "embedding-library/float_embedding_table.h"
+#include "embedding-library/int8_embedding_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BATCH 4096
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t seed = 88172645463325252ull;
+
+static float uniform(void) {
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+    return (float)((seed >> 40) * (1.0 / 16777216.0)) * 2.0f - 1.0f;
+}
+
+static const char *layout_name(uint32_t layout) {
+    switch (layout) {
+    case 0: return "plain";
+    case EMBEDDING_TABLE_LAYOUT_ROW_SCALES: return "ROW_SCALES";
+    case EMBEDDING_TABLE_LAYOUT_INV_NORMS: return "INV_NORMS";
+    case EMBEDDING_TABLE_LAYOUT_ROW_SCALES | EMBEDDING_TABLE_LAYOUT_INV_NORMS:
+        return "ROW_SCALES|INV_NORMS";
+    case EMBEDDING_TABLE_LAYOUT_NORMALIZED: return "NORMALIZED";
+    }
+    return "?";
+}
+
+static void bench_int8(size_t dim, uint32_t layout, size_t rows, size_t queries,
+                       const float *floats) {
+    int8_embedding_table_t *t = int8_embedding_table_init_layout(dim, 0, layout);
+    for (size_t done = 0; done < rows; done += BATCH)
+        int8_embedding_table_add_floats_batch(t, floats, rows - done < BATCH ? rows - done : BATCH);
+
+    size_t ids[10];
+    double t0 = now();
+    for (size_t q = 0; q < queries; q++)
+        int8_embedding_table_topk(t, int8_embedding_table_embedding(t, q * 97 % rows), -1.0, 10,
+                                  ids, NULL);
+    double ms = (now() - t0) / queries * 1e3;
+    printf("int8  %4zu  %-22s %8.1f bytes/row  topk %7.3f ms\n", dim, layout_name(layout),
+           int8_embedding_table_bytes_per_row(t), ms);
+    int8_embedding_table_destroy(t);
+}
+
+static void bench_float(size_t dim, uint32_t layout, size_t rows, size_t queries,
+                        const float *floats) {
+    float_embedding_table_t *t = float_embedding_table_init_layout(dim, 0, layout);
+    for (size_t i = 0; i < rows; i++)
+        float_embedding_table_add_embedding(t, floats + (i % BATCH) * dim, -1.0);
+
+    size_t ids[10];
+    double t0 = now();
+    for (size_t q = 0; q < queries; q++)
+        float_embedding_table_topk(t, floats + (q * 97 % BATCH) * dim, -1.0, 10, ids, NULL);
+    double ms = (now() - t0) / queries * 1e3;
+    printf("float %4zu  %-22s %8.1f bytes/row  topk %7.3f ms\n", dim, layout_name(layout),
+           float_embedding_table_bytes_per_row(t), ms);
+    float_embedding_table_destroy(t);
+}
+
+int main(int argc, char **argv) {
+    size_t rows = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000;
+    size_t queries = argc > 2 ? strtoul(argv[2], NULL, 10) : 20;
+    if (rows == 0) rows = 1;
+
+    static const size_t dims[] = { 384, 768, 1024 };
+    static const uint32_t int8_layouts[] = {
+        0, EMBEDDING_TABLE_LAYOUT_ROW_SCALES, EMBEDDING_TABLE_LAYOUT_INV_NORMS,
+        EMBEDDING_TABLE_LAYOUT_ROW_SCALES | EMBEDDING_TABLE_LAYOUT_INV_NORMS
+    };
+    static const uint32_t float_layouts[] = {
+        0, EMBEDDING_TABLE_LAYOUT_INV_NORMS, EMBEDDING_TABLE_LAYOUT_NORMALIZED
+    };
+
+    float *floats = (float *)malloc(BATCH * 1024 * sizeof(float));
+    if (!floats) return 1;
+    for (size_t i = 0; i < BATCH * 1024; i++) floats[i] = uniform();
+
+    printf("%zu rows, mean of %zu top-10 queries, 1 thread\n", rows, queries);
+    for (size_t d = 0; d < sizeof(dims) / sizeof(dims[0]); d++)
+        for (size_t l = 0; l < sizeof(int8_layouts) / sizeof(int8_layouts[0]); l++)
+            bench_int8(dims[d], int8_layouts[l], rows, queries, floats);
+    for (size_t l = 0; l < sizeof(float_layouts) / sizeof(float_layouts[0]); l++)
+        bench_float(768, float_layouts[l], rows, queries, floats);
+
+    free(floats);
+    return 0;
+}
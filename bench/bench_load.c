@@ -0,0 +1,145 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Load throughput of a serialized 512-dim int8 table.
+ *
+ *   bench_load [rows] [threads] [dir]
+ *
+ * Writes a legacy record file ([double norm | 512 int8] per row) and a
+ * current file for the same rows under dir (default /tmp), then times, with
+ * both files in the page cache:
+ *
+ *   - the old path: two fread()s and one add_embedding() per record
+ *   - int8_embedding_table_deserialize() of each file
+ *   - int8_embedding_table_deserialize_parallel() with threads (default:
+ *     online CPUs)
+ *
+ * Each is the best of a few runs, in GB of file per second.
+ */
+
+#include "embedding-library/int8_embedding_table.h"
+#include "embedding-library/thread_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DIM 512
+#define RUNS 5
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static size_t file_size(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fclose(f);
+    return n > 0 ? (size_t)n : 0;
+}
+
+/* read the file once so every timed run starts from the page cache */
+static void warm(const char *filename) {
+    static char buf[1 << 20];
+    FILE *f = fopen(filename, "rb");
+    if (!f) return;
+    while (fread(buf, 1, sizeof(buf), f) == sizeof(buf)) {}
+    fclose(f);
+}
+
+static int8_embedding_table_t *load_records(const char *filename) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) return NULL;
+    int8_embedding_table_t *t = int8_embedding_table_init(0);
+    double norm;
+    int8_t row[DIM];
+    while (fread(&norm, sizeof(norm), 1, f) == 1 && fread(row, 1, DIM, f) == DIM)
+        int8_embedding_table_add_embedding(t, row, norm);
+    fclose(f);
+    return t;
+}
+
+typedef int8_embedding_table_t *(*load_cb)(const char *filename, embedding_thread_pool_t *pool);
+
+static int8_embedding_table_t *old_path(const char *filename, embedding_thread_pool_t *pool) {
+    (void)pool;
+    return load_records(filename);
+}
+
+static int8_embedding_table_t *serial(const char *filename, embedding_thread_pool_t *pool) {
+    (void)pool;
+    return int8_embedding_table_deserialize(filename);
+}
+
+static int8_embedding_table_t *parallel(const char *filename, embedding_thread_pool_t *pool) {
+    return int8_embedding_table_deserialize_parallel(filename, pool);
+}
+
+static void run(const char *label, load_cb load, const char *filename,
+                embedding_thread_pool_t *pool, size_t rows) {
+    double gb = file_size(filename) / 1e9, best = 0.0;
+    warm(filename);
+    for (int r = 0; r < RUNS; r++) {
+        double t0 = now();
+        int8_embedding_table_t *t = load(filename, pool);
+        double rate = gb / (now() - t0);
+        if (!t || int8_embedding_table_size(t) != rows) {
+            fprintf(stderr, "%s: load failed\n", label);
+            exit(1);
+        }
+        int8_embedding_table_destroy(t);
+        if (rate > best) best = rate;
+    }
+    printf("%-44s %6.2f GB/s\n", label, best);
+}
+
+int main(int argc, char **argv) {
+    size_t rows = argc > 1 ? strtoul(argv[1], NULL, 10) : 400000;
+    size_t threads = argc > 2 ? strtoul(argv[2], NULL, 10) : 0;
+    const char *dir = argc > 3 ? argv[3] : "/tmp";
+    char records[4096], current[4096];
+    snprintf(records, sizeof(records), "%s/bench_load_records.bin", dir);
+    snprintf(current, sizeof(current), "%s/bench_load_table.bin", dir);
+
+    int8_embedding_table_t *t = int8_embedding_table_init(0);
+    FILE *f = fopen(records, "wb");
+    if (!t || !f) {
+        perror(records);
+        return 1;
+    }
+    uint64_t seed = 88172645463325252ull;
+    int8_t row[DIM];
+    for (size_t i = 0; i < rows; i++) {
+        for (size_t d = 0; d < DIM; d++) {
+            seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+            row[d] = (int8_t)(seed >> 56);
+        }
+        row[0] |= 1;
+        int8_embedding_table_add_embedding(t, row, -1.0);
+        double norm = int8_embedding_table_norm(t, i);
+        fwrite(&norm, sizeof(norm), 1, f);
+        fwrite(row, 1, DIM, f);
+    }
+    fclose(f);
+    remove(current);
+    int8_embedding_table_serialize(t, current);
+    int8_embedding_table_destroy(t);
+
+    embedding_thread_pool_t *pool = embedding_thread_pool_init(threads);
+    printf("%zu rows x %d dims: records %.0f MB, table file %.0f MB, %zu threads\n", rows, DIM,
+           file_size(records) / 1e6, file_size(current) / 1e6, embedding_thread_pool_size(pool));
+    run("records, fread per row (old path)", old_path, records, pool, rows);
+    run("records, deserialize()", serial, records, pool, rows);
+    run("table file, deserialize()", serial, current, pool, rows);
+    run("table file, deserialize_parallel()", parallel, current, pool, rows);
+
+    embedding_thread_pool_destroy(pool);
+    remove(records);
+    remove(current);
+    return 0;
+}
@@ -0,0 +1,127 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Memory, scan time and recall of 1-bit sign codes against the int8 scan.
+ *
+ *   bench_sign_codes [rows] [dim] [queries]
+ *
+ * Builds a clustered int8 table and its sign codes, then prints the bytes a
+ * row costs in each, the mean single-threaded time of a brute-force top-10
+ * and of a code scan for the same number of candidates, and for each
+ * oversample the recall@10 of int8_sign_codes_topk() against the brute-force
+ * result with its mean time per query split into scan and re-rank.
+ */
+
+#include "embedding-library/int8.h"
+#include "embedding-library/int8_sign_codes.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define K 10
+#define CLUSTERS 256
+#define BATCH 4096
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t seed = 88172645463325252ull;
+
+static float uniform(void) {
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+    return (float)((seed >> 40) * (1.0 / 16777216.0)) * 2.0f - 1.0f;
+}
+
+/* a point near a random cluster center */
+static void make_point(const float *centers, size_t dim, float *out) {
+    size_t c = (size_t)((uniform() + 1.0f) * 0.5f * CLUSTERS) % CLUSTERS;
+    for (size_t d = 0; d < dim; d++) out[d] = centers[c * dim + d] + 0.5f * uniform();
+}
+
+int main(int argc, char **argv) {
+    size_t rows = argc > 1 ? strtoul(argv[1], NULL, 10) : 200000;
+    size_t dim = argc > 2 ? strtoul(argv[2], NULL, 10) : 768;
+    size_t queries = argc > 3 ? strtoul(argv[3], NULL, 10) : 50;
+    if (rows == 0) rows = 1;
+    if (dim == 0) dim = 1;
+    if (queries == 0) queries = 1;
+
+    float *centers = (float *)malloc(CLUSTERS * dim * sizeof(float));
+    float *floats = (float *)malloc(BATCH * dim * sizeof(float));
+    int8_t *query8 = (int8_t *)malloc(queries * dim);
+    size_t *want = (size_t *)malloc(queries * K * sizeof(size_t));
+    if (!centers || !floats || !query8 || !want) return 1;
+    for (size_t i = 0; i < CLUSTERS * dim; i++) centers[i] = uniform();
+
+    int8_embedding_table_t *t = int8_embedding_table_init_dim(dim, 0);
+    for (size_t done = 0; done < rows; done += BATCH) {
+        size_t n = rows - done < BATCH ? rows - done : BATCH;
+        for (size_t i = 0; i < n; i++) make_point(centers, dim, floats + i * dim);
+        int8_embedding_table_add_floats_batch(t, floats, n);
+    }
+    for (size_t q = 0; q < queries; q++) {
+        make_point(centers, dim, floats);
+        int8_from_floats(floats, dim, query8 + q * dim);
+    }
+    int8_sign_codes_t *c = int8_sign_codes_init(t, NULL);
+    if (!c) return 1;
+
+    double t0 = now();
+    for (size_t q = 0; q < queries; q++)
+        int8_embedding_table_topk(t, query8 + q * dim, -1.0, K, want + q * K, NULL);
+    double brute_ms = (now() - t0) / queries * 1e3;
+
+    size_t scan_n = K * INT8_SIGN_CODES_DEFAULT_OVERSAMPLE;
+    size_t *ids = (size_t *)malloc(scan_n * sizeof(size_t));
+    uint64_t *code = (uint64_t *)malloc(int8_sign_code_words(dim) * sizeof(uint64_t));
+    if (!ids || !code) return 1;
+    t0 = now();
+    for (size_t q = 0; q < queries; q++) {
+        int8_sign_code(query8 + q * dim, dim, code);
+        int8_sign_codes_scan(c, NULL, code, scan_n, ids, NULL);
+    }
+    double scan_ms = (now() - t0) / queries * 1e3;
+
+    printf("%zu rows, %zu dims, mean of %zu top-%d queries, 1 thread\n", rows, dim, queries, K);
+    printf("bytes/row   int8 %.1f   sign codes %zu\n", int8_embedding_table_bytes_per_row(t),
+           int8_sign_codes_bytes_per_row(c));
+    printf("brute-force topk %8.3f ms   code scan for %zu %8.3f ms\n", brute_ms, scan_n, scan_ms);
+    printf("oversample  recall@%d    total ms   scan ms  rerank ms\n", K);
+
+    static const size_t oversamples[] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+    for (size_t o = 0; o < sizeof(oversamples) / sizeof(oversamples[0]); o++) {
+        size_t hits = 0;
+        uint64_t scan_ns = 0, rerank_ns = 0;
+        t0 = now();
+        for (size_t q = 0; q < queries; q++) {
+            size_t got[K];
+            embedding_rerank_stats_t stats;
+            size_t n = int8_sign_codes_topk(c, NULL, query8 + q * dim, -1.0, K, oversamples[o],
+                                            got, NULL, &stats);
+            scan_ns += stats.scan_ns;
+            rerank_ns += stats.rerank_ns;
+            for (size_t i = 0; i < n; i++)
+                for (size_t j = 0; j < K; j++)
+                    if (got[i] == want[q * K + j]) hits++;
+        }
+        double ms = (now() - t0) / queries * 1e3;
+        printf("%10zu  %9.3f  %9.3f  %8.3f  %9.3f\n", oversamples[o],
+               (double)hits / (queries * K), ms, scan_ns / 1e6 / queries,
+               rerank_ns / 1e6 / queries);
+    }
+
+    free(code);
+    free(ids);
+    int8_sign_codes_destroy(c);
+    int8_embedding_table_destroy(t);
+    free(want);
+    free(query8);
+    free(floats);
+    free(centers);
+    return 0;
+}
@@ -0,0 +1,38 @@
+# SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+# SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+# SPDX-License-Identifier: Apache-2.0
+
+# Toolchain file for 64-bit Arm Linux with the GNU cross toolchain
+# (gcc-aarch64-linux-gnu).  If qemu-aarch64 is installed, ctest runs the tests
+# under it, so the kernel parity test (test_kernels) checks every Arm kernel
+# set the emulated CPU supports.  See BUILDING.md for the -march / -cpu matrix.
+#
+#   cmake -S . -B build-aarch64 -DCMAKE_TOOLCHAIN_FILE=cmake/aarch64-linux-gnu.cmake \
+#         -DAARCH64_MARCH=armv8.2-a+dotprod
+#   cmake --build build-aarch64 -j"$(nproc)"
+#   ctest --test-dir build-aarch64 --output-on-failure
+
+set(CMAKE_SYSTEM_NAME Linux)
+set(CMAKE_SYSTEM_PROCESSOR aarch64)
+
+set(AARCH64_TRIPLE "aarch64-linux-gnu" CACHE STRING "Cross toolchain prefix")
+set(AARCH64_MARCH "armv8-a" CACHE STRING
+    "-march of the build: armv8-a, armv8.2-a+dotprod or armv8.2-a+dotprod+sve")
+set(AARCH64_SYSROOT "/usr/${AARCH64_TRIPLE}" CACHE PATH "Target libraries and headers")
+set(AARCH64_QEMU_CPU "max" CACHE STRING "CPU model qemu-aarch64 runs the tests on")
+
+set(CMAKE_C_COMPILER   ${AARCH64_TRIPLE}-gcc)
+set(CMAKE_CXX_COMPILER ${AARCH64_TRIPLE}-g++)
+set(CMAKE_C_FLAGS_INIT   "-march=${AARCH64_MARCH}")
+set(CMAKE_CXX_FLAGS_INIT "-march=${AARCH64_MARCH}")
+
+set(CMAKE_FIND_ROOT_PATH ${AARCH64_SYSROOT})
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_PACKAGE ONLY)
+
+find_program(AARCH64_QEMU NAMES qemu-aarch64 qemu-aarch64-static)
+if(AARCH64_QEMU)
+  set(CMAKE_CROSSCOMPILING_EMULATOR ${AARCH64_QEMU} -cpu ${AARCH64_QEMU_CPU} -L ${AARCH64_SYSROOT})
+endif()
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <math.h>
 #include <arm_neon.h>  // NEON intrinsics for ARM
 
 static inline float dot_product_neon(const float *a, const float *b, size_t size) {
@@ -32,4 +33,32 @@ static inline float dot_product_neon(const float *a, const float *b, size_t size
     return result;
 }
 
+/* largest |v[i]|, 0.0f when size == 0 (inputs must be finite) */
+static inline float float_max_abs_neon(const float *v, size_t size) {
+    float32x4_t m = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4)
+        m = vmaxq_f32(m, vabsq_f32(vld1q_f32(v + i)));
+    float lanes[4];
+    vst1q_f32(lanes, m);
+    float max_abs = 0.0f;
+    for (int l = 0; l < 4; ++l)
+        if (lanes[l] > max_abs) max_abs = lanes[l];
+    for (; i < size; ++i) {
+        float a = fabsf(v[i]);
+        if (a > max_abs) max_abs = a;
+    }
+    return max_abs;
+}
+
+/* roundf() then a clamp to [lo, hi], as int32: adding 0.49999997f (the float
+ * just below 0.5) with x's sign and truncating matches roundf() exactly
+ */
+static inline int32x4_t float_round_clamp_neon(float32x4_t x, float32x4_t lo, float32x4_t hi) {
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(x), vdupq_n_u32(0x80000000u));
+    float32x4_t h = vreinterpretq_f32_u32(
+        vorrq_u32(sign, vreinterpretq_u32_f32(vdupq_n_f32(0.49999997f))));
+    return vcvtq_s32_f32(vminq_f32(vmaxq_f32(vaddq_f32(x, h), lo), hi));
+}
+
 #endif // _embed_arm_float_H
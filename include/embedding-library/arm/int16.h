@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_arm_int16_H
+#define _embed_arm_int16_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <arm_neon.h>
+#include "embedding-library/arm/float.h"
+#include "embedding-library/fallback/int16.h"
+
+/* NEON: vmull/vmlal_s16 sum two int16 products per int32 lane, which
+ * vpadalq_s32 then folds into int64 accumulators before they can overflow.
+ */
+static inline int64_t int16_dot_product_neon(const int16_t *a, const int16_t *b, size_t n) {
+    int64x2_t acc = vdupq_n_s64(0);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t va = vld1q_s16(a + i);
+        int16x8_t vb = vld1q_s16(b + i);
+        int32x4_t p  = vmull_s16(vget_low_s16(va), vget_low_s16(vb));
+        p = vmlal_s16(p, vget_high_s16(va), vget_high_s16(vb));
+        acc = vpadalq_s32(acc, p);
+    }
+    int64_t result = vgetq_lane_s64(acc, 0) + vgetq_lane_s64(acc, 1);
+    for (; i < n; ++i) result += (int32_t)a[i] * (int32_t)b[i];
+    return result;
+}
+
+/* Quantization: same results as the *_scalar reference kernels */
+static inline void int16_scale_floats_neon(const float *input, size_t n, float s,
+                                           int16_t *output) {
+    const float32x4_t lo = vdupq_n_f32(-32768.0f), hi = vdupq_n_f32(32767.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int32x4_t a = float_round_clamp_neon(vmulq_n_f32(vld1q_f32(input + i), s), lo, hi);
+        int32x4_t b = float_round_clamp_neon(vmulq_n_f32(vld1q_f32(input + i + 4), s), lo, hi);
+        vst1q_s16(output + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+    int16_scale_floats_scalar(input + i, n - i, s, output + i);
+}
+
+static inline void int16_from_floats_neon(const float *input, size_t n, int16_t *output) {
+    float max_abs = float_max_abs_neon(input, n);
+    if (max_abs == 0.0f) max_abs = 1.0f;
+    int16_scale_floats_neon(input, n, 32767.0f / max_abs, output);
+}
+
+/* AArch32 has no vector divide and stays scalar */
+static inline void int16_to_floats_neon(const int16_t *input, size_t n, float *output,
+                                        float scale_factor) {
+    size_t i = 0;
+#if defined(__aarch64__)
+    const float32x4_t vs = vdupq_n_f32(scale_factor);
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(input + i);
+        vst1q_f32(output + i, vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), vs));
+        vst1q_f32(output + i + 4, vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), vs));
+    }
+#endif
+    int16_to_floats_scalar(input + i, n - i, output + i, scale_factor);
+}
+
+#endif /* _embed_arm_int16_H */
@@ -5,7 +5,13 @@
 #ifndef _embed_arm_int8_H
 #define _embed_arm_int8_H
 
+#include "embedding-library/target.h"
+#include "embedding-library/arm/float.h"
+#include "embedding-library/fallback/int8.h"
 #include <arm_neon.h>
+#if defined(__ARM_FEATURE_SVE)
+#include <arm_sve.h>
+#endif
 #include <stdint.h>
 #include <stddef.h>
 
@@ -36,4 +42,250 @@ static inline int32_t int8_dot_product_neon(const int8_t *a, const int8_t *b, si
     return sum;
 }
 
+static inline int32_t int8_hsum_s32_neon(int32x4_t v) {
+#if defined(__aarch64__)
+    return vaddvq_s32(v);
+#else
+    int32x2_t pair = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+    pair = vpadd_s32(pair, pair);
+    return vget_lane_s32(pair, 0);
+#endif
+}
+
+/* NEON: one query against `nrows` consecutive rows of `n` elements.
+ * Four rows share every loaded query chunk, so the query is loaded once per
+ * four rows instead of once per row.
+ */
+static inline void int8_dot_product_rows_neon(const int8_t *q, const int8_t *rows,
+                                              size_t nrows, size_t n, int32_t *out) {
+    size_t r = 0;
+    for (; r + 4 <= nrows; r += 4) {
+        const int8_t *r0 = rows + (r + 0) * n;
+        const int8_t *r1 = rows + (r + 1) * n;
+        const int8_t *r2 = rows + (r + 2) * n;
+        const int8_t *r3 = rows + (r + 3) * n;
+        int32x4_t acc0 = vdupq_n_s32(0);
+        int32x4_t acc1 = vdupq_n_s32(0);
+        int32x4_t acc2 = vdupq_n_s32(0);
+        int32x4_t acc3 = vdupq_n_s32(0);
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            int8x16_t vq = vld1q_s8(q + i);
+            int8x8_t  ql = vget_low_s8(vq);
+            int8x8_t  qh = vget_high_s8(vq);
+            int8x16_t v0 = vld1q_s8(r0 + i);
+            int8x16_t v1 = vld1q_s8(r1 + i);
+            int8x16_t v2 = vld1q_s8(r2 + i);
+            int8x16_t v3 = vld1q_s8(r3 + i);
+            acc0 = vpadalq_s16(acc0, vmull_s8(ql, vget_low_s8(v0)));
+            acc0 = vpadalq_s16(acc0, vmull_s8(qh, vget_high_s8(v0)));
+            acc1 = vpadalq_s16(acc1, vmull_s8(ql, vget_low_s8(v1)));
+            acc1 = vpadalq_s16(acc1, vmull_s8(qh, vget_high_s8(v1)));
+            acc2 = vpadalq_s16(acc2, vmull_s8(ql, vget_low_s8(v2)));
+            acc2 = vpadalq_s16(acc2, vmull_s8(qh, vget_high_s8(v2)));
+            acc3 = vpadalq_s16(acc3, vmull_s8(ql, vget_low_s8(v3)));
+            acc3 = vpadalq_s16(acc3, vmull_s8(qh, vget_high_s8(v3)));
+        }
+        int32_t s0 = int8_hsum_s32_neon(acc0);
+        int32_t s1 = int8_hsum_s32_neon(acc1);
+        int32_t s2 = int8_hsum_s32_neon(acc2);
+        int32_t s3 = int8_hsum_s32_neon(acc3);
+        for (; i < n; ++i) {
+            int32_t qi = q[i];
+            s0 += qi * r0[i];
+            s1 += qi * r1[i];
+            s2 += qi * r2[i];
+            s3 += qi * r3[i];
+        }
+        out[r + 0] = s0;
+        out[r + 1] = s1;
+        out[r + 2] = s2;
+        out[r + 3] = s3;
+    }
+    for (; r < nrows; ++r) out[r] = int8_dot_product_neon(q, rows + r * n, n);
+}
+
+#if EMBED_HAVE_TARGET_DOTPROD || defined(__ARM_FEATURE_DOTPROD)
+/* ARMv8.2 SDOT: vdotq_s32 multiplies 16 signed byte pairs and adds each group
+ * of four into a 32-bit lane in one instruction.  Four independent
+ * accumulators hide the instruction latency.
+ */
+EMBED_TARGET_DOTPROD
+static inline int32_t int8_dot_product_neon_dotprod(const int8_t *a, const int8_t *b, size_t n) {
+    int32x4_t acc0 = vdupq_n_s32(0);
+    int32x4_t acc1 = vdupq_n_s32(0);
+    int32x4_t acc2 = vdupq_n_s32(0);
+    int32x4_t acc3 = vdupq_n_s32(0);
+    size_t i = 0;
+
+    for (; i + 64 <= n; i += 64) {
+        acc0 = vdotq_s32(acc0, vld1q_s8(a + i),      vld1q_s8(b + i));
+        acc1 = vdotq_s32(acc1, vld1q_s8(a + i + 16), vld1q_s8(b + i + 16));
+        acc2 = vdotq_s32(acc2, vld1q_s8(a + i + 32), vld1q_s8(b + i + 32));
+        acc3 = vdotq_s32(acc3, vld1q_s8(a + i + 48), vld1q_s8(b + i + 48));
+    }
+    for (; i + 16 <= n; i += 16)
+        acc0 = vdotq_s32(acc0, vld1q_s8(a + i), vld1q_s8(b + i));
+
+    int32_t sum = int8_hsum_s32_neon(vaddq_s32(vaddq_s32(acc0, acc1), vaddq_s32(acc2, acc3)));
+    for (; i < n; ++i) sum += (int32_t)a[i] * (int32_t)b[i];
+    return sum;
+}
+
+/* SDOT rows kernel: one loaded query chunk feeds four rows, each with its
+ * own accumulator.
+ */
+EMBED_TARGET_DOTPROD
+static inline void int8_dot_product_rows_neon_dotprod(const int8_t *q, const int8_t *rows,
+                                                      size_t nrows, size_t n, int32_t *out) {
+    size_t r = 0;
+    for (; r + 4 <= nrows; r += 4) {
+        const int8_t *r0 = rows + (r + 0) * n;
+        const int8_t *r1 = rows + (r + 1) * n;
+        const int8_t *r2 = rows + (r + 2) * n;
+        const int8_t *r3 = rows + (r + 3) * n;
+        int32x4_t acc0 = vdupq_n_s32(0);
+        int32x4_t acc1 = vdupq_n_s32(0);
+        int32x4_t acc2 = vdupq_n_s32(0);
+        int32x4_t acc3 = vdupq_n_s32(0);
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            int8x16_t vq = vld1q_s8(q + i);
+            acc0 = vdotq_s32(acc0, vq, vld1q_s8(r0 + i));
+            acc1 = vdotq_s32(acc1, vq, vld1q_s8(r1 + i));
+            acc2 = vdotq_s32(acc2, vq, vld1q_s8(r2 + i));
+            acc3 = vdotq_s32(acc3, vq, vld1q_s8(r3 + i));
+        }
+        int32_t s0 = int8_hsum_s32_neon(acc0);
+        int32_t s1 = int8_hsum_s32_neon(acc1);
+        int32_t s2 = int8_hsum_s32_neon(acc2);
+        int32_t s3 = int8_hsum_s32_neon(acc3);
+        for (; i < n; ++i) {
+            int32_t qi = q[i];
+            s0 += qi * r0[i];
+            s1 += qi * r1[i];
+            s2 += qi * r2[i];
+            s3 += qi * r3[i];
+        }
+        out[r + 0] = s0;
+        out[r + 1] = s1;
+        out[r + 2] = s2;
+        out[r + 3] = s3;
+    }
+    for (; r < nrows; ++r) out[r] = int8_dot_product_neon_dotprod(q, rows + r * n, n);
+}
+#endif
+
+#if defined(__ARM_FEATURE_SVE)
+/* SVE / SVE2: vector-length agnostic SDOT.  The main loop runs two vectors
+ * per iteration into independent accumulators; the tail is handled by a
+ * whilelt predicate (inactive lanes load as zero), so there is no scalar tail.
+ */
+static inline int32_t int8_dot_product_sve(const int8_t *a, const int8_t *b, size_t n) {
+    const svbool_t all = svptrue_b8();
+    const size_t vl = svcntb();
+    svint32_t acc0 = svdup_n_s32(0);
+    svint32_t acc1 = svdup_n_s32(0);
+    size_t i = 0;
+
+    for (; i + 2 * vl <= n; i += 2 * vl) {
+        acc0 = svdot_s32(acc0, svld1_s8(all, a + i),      svld1_s8(all, b + i));
+        acc1 = svdot_s32(acc1, svld1_s8(all, a + i + vl), svld1_s8(all, b + i + vl));
+    }
+    for (; i < n; i += vl) {
+        svbool_t pg = svwhilelt_b8_u64((uint64_t)i, (uint64_t)n);
+        acc0 = svdot_s32(acc0, svld1_s8(pg, a + i), svld1_s8(pg, b + i));
+    }
+    return (int32_t)svaddv_s32(svptrue_b32(), svadd_s32_x(svptrue_b32(), acc0, acc1));
+}
+
+/* SVE rows kernel: one predicated query chunk feeds four rows. */
+static inline void int8_dot_product_rows_sve(const int8_t *q, const int8_t *rows,
+                                             size_t nrows, size_t n, int32_t *out) {
+    const size_t vl = svcntb();
+    const svbool_t all32 = svptrue_b32();
+    size_t r = 0;
+    for (; r + 4 <= nrows; r += 4) {
+        const int8_t *r0 = rows + (r + 0) * n;
+        const int8_t *r1 = rows + (r + 1) * n;
+        const int8_t *r2 = rows + (r + 2) * n;
+        const int8_t *r3 = rows + (r + 3) * n;
+        svint32_t acc0 = svdup_n_s32(0);
+        svint32_t acc1 = svdup_n_s32(0);
+        svint32_t acc2 = svdup_n_s32(0);
+        svint32_t acc3 = svdup_n_s32(0);
+        for (size_t i = 0; i < n; i += vl) {
+            svbool_t pg = svwhilelt_b8_u64((uint64_t)i, (uint64_t)n);
+            svint8_t vq = svld1_s8(pg, q + i);
+            acc0 = svdot_s32(acc0, vq, svld1_s8(pg, r0 + i));
+            acc1 = svdot_s32(acc1, vq, svld1_s8(pg, r1 + i));
+            acc2 = svdot_s32(acc2, vq, svld1_s8(pg, r2 + i));
+            acc3 = svdot_s32(acc3, vq, svld1_s8(pg, r3 + i));
+        }
+        out[r + 0] = (int32_t)svaddv_s32(all32, acc0);
+        out[r + 1] = (int32_t)svaddv_s32(all32, acc1);
+        out[r + 2] = (int32_t)svaddv_s32(all32, acc2);
+        out[r + 3] = (int32_t)svaddv_s32(all32, acc3);
+    }
+    for (; r < nrows; ++r) out[r] = int8_dot_product_sve(q, rows + r * n, n);
+}
+#endif
+
+/* Quantization: same results as the *_scalar reference kernels, see
+ * float_round_clamp_neon().  Tails go through the scalar kernels.
+ */
+static inline int8x8_t int8_pack_s32_neon(int32x4_t a, int32x4_t b) {
+    return vqmovn_s16(vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+}
+
+static inline void int8_scale_floats_neon(const float *input, size_t n, float s,
+                                          int8_t *output) {
+    const float32x4_t lo = vdupq_n_f32(-128.0f), hi = vdupq_n_f32(127.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int32x4_t a = float_round_clamp_neon(vmulq_n_f32(vld1q_f32(input + i), s), lo, hi);
+        int32x4_t b = float_round_clamp_neon(vmulq_n_f32(vld1q_f32(input + i + 4), s), lo, hi);
+        vst1_s8(output + i, int8_pack_s32_neon(a, b));
+    }
+    int8_scale_floats_scalar(input + i, n - i, s, output + i);
+}
+
+static inline void int8_from_floats_neon(const float *input, size_t n, int8_t *output) {
+    float max_abs = float_max_abs_neon(input, n);
+    if (max_abs == 0.0f) max_abs = 1.0f;
+    int8_scale_floats_neon(input, n, 127.0f / max_abs, output);
+}
+
+static inline void int8_from_int16s_neon(const int16_t *input, size_t n, int8_t *output) {
+    const float s = 127.0f / 32767.0f;
+    const float32x4_t lo = vdupq_n_f32(-128.0f), hi = vdupq_n_f32(127.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vld1q_s16(input + i);
+        float32x4_t x0 = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        float32x4_t x1 = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+        int32x4_t a = float_round_clamp_neon(vmulq_n_f32(x0, s), lo, hi);
+        int32x4_t b = float_round_clamp_neon(vmulq_n_f32(x1, s), lo, hi);
+        vst1_s8(output + i, int8_pack_s32_neon(a, b));
+    }
+    int8_from_int16s_scalar(input + i, n - i, output + i);
+}
+
+/* a true division per element, as the reference does, so results match;
+ * AArch32 has no vector divide and stays scalar
+ */
+static inline void int8_to_floats_neon(const int8_t *input, size_t n, float *output,
+                                       float scale_factor) {
+    size_t i = 0;
+#if defined(__aarch64__)
+    const float32x4_t vs = vdupq_n_f32(scale_factor);
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t v = vmovl_s8(vld1_s8(input + i));
+        vst1q_f32(output + i, vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), vs));
+        vst1q_f32(output + i + 4, vdivq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), vs));
+    }
+#endif
+    int8_to_floats_scalar(input + i, n - i, output + i, scale_factor);
+}
+
 #endif /* _embed_arm_int8_H */
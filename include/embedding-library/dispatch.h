@@ -0,0 +1,112 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_dispatch_H
+#define _embed_dispatch_H
+
+/* Runtime CPU dispatch.
+ *
+ * float.h / int8.h pick kernels at compile time, which ties a binary to the
+ * ISA it was built for.  The compiled library instead probes the host once
+ * (cpuid/xgetbv on x86, getauxval on Linux/AArch64) and resolves a table of
+ * function pointers to the best kernels available, so one build uses
+ * AVX-512 VNNI where it exists and still runs on a plain AVX2 machine.
+ *
+ * Setting EMBEDDING_LIBRARY_KERNELS=<name> in the environment (e.g. "avx2",
+ * "scalar") caps the selection, which is handy for comparing kernels.  A
+ * name the host cannot run is ignored.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* bits returned by embedding_cpu_features() */
+#define EMBEDDING_CPU_AVX          (1u << 0)
+#define EMBEDDING_CPU_AVX2         (1u << 1)
+#define EMBEDDING_CPU_AVXVNNI      (1u << 2)
+#define EMBEDDING_CPU_AVX512F      (1u << 3)
+#define EMBEDDING_CPU_AVX512BW     (1u << 4)
+#define EMBEDDING_CPU_AVX512VNNI   (1u << 5)
+#define EMBEDDING_CPU_SSE42        (1u << 6)   /* crc32 instruction */
+#define EMBEDDING_CPU_POPCNT       (1u << 7)
+#define EMBEDDING_CPU_NEON         (1u << 8)
+#define EMBEDDING_CPU_DOTPROD      (1u << 9)
+#define EMBEDDING_CPU_SVE          (1u << 10)
+#define EMBEDDING_CPU_CRC32        (1u << 11)
+#define EMBEDDING_CPU_AVX512VPOPCNTDQ (1u << 12)
+
+typedef float   (*embedding_dot_product_cb)(const float *a, const float *b, size_t size);
+typedef int32_t (*embedding_int8_dot_product_cb)(const int8_t *a, const int8_t *b, size_t size);
+typedef void    (*embedding_int8_dot_product_rows_cb)(const int8_t *query, const int8_t *rows,
+                                                      size_t nrows, size_t size, int32_t *out);
+typedef int64_t (*embedding_int16_dot_product_cb)(const int16_t *a, const int16_t *b, size_t size);
+typedef void    (*embedding_int8_from_floats_cb)(const float *input, size_t size, int8_t *output);
+typedef void    (*embedding_int8_from_int16s_cb)(const int16_t *input, size_t size, int8_t *output);
+typedef void    (*embedding_int8_to_floats_cb)(const int8_t *input, size_t size, float *output,
+                                               float scale_factor);
+typedef void    (*embedding_int16_from_floats_cb)(const float *input, size_t size, int16_t *output);
+typedef void    (*embedding_int16_to_floats_cb)(const int16_t *input, size_t size, float *output,
+                                                float scale_factor);
+typedef float   (*embedding_float_max_abs_cb)(const float *input, size_t size);
+typedef void    (*embedding_int8_scale_floats_cb)(const float *input, size_t size, float s,
+                                                  int8_t *output);
+
+/* embedding sizes with a dedicated rows kernel, see embedding_int8_rows_kernel() */
+#define EMBEDDING_FIXED_DIMS 4
+#define EMBEDDING_FIXED_DIM_LIST { 384, 512, 768, 1024 }
+
+struct embedding_kernels_s {
+    const char *name;                     /* e.g. "avx512_vnni", "neon", "scalar" */
+    uint32_t required;                    /* EMBEDDING_CPU_* bits this set needs */
+    embedding_dot_product_cb dot_product;
+    embedding_int8_dot_product_cb int8_dot_product;
+    embedding_int8_dot_product_rows_cb int8_dot_product_rows;
+    embedding_int16_dot_product_cb int16_dot_product;
+    /* quantization; every set gives the same results as the scalar one */
+    embedding_int8_from_floats_cb int8_from_floats;
+    embedding_int8_from_int16s_cb int8_from_int16s;
+    embedding_int8_to_floats_cb int8_to_floats;
+    embedding_int16_from_floats_cb int16_from_floats;
+    embedding_int16_to_floats_cb int16_to_floats;
+    embedding_float_max_abs_cb float_max_abs;
+    embedding_int8_scale_floats_cb int8_scale_floats;
+    /* int8_dot_product_rows compiled for each EMBEDDING_FIXED_DIM_LIST size */
+    embedding_int8_dot_product_rows_cb int8_dot_product_rows_fixed[EMBEDDING_FIXED_DIMS];
+};
+typedef struct embedding_kernels_s embedding_kernels_t;
+
+/* Feature bits of the running CPU (probed once). */
+uint32_t embedding_cpu_features(void);
+
+/* Best kernel set for this host, resolved on first call.  Thread-safe. */
+const embedding_kernels_t *embedding_kernels(void);
+
+/* The i-th kernel set compiled into the library, best first, ending with
+ * "scalar"; NULL past the end.  Sets the host cannot run are listed too:
+ * check (k->required & embedding_cpu_features()) == k->required before
+ * calling one.
+ */
+const embedding_kernels_t *embedding_kernel_set(size_t i);
+
+/* The rows kernel of k to use for embeddings of `size` elements: a copy with
+ * the size compiled in (fully resolved chunk loop, no tail handling) for the
+ * common model dims, otherwise k->int8_dot_product_rows.
+ */
+embedding_int8_dot_product_rows_cb embedding_int8_rows_kernel(const embedding_kernels_t *k,
+                                                              size_t size);
+
+/* Runtime-dispatched equivalents of dot_product() / int8_dot_product() / ... */
+float dot_product_dispatch(const float *a, const float *b, size_t size);
+int32_t int8_dot_product_dispatch(const int8_t *a, const int8_t *b, size_t size);
+void int8_dot_product_rows_dispatch(const int8_t *query, const int8_t *rows,
+                                    size_t nrows, size_t size, int32_t *out);
+int64_t int16_dot_product_dispatch(const int16_t *a, const int16_t *b, size_t size);
+void int8_from_floats_dispatch(const float *input, size_t size, int8_t *output);
+void int8_from_int16s_dispatch(const int16_t *input, size_t size, int8_t *output);
+void int8_to_floats_dispatch(const int8_t *input, size_t size, float *output, float scale_factor);
+void int16_from_floats_dispatch(const float *input, size_t size, int16_t *output);
+void int16_to_floats_dispatch(const int16_t *input, size_t size, float *output, float scale_factor);
+float int8_from_floats_scaled_dispatch(const float *input, size_t size, int8_t *output);
+
+#endif // _embed_dispatch_H
@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_embedding_allocator_H
+#define _embed_embedding_allocator_H
+
+/* Caller-supplied memory for node allocations.
+ *
+ * A table allocates one piece of memory per node: the node's header with its
+ * block right behind it.  By default that comes from the heap; a table given
+ * an allocator takes it from there instead, so an application can account
+ * for, pool or place table memory itself.  The arena below is one such
+ * allocator, for many small tables: it hands out pieces of large shared
+ * chunks and recycles freed pieces of the same size.
+ */
+
+#include <stddef.h>
+
+struct embedding_allocator_s {
+    /* size bytes aligned to alignment (a power of two, at most 64); NULL on failure */
+    void *(*alloc)(void *ctx, size_t size, size_t alignment);
+    /* release p, which alloc(ctx, size, ...) returned */
+    void (*free)(void *ctx, void *p, size_t size);
+    void *ctx;
+};
+typedef struct embedding_allocator_s embedding_allocator_t;
+
+/* posix_memalign() / free(); what tables use unless told otherwise */
+extern const embedding_allocator_t embedding_heap_allocator;
+
+struct embedding_arena_s;
+typedef struct embedding_arena_s embedding_arena_t;
+
+/* An arena carving allocations out of chunk_bytes chunks (0 picks 16 MiB);
+ * larger allocations get a chunk of their own.  Freed pieces are kept on
+ * per-size free lists for reuse and chunks are only returned by destroy(), so
+ * it suits many tables with the same node size.  Thread-safe.
+ */
+embedding_arena_t *embedding_arena_init(size_t chunk_bytes);
+
+/* frees every chunk; tables using the arena must be destroyed first */
+void embedding_arena_destroy(embedding_arena_t *a);
+
+/* an allocator drawing from a (valid until the arena is destroyed) */
+embedding_allocator_t embedding_arena_allocator(embedding_arena_t *a);
+
+/* bytes of chunks the arena holds, and of those handed out and not freed */
+size_t embedding_arena_reserved(const embedding_arena_t *a);
+size_t embedding_arena_used(const embedding_arena_t *a);
+
+#endif // _embed_embedding_allocator_H
@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_embedding_filter_H
+#define _embed_embedding_filter_H
+
+/* Row filters for the table scans.
+ *
+ * An embedding_bitmap_t is a set of row ids, e.g. the rows of one tenant or
+ * one category: keep one per label and set a row's bit as it is added.  It
+ * is stored in blocks of 512 bits, one per table node, and a block is only
+ * allocated once a row in it is set, so a label that covers a few nodes
+ * costs 8 bytes per node plus 64 bytes per node it touches.
+ *
+ * A filtered scan (int8_embedding_table_topk_filtered()) skips a node whose
+ * block is missing or empty without reading it, and scores only the rows
+ * whose bits are set.  A predicate can narrow that further; it runs on the
+ * rows the bitmap lets through, before they are scored.
+ *
+ * Concurrency: like the tables, one thread may set and clear bits while any
+ * number of others test them or scan with the bitmap; no lock is taken.
+ */
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define EMBEDDING_BITMAP_BLOCK_WORDS 8   /* uint64 words per block (512 rows) */
+
+typedef struct {
+    _Atomic(uint64_t) words[EMBEDDING_BITMAP_BLOCK_WORDS];   /* row r: word r / 64, bit r % 64 */
+} embedding_bitmap_block_t;
+
+struct embedding_bitmap_s {
+    _Atomic(_Atomic(embedding_bitmap_block_t *) *) blocks;  /* per node, NULL until a bit is set */
+    atomic_size_t num_blocks;   /* slots readers may look at */
+    size_t capacity;            /* slots in blocks, writer side */
+    atomic_size_t count;        /* bits set */
+    void **retired;             /* superseded slot arrays readers may hold */
+    size_t num_retired;
+};
+typedef struct embedding_bitmap_s embedding_bitmap_t;
+
+/* An empty bitmap.  NULL on failure. */
+embedding_bitmap_t *embedding_bitmap_init(void);
+
+void embedding_bitmap_destroy(embedding_bitmap_t *b);
+
+/* Add row id.  returns 0 on success, -1 on failure */
+int embedding_bitmap_set(embedding_bitmap_t *b, size_t id);
+
+/* Remove row id (its block stays allocated) */
+void embedding_bitmap_clear(embedding_bitmap_t *b, size_t id);
+
+/* rows set */
+static inline size_t embedding_bitmap_count(const embedding_bitmap_t *b) {
+    return atomic_load_explicit(&((embedding_bitmap_t *)b)->count, memory_order_relaxed);
+}
+
+/* the block of rows [512 * node, 512 * node + 512), or NULL if none of them is set */
+static inline const embedding_bitmap_block_t *
+embedding_bitmap_block(const embedding_bitmap_t *b, size_t node) {
+    embedding_bitmap_t *m = (embedding_bitmap_t *)b;
+    /* the count first: the slot array loaded after it holds every published slot */
+    if (node >= atomic_load_explicit(&m->num_blocks, memory_order_acquire)) return NULL;
+    _Atomic(embedding_bitmap_block_t *) *blocks =
+        atomic_load_explicit(&m->blocks, memory_order_acquire);
+    return atomic_load_explicit(&blocks[node], memory_order_acquire);
+}
+
+static inline int embedding_bitmap_test(const embedding_bitmap_t *b, size_t id) {
+    const embedding_bitmap_block_t *blk = embedding_bitmap_block(b, id >> 9);
+    if (!blk) return 0;
+    uint64_t word = atomic_load_explicit(&blk->words[(id & 0x1FF) >> 6], memory_order_relaxed);
+    return (int)((word >> (id & 63)) & 1u);
+}
+
+/* New bitmaps holding the rows in both a and b, or in either.  NULL on failure. */
+embedding_bitmap_t *embedding_bitmap_and(const embedding_bitmap_t *a, const embedding_bitmap_t *b);
+embedding_bitmap_t *embedding_bitmap_or(const embedding_bitmap_t *a, const embedding_bitmap_t *b);
+
+/* returns non-zero to keep row id */
+typedef int (*embedding_row_predicate_cb)(void *arg, size_t id);
+
+/* Rows a filtered scan may return: those set in rows (NULL: every row) that
+ * match also accepts (NULL: all of them).  Deleted rows never pass.
+ */
+typedef struct {
+    const embedding_bitmap_t *rows;
+    embedding_row_predicate_cb match;
+    void *arg;
+} embedding_filter_t;
+
+#endif // _embed_embedding_filter_H
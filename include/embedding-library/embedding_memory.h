@@ -0,0 +1,41 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_embedding_memory_H
+#define _embed_embedding_memory_H
+
+/* Placement of node blocks.
+ *
+ * By default every node block is its own aligned heap allocation, so a large
+ * table is spread over 4 KiB pages wherever the allocator finds them and a
+ * full scan takes a TLB miss every few rows.  A table given a memory mode
+ * instead carves its blocks out of slabs: 2 MiB-aligned anonymous mappings
+ * holding many blocks each, which the kernel can back with huge pages and,
+ * on a multi-socket host, place on chosen NUMA nodes.  Only Linux honours
+ * the huge page and NUMA bits; elsewhere slabs are plain mappings.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* memory mode bits */
+#define EMBEDDING_MEMORY_HUGEPAGES       1u  /* madvise(MADV_HUGEPAGE) each slab (THP) */
+#define EMBEDDING_MEMORY_HUGETLB         2u  /* map slabs from the hugetlbfs pool (MAP_HUGETLB),
+                                                falling back to THP if the pool is empty */
+#define EMBEDDING_MEMORY_NUMA_INTERLEAVE 4u  /* interleave every slab's pages across nodes */
+#define EMBEDDING_MEMORY_NUMA_SPREAD     8u  /* place whole slabs round-robin on the nodes,
+                                                so each node's blocks are local to it */
+
+/* Slab size: the huge page size every slab is aligned to and a multiple of. */
+#define EMBEDDING_MEMORY_SLAB_ALIGN (2u * 1024u * 1024u)
+
+/* Number of online NUMA nodes (1 where NUMA is unknown); probed once. */
+size_t embedding_numa_nodes(void);
+
+/* Write up to max of the CPU ids of NUMA node `node` to cpus; returns how many
+ * the node has (0 for an unknown node).
+ */
+size_t embedding_numa_node_cpus(size_t node, int *cpus, size_t max);
+
+#endif // _embed_embedding_memory_H
@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_embedding_rerank_H
+#define _embed_embedding_rerank_H
+
+/* Two-stage search.
+ *
+ * Stage one scans an int8 table for k * oversample candidates (a quarter of
+ * the bandwidth of a float scan); stage two re-scores only those rows against
+ * a companion float or int16 table holding the same rows under the same ids
+ * (e.g. one opened with *_mmap()), and returns the best k by the exact score.
+ * Raising oversample trades stage-two time for recall lost to int8
+ * quantization.
+ */
+
+#include "embedding-library/int8_embedding_table.h"
+#include "embedding-library/float_embedding_table.h"
+#include "embedding-library/int16_embedding_table.h"
+#include "embedding-library/thread_pool.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define EMBEDDING_RERANK_DEFAULT_OVERSAMPLE 4
+
+/* Where the time of one search went */
+typedef struct {
+    size_t candidates;     /* rows returned by the int8 scan and re-scored */
+    uint64_t scan_ns;      /* stage one: int8 top-(k * oversample) */
+    uint64_t rerank_ns;    /* stage two: exact scores and final top-k */
+} embedding_rerank_stats_t;
+
+/* Search coarse for k * oversample candidates (oversample 0 means
+ * EMBEDDING_RERANK_DEFAULT_OVERSAMPLE), split across pool (may be NULL), then
+ * re-score them against fine.  query8 is the int8 form of query; pass NULL to
+ * have it quantized with int8_from_floats_dispatch().  A query_norm < 0.0 is
+ * recomputed.  Writes at most k results, best first, to out_ids / out_scores
+ * (either may be NULL) and the stage timings to stats (may be NULL).
+ * returns the number of results; 0 if the tables' dims differ
+ */
+size_t embedding_rerank_float(int8_embedding_table_t *coarse, float_embedding_table_t *fine,
+                              embedding_thread_pool_t *pool,
+                              const float *query, double query_norm, const int8_t *query8,
+                              size_t k, size_t oversample,
+                              size_t *out_ids, double *out_scores,
+                              embedding_rerank_stats_t *stats);
+
+/* embedding_rerank_float() against an int16 table; a NULL query8 is derived
+ * with int8_from_int16s_dispatch()
+ */
+size_t embedding_rerank_int16(int8_embedding_table_t *coarse, int16_embedding_table_t *fine,
+                              embedding_thread_pool_t *pool,
+                              const int16_t *query, double query_norm, const int8_t *query8,
+                              size_t k, size_t oversample,
+                              size_t *out_ids, double *out_scores,
+                              embedding_rerank_stats_t *stats);
+
+#endif // _embed_embedding_rerank_H
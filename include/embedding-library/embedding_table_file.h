@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_embedding_table_file_H
+#define _embed_embedding_table_file_H
+
+/* On-disk format shared by the int8, int16 and float tables (host byte order):
+ *   [4 KiB header: magic "I8EMBTBL", version, element type, dim, node
+ *                  capacity, rows, node layout, CRC table offset, table id,
+ *                  write generation, CRC32C of the header]
+ *   [node 0][node 1]...   each node is the in-memory block verbatim:
+ *                         [512 norms | per-row extras | 512 * dim elements],
+ *                         padded to whole pages (260 KiB = 65 pages for
+ *                         512-dim int8 without extras)
+ *   [uint32 CRC32C per node block]
+ *   [optional channel section: dim float scales, dim float zero points]
+ *   [optional deleted section: 8 uint64 tombstone words per node]
+ * Every node, including a partially filled last node, occupies a full block,
+ * so node i starts at a page-aligned offset and can be mapped in place.
+ * Version 3 adds the layout bits (EMBEDDING_TABLE_LAYOUT_*, which also set the
+ * width of the norms: double, float 1/norm or none) and the channel section.
+ * Version 4 adds the deleted section (int8 tables with deleted rows), with
+ * its own CRC32C.  Version 5 adds the table id: a table gets a new one when
+ * it is created (compaction creates one) and keeps its file's when it is
+ * loaded.  Version 6, which every file is now written as, adds the write
+ * generation, new on every serialize; a table remembers the generation it
+ * last wrote or loaded.  Loaders refuse files whose version, element type,
+ * dimension or layout they do not know.
+ *
+ * serialize() is incremental: if the file still holds the commit the table
+ * last wrote or loaded (same table id and generation), its rows are a prefix
+ * of the table's, so they are kept and only the last partial node onwards is
+ * rewritten, whole blocks at a time with one pwritev() per 16 nodes, then
+ * the CRC table, the channel and deleted sections and, after an fsync, the
+ * header.  What the rewrite overwrites (the old last node and trailer) is
+ * first saved to <file>.journal and synced, so a crash mid-write is rolled
+ * back to the last commit by the next serialize() or load instead of
+ * forcing a full rewrite.
+ * Any other file (another table's, an older version's, or one a second copy
+ * of the table loaded from the same file has since written) is written to
+ * <file>.tmp and renamed over the old one.  Writers hold an exclusive
+ * flock() on the file and deserialize(), mmap() and verify() a shared one
+ * while they read it, so a reader never sees a commit half done.
+ * deserialize() reads up to 16 nodes per syscall straight into their blocks
+ * and rejects the file if a block fails its CRC or holds a norm that is not
+ * positive and finite.  int8 tables also read version 1 files (no checksums)
+ * and the older headerless [double | 512 int8] record format; both are
+ * rewritten as version 6 on the next serialize.
+ */
+
+#include "embedding-library/thread_pool.h"
+#include <stdint.h>
+
+/* Table layout bits: how the per-row data ahead of the rows in each node
+ * block is stored.  Without any, a row has a double norm (8 bytes).
+ */
+#define EMBEDDING_TABLE_LAYOUT_ROW_SCALES 1u  /* float per row: dequantization scale */
+#define EMBEDDING_TABLE_LAYOUT_INV_NORMS  2u  /* float 1/norm per row instead of the
+                                                 double norm: half the metadata and
+                                                 no divide in the scan */
+#define EMBEDDING_TABLE_LAYOUT_NORMALIZED 4u  /* float tables: rows are stored at unit
+                                                 length and no norm is kept, so cosine
+                                                 is the dot product */
+
+/* *_mmap() flags */
+#define EMBEDDING_TABLE_MMAP_POPULATE   1u  /* prefault the whole file (MAP_POPULATE) */
+#define EMBEDDING_TABLE_MMAP_SEQUENTIAL 2u  /* madvise(MADV_SEQUENTIAL): scan-heavy use */
+#define EMBEDDING_TABLE_MMAP_RANDOM     4u  /* madvise(MADV_RANDOM): point lookups */
+#define EMBEDDING_TABLE_MMAP_WILLNEED   8u  /* madvise(MADV_WILLNEED): start readahead now */
+#define EMBEDDING_TABLE_MMAP_VERIFY    16u  /* check every block's CRC (reads the whole file) */
+
+/* Check a serialized table of any element type: its header and every node
+ * block against its CRC32C, with the blocks split across pool (may be NULL).
+ * Version 1 files only get the header checks.
+ * returns 0 if the file is intact, -1 otherwise
+ */
+int embedding_table_verify(const char *filename, embedding_thread_pool_t *pool);
+
+#endif // _embed_embedding_table_file_H
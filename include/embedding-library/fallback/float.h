@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <math.h>
 
 static inline float dot_product_scalar(const float *a, const float *b, size_t size) {
     float result = 0.0f;
@@ -16,4 +17,14 @@ static inline float dot_product_scalar(const float *a, const float *b, size_t si
     return result;
 }
 
+/* largest |v[i]|, 0.0f when size == 0 (inputs must be finite) */
+static inline float float_max_abs_scalar(const float *v, size_t size) {
+    float max_abs = 0.0f;
+    for (size_t i = 0; i < size; ++i) {
+        float a = fabsf(v[i]);
+        if (a > max_abs) max_abs = a;
+    }
+    return max_abs;
+}
+
 #endif // _embed_fallback_float_H
@@ -0,0 +1,45 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_fallback_int16_H
+#define _embed_fallback_int16_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "embedding-library/fallback/float.h"
+
+static inline int64_t int16_dot_product_scalar(const int16_t *a, const int16_t *b, size_t size) {
+    int64_t result = 0;
+    for (size_t i = 0; i < size; ++i) {
+        result += (int32_t)a[i] * (int32_t)b[i];
+    }
+    return result;
+}
+
+/* out[i] = clamp(roundf(in[i] * s), -32768, 32767) */
+static inline void int16_scale_floats_scalar(const float *input, size_t size, float s,
+                                             int16_t *output) {
+    for (size_t i = 0; i < size; ++i) {
+        float x = roundf(input[i] * s);
+        if (x >  32767.0f) x =  32767.0f;
+        if (x < -32768.0f) x = -32768.0f;
+        output[i] = (int16_t)x;
+    }
+}
+
+static inline void int16_from_floats_scalar(const float *input, size_t size, int16_t *output) {
+    float max_abs = float_max_abs_scalar(input, size);
+    if (max_abs == 0.0f) max_abs = 1.0f;
+    int16_scale_floats_scalar(input, size, 32767.0f / max_abs, output);
+}
+
+static inline void int16_to_floats_scalar(const int16_t *input, size_t size, float *output,
+                                          float scale_factor) {
+    for (size_t i = 0; i < size; ++i) {
+        output[i] = input[i] / scale_factor;
+    }
+}
+
+#endif /* _embed_fallback_int16_H */
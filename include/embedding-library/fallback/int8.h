@@ -7,6 +7,8 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <math.h>
+#include "embedding-library/fallback/float.h"
 
 static inline int32_t int8_dot_product_scalar(const int8_t *a, const int8_t *b, size_t size) {
     int32_t result = 0;
@@ -16,4 +18,48 @@ static inline int32_t int8_dot_product_scalar(const int8_t *a, const int8_t *b,
     return result;
 }
 
+/* Score one query against `nrows` consecutive rows of `size` elements each */
+static inline void int8_dot_product_rows_scalar(const int8_t *q, const int8_t *rows,
+                                                size_t nrows, size_t size, int32_t *out) {
+    for (size_t r = 0; r < nrows; ++r) {
+        out[r] = int8_dot_product_scalar(q, rows + r * size, size);
+    }
+}
+
+/* Quantization reference kernels; the SIMD versions match them bit for bit.
+ * out[i] = clamp(roundf(in[i] * s), -128, 127)
+ */
+static inline void int8_scale_floats_scalar(const float *input, size_t size, float s,
+                                            int8_t *output) {
+    for (size_t i = 0; i < size; ++i) {
+        float x = roundf(input[i] * s);
+        if (x >  127.0f) x =  127.0f;
+        if (x < -128.0f) x = -128.0f;
+        output[i] = (int8_t)x;
+    }
+}
+
+static inline void int8_from_floats_scalar(const float *input, size_t size, int8_t *output) {
+    float max_abs = float_max_abs_scalar(input, size);
+    if (max_abs == 0.0f) max_abs = 1.0f;
+    int8_scale_floats_scalar(input, size, 127.0f / max_abs, output);
+}
+
+static inline void int8_from_int16s_scalar(const int16_t *input, size_t size, int8_t *output) {
+    const float s = 127.0f / 32767.0f;
+    for (size_t i = 0; i < size; ++i) {
+        float x = roundf(input[i] * s);
+        if (x >  127.0f) x =  127.0f;
+        if (x < -128.0f) x = -128.0f;
+        output[i] = (int8_t)x;
+    }
+}
+
+static inline void int8_to_floats_scalar(const int8_t *input, size_t size, float *output,
+                                         float scale_factor) {
+    for (size_t i = 0; i < size; ++i) {
+        output[i] = input[i] / scale_factor;
+    }
+}
+
 #endif /* _embed_fallback_int8_H */
@@ -5,12 +5,14 @@
 #ifndef _embed_float_H
 #define _embed_float_H
 
-#if defined(__AVX512F__) || defined(__AVX__)
+/* The scalar kernels are always available (reference + last resort); SIMD
+ * kernels come from the header for the target architecture.
+ */
+#include "embedding-library/fallback/float.h"
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
 #include "embedding-library/x86/float.h"
 #elif defined(__ARM_NEON)
 #include "embedding-library/arm/float.h"
-#else
-#include "embedding-library/fallback/float.h"
 #endif
 
 #include <stdint.h>
@@ -19,7 +21,9 @@
 
 /* Generic dot product – pick an implementation ONLY if it was compiled in */
 static inline float dot_product(const float *a, const float *b, size_t size) {
-#if defined(__AVX512F__) || defined(__AVX__)
+#if defined(__AVX512F__)
+    return dot_product_avx512(a, b, size);
+#elif defined(__AVX__)
     return dot_product_avx(a, b, size);
 #elif defined(__ARM_NEON)
     return dot_product_neon(a, b, size);
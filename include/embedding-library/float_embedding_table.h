@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_float_embedding_table_H
+#define _embed_float_embedding_table_H
+
+/* Full-precision counterpart of int8_embedding_table.h: the same 512-row
+ * nodes (norms, then contiguous rows), append, norm caching, top-k scans and
+ * file format, with float rows scored by dot_product().
+ */
+
+#include "embedding-library/float.h"
+#include "embedding-library/thread_pool.h"
+#include "embedding-library/embedding_table_file.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h> /* ssize_t */
+
+/* node flags */
+#define FLOAT_EMBEDDING_NODE_MAPPED 1u   /* block points into a read-only file mapping */
+
+struct float_embedding_node_s {
+    float *data;
+    double *norms;      /* NULL with the INV_NORMS and NORMALIZED layouts */
+    float *inv_norms;   /* 1/norm per row with EMBEDDING_TABLE_LAYOUT_INV_NORMS, else NULL */
+    void *block;        /* start of the node's block */
+    uint32_t size;
+    uint32_t flags;
+};
+typedef struct float_embedding_node_s float_embedding_node_t;
+
+struct float_embedding_table_s {
+    float_embedding_node_t **table;
+    size_t size;
+    size_t index;
+    size_t dim;         /* floats per embedding */
+    size_t node_bytes;  /* bytes in one node block */
+    void *map;          /* file mapping backing MAPPED nodes (or NULL) */
+    size_t map_size;
+    uint64_t table_id;  /* identity recorded in its file (see embedding_table_file.h) */
+    uint64_t file_generation;  /* commit of the file it last wrote or loaded */
+    uint32_t layout;    /* EMBEDDING_TABLE_LAYOUT_* bits */
+};
+typedef struct float_embedding_table_s float_embedding_table_t;
+
+/* If norm < 0.0 it is computed from the embedding.  returns the row id, or -1
+ * if the norm is 0.0 (or on allocation failure).  A NORMALIZED table stores
+ * embedding / norm.
+ */
+ssize_t float_embedding_table_add_embedding(float_embedding_table_t *t, const float *embedding,
+                                            double norm);
+
+/* A table of dim-float embeddings (1..65536); NULL for an unsupported dim.
+ * size is the initial node array capacity; 0 grows it as nodes are added.
+ */
+float_embedding_table_t *float_embedding_table_init(size_t dim, size_t size);
+
+/* init() with a different per-row layout: EMBEDDING_TABLE_LAYOUT_INV_NORMS
+ * (float 1/norm per row) or EMBEDDING_TABLE_LAYOUT_NORMALIZED (unit-length
+ * rows, no per-row data, cosine is the dot product).  NULL for other bits.
+ */
+float_embedding_table_t *float_embedding_table_init_layout(size_t dim, size_t size,
+                                                           uint32_t layout);
+void float_embedding_table_destroy(float_embedding_table_t *t);
+
+static inline
+size_t float_embedding_table_dim(const float_embedding_table_t *t) {
+    return t->dim;
+}
+
+static inline
+size_t float_embedding_table_size(float_embedding_table_t *t) {
+    if (t->index == 0) return 0;
+    return ((t->index - 1) << 9) + t->table[t->index - 1]->size;
+}
+
+static inline
+double float_embedding_table_norm(float_embedding_table_t *t, size_t index) {
+    size_t node_index = index >> 9; // /512
+    size_t offset     = index & 0x1FF; // %512
+    if (node_index >= t->index) return 0.0;
+    const float_embedding_node_t *n = t->table[node_index];
+    if (n->norms) return n->norms[offset];
+    return n->inv_norms ? 1.0 / n->inv_norms[offset] : 1.0;
+}
+
+/* memory one row takes in the table's nodes; see int8_embedding_table_bytes_per_row() */
+static inline
+double float_embedding_table_bytes_per_row(const float_embedding_table_t *t) {
+    return (double)t->node_bytes / 512.0;
+}
+
+static inline
+float *float_embedding_table_embedding(float_embedding_table_t *t, size_t index) {
+    size_t node_index = index >> 9; // /512
+    size_t offset     = index & 0x1FF; // %512
+    if (node_index >= t->index) return NULL;
+    return t->table[node_index]->data + (offset * t->dim);
+}
+
+static inline
+double float_embedding_table_cosine_similarity(float_embedding_table_t *t,
+                                               size_t indexA, size_t indexB) {
+    double normA = float_embedding_table_norm(t, indexA);
+    double normB = float_embedding_table_norm(t, indexB);
+    if (normA == 0.0 || normB == 0.0) return 0.0;
+    double dp = dot_product(float_embedding_table_embedding(t, indexA),
+                            float_embedding_table_embedding(t, indexB), t->dim);
+    if (t->layout & EMBEDDING_TABLE_LAYOUT_NORMALIZED) return dp;
+    return dp / (normA * normB);
+}
+
+/* Brute-force k nearest neighbours by cosine similarity, best first; see
+ * int8_embedding_table_topk().  If query_norm < 0.0 it is recomputed.
+ */
+size_t float_embedding_table_topk(float_embedding_table_t *t,
+                                  const float *query, double query_norm,
+                                  size_t k, size_t *out_ids, double *out_scores);
+
+/* float_embedding_table_topk() split across pool (may be NULL) */
+size_t float_embedding_table_topk_parallel(float_embedding_table_t *t,
+                                           embedding_thread_pool_t *pool,
+                                           const float *query, double query_norm,
+                                           size_t k, size_t *out_ids, double *out_scores);
+
+/* Files use the shared table format, see embedding-library/embedding_table_file.h */
+void float_embedding_table_serialize(float_embedding_table_t *t, const char *filename);
+float_embedding_table_t *float_embedding_table_deserialize(const char *filename);
+float_embedding_table_t *float_embedding_table_deserialize_parallel(const char *filename,
+                                                                    embedding_thread_pool_t *pool);
+
+/* Map a serialized table read-only (EMBEDDING_TABLE_MMAP_* flags); see
+ * int8_embedding_table_mmap()
+ */
+float_embedding_table_t *float_embedding_table_mmap(const char *filename, uint32_t flags);
+
+#endif // _embed_float_embedding_table_H
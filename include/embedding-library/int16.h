@@ -5,35 +5,73 @@
 #ifndef _embed_int16_H
 #define _embed_int16_H
 
+#include "embedding-library/fallback/int16.h"  /* always: reference kernels */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include "embedding-library/x86/int16.h"
+#elif defined(__ARM_NEON)
+#include "embedding-library/arm/int16.h"
+#endif
+
 #include <stdint.h>
 #include <stddef.h>
 #include <math.h>
 
-/* Quantize float -> int16 with clamping */
+/* Quantize float -> int16 with clamping (scale 32767 / max|input|, roundf()
+ * rounding; the SIMD kernels match int16_from_floats_scalar() exactly)
+ */
 static inline
 void int16_from_floats(const float *input, size_t num_floats, int16_t *output) {
-    float max_abs = 0.0f;
-    for (size_t i = 0; i < num_floats; ++i) {
-        float v = fabsf(input[i]);
-        if (v > max_abs) max_abs = v;
-    }
-    if (max_abs == 0.0f) max_abs = 1.0f;
-
-    const float s = 32767.0f / max_abs;
-    for (size_t i = 0; i < num_floats; ++i) {
-        float x = roundf(input[i] * s);
-        if (x >  32767.0f) x =  32767.0f;
-        if (x < -32768.0f) x = -32768.0f;
-        output[i] = (int16_t)x;
-    }
+#if defined(__AVX512F__)
+    int16_from_floats_avx512(input, num_floats, output);
+#elif defined(__AVX2__)
+    int16_from_floats_avx(input, num_floats, output);
+#elif defined(__ARM_NEON)
+    int16_from_floats_neon(input, num_floats, output);
+#else
+    int16_from_floats_scalar(input, num_floats, output);
+#endif
 }
 
 /* Dequantize int16 -> float with provided scale */
 static inline
 void int16_to_floats(const int16_t *input, size_t num_floats, float *output, float scale_factor) {
-    for (size_t i = 0; i < num_floats; ++i) {
-        output[i] = input[i] / scale_factor;
-    }
+#if defined(__AVX512F__)
+    int16_to_floats_avx512(input, num_floats, output, scale_factor);
+#elif defined(__AVX2__)
+    int16_to_floats_avx(input, num_floats, output, scale_factor);
+#elif defined(__ARM_NEON)
+    int16_to_floats_neon(input, num_floats, output, scale_factor);
+#else
+    int16_to_floats_scalar(input, num_floats, output, scale_factor);
+#endif
+}
+
+/* Signed 16-bit dot product: choose the best compiled-in backend.
+ * The SIMD kernels add two products in an int32 lane first, so inputs must
+ * stay within [-32767, 32767] (as int16_from_floats() produces).
+ */
+static inline
+int64_t int16_dot_product(const int16_t *embeddingA, const int16_t *embeddingB, size_t embedding_size) {
+#if defined(__AVX512F__) && defined(__AVX512BW__)
+    return int16_dot_product_avx512(embeddingA, embeddingB, embedding_size);
+#elif defined(__AVX2__)
+    return int16_dot_product_avx(embeddingA, embeddingB, embedding_size);
+#elif defined(__ARM_NEON)
+    return int16_dot_product_neon(embeddingA, embeddingB, embedding_size);
+#else
+    return int16_dot_product_scalar(embeddingA, embeddingB, embedding_size);
+#endif
+}
+
+/* Cosine similarity helper */
+static inline
+double int16_cosine_similarity(const int16_t *embeddingA, double normA,
+                               const int16_t *embeddingB, double normB,
+                               size_t embedding_size) {
+    double denom = normA * normB;
+    if (denom == 0.0) return 0.0;
+    int64_t dp = int16_dot_product(embeddingA, embeddingB, embedding_size);
+    return (double)dp / denom;
 }
 
 #endif // _embed_int16_H
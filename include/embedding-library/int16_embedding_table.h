@@ -0,0 +1,125 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_int16_embedding_table_H
+#define _embed_int16_embedding_table_H
+
+/* 16-bit counterpart of int8_embedding_table.h: the same 512-row nodes,
+ * append, norm caching, top-k scans and file format, with int16 rows scored
+ * by int16_dot_product().  Elements must lie in [-32767, 32767] (see
+ * int16_from_floats()).
+ */
+
+#include "embedding-library/int16.h"
+#include "embedding-library/thread_pool.h"
+#include "embedding-library/embedding_table_file.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h> /* ssize_t */
+
+/* node flags */
+#define INT16_EMBEDDING_NODE_MAPPED 1u   /* block points into a read-only file mapping */
+
+struct int16_embedding_node_s {
+    int16_t *data;
+    double *norms;
+    uint32_t size;
+    uint32_t flags;
+};
+typedef struct int16_embedding_node_s int16_embedding_node_t;
+
+struct int16_embedding_table_s {
+    int16_embedding_node_t **table;
+    size_t size;
+    size_t index;
+    size_t dim;         /* int16 elements per embedding */
+    size_t node_bytes;  /* bytes in one node block */
+    void *map;          /* file mapping backing MAPPED nodes (or NULL) */
+    size_t map_size;
+    uint64_t table_id;  /* identity recorded in its file (see embedding_table_file.h) */
+    uint64_t file_generation;  /* commit of the file it last wrote or loaded */
+};
+typedef struct int16_embedding_table_s int16_embedding_table_t;
+
+/* If norm < 0.0 it is computed from the embedding.  returns the row id, or -1
+ * if the norm is 0.0 (or on allocation failure)
+ */
+ssize_t int16_embedding_table_add_embedding(int16_embedding_table_t *t, const int16_t *embedding,
+                                            double norm);
+
+/* A table of dim-element int16 embeddings (1..65536); NULL for an unsupported dim.
+ * size is the initial node array capacity; 0 grows it as nodes are added.
+ */
+int16_embedding_table_t *int16_embedding_table_init(size_t dim, size_t size);
+void int16_embedding_table_destroy(int16_embedding_table_t *t);
+
+static inline
+size_t int16_embedding_table_dim(const int16_embedding_table_t *t) {
+    return t->dim;
+}
+
+static inline
+size_t int16_embedding_table_size(int16_embedding_table_t *t) {
+    if (t->index == 0) return 0;
+    return ((t->index - 1) << 9) + t->table[t->index - 1]->size;
+}
+
+static inline
+double int16_embedding_table_norm(int16_embedding_table_t *t, size_t index) {
+    size_t node_index = index >> 9; // /512
+    size_t offset     = index & 0x1FF; // %512
+    if (node_index >= t->index) return 0.0;
+    return t->table[node_index]->norms[offset];
+}
+
+/* memory one row takes in the table's nodes; see int8_embedding_table_bytes_per_row() */
+static inline
+double int16_embedding_table_bytes_per_row(const int16_embedding_table_t *t) {
+    return (double)t->node_bytes / 512.0;
+}
+
+static inline
+int16_t *int16_embedding_table_embedding(int16_embedding_table_t *t, size_t index) {
+    size_t node_index = index >> 9; // /512
+    size_t offset     = index & 0x1FF; // %512
+    if (node_index >= t->index) return NULL;
+    return t->table[node_index]->data + (offset * t->dim);
+}
+
+static inline
+double int16_embedding_table_cosine_similarity(int16_embedding_table_t *t,
+                                               size_t indexA, size_t indexB) {
+    double normA = int16_embedding_table_norm(t, indexA);
+    double normB = int16_embedding_table_norm(t, indexB);
+    if (normA == 0.0 || normB == 0.0) return 0.0;
+    double dp = (double)int16_dot_product(int16_embedding_table_embedding(t, indexA),
+                            int16_embedding_table_embedding(t, indexB), t->dim);
+    return dp / (normA * normB);
+}
+
+/* Brute-force k nearest neighbours by cosine similarity, best first; see
+ * int8_embedding_table_topk().  If query_norm < 0.0 it is recomputed.
+ */
+size_t int16_embedding_table_topk(int16_embedding_table_t *t,
+                                  const int16_t *query, double query_norm,
+                                  size_t k, size_t *out_ids, double *out_scores);
+
+/* int16_embedding_table_topk() split across pool (may be NULL) */
+size_t int16_embedding_table_topk_parallel(int16_embedding_table_t *t,
+                                           embedding_thread_pool_t *pool,
+                                           const int16_t *query, double query_norm,
+                                           size_t k, size_t *out_ids, double *out_scores);
+
+/* Files use the shared table format, see embedding-library/embedding_table_file.h */
+void int16_embedding_table_serialize(int16_embedding_table_t *t, const char *filename);
+int16_embedding_table_t *int16_embedding_table_deserialize(const char *filename);
+int16_embedding_table_t *int16_embedding_table_deserialize_parallel(const char *filename,
+                                                                    embedding_thread_pool_t *pool);
+
+/* Map a serialized table read-only (EMBEDDING_TABLE_MMAP_* flags); see
+ * int8_embedding_table_mmap()
+ */
+int16_embedding_table_t *int16_embedding_table_mmap(const char *filename, uint32_t flags);
+
+#endif // _embed_int16_embedding_table_H
@@ -5,64 +5,105 @@
 #ifndef _embed_int8_H
 #define _embed_int8_H
 
-#if defined(__AVX512F__) || defined(__AVX2__)
+#include "embedding-library/fallback/int8.h"  /* always: reference kernels */
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
 #include "embedding-library/x86/int8.h"
 #elif defined(__ARM_NEON)
 #include "embedding-library/arm/int8.h"
-#else
-#include "embedding-library/fallback/int8.h"
 #endif
 
 #include <stdint.h>
 #include <stddef.h>
 #include <math.h>
 
-/* Quantize float -> int8 with clamping */
+/* Quantize float -> int8 with clamping: each value is scaled by
+ * 127 / max|input| and rounded half away from zero (roundf()).  The SIMD
+ * kernels give the same bytes as int8_from_floats_scalar().
+ */
 static inline
 void int8_from_floats(const float *input, size_t num_floats, int8_t *output) {
-    float max_abs = 0.0f;
-    for (size_t i = 0; i < num_floats; ++i) {
-        float v = fabsf(input[i]);
-        if (v > max_abs) max_abs = v;
-    }
-    if (max_abs == 0.0f) max_abs = 1.0f;
+#if defined(__AVX512F__)
+    int8_from_floats_avx512(input, num_floats, output);
+#elif defined(__AVX2__)
+    int8_from_floats_avx(input, num_floats, output);
+#elif defined(__ARM_NEON)
+    int8_from_floats_neon(input, num_floats, output);
+#else
+    int8_from_floats_scalar(input, num_floats, output);
+#endif
+}
 
-    const float s = 127.0f / max_abs;
-    for (size_t i = 0; i < num_floats; ++i) {
-        float x = roundf(input[i] * s);
-        if (x >  127.0f) x =  127.0f;
-        if (x < -128.0f) x = -128.0f;
-        output[i] = (int8_t)x;
-    }
+/* int8_from_floats() that also returns the row's dequantization scale,
+ * max|input| / 127, so input[i] ~= output[i] * scale.  Keep it with the row
+ * to recover float magnitudes (see int8_scaled_dot_product()).
+ */
+static inline
+float int8_from_floats_scaled(const float *input, size_t num_floats, int8_t *output) {
+#if defined(__AVX512F__)
+    float max_abs = float_max_abs_avx512(input, num_floats);
+#elif defined(__AVX2__)
+    float max_abs = float_max_abs_avx(input, num_floats);
+#elif defined(__ARM_NEON)
+    float max_abs = float_max_abs_neon(input, num_floats);
+#else
+    float max_abs = float_max_abs_scalar(input, num_floats);
+#endif
+    if (max_abs == 0.0f) max_abs = 1.0f;
+#if defined(__AVX512F__)
+    int8_scale_floats_avx512(input, num_floats, 127.0f / max_abs, output);
+#elif defined(__AVX2__)
+    int8_scale_floats_avx(input, num_floats, 127.0f / max_abs, output);
+#elif defined(__ARM_NEON)
+    int8_scale_floats_neon(input, num_floats, 127.0f / max_abs, output);
+#else
+    int8_scale_floats_scalar(input, num_floats, 127.0f / max_abs, output);
+#endif
+    return max_abs / 127.0f;
 }
 
 /* Assume input was already scaled to int16 range; convert to int8 with clamping */
 static inline
 void int8_from_int16s(const int16_t *input, size_t num_values, int8_t *output) {
-    const float s = 127.0f / 32767.0f;
-    for (size_t i = 0; i < num_values; ++i) {
-        float x = roundf(input[i] * s);
-        if (x >  127.0f) x =  127.0f;
-        if (x < -128.0f) x = -128.0f;
-        output[i] = (int8_t)x;
-    }
+#if defined(__AVX512F__)
+    int8_from_int16s_avx512(input, num_values, output);
+#elif defined(__AVX2__)
+    int8_from_int16s_avx(input, num_values, output);
+#elif defined(__ARM_NEON)
+    int8_from_int16s_neon(input, num_values, output);
+#else
+    int8_from_int16s_scalar(input, num_values, output);
+#endif
 }
 
 /* Dequantize int8 -> float with provided scale */
 static inline
 void int8_to_floats(const int8_t *input, size_t num_floats, float *output, float scale_factor) {
-    for (size_t i = 0; i < num_floats; ++i) {
-        output[i] = input[i] / scale_factor;
-    }
+#if defined(__AVX512F__)
+    int8_to_floats_avx512(input, num_floats, output, scale_factor);
+#elif defined(__AVX2__)
+    int8_to_floats_avx(input, num_floats, output, scale_factor);
+#elif defined(__ARM_NEON)
+    int8_to_floats_neon(input, num_floats, output, scale_factor);
+#else
+    int8_to_floats_scalar(input, num_floats, output, scale_factor);
+#endif
 }
 
 /* Signed 8-bit dot product: choose the best compiled-in backend */
 static inline
 int32_t int8_dot_product(const int8_t *embeddingA, const int8_t *embeddingB, size_t embedding_size) {
-#if defined(__AVX512F__) && defined(__AVX512BW__)
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VNNI__)
+    return int8_dot_product_avx512_vnni(embeddingA, embeddingB, embedding_size);
+#elif defined(__AVX512F__) && defined(__AVX512BW__)
     return int8_dot_product_avx512(embeddingA, embeddingB, embedding_size);
+#elif defined(__AVX2__) && defined(__AVXVNNI__)
+    return int8_dot_product_avx_vnni(embeddingA, embeddingB, embedding_size);
 #elif defined(__AVX2__)
     return int8_dot_product_avx(embeddingA, embeddingB, embedding_size);
+#elif defined(__ARM_FEATURE_SVE)
+    return int8_dot_product_sve(embeddingA, embeddingB, embedding_size);
+#elif defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    return int8_dot_product_neon_dotprod(embeddingA, embeddingB, embedding_size);
 #elif defined(__ARM_NEON)
     return int8_dot_product_neon(embeddingA, embeddingB, embedding_size);
 #else
@@ -70,6 +111,78 @@ int32_t int8_dot_product(const int8_t *embeddingA, const int8_t *embeddingB, siz
 #endif
 }
 
+/* Score one query against `nrows` consecutive rows of `embedding_size` elements,
+ * writing one dot product per row into `out`.  Equivalent to calling
+ * int8_dot_product() per row, but the query stays hot across rows.
+ */
+static inline
+void int8_dot_product_rows(const int8_t *query, const int8_t *rows, size_t nrows,
+                           size_t embedding_size, int32_t *out) {
+#if defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VNNI__)
+    int8_dot_product_rows_avx512_vnni(query, rows, nrows, embedding_size, out);
+#elif defined(__AVX512F__) && defined(__AVX512BW__)
+    int8_dot_product_rows_avx512(query, rows, nrows, embedding_size, out);
+#elif defined(__AVX2__) && defined(__AVXVNNI__)
+    int8_dot_product_rows_avx_vnni(query, rows, nrows, embedding_size, out);
+#elif defined(__AVX2__)
+    int8_dot_product_rows_avx(query, rows, nrows, embedding_size, out);
+#elif defined(__ARM_FEATURE_SVE)
+    int8_dot_product_rows_sve(query, rows, nrows, embedding_size, out);
+#elif defined(__ARM_NEON) && defined(__ARM_FEATURE_DOTPROD)
+    int8_dot_product_rows_neon_dotprod(query, rows, nrows, embedding_size, out);
+#elif defined(__ARM_NEON)
+    int8_dot_product_rows_neon(query, rows, nrows, embedding_size, out);
+#else
+    int8_dot_product_rows_scalar(query, rows, nrows, embedding_size, out);
+#endif
+}
+
+/* int8_dot_product_matrix() with the rows kernel passed in, e.g. one picked
+ * at runtime by embedding_int8_rows_kernel() (dispatch.h).
+ */
+static inline
+void int8_dot_product_matrix_with(void (*rows_kernel)(const int8_t *query, const int8_t *rows,
+                                                      size_t nrows, size_t size, int32_t *out),
+                                  const int8_t *queries, size_t nqueries,
+                                  const int8_t *rows, size_t nrows,
+                                  size_t embedding_size, int32_t *out) {
+    /* a multiple of 4 rows, so tiles stay on the 4-row path of the kernels */
+    size_t tile = embedding_size ? (16384 / embedding_size) & ~(size_t)3 : nrows;
+    if (tile < 4) tile = 4;
+    for (size_t r = 0; r < nrows; r += tile) {
+        size_t m = (nrows - r < tile) ? nrows - r : tile;
+        const int8_t *block = rows + r * embedding_size;
+        for (size_t q = 0; q < nqueries; ++q) {
+            rows_kernel(queries + q * embedding_size, block, m,
+                        embedding_size, out + q * nrows + r);
+        }
+    }
+}
+
+/* Score a block of queries against a block of rows, GEMM-style:
+ * out[q * nrows + r] = dot(queries[q], rows[r]).
+ * Rows are processed in tiles small enough to stay in L1 while every query is
+ * run against them, so each row is read from memory once per call rather than
+ * once per query.
+ */
+static inline
+void int8_dot_product_matrix(const int8_t *queries, size_t nqueries,
+                             const int8_t *rows, size_t nrows,
+                             size_t embedding_size, int32_t *out) {
+    int8_dot_product_matrix_with(int8_dot_product_rows, queries, nqueries, rows, nrows,
+                                 embedding_size, out);
+}
+
+/* Approximate float inner product of two rows quantized with
+ * int8_from_floats_scaled(): the exact int8 dot product times both scales.
+ */
+static inline
+float int8_scaled_dot_product(const int8_t *embeddingA, float scaleA,
+                              const int8_t *embeddingB, float scaleB,
+                              size_t embedding_size) {
+    return (float)int8_dot_product(embeddingA, embeddingB, embedding_size) * (scaleA * scaleB);
+}
+
 /* Cosine similarity helper */
 static inline
 float int8_cosine_similarity(const int8_t *embeddingA, float normA,
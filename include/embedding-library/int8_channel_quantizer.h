@@ -0,0 +1,59 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_int8_channel_quantizer_H
+#define _embed_int8_channel_quantizer_H
+
+/* Asymmetric per-dimension (per-channel) int8 quantization.
+ *
+ * int8_from_floats() uses one symmetric scale for a whole row, so dimensions
+ * with a small or off-centre range get only a few of the 256 codes.  A
+ * channel quantizer is trained on a sample of rows and maps each dimension's
+ * [min, max] onto [-128, 127]:
+ *
+ *   code[j] = clamp(roundf(x[j] / scale[j] + zero_point[j]), -128, 127)
+ *   x[j]   ~= (code[j] - zero_point[j]) * scale[j]
+ *
+ * The inner product with a float query q is then
+ *   sum_j q[j] * scale[j] * (code[j] - zero_point[j])
+ * which int8_embedding_table_topk_ip() evaluates with the int8 kernels after
+ * folding scale[] into the query (see int8_channel_quantizer_query()).
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct int8_channel_quantizer_s {
+    size_t dim;
+    float *scale;        /* dim entries */
+    float *zero_point;   /* dim entries, directly behind scale */
+};
+typedef struct int8_channel_quantizer_s int8_channel_quantizer_t;
+
+/* Train from `rows` sample rows of dim floats laid out back to back (each
+ * dimension's min and max).  Returns NULL on failure or if rows or dim is 0.
+ */
+int8_channel_quantizer_t *int8_channel_quantizer_train(const float *sample, size_t rows,
+                                                       size_t dim);
+
+/* A quantizer from known parameters (copied).  returns NULL on failure */
+int8_channel_quantizer_t *int8_channel_quantizer_init(size_t dim, const float *scale,
+                                                      const float *zero_point);
+
+void int8_channel_quantizer_destroy(int8_channel_quantizer_t *q);
+
+/* Quantize / dequantize one row of q->dim values. */
+void int8_channel_quantizer_encode(const int8_channel_quantizer_t *q, const float *input,
+                                   int8_t *output);
+void int8_channel_quantizer_decode(const int8_channel_quantizer_t *q, const int8_t *input,
+                                   float *output);
+
+/* Fold the scales into a float query: output[j] = query[j] * scale[j].  The
+ * inner product of query with a decoded row is then
+ *   dot(output, code) - sum_j output[j] * zero_point[j].
+ */
+void int8_channel_quantizer_query(const int8_channel_quantizer_t *q, const float *query,
+                                  float *output);
+
+#endif // _embed_int8_channel_quantizer_H
@@ -6,63 +6,418 @@
 #define _embed_int8_embedding_table_H
 
 #include "embedding-library/int8.h"
+#include "embedding-library/int8_channel_quantizer.h"
+#include "embedding-library/thread_pool.h"
+#include "embedding-library/embedding_table_file.h"
+#include "embedding-library/embedding_memory.h"
+#include "embedding-library/embedding_allocator.h"
+#include "embedding-library/embedding_filter.h"
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <sys/types.h> /* ssize_t */
 
+/* node flags */
+#define INT8_EMBEDDING_NODE_MAPPED 1u   /* block points into a read-only file mapping */
+#define INT8_EMBEDDING_NODE_SLAB   2u   /* block belongs to the table's slab allocator */
+#define INT8_EMBEDDING_NODE_INLINE 4u   /* node and block are one allocation, the node first */
+
 struct int8_embedding_node_s {
     int8_t *data;
-    double *norms;
+    double *norms;      /* NULL with EMBEDDING_TABLE_LAYOUT_INV_NORMS */
+    float *inv_norms;   /* 1/norm per row with EMBEDDING_TABLE_LAYOUT_INV_NORMS, else NULL */
+    float *scales;      /* per-row dequantization scales, NULL without
+                           EMBEDDING_TABLE_LAYOUT_ROW_SCALES */
+    void *block;        /* start of the node's block */
     uint32_t size;
+    uint32_t flags;
+    uint32_t numa;      /* NUMA node of a SLAB block placed with NUMA_SPREAD, else 0 */
+    _Atomic(uint32_t) num_deleted;      /* bits set in deleted */
+    _Atomic(uint64_t) deleted[8];       /* tombstones, one bit per row (row r: word
+                                           r / 64, bit r % 64); kept beside the
+                                           block so mapped nodes can take them */
 };
 typedef struct int8_embedding_node_s int8_embedding_node_t;
 
+/* Concurrency: one thread may add rows (add_*, set_*, delete(), update())
+ * while any number of others read the table (size(), embedding(), norm(),
+ * the topk functions, serialize(), compaction steps).  Readers see the rows
+ * published when they read the row count and never look past it; the node
+ * array is replaced rather than moved when it grows, and superseded arrays
+ * (and node headers) are kept until destroy(), so no lock is taken on either
+ * side.  Writes still need a single writer.
+ */
 struct int8_embedding_table_s {
-    int8_embedding_node_t **table;
+    _Atomic(int8_embedding_node_t **) table;
     size_t size;
-    size_t index;
+    size_t index;       /* nodes in use, writer side */
+    atomic_size_t rows; /* rows published to readers */
+    size_t dim;         /* int8 elements per embedding */
+    size_t node_bytes;  /* bytes in one node block */
+    void *map;          /* file mapping backing MAPPED nodes (or NULL) */
+    size_t map_size;
+    uint64_t table_id;  /* identity recorded in its file (see embedding_table_file.h) */
+    _Atomic(uint64_t) file_generation;  /* commit of the file it last wrote or loaded;
+                                           serialize() and a flusher both set it */
+    uint32_t layout;    /* EMBEDDING_TABLE_LAYOUT_* bits */
+    int8_channel_quantizer_t *channel;  /* per-dimension quantizer, or NULL */
+    uint32_t memory;    /* EMBEDDING_MEMORY_* bits new blocks are allocated with */
+    struct embedding_slab_s *slab;      /* their slabs, NULL to use allocator */
+    embedding_allocator_t allocator;    /* new nodes without a slab */
+    void **retired;     /* superseded node arrays and headers readers may hold */
+    size_t num_retired;
+    atomic_size_t num_deleted;  /* tombstoned rows */
 };
 typedef struct int8_embedding_table_s int8_embedding_table_t;
 
 /* returns -1 if norm is 0.0 */
 ssize_t int8_embedding_table_add_embedding(int8_embedding_table_t *t, const int8_t *embedding, double norm);
+
+/* add_embedding() recording the row's dequantization scale (the value
+ * int8_from_floats_scaled() returned), so float ≈ int8 * scale.  The scale is
+ * only kept if the table was created with EMBEDDING_TABLE_LAYOUT_ROW_SCALES;
+ * add_embedding() stores 1.0.
+ */
+ssize_t int8_embedding_table_add_embedding_scaled(int8_embedding_table_t *t,
+                                                  const int8_t *embedding, double norm,
+                                                  float scale);
+
+/* Bulk append of n float rows of the table's dim, laid out back to back.
+ * Each row is quantized straight into its node slot, with the table's channel
+ * quantizer if it has one and int8_from_floats_scaled() otherwise (keeping
+ * the scale when the layout has row scales), and its norm computed from the
+ * int8 row, as add_embedding() with norm < 0.0 would.  All nodes are reserved
+ * up front.  Returns the id of the first new
+ * row, or -1 with the table unchanged if a row is all zeros (or on allocation
+ * failure).
+ */
+ssize_t int8_embedding_table_add_floats_batch(int8_embedding_table_t *t,
+                                              const float *floats, size_t n);
+
+/* add_floats_batch() with whole nodes handed out to the pool's threads (pool
+ * may be NULL); each thread writes only its own nodes.
+ */
+ssize_t int8_embedding_table_add_floats_batch_parallel(int8_embedding_table_t *t,
+                                                       embedding_thread_pool_t *pool,
+                                                       const float *floats, size_t n);
+
+/* Mark row index deleted.  Its id stays taken (ids are positions), but the
+ * topk functions skip it from the next scan on; compaction drops it.
+ * returns 0 on success, -1 for an unknown or already deleted id.
+ */
+int int8_embedding_table_delete(int8_embedding_table_t *t, size_t index);
+
+/* Replace row index: the new row is appended, then the old one deleted (rows
+ * are never rewritten in place, so a concurrent scan sees the old row, the
+ * new one or, for a moment, both).
+ * norm as in add_embedding(), scale as in add_embedding_scaled().  Returns
+ * the row's new id, or -1 with the table unchanged on failure.
+ */
+ssize_t int8_embedding_table_update(int8_embedding_table_t *t, size_t index,
+                                    const int8_t *embedding, double norm, float scale);
+
+/* A table of 512-dim embeddings.  size is the initial capacity of the node
+ * array, in nodes; 0 starts it empty and grows it as nodes are added.
+ */
 int8_embedding_table_t *int8_embedding_table_init(size_t size);
+
+/* A table of dim-element embeddings (1..65536).  384, 512, 768 and 1024 use
+ * scan kernels specialised for that size; any other dim works through the
+ * generic ones.  Returns NULL for an unsupported dim.
+ */
+int8_embedding_table_t *int8_embedding_table_init_dim(size_t dim, size_t size);
+
+/* init_dim() with a different per-row layout: a set of
+ * EMBEDDING_TABLE_LAYOUT_* bits (0 is the plain table).  int8 tables take
+ * ROW_SCALES and INV_NORMS; returns NULL for anything else.
+ */
+int8_embedding_table_t *int8_embedding_table_init_layout(size_t dim, size_t size,
+                                                         uint32_t layout);
 void int8_embedding_table_destroy(int8_embedding_table_t *t);
 
+/* Quantize rows added from floats with a copy of q (see
+ * int8_channel_quantizer.h) instead of a per-row scale; q == NULL goes back
+ * to per-row quantization.  The quantizer is saved with the table.  Only
+ * allowed while the table is empty; returns 0 on success, -1 on failure.
+ */
+int int8_embedding_table_set_channel_quantizer(int8_embedding_table_t *t,
+                                               const int8_channel_quantizer_t *q);
+
+/* Allocate the table's node blocks from huge page backed, optionally NUMA
+ * placed slabs (see embedding-library/embedding_memory.h); 0 goes back to one
+ * heap allocation per block.  Blocks loaded by deserialize() or mapped by
+ * mmap() are not moved.  Only allowed while the table has no nodes; returns 0
+ * on success, -1 on failure.
+ */
+int int8_embedding_table_set_memory(int8_embedding_table_t *t, uint32_t flags);
+
+/* Allocate new nodes from a (a copy is kept; NULL is the heap) instead of the
+ * heap, each node's header and block as one allocation.  Clears any memory
+ * mode.  Only allowed while the table has no nodes; returns 0 on success, -1
+ * on failure.  An arena (see embedding-library/embedding_allocator.h) lets
+ * many small tables share a few large chunks.
+ */
+int int8_embedding_table_set_allocator(int8_embedding_table_t *t,
+                                       const embedding_allocator_t *a);
+
+static inline
+size_t int8_embedding_table_dim(const int8_embedding_table_t *t) {
+    return t->dim;
+}
+
+/* int8_dot_product() over dim elements, with the common dims as compile-time
+ * constants so the kernel's loop is fully unrolled for them
+ */
+static inline
+int32_t int8_embedding_table_dot(const int8_t *a, const int8_t *b, size_t dim) {
+    switch (dim) {
+    case 384:  return int8_dot_product(a, b, 384);
+    case 512:  return int8_dot_product(a, b, 512);
+    case 768:  return int8_dot_product(a, b, 768);
+    case 1024: return int8_dot_product(a, b, 1024);
+    default:   return int8_dot_product(a, b, dim);
+    }
+}
+
+/* rows published so far; safe to call while another thread appends */
 static inline
 size_t int8_embedding_table_size(int8_embedding_table_t *t) {
-    if (t->index == 0) return 0;
-    return ((t->index - 1) << 9) + t->table[t->index - 1]->size;
+    return atomic_load_explicit(&t->rows, memory_order_acquire);
+}
+
+/* node i of the current node array; only valid for i < nodes of size() */
+static inline
+const int8_embedding_node_t *int8_embedding_table_node(int8_embedding_table_t *t, size_t i) {
+    return atomic_load_explicit(&t->table, memory_order_acquire)[i];
 }
 
 static inline
 double int8_embedding_table_norm(int8_embedding_table_t *t, size_t index) {
-    size_t node_index = index >> 9; // /512
     size_t offset     = index & 0x1FF; // %512
-    if (node_index >= t->index) return 0.0;
-    return t->table[node_index]->norms[offset];
+    if (index >= int8_embedding_table_size(t)) return 0.0;
+    const int8_embedding_node_t *n = int8_embedding_table_node(t, index >> 9);
+    return n->norms ? n->norms[offset] : 1.0 / n->inv_norms[offset];
+}
+
+/* true if row index was deleted; unknown ids count as deleted */
+static inline
+int int8_embedding_table_is_deleted(int8_embedding_table_t *t, size_t index) {
+    if (index >= int8_embedding_table_size(t)) return 1;
+    const int8_embedding_node_t *n = int8_embedding_table_node(t, index >> 9);
+    uint64_t word = atomic_load_explicit(&n->deleted[(index & 0x1FF) >> 6], memory_order_relaxed);
+    return (int)((word >> (index & 63)) & 1u);
+}
+
+/* rows deleted and not yet compacted away */
+static inline
+size_t int8_embedding_table_num_deleted(int8_embedding_table_t *t) {
+    return atomic_load_explicit(&t->num_deleted, memory_order_relaxed);
+}
+
+/* Memory one row takes in the table's nodes: its elements plus its share of
+ * the norms, per-row extras and block padding.
+ */
+static inline
+double int8_embedding_table_bytes_per_row(const int8_embedding_table_t *t) {
+    return (double)t->node_bytes / 512.0;
+}
+
+/* the row's dequantization scale; 1.0 if the table keeps none */
+static inline
+float int8_embedding_table_scale(int8_embedding_table_t *t, size_t index) {
+    size_t offset     = index & 0x1FF; // %512
+    if (index >= int8_embedding_table_size(t)) return 1.0f;
+    const int8_embedding_node_t *n = int8_embedding_table_node(t, index >> 9);
+    return n->scales ? n->scales[offset] : 1.0f;
 }
 
 static inline
 int8_t *int8_embedding_table_embedding(int8_embedding_table_t *t, size_t index) {
-    size_t node_index = index >> 9; // /512
     size_t offset     = index & 0x1FF; // %512
-    if (node_index >= t->index) return NULL;
-    return t->table[node_index]->data + (offset * 512);
+    if (index >= int8_embedding_table_size(t)) return NULL;
+    return int8_embedding_table_node(t, index >> 9)->data + (offset * t->dim);
 }
 
 static inline
 double int8_embedding_table_cosine_similarity(int8_embedding_table_t *t,
                                               size_t indexA, size_t indexB) {
-    double normA = int8_embedding_table_norm(t, indexA);
-    double normB = int8_embedding_table_norm(t, indexB);
-    if (normA == 0.0 || normB == 0.0) return 0.0;
-    double dp = int8_dot_product(int8_embedding_table_embedding(t, indexA),
-                                 int8_embedding_table_embedding(t, indexB), 512);
-    return dp / (normA * normB);
+    size_t rows = int8_embedding_table_size(t);
+    if (indexA >= rows || indexB >= rows) return 0.0;
+    double dp = int8_embedding_table_dot(int8_embedding_table_embedding(t, indexA),
+                                         int8_embedding_table_embedding(t, indexB), t->dim);
+    const int8_embedding_node_t *a = int8_embedding_table_node(t, indexA >> 9);
+    const int8_embedding_node_t *b = int8_embedding_table_node(t, indexB >> 9);
+    if (!a->norms) return dp * ((double)a->inv_norms[indexA & 0x1FF] * b->inv_norms[indexB & 0x1FF]);
+    return dp / (a->norms[indexA & 0x1FF] * b->norms[indexB & 0x1FF]);
 }
 
+/* Brute-force k nearest neighbours by cosine similarity.
+ * Scans every row once, skipping deleted ones, and writes at most k results,
+ * best first, into out_ids / out_scores (either may be NULL).  If
+ * query_norm < 0.0 it is recomputed from the query.  Returns the number of
+ * results written.
+ */
+size_t int8_embedding_table_topk(int8_embedding_table_t *t,
+                                 const int8_t *query, double query_norm,
+                                 size_t k, size_t *out_ids, double *out_scores);
+
+/* Same results as int8_embedding_table_topk(), but the node array is split
+ * into contiguous partitions scanned by the pool's threads, each keeping its
+ * own top-k, which are merged at the end.  A NULL pool scans serially.  With
+ * EMBEDDING_MEMORY_NUMA_SPREAD the partitions are grouped by the NUMA node
+ * their blocks sit on and run with embedding_thread_pool_run_grouped(), so a
+ * pool from embedding_thread_pool_init_numa() scans mostly local memory.
+ */
+size_t int8_embedding_table_topk_parallel(int8_embedding_table_t *t,
+                                          embedding_thread_pool_t *pool,
+                                          const int8_t *query, double query_norm,
+                                          size_t k, size_t *out_ids, double *out_scores);
+
+/* topk() over only the rows filter lets through (see
+ * embedding-library/embedding_filter.h; NULL is every row).  Nodes with no
+ * row set in filter->rows are skipped unread, and rows it excludes or match
+ * rejects are never scored: a node where few rows pass scores just those,
+ * one dot product each, and one where many pass runs the rows kernel over it
+ * and keeps the ones that pass.
+ */
+size_t int8_embedding_table_topk_filtered(int8_embedding_table_t *t,
+                                          const int8_t *query, double query_norm,
+                                          const embedding_filter_t *filter,
+                                          size_t k, size_t *out_ids, double *out_scores);
+
+/* topk_filtered() split across the pool's threads like topk_parallel(); match
+ * is called from those threads.
+ */
+size_t int8_embedding_table_topk_filtered_parallel(int8_embedding_table_t *t,
+                                                   embedding_thread_pool_t *pool,
+                                                   const int8_t *query, double query_norm,
+                                                   const embedding_filter_t *filter,
+                                                   size_t k, size_t *out_ids,
+                                                   double *out_scores);
+
+/* Inner-product search with a float query: each row scores approximately
+ * dot(query, row as floats), using the row scales and channel quantizer, so
+ * unnormalized embeddings rank as they would in float.  The query is
+ * quantized once to int8 (after folding in the channel scales) and scored with
+ * the int8 rows kernels; zero points are applied as one offset per query:
+ *
+ *   score = row_scale * query_scale * (dot(q8, code) - dot(q8, zero_point))
+ *
+ * Results are written best first as in topk(); returns the number written.
+ */
+size_t int8_embedding_table_topk_ip(int8_embedding_table_t *t, const float *query,
+                                    size_t k, size_t *out_ids, double *out_scores);
+
+/* topk_ip() split across the pool's threads like topk_parallel() */
+size_t int8_embedding_table_topk_ip_parallel(int8_embedding_table_t *t,
+                                             embedding_thread_pool_t *pool,
+                                             const float *query, size_t k,
+                                             size_t *out_ids, double *out_scores);
+
+/* The topk_ip() score of one row; 0.0 for an unknown id */
+double int8_embedding_table_inner_product(int8_embedding_table_t *t, const float *query,
+                                          size_t index);
+
+/* Top-k for a batch of queries in a single pass over the table.  queries
+ * holds num_queries contiguous vectors of the table's dim; query_norms may be
+ * NULL (or hold values < 0.0) to have norms recomputed.  Each node is scored
+ * against the whole batch while it is in cache (see
+ * int8_dot_product_matrix()).  Results for query q are written best first to
+ * out_ids[q * k] and out_scores[q * k].
+ * Returns the number of slots filled per query, min(k, rows), deleted rows
+ * included.  A query with fewer live rows to return than that (any query
+ * when rows are deleted, and every query with a zero norm, which matches
+ * nothing) has its remaining slots padded with ids of (size_t)-1 and scores
+ * of 0.0.
+ */
+size_t int8_embedding_table_topk_batch(int8_embedding_table_t *t,
+                                       const int8_t *queries, const double *query_norms,
+                                       size_t num_queries, size_t k,
+                                       size_t *out_ids, double *out_scores);
+
+/* Compaction: copy the live rows of a table into a new, dense one, a few
+ * nodes at a time.  begin() and step() only read t, so they can run on a
+ * background thread while the writer keeps adding and deleting rows; finish()
+ * must be called with writes paused (or by the writer).  It copies the rows
+ * added since the last step, carries over deletions made meanwhile, and
+ * returns the new table (the same dim, layout, quantizer and memory mode)
+ * along with a malloc'd remap: remap[old id] is the row's id in the new table,
+ * or (size_t)-1 if it was deleted, for every id below size(t); it is
+ * allocated even when t is empty.  The caller switches readers to the new
+ * table, frees remap and destroys t once no reader holds it.  Scans of the
+ * new table no longer spend time on deleted rows.
+ */
+struct int8_embedding_table_compaction_s;
+typedef struct int8_embedding_table_compaction_s int8_embedding_table_compaction_t;
+
+/* NULL on failure */
+int8_embedding_table_compaction_t *int8_embedding_table_compact_begin(int8_embedding_table_t *t);
+
+/* copy up to max_nodes more source nodes (0: all of them); returns 1 once
+ * every published row has been copied, 0 if there is more to do, -1 on failure
+ */
+int int8_embedding_table_compact_step(int8_embedding_table_compaction_t *c, size_t max_nodes);
+
+/* returns the compacted table, or NULL on failure; c is freed either way */
+int8_embedding_table_t *int8_embedding_table_compact_finish(int8_embedding_table_compaction_t *c,
+                                                            size_t **remap);
+
+/* give up on a compaction, freeing c and the partial table */
+void int8_embedding_table_compact_abort(int8_embedding_table_compaction_t *c);
+
+/* begin(), step() to the end and finish() in one call */
+int8_embedding_table_t *int8_embedding_table_compact(int8_embedding_table_t *t, size_t **remap);
+
+/* Files use the shared table format, see embedding-library/embedding_table_file.h */
 void int8_embedding_table_serialize(int8_embedding_table_t *t, const char *filename);
 int8_embedding_table_t *int8_embedding_table_deserialize(const char *filename);
 
+/* deserialize() with the reads and checks split into contiguous runs of nodes
+ * across pool (may be NULL).
+ */
+int8_embedding_table_t *int8_embedding_table_deserialize_parallel(const char *filename,
+                                                                  embedding_thread_pool_t *pool);
+
+/* Background flushing: a thread of its own serializes t to filename every
+ * interval_ms milliseconds (0: only when flush() is called) if rows were
+ * added or deleted since its last write.  Like any reader it runs alongside
+ * the writer without blocking it, and each write takes the rows published
+ * when it starts.  Writes are incremental and crash-safe (see
+ * embedding-library/embedding_table_file.h).  Destroy the flusher before the
+ * table.  NULL on failure.
+ */
+struct int8_embedding_table_flusher_s;
+typedef struct int8_embedding_table_flusher_s int8_embedding_table_flusher_t;
+
+int8_embedding_table_flusher_t *int8_embedding_table_flusher_init(int8_embedding_table_t *t,
+                                                                  const char *filename,
+                                                                  unsigned interval_ms);
+
+/* write what is published now and wait for it; returns 0 on success, -1 if
+ * the write failed
+ */
+int int8_embedding_table_flusher_flush(int8_embedding_table_flusher_t *f);
+
+/* a last flush, then the thread is stopped */
+void int8_embedding_table_flusher_destroy(int8_embedding_table_flusher_t *f);
+
+/* int8_embedding_table_mmap flags (the shared EMBEDDING_TABLE_MMAP_* values) */
+#define INT8_EMBEDDING_TABLE_MMAP_POPULATE   EMBEDDING_TABLE_MMAP_POPULATE
+#define INT8_EMBEDDING_TABLE_MMAP_SEQUENTIAL EMBEDDING_TABLE_MMAP_SEQUENTIAL
+#define INT8_EMBEDDING_TABLE_MMAP_RANDOM     EMBEDDING_TABLE_MMAP_RANDOM
+#define INT8_EMBEDDING_TABLE_MMAP_WILLNEED   EMBEDDING_TABLE_MMAP_WILLNEED
+#define INT8_EMBEDDING_TABLE_MMAP_VERIFY     EMBEDDING_TABLE_MMAP_VERIFY
+
+/* Open a serialized table without copying it: the file is mapped read-only
+ * and shared, and every node points straight into the mapping, so opening is
+ * O(nodes) and the page cache is shared by all processes using the file.
+ * Appending still works; a partial last node is copied to the heap when the
+ * file is opened.  The file must not be truncated or rewritten with fewer rows
+ * while mapped.  Returns NULL for legacy (headerless) files.
+ */
+int8_embedding_table_t *int8_embedding_table_mmap(const char *filename, uint32_t flags);
+
+/* embedding_table_verify(); returns 0 if the file is intact, -1 otherwise */
+int int8_embedding_table_verify(const char *filename, embedding_thread_pool_t *pool);
+
 #endif // _embed_int8_embedding_table_H
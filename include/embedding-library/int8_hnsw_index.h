@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_int8_hnsw_index_H
+#define _embed_int8_hnsw_index_H
+
+/* Hierarchical navigable small world (HNSW) graph over an int8 table.
+ *
+ * Every row added to the graph gets a random level (most stay at level 0) and
+ * links to up to m of its nearest rows on each level it is on, 2 * m on level
+ * 0.  A search descends greedily from the top level's entry point, then runs
+ * a best-first search of level 0 keeping the ef best rows, and returns the
+ * top k of those by the cosine score int8_embedding_table_topk() gives.
+ * Raising ef trades time for recall.
+ *
+ * Links live in flat arrays indexed by the row's id in the table: one
+ * 64-byte aligned slot per row for level 0 (its level, where its upper links
+ * start, the link count and the links) and a pool of slots for the upper
+ * levels, both in chunks of 4096 slots.  Rows are scored with the int8 dot
+ * product kernel and the norms the table keeps.
+ *
+ * Rows are inserted with add() or sync(), from any number of threads at once
+ * (each row locks only the lists it changes).  Searches take no lock and run
+ * alongside inserts and the table's writer.  Rows deleted in the table stay
+ * in the graph to route through but are left out of results.  Ids are kept
+ * as 32 bits, so the table must stay below 2^32 - 1 rows.  After a compaction
+ * the graph is rebuilt for the new table.
+ */
+
+#include "embedding-library/int8_embedding_table.h"
+#include "embedding-library/thread_pool.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define INT8_HNSW_INDEX_DEFAULT_M               16
+#define INT8_HNSW_INDEX_DEFAULT_EF_CONSTRUCTION 100
+
+struct int8_hnsw_index_s;
+typedef struct int8_hnsw_index_s int8_hnsw_index_t;
+
+/* An empty graph over t's rows, with m links per upper level (0: the
+ * default, at most 255) and ef_construction candidates kept while inserting
+ * (0: the default).  t must outlive the index.  NULL on failure.
+ */
+int8_hnsw_index_t *int8_hnsw_index_init(int8_embedding_table_t *t, size_t m,
+                                        size_t ef_construction);
+
+void int8_hnsw_index_destroy(int8_hnsw_index_t *h);
+
+/* Insert row id of the table (an id add_embedding() returned).  Safe to call
+ * from several threads at once.  returns 0 on success (or if the row is
+ * already in the graph), -1 on failure
+ */
+int int8_hnsw_index_add(int8_hnsw_index_t *h, size_t id);
+
+/* Insert every row of the table not in the graph yet, split across pool
+ * (may be NULL).  Deleted rows are skipped.  returns 0 on success, -1 on failure
+ */
+int int8_hnsw_index_sync(int8_hnsw_index_t *h, embedding_thread_pool_t *pool);
+
+/* rows in the graph */
+size_t int8_hnsw_index_size(const int8_hnsw_index_t *h);
+
+/* Approximate top-k by cosine similarity, searching level 0 with
+ * max(ef, k) candidates.  If query_norm < 0.0 it is recomputed.  Writes at
+ * most k results, best first, to out_ids / out_scores (either may be NULL);
+ * returns the number written.
+ */
+size_t int8_hnsw_index_topk(int8_hnsw_index_t *h, const int8_t *query, double query_norm,
+                            size_t ef, size_t k, size_t *out_ids, double *out_scores);
+
+/* Save the graph to filename, written beside it and renamed into place.
+ * Inserts wait while it runs; searches do not.  Kept next to the table's own
+ * file (e.g. "tbl.bin.hnsw") and saved after it.  returns 0 on success, -1 on
+ * failure
+ */
+int int8_hnsw_index_save(int8_hnsw_index_t *h, const char *filename);
+
+/* Load a graph saved for t (the same table file, possibly with rows appended
+ * since; sync() adds those).  Every link is checked.  NULL if the file is
+ * damaged or does not fit t, or if it was saved for another table, such as
+ * the one t was compacted from (see embedding_table_file.h for table ids).
+ */
+int8_hnsw_index_t *int8_hnsw_index_load(int8_embedding_table_t *t, const char *filename);
+
+/* Open a saved graph without copying it: the link arrays point into a
+ * private mapping of the file (pages are copied only when an insert changes
+ * them; the file is never written).  flags are EMBEDDING_TABLE_MMAP_* bits;
+ * links are only checked with EMBEDDING_TABLE_MMAP_VERIFY.  NULL on failure.
+ */
+int8_hnsw_index_t *int8_hnsw_index_mmap(int8_embedding_table_t *t, const char *filename,
+                                        uint32_t flags);
+
+#endif // _embed_int8_hnsw_index_H
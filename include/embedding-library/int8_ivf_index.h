@@ -0,0 +1,99 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_int8_ivf_index_H
+#define _embed_int8_ivf_index_H
+
+/* Inverted-file (IVF) index over an int8 table.
+ *
+ * Spherical k-means on a sample of the table's rows picks nlist centroids;
+ * every row is then filed in the posting list of the centroid closest to it
+ * by cosine.  A search scores the query against the centroids, scans only the
+ * rows of the nprobe best lists and returns the top k of those by the same
+ * cosine score as int8_embedding_table_topk(), so it reads roughly
+ * nprobe / nlist of the table.  Raising nprobe trades time for recall.
+ *
+ * Lists hold row ids, in id order, and the rows are read from the table.
+ * With INT8_IVF_INDEX_COPY_ROWS each list also keeps a copy of its rows back
+ * to back (twice the memory), so a probe is one contiguous run for the rows
+ * kernel instead of a gather across the table.
+ *
+ * The index follows the table: sync() files rows appended since it last ran,
+ * searches skip rows deleted in the table, and remap() carries it over to the
+ * table returned by compaction.  Searches may run concurrently with each other
+ * and with the table's writer; sync() and remap() wait for running searches.
+ */
+
+#include "embedding-library/int8_embedding_table.h"
+#include "embedding-library/thread_pool.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/* flags */
+#define INT8_IVF_INDEX_COPY_ROWS 1u   /* keep each list's rows contiguous in the list */
+
+#define INT8_IVF_INDEX_DEFAULT_ITERATIONS 10
+#define INT8_IVF_INDEX_DEFAULT_SAMPLE_PER_LIST 64
+
+struct int8_ivf_index_s;
+typedef struct int8_ivf_index_s int8_ivf_index_t;
+
+/* Train nlist centroids on sample rows of t (0: nlist *
+ * INT8_IVF_INDEX_DEFAULT_SAMPLE_PER_LIST, at most every live row) with
+ * iterations rounds of k-means (0: INT8_IVF_INDEX_DEFAULT_ITERATIONS), then
+ * file every row of t.  Assignment is split across pool (may be NULL).  t
+ * must outlive the index.  Returns NULL on failure or if t has fewer live rows
+ * than nlist.
+ */
+int8_ivf_index_t *int8_ivf_index_train(int8_embedding_table_t *t, size_t nlist,
+                                       size_t sample, unsigned iterations,
+                                       uint32_t flags, embedding_thread_pool_t *pool);
+
+void int8_ivf_index_destroy(int8_ivf_index_t *ivf);
+
+/* File the rows added to the table since the index last covered it.
+ * returns 0 on success, -1 on failure (the index is unchanged)
+ */
+int int8_ivf_index_sync(int8_ivf_index_t *ivf, embedding_thread_pool_t *pool);
+
+/* Move the index to t, the table compact_finish() returned for the table it
+ * indexed, using that call's remap.  Rows the compaction dropped leave their
+ * lists.  returns 0 on success, -1 on failure (the index is unchanged)
+ */
+int int8_ivf_index_remap(int8_ivf_index_t *ivf, int8_embedding_table_t *t,
+                         const size_t *remap);
+
+size_t int8_ivf_index_nlist(const int8_ivf_index_t *ivf);
+
+/* rows of the table the index covers (deleted ones included) */
+size_t int8_ivf_index_size(const int8_ivf_index_t *ivf);
+
+/* rows filed in list */
+size_t int8_ivf_index_list_size(const int8_ivf_index_t *ivf, size_t list);
+
+/* Approximate top-k by cosine similarity over the nprobe lists (at most
+ * nlist) whose centroids score best against query.  If query_norm < 0.0 it
+ * is recomputed.  Writes at most k results, best first, to out_ids /
+ * out_scores (either may be NULL); returns the number written.
+ */
+size_t int8_ivf_index_topk(int8_ivf_index_t *ivf, const int8_t *query, double query_norm,
+                           size_t nprobe, size_t k, size_t *out_ids, double *out_scores);
+
+/* Save the centroids and lists to filename, written beside it and renamed
+ * into place.  Kept next to the table's own file (e.g. "tbl.bin.ivf"), the
+ * index is saved after the table is serialized and loaded after it.
+ * returns 0 on success, -1 on failure
+ */
+int int8_ivf_index_save(int8_ivf_index_t *ivf, const char *filename);
+
+/* Load an index saved for t (by deserialize() or mmap() of the same table
+ * file, possibly with rows appended since) and sync() it.  Returns NULL if
+ * the file is damaged or does not fit t, or if it was saved for another
+ * table: one whose file t does not continue, such as the table t was
+ * compacted from (see embedding_table_file.h for table ids).
+ */
+int8_ivf_index_t *int8_ivf_index_load(int8_embedding_table_t *t, const char *filename,
+                                      embedding_thread_pool_t *pool);
+
+#endif // _embed_int8_ivf_index_H
@@ -0,0 +1,94 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_int8_sign_codes_H
+#define _embed_int8_sign_codes_H
+
+/* 1-bit sign codes of an int8 table's rows, as a compressed first pass.
+ *
+ * Each row is kept as one bit per element, its sign bit (dim / 8 bytes, e.g.
+ * 96 for 768 dims against the table's 776), packed into 64-bit words.  The
+ * Hamming distance between two codes tracks the angle between the rows, so a
+ * scan of the codes with popcount picks k * oversample candidates that are
+ * then re-scored from the table with the exact int8 cosine.  Only those rows
+ * of the table are read, so the table can stay on disk (int8_embedding_table_mmap())
+ * while the codes sit in memory.  Raising oversample trades re-scoring time
+ * for recall lost to the 1-bit codes.
+ *
+ * The popcount kernel is picked for the host at runtime (AVX-512 VPOPCNTDQ,
+ * then POPCNT, then a portable fallback).
+ *
+ * The codes follow the table: sync() encodes rows appended since it last ran,
+ * and searches skip rows deleted in the table.  After a compaction, build new
+ * codes for the new table.  Searches may run concurrently with each other and
+ * with the table's writer; sync() waits for running searches only to publish.
+ */
+
+#include "embedding-library/int8_embedding_table.h"
+#include "embedding-library/embedding_rerank.h"
+#include "embedding-library/thread_pool.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define INT8_SIGN_CODES_DEFAULT_OVERSAMPLE 32
+
+struct int8_sign_codes_s;
+typedef struct int8_sign_codes_s int8_sign_codes_t;
+
+/* 64-bit words in the code of a dim-element row */
+static inline size_t int8_sign_code_words(size_t dim) {
+    return (dim + 63) / 64;
+}
+
+/* The code of row: bit i (word i / 64, bit i % 64) is set when row[i] < 0;
+ * the bits past dim in the last word are 0.  code holds
+ * int8_sign_code_words(dim) words.
+ */
+void int8_sign_code(const int8_t *row, size_t dim, uint64_t *code);
+
+/* Hamming distance between two codes of `words` words */
+uint32_t int8_sign_code_distance(const uint64_t *a, const uint64_t *b, size_t words);
+
+/* Codes for every row of t, encoded across pool (may be NULL).  t must
+ * outlive the codes.  NULL on failure.
+ */
+int8_sign_codes_t *int8_sign_codes_init(int8_embedding_table_t *t,
+                                        embedding_thread_pool_t *pool);
+
+void int8_sign_codes_destroy(int8_sign_codes_t *c);
+
+/* Encode the rows added to the table since the codes last covered it.
+ * returns 0 on success, -1 on failure (the codes are unchanged)
+ */
+int int8_sign_codes_sync(int8_sign_codes_t *c, embedding_thread_pool_t *pool);
+
+/* rows of the table the codes cover (deleted ones included) */
+size_t int8_sign_codes_size(const int8_sign_codes_t *c);
+
+/* memory the codes take per row */
+size_t int8_sign_codes_bytes_per_row(const int8_sign_codes_t *c);
+
+/* The n rows whose codes are nearest to code (int8_sign_code_words(dim)
+ * words) by Hamming distance, scanned across pool (may be NULL) and skipping
+ * deleted rows.  Writes at most n ids, nearest first, to out_ids and their
+ * distances to out_distances (may be NULL); returns the number written.
+ */
+size_t int8_sign_codes_scan(int8_sign_codes_t *c, embedding_thread_pool_t *pool,
+                            const uint64_t *code, size_t n,
+                            size_t *out_ids, uint32_t *out_distances);
+
+/* Approximate top-k by cosine similarity: scan() for k * oversample
+ * candidates (oversample 0 means INT8_SIGN_CODES_DEFAULT_OVERSAMPLE), then
+ * re-score them from the table with the score int8_embedding_table_topk()
+ * gives.  If query_norm < 0.0 it is recomputed.  Writes at most k results,
+ * best first, to out_ids / out_scores (either may be NULL) and the stage
+ * timings to stats (may be NULL); returns the number written.
+ */
+size_t int8_sign_codes_topk(int8_sign_codes_t *c, embedding_thread_pool_t *pool,
+                            const int8_t *query, double query_norm,
+                            size_t k, size_t oversample,
+                            size_t *out_ids, double *out_scores,
+                            embedding_rerank_stats_t *stats);
+
+#endif // _embed_int8_sign_codes_H
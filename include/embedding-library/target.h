@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_target_H
+#define _embed_target_H
+
+/* Per-function ISA targeting.
+ *
+ * With GCC/Clang every SIMD kernel is compiled with a target attribute, so
+ * all of them exist in any build (even without -mavx2 etc.) and the runtime
+ * dispatcher (embedding-library/dispatch.h) can pick one per host.  The
+ * compile-time dispatchers in float.h / int8.h still only call a kernel when
+ * the matching -m flags are on, so header-only use is unchanged.
+ *
+ * Compilers without target attributes only get the kernels their global
+ * flags allow.  Define EMBED_NO_TARGET_ATTRIBUTES to force that behaviour.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(EMBED_NO_TARGET_ATTRIBUTES)
+#define EMBED_TARGET(isa) __attribute__((target(isa)))
+#define EMBED_HAVE_TARGET 1
+#else
+#define EMBED_TARGET(isa)
+#define EMBED_HAVE_TARGET 0
+#endif
+
+/* avxvnni target strings arrived in GCC 11 / Clang 12 */
+#if EMBED_HAVE_TARGET && \
+    ((defined(__clang__) && __clang_major__ >= 12) || \
+     (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 11))
+#define EMBED_HAVE_TARGET_AVXVNNI 1
+#else
+#define EMBED_HAVE_TARGET_AVXVNNI 0
+#endif
+
+/* AArch64 dot-product intrinsics usable under a target attribute:
+ * GCC 10+ ("+dotprod"), Clang 16+ ("dotprod").
+ */
+#if EMBED_HAVE_TARGET && defined(__aarch64__) && \
+    !defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 10
+#define EMBED_TARGET_DOTPROD EMBED_TARGET("+dotprod")
+#define EMBED_HAVE_TARGET_DOTPROD 1
+#elif EMBED_HAVE_TARGET && defined(__aarch64__) && \
+    defined(__clang__) && __clang_major__ >= 16
+#define EMBED_TARGET_DOTPROD EMBED_TARGET("dotprod")
+#define EMBED_HAVE_TARGET_DOTPROD 1
+#else
+#define EMBED_TARGET_DOTPROD
+#define EMBED_HAVE_TARGET_DOTPROD 0
+#endif
+
+/* AArch64 CRC32 intrinsics (__crc32cd) under a target attribute, same versions */
+#if EMBED_HAVE_TARGET && defined(__aarch64__) && \
+    !defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 10
+#define EMBED_TARGET_CRC EMBED_TARGET("+crc")
+#define EMBED_HAVE_TARGET_CRC 1
+#elif EMBED_HAVE_TARGET && defined(__aarch64__) && \
+    defined(__clang__) && __clang_major__ >= 16
+#define EMBED_TARGET_CRC EMBED_TARGET("crc")
+#define EMBED_HAVE_TARGET_CRC 1
+#else
+#define EMBED_TARGET_CRC
+#define EMBED_HAVE_TARGET_CRC 0
+#endif
+
+#endif // _embed_target_H
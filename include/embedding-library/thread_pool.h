@@ -0,0 +1,56 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_thread_pool_H
+#define _embed_thread_pool_H
+
+#include <stddef.h>
+
+/* A persistent pool of worker threads for fan-out/fan-in work such as
+ * partitioned table scans.  Threads are created once by
+ * embedding_thread_pool_init() and park on a condition variable between runs,
+ * so a query only pays for a wake-up, not a thread spawn.
+ */
+struct embedding_thread_pool_s;
+typedef struct embedding_thread_pool_s embedding_thread_pool_t;
+
+typedef void (*embedding_thread_pool_cb)(void *arg, size_t task);
+
+/* num_threads is the total parallelism of a run, including the calling
+ * thread (which always participates).  0 picks the number of online CPUs.
+ * NULL if the pool or any of its threads cannot be created.
+ */
+embedding_thread_pool_t *embedding_thread_pool_init(size_t num_threads);
+
+/* init() with the workers spread round-robin over the host's NUMA nodes and
+ * each pinned to its node's CPUs; the caller counts as node 0.  On a single
+ * node host this is init().
+ */
+embedding_thread_pool_t *embedding_thread_pool_init_numa(size_t num_threads);
+void embedding_thread_pool_destroy(embedding_thread_pool_t *pool);
+
+size_t embedding_thread_pool_size(const embedding_thread_pool_t *pool);
+
+/* NUMA nodes the pool's workers are spread over (1 unless from init_numa()) */
+size_t embedding_thread_pool_numa_nodes(const embedding_thread_pool_t *pool);
+
+/* Call cb(arg, task) once for every task in [0, num_tasks) and return when
+ * all of them have finished.  Tasks are handed out dynamically, so uneven
+ * tasks balance across threads.  Concurrent runs on one pool are serialized.
+ */
+void embedding_thread_pool_run(embedding_thread_pool_t *pool,
+                               embedding_thread_pool_cb cb, void *arg,
+                               size_t num_tasks);
+
+/* run() over num_groups groups of tasks numbered one group after another:
+ * group g holds group_tasks[g] tasks and belongs to NUMA node
+ * g % embedding_thread_pool_numa_nodes(pool).  Each thread drains the groups of
+ * its own node before helping with the rest, so data placed on a node is
+ * mostly scanned by that node's threads.
+ */
+void embedding_thread_pool_run_grouped(embedding_thread_pool_t *pool,
+                                       embedding_thread_pool_cb cb, void *arg,
+                                       const size_t *group_tasks, size_t num_groups);
+
+#endif // _embed_thread_pool_H
@@ -5,13 +5,16 @@
 #ifndef _embed_x86_float_H
 #define _embed_x86_float_H
 
+#include "embedding-library/target.h"
 #include <stdint.h>
 #include <stddef.h>
+#include <math.h>
 #include <immintrin.h>
 
-#if defined(__AVX512F__)
+#if EMBED_HAVE_TARGET || defined(__AVX512F__)
 /* AVX-512 implementation with scalar tail */
-static inline float dot_product_avx(const float *a, const float *b, size_t size) {
+EMBED_TARGET("avx512f")
+static inline float dot_product_avx512(const float *a, const float *b, size_t size) {
     __m512 sum = _mm512_setzero_ps();
     size_t i = 0;
     for (; i + 16 <= size; i += 16) {
@@ -23,8 +26,11 @@ static inline float dot_product_avx(const float *a, const float *b, size_t size)
     for (; i < size; ++i) acc += a[i] * b[i];
     return acc;
 }
-#else
+#endif
+
+#if EMBED_HAVE_TARGET || defined(__AVX__)
 /* AVX (256-bit) implementation with scalar tail */
+EMBED_TARGET("avx")
 static inline float dot_product_avx(const float *a, const float *b, size_t size) {
     __m256 sum = _mm256_setzero_ps();
     size_t i = 0;
@@ -41,4 +47,65 @@ static inline float dot_product_avx(const float *a, const float *b, size_t size)
 }
 #endif
 
+/* Quantization helpers.  float_round_clamp_*() is roundf() then a clamp to
+ * [lo, hi], converted to int32: adding 0.49999997f (the float just below 0.5)
+ * with x's sign and truncating rounds half away from zero exactly like
+ * roundf() for every finite x, where the cvtps rounding modes would round
+ * half to even.
+ */
+#if EMBED_HAVE_TARGET || defined(__AVX512F__)
+EMBED_TARGET("avx512f")
+static inline float float_max_abs_avx512(const float *v, size_t size) {
+    __m512 m = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16)
+        m = _mm512_max_ps(m, _mm512_abs_ps(_mm512_loadu_ps(v + i)));
+    float max_abs = _mm512_reduce_max_ps(m);
+    for (; i < size; ++i) {
+        float a = fabsf(v[i]);
+        if (a > max_abs) max_abs = a;
+    }
+    return max_abs;
+}
+
+EMBED_TARGET("avx512f")
+static inline __m512i float_round_clamp_avx512(__m512 x, __m512 lo, __m512 hi) {
+    const __m512i sign = _mm512_set1_epi32((int)0x80000000u);
+    const __m512i half = _mm512_castps_si512(_mm512_set1_ps(0.49999997f));
+    __m512 h = _mm512_castsi512_ps(
+        _mm512_or_si512(_mm512_and_si512(_mm512_castps_si512(x), sign), half));
+    __m512 y = _mm512_min_ps(_mm512_max_ps(_mm512_add_ps(x, h), lo), hi);
+    return _mm512_cvttps_epi32(y);
+}
+#endif
+
+#if EMBED_HAVE_TARGET || defined(__AVX__)
+EMBED_TARGET("avx")
+static inline float float_max_abs_avx(const float *v, size_t size) {
+    const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 m = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+        m = _mm256_max_ps(m, _mm256_and_ps(_mm256_loadu_ps(v + i), abs_mask));
+    float lanes[8];
+    _mm256_storeu_ps(lanes, m);
+    float max_abs = 0.0f;
+    for (int l = 0; l < 8; ++l)
+        if (lanes[l] > max_abs) max_abs = lanes[l];
+    for (; i < size; ++i) {
+        float a = fabsf(v[i]);
+        if (a > max_abs) max_abs = a;
+    }
+    return max_abs;
+}
+
+EMBED_TARGET("avx")
+static inline __m256i float_round_clamp_avx(__m256 x, __m256 lo, __m256 hi) {
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    __m256 h = _mm256_or_ps(_mm256_and_ps(x, sign), _mm256_set1_ps(0.49999997f));
+    __m256 y = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(x, h), lo), hi);
+    return _mm256_cvttps_epi32(y);
+}
+#endif
+
 #endif // _embed_x86_float_H
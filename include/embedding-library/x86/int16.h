@@ -0,0 +1,130 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_x86_int16_H
+#define _embed_x86_int16_H
+
+#include "embedding-library/target.h"
+#include "embedding-library/x86/float.h"
+#include "embedding-library/fallback/int16.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <immintrin.h>
+
+/* madd_epi16 sums adjacent int16 products into int32 lanes; each pair sum is
+ * widened to int64 straight away, since a few of them already overflow int32.
+ */
+
+#if EMBED_HAVE_TARGET || defined(__AVX2__)
+/* AVX2: 16 int16 per step */
+EMBED_TARGET("avx2")
+static inline int64_t int16_dot_product_avx(const int16_t *a, const int16_t *b, size_t n) {
+    __m256i acc = _mm256_setzero_si256();   /* 4 x int64 */
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i p  = _mm256_madd_epi16(va, vb);
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(p)));
+        acc = _mm256_add_epi64(acc, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(p, 1)));
+    }
+    int64_t lanes[4];
+    _mm256_storeu_si256((__m256i *)lanes, acc);
+    int64_t result = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; i < n; ++i) result += (int32_t)a[i] * (int32_t)b[i];
+    return result;
+}
+#endif
+
+#if EMBED_HAVE_TARGET || (defined(__AVX512F__) && defined(__AVX512BW__))
+/* AVX-512BW: 32 int16 per step */
+EMBED_TARGET("avx512f,avx512bw")
+static inline int64_t int16_dot_product_avx512(const int16_t *a, const int16_t *b, size_t n) {
+    __m512i acc = _mm512_setzero_si512();   /* 8 x int64 */
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512i va = _mm512_loadu_si512((const void *)(a + i));
+        __m512i vb = _mm512_loadu_si512((const void *)(b + i));
+        __m512i p  = _mm512_madd_epi16(va, vb);
+        acc = _mm512_add_epi64(acc, _mm512_cvtepi32_epi64(_mm512_castsi512_si256(p)));
+        acc = _mm512_add_epi64(acc, _mm512_cvtepi32_epi64(_mm512_extracti64x4_epi64(p, 1)));
+    }
+    int64_t result = _mm512_reduce_add_epi64(acc);
+    for (; i < n; ++i) result += (int32_t)a[i] * (int32_t)b[i];
+    return result;
+}
+#endif
+
+/* Quantization: same results as the *_scalar reference kernels */
+#if EMBED_HAVE_TARGET || defined(__AVX2__)
+EMBED_TARGET("avx2")
+static inline void int16_scale_floats_avx(const float *input, size_t n, float s,
+                                          int16_t *output) {
+    const __m256 vs = _mm256_set1_ps(s);
+    const __m256 lo = _mm256_set1_ps(-32768.0f), hi = _mm256_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i a = float_round_clamp_avx(_mm256_mul_ps(_mm256_loadu_ps(input + i), vs), lo, hi);
+        __m256i b = float_round_clamp_avx(_mm256_mul_ps(_mm256_loadu_ps(input + i + 8), vs), lo, hi);
+        __m256i v = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i *)(output + i), v);
+    }
+    int16_scale_floats_scalar(input + i, n - i, s, output + i);
+}
+
+EMBED_TARGET("avx2")
+static inline void int16_from_floats_avx(const float *input, size_t n, int16_t *output) {
+    float max_abs = float_max_abs_avx(input, n);
+    if (max_abs == 0.0f) max_abs = 1.0f;
+    int16_scale_floats_avx(input, n, 32767.0f / max_abs, output);
+}
+
+EMBED_TARGET("avx2")
+static inline void int16_to_floats_avx(const int16_t *input, size_t n, float *output,
+                                       float scale_factor) {
+    const __m256 vs = _mm256_set1_ps(scale_factor);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(input + i)));
+        _mm256_storeu_ps(output + i, _mm256_div_ps(_mm256_cvtepi32_ps(v), vs));
+    }
+    int16_to_floats_scalar(input + i, n - i, output + i, scale_factor);
+}
+#endif
+
+#if EMBED_HAVE_TARGET || defined(__AVX512F__)
+EMBED_TARGET("avx512f")
+static inline void int16_scale_floats_avx512(const float *input, size_t n, float s,
+                                             int16_t *output) {
+    const __m512 vs = _mm512_set1_ps(s);
+    const __m512 lo = _mm512_set1_ps(-32768.0f), hi = _mm512_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i v = float_round_clamp_avx512(_mm512_mul_ps(_mm512_loadu_ps(input + i), vs), lo, hi);
+        _mm256_storeu_si256((__m256i *)(output + i), _mm512_cvtsepi32_epi16(v));
+    }
+    int16_scale_floats_scalar(input + i, n - i, s, output + i);
+}
+
+EMBED_TARGET("avx512f")
+static inline void int16_from_floats_avx512(const float *input, size_t n, int16_t *output) {
+    float max_abs = float_max_abs_avx512(input, n);
+    if (max_abs == 0.0f) max_abs = 1.0f;
+    int16_scale_floats_avx512(input, n, 32767.0f / max_abs, output);
+}
+
+EMBED_TARGET("avx512f")
+static inline void int16_to_floats_avx512(const int16_t *input, size_t n, float *output,
+                                          float scale_factor) {
+    const __m512 vs = _mm512_set1_ps(scale_factor);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i v = _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)(input + i)));
+        _mm512_storeu_ps(output + i, _mm512_div_ps(_mm512_cvtepi32_ps(v), vs));
+    }
+    int16_to_floats_scalar(input + i, n - i, output + i, scale_factor);
+}
+#endif
+
+#endif /* _embed_x86_int16_H */
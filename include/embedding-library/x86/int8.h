@@ -5,12 +5,184 @@
 #ifndef _embed_x86_int8_H
 #define _embed_x86_int8_H
 
+#include "embedding-library/target.h"
+#include "embedding-library/x86/float.h"
+#include "embedding-library/fallback/int8.h"
 #include <immintrin.h>
 #include <stdint.h>
 #include <stddef.h>
 
-#if defined(__AVX512F__) && defined(__AVX512BW__)
+#if EMBED_HAVE_TARGET || defined(__AVX2__)
+/* AVX2: signed int8 × signed int8 */
+EMBED_TARGET("avx2")
+static inline int32_t int8_dot_product_avx(const int8_t *a, const int8_t *b, size_t n) {
+    __m256i acc32 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+
+        __m128i va_lo = _mm256_castsi256_si128(va);
+        __m128i va_hi = _mm256_extracti128_si256(va, 1);
+        __m128i vb_lo = _mm256_castsi256_si128(vb);
+        __m128i vb_hi = _mm256_extracti128_si256(vb, 1);
+
+        __m256i a16_lo = _mm256_cvtepi8_epi16(va_lo);
+        __m256i a16_hi = _mm256_cvtepi8_epi16(va_hi);
+        __m256i b16_lo = _mm256_cvtepi8_epi16(vb_lo);
+        __m256i b16_hi = _mm256_cvtepi8_epi16(vb_hi);
+
+        __m256i prod_lo = _mm256_mullo_epi16(a16_lo, b16_lo);
+        __m256i prod_hi = _mm256_mullo_epi16(a16_hi, b16_hi);
+
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i sums_lo = _mm256_madd_epi16(prod_lo, ones);
+        __m256i sums_hi = _mm256_madd_epi16(prod_hi, ones);
+
+        acc32 = _mm256_add_epi32(acc32, sums_lo);
+        acc32 = _mm256_add_epi32(acc32, sums_hi);
+    }
+
+    int32_t tmp[8];
+    _mm256_storeu_si256((__m256i*)tmp, acc32);
+    int32_t result = tmp[0]+tmp[1]+tmp[2]+tmp[3]+tmp[4]+tmp[5]+tmp[6]+tmp[7];
+    for (; i < n; ++i) result += (int32_t)a[i] * (int32_t)b[i];
+    return result;
+}
+
+EMBED_TARGET("avx2")
+static inline int32_t int8_hsum_epi32_avx(__m256i v) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(s);
+}
+
+/* AVX2: one query against `nrows` consecutive rows of `n` elements.
+ * Four rows share every widened query chunk, so the query is loaded once per
+ * four rows instead of once per row.
+ */
+EMBED_TARGET("avx2")
+static inline void int8_dot_product_rows_avx(const int8_t *q, const int8_t *rows,
+                                             size_t nrows, size_t n, int32_t *out) {
+    size_t r = 0;
+    for (; r + 4 <= nrows; r += 4) {
+        const int8_t *r0 = rows + (r + 0) * n;
+        const int8_t *r1 = rows + (r + 1) * n;
+        const int8_t *r2 = rows + (r + 2) * n;
+        const int8_t *r3 = rows + (r + 3) * n;
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+        __m256i acc2 = _mm256_setzero_si256();
+        __m256i acc3 = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 16 <= n; i += 16) {
+            __m256i q16 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(q + i)));
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(q16,
+                       _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(r0 + i)))));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(q16,
+                       _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(r1 + i)))));
+            acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(q16,
+                       _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(r2 + i)))));
+            acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(q16,
+                       _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(r3 + i)))));
+        }
+        int32_t s0 = int8_hsum_epi32_avx(acc0);
+        int32_t s1 = int8_hsum_epi32_avx(acc1);
+        int32_t s2 = int8_hsum_epi32_avx(acc2);
+        int32_t s3 = int8_hsum_epi32_avx(acc3);
+        for (; i < n; ++i) {
+            int32_t qi = q[i];
+            s0 += qi * r0[i];
+            s1 += qi * r1[i];
+            s2 += qi * r2[i];
+            s3 += qi * r3[i];
+        }
+        out[r + 0] = s0;
+        out[r + 1] = s1;
+        out[r + 2] = s2;
+        out[r + 3] = s3;
+    }
+    for (; r < nrows; ++r) out[r] = int8_dot_product_avx(q, rows + r * n, n);
+}
+#endif
+
+#if EMBED_HAVE_TARGET_AVXVNNI || (defined(__AVX2__) && defined(__AVXVNNI__))
+/* AVX-VNNI (VEX-encoded vpdpbusd, e.g. Alder Lake): same bias trick as the
+ * AVX-512 VNNI kernel, a·b = (a ^ 0x80)·b − 128·Σb, exact.
+ */
+EMBED_TARGET("avx2,avxvnni")
+static inline int32_t int8_dot_product_avx_vnni(const int8_t *a, const int8_t *b, size_t n) {
+    const __m256i bias = _mm256_set1_epi8((char)0x80);
+    __m256i acc  = _mm256_setzero_si256();
+    __m256i corr = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        acc  = _mm256_dpbusd_avx_epi32(acc, _mm256_xor_si256(va, bias), vb);
+        corr = _mm256_dpbusd_avx_epi32(corr, bias, vb);
+    }
+
+    int32_t result = int8_hsum_epi32_avx(_mm256_sub_epi32(acc, corr));
+    for (; i < n; ++i) result += (int32_t)a[i] * (int32_t)b[i];
+    return result;
+}
+
+/* AVX-VNNI rows kernel; rows take the unsigned side so 128·Σq is per call. */
+EMBED_TARGET("avx2,avxvnni")
+static inline void int8_dot_product_rows_avx_vnni(const int8_t *q, const int8_t *rows,
+                                                  size_t nrows, size_t n, int32_t *out) {
+    const __m256i bias = _mm256_set1_epi8((char)0x80);
+    size_t simd = n & ~(size_t)31;
+    int32_t qsum = 0;
+    for (size_t i = 0; i < simd; ++i) qsum += q[i];
+    const int32_t corr = qsum * 128;
+
+    size_t r = 0;
+    for (; r + 4 <= nrows; r += 4) {
+        const int8_t *r0 = rows + (r + 0) * n;
+        const int8_t *r1 = rows + (r + 1) * n;
+        const int8_t *r2 = rows + (r + 2) * n;
+        const int8_t *r3 = rows + (r + 3) * n;
+        __m256i acc0 = _mm256_setzero_si256();
+        __m256i acc1 = _mm256_setzero_si256();
+        __m256i acc2 = _mm256_setzero_si256();
+        __m256i acc3 = _mm256_setzero_si256();
+        for (size_t i = 0; i < simd; i += 32) {
+            __m256i vq = _mm256_loadu_si256((const __m256i*)(q + i));
+            acc0 = _mm256_dpbusd_avx_epi32(acc0, _mm256_xor_si256(
+                       _mm256_loadu_si256((const __m256i*)(r0 + i)), bias), vq);
+            acc1 = _mm256_dpbusd_avx_epi32(acc1, _mm256_xor_si256(
+                       _mm256_loadu_si256((const __m256i*)(r1 + i)), bias), vq);
+            acc2 = _mm256_dpbusd_avx_epi32(acc2, _mm256_xor_si256(
+                       _mm256_loadu_si256((const __m256i*)(r2 + i)), bias), vq);
+            acc3 = _mm256_dpbusd_avx_epi32(acc3, _mm256_xor_si256(
+                       _mm256_loadu_si256((const __m256i*)(r3 + i)), bias), vq);
+        }
+        int32_t s0 = int8_hsum_epi32_avx(acc0) - corr;
+        int32_t s1 = int8_hsum_epi32_avx(acc1) - corr;
+        int32_t s2 = int8_hsum_epi32_avx(acc2) - corr;
+        int32_t s3 = int8_hsum_epi32_avx(acc3) - corr;
+        for (size_t i = simd; i < n; ++i) {
+            int32_t qi = q[i];
+            s0 += qi * r0[i];
+            s1 += qi * r1[i];
+            s2 += qi * r2[i];
+            s3 += qi * r3[i];
+        }
+        out[r + 0] = s0;
+        out[r + 1] = s1;
+        out[r + 2] = s2;
+        out[r + 3] = s3;
+    }
+    for (; r < nrows; ++r) out[r] = int8_dot_product_avx_vnni(q, rows + r * n, n);
+}
+#endif
+
+#if EMBED_HAVE_TARGET || (defined(__AVX512F__) && defined(__AVX512BW__))
 /* AVX-512F+BW: signed int8 × signed int8 */
+EMBED_TARGET("avx512f,avx512bw")
 static inline int32_t int8_dot_product_avx512(const int8_t *a, const int8_t *b, size_t n) {
     __m512i acc32 = _mm512_setzero_si512();
     size_t i = 0;
@@ -43,41 +215,243 @@ static inline int32_t int8_dot_product_avx512(const int8_t *a, const int8_t *b,
     for (; i < n; ++i) result += (int32_t)a[i] * (int32_t)b[i];
     return result;
 }
-#elif defined(__AVX2__)
-/* AVX2: signed int8 × signed int8 */
-static inline int32_t int8_dot_product_avx(const int8_t *a, const int8_t *b, size_t n) {
-    __m256i acc32 = _mm256_setzero_si256();
+
+/* AVX-512F+BW: one query against `nrows` consecutive rows of `n` elements.
+ * Four rows share every widened query chunk, so the query is loaded once per
+ * four rows instead of once per row.
+ */
+EMBED_TARGET("avx512f,avx512bw")
+static inline void int8_dot_product_rows_avx512(const int8_t *q, const int8_t *rows,
+                                                size_t nrows, size_t n, int32_t *out) {
+    size_t r = 0;
+    for (; r + 4 <= nrows; r += 4) {
+        const int8_t *r0 = rows + (r + 0) * n;
+        const int8_t *r1 = rows + (r + 1) * n;
+        const int8_t *r2 = rows + (r + 2) * n;
+        const int8_t *r3 = rows + (r + 3) * n;
+        __m512i acc0 = _mm512_setzero_si512();
+        __m512i acc1 = _mm512_setzero_si512();
+        __m512i acc2 = _mm512_setzero_si512();
+        __m512i acc3 = _mm512_setzero_si512();
+        size_t i = 0;
+        for (; i + 32 <= n; i += 32) {
+            __m512i q16 = _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(q + i)));
+            acc0 = _mm512_add_epi32(acc0, _mm512_madd_epi16(q16,
+                       _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(r0 + i)))));
+            acc1 = _mm512_add_epi32(acc1, _mm512_madd_epi16(q16,
+                       _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(r1 + i)))));
+            acc2 = _mm512_add_epi32(acc2, _mm512_madd_epi16(q16,
+                       _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(r2 + i)))));
+            acc3 = _mm512_add_epi32(acc3, _mm512_madd_epi16(q16,
+                       _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(r3 + i)))));
+        }
+        int32_t s0 = _mm512_reduce_add_epi32(acc0);
+        int32_t s1 = _mm512_reduce_add_epi32(acc1);
+        int32_t s2 = _mm512_reduce_add_epi32(acc2);
+        int32_t s3 = _mm512_reduce_add_epi32(acc3);
+        for (; i < n; ++i) {
+            int32_t qi = q[i];
+            s0 += qi * r0[i];
+            s1 += qi * r1[i];
+            s2 += qi * r2[i];
+            s3 += qi * r3[i];
+        }
+        out[r + 0] = s0;
+        out[r + 1] = s1;
+        out[r + 2] = s2;
+        out[r + 3] = s3;
+    }
+    for (; r < nrows; ++r) out[r] = int8_dot_product_avx512(q, rows + r * n, n);
+}
+#endif
+
+#if EMBED_HAVE_TARGET || (defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VNNI__))
+/* AVX-512 VNNI: vpdpbusd multiplies unsigned × signed bytes, so bias one side
+ * into unsigned range and subtract the bias afterwards:
+ *   a·b = (a + 128)·b − 128·Σb
+ * (a + 128) is just a ^ 0x80.  vpdpbusd does not saturate, so this is exact.
+ */
+EMBED_TARGET("avx512f,avx512bw,avx512vnni")
+static inline int32_t int8_dot_product_avx512_vnni(const int8_t *a, const int8_t *b, size_t n) {
+    const __m512i bias = _mm512_set1_epi8((char)0x80);
+    __m512i acc  = _mm512_setzero_si512();
+    __m512i corr = _mm512_setzero_si512();
+    size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+        __m512i va = _mm512_loadu_si512((const void*)(a + i));
+        __m512i vb = _mm512_loadu_si512((const void*)(b + i));
+        acc  = _mm512_dpbusd_epi32(acc, _mm512_xor_si512(va, bias), vb);
+        corr = _mm512_dpbusd_epi32(corr, bias, vb);
+    }
+
+    int32_t result = _mm512_reduce_add_epi32(_mm512_sub_epi32(acc, corr));
+    for (; i < n; ++i) result += (int32_t)a[i] * (int32_t)b[i];
+    return result;
+}
+
+/* AVX-512 VNNI rows kernel.  Here the rows take the unsigned side, so the
+ * correction 128·Σq depends only on the query and is computed once per call.
+ */
+EMBED_TARGET("avx512f,avx512bw,avx512vnni")
+static inline void int8_dot_product_rows_avx512_vnni(const int8_t *q, const int8_t *rows,
+                                                     size_t nrows, size_t n, int32_t *out) {
+    const __m512i bias = _mm512_set1_epi8((char)0x80);
+    size_t simd = n & ~(size_t)63;
+    int32_t qsum = 0;
+    for (size_t i = 0; i < simd; ++i) qsum += q[i];
+    const int32_t corr = qsum * 128;
+
+    size_t r = 0;
+    for (; r + 4 <= nrows; r += 4) {
+        const int8_t *r0 = rows + (r + 0) * n;
+        const int8_t *r1 = rows + (r + 1) * n;
+        const int8_t *r2 = rows + (r + 2) * n;
+        const int8_t *r3 = rows + (r + 3) * n;
+        __m512i acc0 = _mm512_setzero_si512();
+        __m512i acc1 = _mm512_setzero_si512();
+        __m512i acc2 = _mm512_setzero_si512();
+        __m512i acc3 = _mm512_setzero_si512();
+        for (size_t i = 0; i < simd; i += 64) {
+            __m512i vq = _mm512_loadu_si512((const void*)(q + i));
+            acc0 = _mm512_dpbusd_epi32(acc0, _mm512_xor_si512(
+                       _mm512_loadu_si512((const void*)(r0 + i)), bias), vq);
+            acc1 = _mm512_dpbusd_epi32(acc1, _mm512_xor_si512(
+                       _mm512_loadu_si512((const void*)(r1 + i)), bias), vq);
+            acc2 = _mm512_dpbusd_epi32(acc2, _mm512_xor_si512(
+                       _mm512_loadu_si512((const void*)(r2 + i)), bias), vq);
+            acc3 = _mm512_dpbusd_epi32(acc3, _mm512_xor_si512(
+                       _mm512_loadu_si512((const void*)(r3 + i)), bias), vq);
+        }
+        int32_t s0 = _mm512_reduce_add_epi32(acc0) - corr;
+        int32_t s1 = _mm512_reduce_add_epi32(acc1) - corr;
+        int32_t s2 = _mm512_reduce_add_epi32(acc2) - corr;
+        int32_t s3 = _mm512_reduce_add_epi32(acc3) - corr;
+        for (size_t i = simd; i < n; ++i) {
+            int32_t qi = q[i];
+            s0 += qi * r0[i];
+            s1 += qi * r1[i];
+            s2 += qi * r2[i];
+            s3 += qi * r3[i];
+        }
+        out[r + 0] = s0;
+        out[r + 1] = s1;
+        out[r + 2] = s2;
+        out[r + 3] = s3;
+    }
+    for (; r < nrows; ++r) out[r] = int8_dot_product_avx512_vnni(q, rows + r * n, n);
+}
+#endif
+
+/* Quantization: same results as the *_scalar reference kernels, see
+ * float_round_clamp_avx().  Tails go through the scalar kernels.
+ */
+#if EMBED_HAVE_TARGET || defined(__AVX2__)
+/* four vectors of int32 (already in range) -> 32 int8 in order */
+EMBED_TARGET("avx2")
+static inline __m256i int8_pack_epi32_avx(__m256i a, __m256i b, __m256i c, __m256i d) {
+    __m256i v = _mm256_packs_epi16(_mm256_packs_epi32(a, b), _mm256_packs_epi32(c, d));
+    return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+}
+
+EMBED_TARGET("avx2")
+static inline void int8_scale_floats_avx(const float *input, size_t n, float s, int8_t *output) {
+    const __m256 vs = _mm256_set1_ps(s);
+    const __m256 lo = _mm256_set1_ps(-128.0f), hi = _mm256_set1_ps(127.0f);
     size_t i = 0;
     for (; i + 32 <= n; i += 32) {
-        __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
-        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+        __m256i a = float_round_clamp_avx(_mm256_mul_ps(_mm256_loadu_ps(input + i), vs), lo, hi);
+        __m256i b = float_round_clamp_avx(_mm256_mul_ps(_mm256_loadu_ps(input + i + 8), vs), lo, hi);
+        __m256i c = float_round_clamp_avx(_mm256_mul_ps(_mm256_loadu_ps(input + i + 16), vs), lo, hi);
+        __m256i d = float_round_clamp_avx(_mm256_mul_ps(_mm256_loadu_ps(input + i + 24), vs), lo, hi);
+        _mm256_storeu_si256((__m256i *)(output + i), int8_pack_epi32_avx(a, b, c, d));
+    }
+    int8_scale_floats_scalar(input + i, n - i, s, output + i);
+}
 
-        __m128i va_lo = _mm256_castsi256_si128(va);
-        __m128i va_hi = _mm256_extracti128_si256(va, 1);
-        __m128i vb_lo = _mm256_castsi256_si128(vb);
-        __m128i vb_hi = _mm256_extracti128_si256(vb, 1);
+EMBED_TARGET("avx2")
+static inline void int8_from_floats_avx(const float *input, size_t n, int8_t *output) {
+    float max_abs = float_max_abs_avx(input, n);
+    if (max_abs == 0.0f) max_abs = 1.0f;
+    int8_scale_floats_avx(input, n, 127.0f / max_abs, output);
+}
 
-        __m256i a16_lo = _mm256_cvtepi8_epi16(va_lo);
-        __m256i a16_hi = _mm256_cvtepi8_epi16(va_hi);
-        __m256i b16_lo = _mm256_cvtepi8_epi16(vb_lo);
-        __m256i b16_hi = _mm256_cvtepi8_epi16(vb_hi);
+EMBED_TARGET("avx2")
+static inline void int8_from_int16s_avx(const int16_t *input, size_t n, int8_t *output) {
+    const __m256 vs = _mm256_set1_ps(127.0f / 32767.0f);
+    const __m256 lo = _mm256_set1_ps(-128.0f), hi = _mm256_set1_ps(127.0f);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i *)(input + i));
+        __m256i v1 = _mm256_loadu_si256((const __m256i *)(input + i + 16));
+        __m256i w[4] = { _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v0)),
+                         _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v0, 1)),
+                         _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v1)),
+                         _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v1, 1)) };
+        for (int j = 0; j < 4; ++j)
+            w[j] = float_round_clamp_avx(_mm256_mul_ps(_mm256_cvtepi32_ps(w[j]), vs), lo, hi);
+        _mm256_storeu_si256((__m256i *)(output + i), int8_pack_epi32_avx(w[0], w[1], w[2], w[3]));
+    }
+    int8_from_int16s_scalar(input + i, n - i, output + i);
+}
 
-        __m256i prod_lo = _mm256_mullo_epi16(a16_lo, b16_lo);
-        __m256i prod_hi = _mm256_mullo_epi16(a16_hi, b16_hi);
+/* a true division per element, as the reference does, so results match */
+EMBED_TARGET("avx2")
+static inline void int8_to_floats_avx(const int8_t *input, size_t n, float *output,
+                                      float scale_factor) {
+    const __m256 vs = _mm256_set1_ps(scale_factor);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i *)(input + i)));
+        _mm256_storeu_ps(output + i, _mm256_div_ps(_mm256_cvtepi32_ps(v), vs));
+    }
+    int8_to_floats_scalar(input + i, n - i, output + i, scale_factor);
+}
+#endif
 
-        const __m256i ones = _mm256_set1_epi16(1);
-        __m256i sums_lo = _mm256_madd_epi16(prod_lo, ones);
-        __m256i sums_hi = _mm256_madd_epi16(prod_hi, ones);
+#if EMBED_HAVE_TARGET || defined(__AVX512F__)
+EMBED_TARGET("avx512f")
+static inline void int8_scale_floats_avx512(const float *input, size_t n, float s,
+                                            int8_t *output) {
+    const __m512 vs = _mm512_set1_ps(s);
+    const __m512 lo = _mm512_set1_ps(-128.0f), hi = _mm512_set1_ps(127.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i v = float_round_clamp_avx512(_mm512_mul_ps(_mm512_loadu_ps(input + i), vs), lo, hi);
+        _mm_storeu_si128((__m128i *)(output + i), _mm512_cvtsepi32_epi8(v));
+    }
+    int8_scale_floats_scalar(input + i, n - i, s, output + i);
+}
 
-        acc32 = _mm256_add_epi32(acc32, sums_lo);
-        acc32 = _mm256_add_epi32(acc32, sums_hi);
+EMBED_TARGET("avx512f")
+static inline void int8_from_floats_avx512(const float *input, size_t n, int8_t *output) {
+    float max_abs = float_max_abs_avx512(input, n);
+    if (max_abs == 0.0f) max_abs = 1.0f;
+    int8_scale_floats_avx512(input, n, 127.0f / max_abs, output);
+}
+
+EMBED_TARGET("avx512f")
+static inline void int8_from_int16s_avx512(const int16_t *input, size_t n, int8_t *output) {
+    const __m512 vs = _mm512_set1_ps(127.0f / 32767.0f);
+    const __m512 lo = _mm512_set1_ps(-128.0f), hi = _mm512_set1_ps(127.0f);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i w = _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)(input + i)));
+        w = float_round_clamp_avx512(_mm512_mul_ps(_mm512_cvtepi32_ps(w), vs), lo, hi);
+        _mm_storeu_si128((__m128i *)(output + i), _mm512_cvtsepi32_epi8(w));
     }
+    int8_from_int16s_scalar(input + i, n - i, output + i);
+}
 
-    int32_t tmp[8];
-    _mm256_storeu_si256((__m256i*)tmp, acc32);
-    int32_t result = tmp[0]+tmp[1]+tmp[2]+tmp[3]+tmp[4]+tmp[5]+tmp[6]+tmp[7];
-    for (; i < n; ++i) result += (int32_t)a[i] * (int32_t)b[i];
-    return result;
+EMBED_TARGET("avx512f")
+static inline void int8_to_floats_avx512(const int8_t *input, size_t n, float *output,
+                                         float scale_factor) {
+    const __m512 vs = _mm512_set1_ps(scale_factor);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i v = _mm512_cvtepi8_epi32(_mm_loadu_si128((const __m128i *)(input + i)));
+        _mm512_storeu_ps(output + i, _mm512_div_ps(_mm512_cvtepi32_ps(v), vs));
+    }
+    int8_to_floats_scalar(input + i, n - i, output + i, scale_factor);
 }
 #endif
 
@@ -0,0 +1,132 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "crc32c.h"
+#include "embedding-library/dispatch.h"
+#include "embedding-library/target.h"
+#include <stdatomic.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__) && (EMBED_HAVE_TARGET_CRC || defined(__ARM_FEATURE_CRC32))
+#include <arm_acle.h>
+#define EMBED_ARM_CRC 1
+#endif
+
+#define CRC32C_POLY 0x82F63B78u     /* reflected Castagnoli polynomial */
+
+typedef uint32_t (*crc32c_cb)(uint32_t crc, const unsigned char *p, size_t len);
+
+/* ---- slicing-by-8 fallback ------------------------------------------------ */
+
+static uint32_t crc_table[8][256];
+static atomic_int crc_table_ready;
+
+static void crc_table_init(void) {
+    if (atomic_load_explicit(&crc_table_ready, memory_order_acquire)) return;
+    /* filling twice from racing callers writes identical values */
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = (c >> 1) ^ (CRC32C_POLY & (0u - (c & 1u)));
+        crc_table[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = crc_table[0][i];
+        for (int s = 1; s < 8; s++) {
+            c = crc_table[0][c & 0xFF] ^ (c >> 8);
+            crc_table[s][i] = c;
+        }
+    }
+    atomic_store_explicit(&crc_table_ready, 1, memory_order_release);
+}
+
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t len) {
+    crc_table_init();
+    while (len >= 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        lo = __builtin_bswap32(lo);
+        hi = __builtin_bswap32(hi);
+#endif
+        lo ^= crc;
+        crc = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF] ^
+              crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24] ^
+              crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF] ^
+              crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = crc_table[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+/* ---- hardware ------------------------------------------------------------- */
+
+#if defined(__x86_64__) && (EMBED_HAVE_TARGET || defined(__SSE4_2__))
+#define HAVE_HW_CRC 1
+EMBED_TARGET("sse4.2")
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *p, size_t len) {
+    uint64_t c = crc;
+    while (len >= 32) {
+        uint64_t a, b, d, e;
+        memcpy(&a, p, 8);
+        memcpy(&b, p + 8, 8);
+        memcpy(&d, p + 16, 8);
+        memcpy(&e, p + 24, 8);
+        c = _mm_crc32_u64(c, a);
+        c = _mm_crc32_u64(c, b);
+        c = _mm_crc32_u64(c, d);
+        c = _mm_crc32_u64(c, e);
+        p += 32;
+        len -= 32;
+    }
+    while (len >= 8) {
+        uint64_t a;
+        memcpy(&a, p, 8);
+        c = _mm_crc32_u64(c, a);
+        p += 8;
+        len -= 8;
+    }
+    uint32_t c32 = (uint32_t)c;
+    while (len--) c32 = _mm_crc32_u8(c32, *p++);
+    return c32;
+}
+#define HW_CRC_FEATURE EMBEDDING_CPU_SSE42
+#elif defined(EMBED_ARM_CRC)
+#define HAVE_HW_CRC 1
+EMBED_TARGET_CRC
+static uint32_t crc32c_hw(uint32_t crc, const unsigned char *p, size_t len) {
+    while (len >= 8) {
+        uint64_t a;
+        memcpy(&a, p, 8);
+        crc = __crc32cd(crc, a);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) crc = __crc32cb(crc, *p++);
+    return crc;
+}
+#define HW_CRC_FEATURE EMBEDDING_CPU_CRC32
+#endif
+
+static _Atomic(crc32c_cb) resolved;
+
+static crc32c_cb resolve(void) {
+#if defined(HAVE_HW_CRC)
+    if (embedding_cpu_features() & HW_CRC_FEATURE) return crc32c_hw;
+#endif
+    return crc32c_sw;
+}
+
+uint32_t embedding_crc32c(uint32_t crc, const void *buf, size_t len) {
+    crc32c_cb cb = atomic_load_explicit(&resolved, memory_order_acquire);
+    if (!cb) {
+        cb = resolve();
+        atomic_store_explicit(&resolved, cb, memory_order_release);
+    }
+    return ~cb(~crc, (const unsigned char *)buf, len);
+}
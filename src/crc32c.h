@@ -0,0 +1,20 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_crc32c_H
+#define _embed_crc32c_H
+
+/* CRC32C (Castagnoli) used by the file format; not installed.
+ *
+ * Uses the SSE4.2 / ARMv8 crc32c instructions when the host has them and a
+ * slicing-by-8 table otherwise.  Calls chain: pass the previous result as
+ * `crc` to continue a running checksum, 0 to start one.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+uint32_t embedding_crc32c(uint32_t crc, const void *buf, size_t len);
+
+#endif // _embed_crc32c_H
@@ -0,0 +1,316 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "embedding-library/dispatch.h"
+#include "embedding-library/float.h"
+#include "embedding-library/int16.h"
+#include "embedding-library/int8.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define EMBED_X86 1
+#include <cpuid.h>
+#elif defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#elif defined(__aarch64__) && defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+/* ---- feature probing ----------------------------------------------------- */
+
+#if defined(EMBED_X86)
+static uint64_t read_xcr0(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static uint32_t probe_features(void) {
+    uint32_t eax, ebx, ecx, edx;
+    uint32_t f = 0;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return 0;
+    if ((ecx >> 20) & 1) f |= EMBEDDING_CPU_SSE42;
+    if ((ecx >> 23) & 1) f |= EMBEDDING_CPU_POPCNT;
+    int osxsave = (ecx >> 27) & 1;
+    int avx     = (ecx >> 28) & 1;
+    if (!osxsave || !avx) return f;
+
+    /* the OS must save YMM (bits 1,2) and, for AVX-512, opmask/ZMM (bits 5-7) */
+    uint64_t xcr0 = read_xcr0();
+    int ymm_ok = (xcr0 & 0x6) == 0x6;
+    int zmm_ok = ymm_ok && (xcr0 & 0xE0) == 0xE0;
+    if (!ymm_ok) return f;
+    f |= EMBEDDING_CPU_AVX;
+
+    if (__get_cpuid_max(0, NULL) < 7) return f;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if ((ebx >> 5) & 1) f |= EMBEDDING_CPU_AVX2;
+    if (zmm_ok) {
+        if ((ebx >> 16) & 1) f |= EMBEDDING_CPU_AVX512F;
+        if ((ebx >> 30) & 1) f |= EMBEDDING_CPU_AVX512BW;
+        if ((ecx >> 11) & 1) f |= EMBEDDING_CPU_AVX512VNNI;
+        if ((ecx >> 14) & 1) f |= EMBEDDING_CPU_AVX512VPOPCNTDQ;
+    }
+    __cpuid_count(7, 1, eax, ebx, ecx, edx);
+    if ((eax >> 4) & 1) f |= EMBEDDING_CPU_AVXVNNI;
+    return f;
+}
+#elif defined(__aarch64__) && defined(__linux__)
+#ifndef HWCAP_ASIMDDP
+#define HWCAP_ASIMDDP (1ul << 20)
+#endif
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1ul << 7)
+#endif
+#ifndef HWCAP_SVE
+#define HWCAP_SVE (1ul << 22)
+#endif
+static uint32_t probe_features(void) {
+    unsigned long hw = getauxval(AT_HWCAP);
+    uint32_t f = EMBEDDING_CPU_NEON;  /* AdvSIMD is mandatory on AArch64 */
+    if (hw & HWCAP_ASIMDDP) f |= EMBEDDING_CPU_DOTPROD;
+    if (hw & HWCAP_SVE)     f |= EMBEDDING_CPU_SVE;
+    if (hw & HWCAP_CRC32)   f |= EMBEDDING_CPU_CRC32;
+    return f;
+}
+#elif defined(__aarch64__) && defined(__APPLE__)
+static uint32_t probe_features(void) {
+    uint32_t f = EMBEDDING_CPU_NEON;
+    int v = 0;
+    size_t len = sizeof(v);
+    if (sysctlbyname("hw.optional.arm.FEAT_DotProd", &v, &len, NULL, 0) == 0 && v)
+        f |= EMBEDDING_CPU_DOTPROD;
+    f |= EMBEDDING_CPU_CRC32;   /* every Apple AArch64 core has it */
+    return f;
+}
+#elif defined(__ARM_NEON)
+static uint32_t probe_features(void) {
+    return EMBEDDING_CPU_NEON;
+}
+#else
+static uint32_t probe_features(void) {
+    return 0;
+}
+#endif
+
+/* ---- kernel sets, best first ---------------------------------------------- */
+
+#if defined(EMBED_X86)
+#if EMBED_HAVE_TARGET || defined(__AVX2__)
+#define HAVE_AVX2_KERNELS 1
+#endif
+#if EMBED_HAVE_TARGET_AVXVNNI || (defined(__AVX2__) && defined(__AVXVNNI__))
+#define HAVE_AVXVNNI_KERNELS 1
+#endif
+#if EMBED_HAVE_TARGET || (defined(__AVX512F__) && defined(__AVX512BW__))
+#define HAVE_AVX512_KERNELS 1
+#endif
+#if EMBED_HAVE_TARGET || \
+    (defined(__AVX512F__) && defined(__AVX512BW__) && defined(__AVX512VNNI__))
+#define HAVE_AVX512VNNI_KERNELS 1
+#endif
+#endif
+
+/* Each rows kernel again with the embedding size fixed at compile time.  The
+ * wrapper carries the kernel's target so the static inline body is inlined
+ * into it and specialised for the constant size.
+ */
+#define ROWS_FIXED(kernel, attr, dim)                                          \
+    attr static void kernel##_##dim(const int8_t *q, const int8_t *rows,      \
+                                    size_t nrows, size_t size, int32_t *out) { \
+        (void)size;                                                            \
+        kernel(q, rows, nrows, dim, out);                                      \
+    }
+#define ROWS_FIXED_ALL(kernel, attr) \
+    ROWS_FIXED(kernel, attr, 384) ROWS_FIXED(kernel, attr, 512) \
+    ROWS_FIXED(kernel, attr, 768) ROWS_FIXED(kernel, attr, 1024)
+#define ROWS_FIXED_SET(kernel) \
+    { kernel##_384, kernel##_512, kernel##_768, kernel##_1024 }
+
+/* the quantization kernels of one ISA, in struct order */
+#define QUANTIZE_SET(isa) \
+    int8_from_floats_##isa, int8_from_int16s_##isa, int8_to_floats_##isa, \
+    int16_from_floats_##isa, int16_to_floats_##isa, float_max_abs_##isa, int8_scale_floats_##isa
+
+#if defined(HAVE_AVX512VNNI_KERNELS)
+ROWS_FIXED_ALL(int8_dot_product_rows_avx512_vnni, EMBED_TARGET("avx512f,avx512bw,avx512vnni"))
+#endif
+#if defined(HAVE_AVX512_KERNELS)
+ROWS_FIXED_ALL(int8_dot_product_rows_avx512, EMBED_TARGET("avx512f,avx512bw"))
+#endif
+#if defined(HAVE_AVXVNNI_KERNELS)
+ROWS_FIXED_ALL(int8_dot_product_rows_avx_vnni, EMBED_TARGET("avx2,avxvnni"))
+#endif
+#if defined(HAVE_AVX2_KERNELS)
+ROWS_FIXED_ALL(int8_dot_product_rows_avx, EMBED_TARGET("avx2"))
+#endif
+#if defined(__ARM_NEON) && defined(__ARM_FEATURE_SVE)
+ROWS_FIXED_ALL(int8_dot_product_rows_sve, )
+#endif
+#if defined(__ARM_NEON) && (EMBED_HAVE_TARGET_DOTPROD || defined(__ARM_FEATURE_DOTPROD))
+ROWS_FIXED_ALL(int8_dot_product_rows_neon_dotprod, EMBED_TARGET_DOTPROD)
+#endif
+#if defined(__ARM_NEON)
+ROWS_FIXED_ALL(int8_dot_product_rows_neon, )
+#endif
+ROWS_FIXED_ALL(int8_dot_product_rows_scalar, )
+
+static const embedding_kernels_t kernel_sets[] = {
+#if defined(HAVE_AVX512VNNI_KERNELS)
+    { "avx512_vnni",
+      EMBEDDING_CPU_AVX512F | EMBEDDING_CPU_AVX512BW | EMBEDDING_CPU_AVX512VNNI,
+      dot_product_avx512, int8_dot_product_avx512_vnni, int8_dot_product_rows_avx512_vnni,
+      int16_dot_product_avx512, QUANTIZE_SET(avx512),
+      ROWS_FIXED_SET(int8_dot_product_rows_avx512_vnni) },
+#endif
+#if defined(HAVE_AVX512_KERNELS)
+    { "avx512",
+      EMBEDDING_CPU_AVX512F | EMBEDDING_CPU_AVX512BW,
+      dot_product_avx512, int8_dot_product_avx512, int8_dot_product_rows_avx512,
+      int16_dot_product_avx512, QUANTIZE_SET(avx512),
+      ROWS_FIXED_SET(int8_dot_product_rows_avx512) },
+#endif
+#if defined(HAVE_AVXVNNI_KERNELS)
+    { "avx_vnni",
+      EMBEDDING_CPU_AVX | EMBEDDING_CPU_AVX2 | EMBEDDING_CPU_AVXVNNI,
+      dot_product_avx, int8_dot_product_avx_vnni, int8_dot_product_rows_avx_vnni,
+      int16_dot_product_avx, QUANTIZE_SET(avx),
+      ROWS_FIXED_SET(int8_dot_product_rows_avx_vnni) },
+#endif
+#if defined(HAVE_AVX2_KERNELS)
+    { "avx2",
+      EMBEDDING_CPU_AVX | EMBEDDING_CPU_AVX2,
+      dot_product_avx, int8_dot_product_avx, int8_dot_product_rows_avx,
+      int16_dot_product_avx, QUANTIZE_SET(avx),
+      ROWS_FIXED_SET(int8_dot_product_rows_avx) },
+#endif
+#if defined(__ARM_NEON) && defined(__ARM_FEATURE_SVE)
+    { "sve",
+      EMBEDDING_CPU_NEON | EMBEDDING_CPU_SVE,
+      dot_product_neon, int8_dot_product_sve, int8_dot_product_rows_sve,
+      int16_dot_product_neon, QUANTIZE_SET(neon),
+      ROWS_FIXED_SET(int8_dot_product_rows_sve) },
+#endif
+#if defined(__ARM_NEON) && (EMBED_HAVE_TARGET_DOTPROD || defined(__ARM_FEATURE_DOTPROD))
+    { "neon_dotprod",
+      EMBEDDING_CPU_NEON | EMBEDDING_CPU_DOTPROD,
+      dot_product_neon, int8_dot_product_neon_dotprod, int8_dot_product_rows_neon_dotprod,
+      int16_dot_product_neon, QUANTIZE_SET(neon),
+      ROWS_FIXED_SET(int8_dot_product_rows_neon_dotprod) },
+#endif
+#if defined(__ARM_NEON)
+    { "neon",
+      EMBEDDING_CPU_NEON,
+      dot_product_neon, int8_dot_product_neon, int8_dot_product_rows_neon,
+      int16_dot_product_neon, QUANTIZE_SET(neon),
+      ROWS_FIXED_SET(int8_dot_product_rows_neon) },
+#endif
+    { "scalar", 0,
+      dot_product_scalar, int8_dot_product_scalar, int8_dot_product_rows_scalar,
+      int16_dot_product_scalar, QUANTIZE_SET(scalar),
+      ROWS_FIXED_SET(int8_dot_product_rows_scalar) },
+};
+
+#define NUM_KERNEL_SETS (sizeof(kernel_sets) / sizeof(kernel_sets[0]))
+
+static atomic_uint cpu_features;      /* probed bits | 0x80000000 once valid */
+static _Atomic(const embedding_kernels_t *) resolved;
+
+uint32_t embedding_cpu_features(void) {
+    unsigned v = atomic_load_explicit(&cpu_features, memory_order_relaxed);
+    if (!(v & 0x80000000u)) {
+        v = probe_features() | 0x80000000u;
+        atomic_store_explicit(&cpu_features, v, memory_order_relaxed);
+    }
+    return v & ~0x80000000u;
+}
+
+static const embedding_kernels_t *resolve(void) {
+    uint32_t f = embedding_cpu_features();
+    const char *want = getenv("EMBEDDING_LIBRARY_KERNELS");
+
+    if (want && *want) {
+        for (size_t i = 0; i < NUM_KERNEL_SETS; i++) {
+            const embedding_kernels_t *k = &kernel_sets[i];
+            if (!strcmp(k->name, want) && (k->required & f) == k->required)
+                return k;
+        }
+    }
+    for (size_t i = 0; i < NUM_KERNEL_SETS; i++) {
+        const embedding_kernels_t *k = &kernel_sets[i];
+        if ((k->required & f) == k->required) return k;
+    }
+    return &kernel_sets[NUM_KERNEL_SETS - 1];
+}
+
+const embedding_kernels_t *embedding_kernels(void) {
+    /* resolution is idempotent, so racing first callers just agree */
+    const embedding_kernels_t *k = atomic_load_explicit(&resolved, memory_order_acquire);
+    if (!k) {
+        k = resolve();
+        atomic_store_explicit(&resolved, k, memory_order_release);
+    }
+    return k;
+}
+
+const embedding_kernels_t *embedding_kernel_set(size_t i) {
+    return i < NUM_KERNEL_SETS ? &kernel_sets[i] : NULL;
+}
+
+embedding_int8_dot_product_rows_cb embedding_int8_rows_kernel(const embedding_kernels_t *k,
+                                                              size_t size) {
+    static const size_t dims[EMBEDDING_FIXED_DIMS] = EMBEDDING_FIXED_DIM_LIST;
+    for (size_t i = 0; i < EMBEDDING_FIXED_DIMS; i++) {
+        if (dims[i] == size) return k->int8_dot_product_rows_fixed[i];
+    }
+    return k->int8_dot_product_rows;
+}
+
+float dot_product_dispatch(const float *a, const float *b, size_t size) {
+    return embedding_kernels()->dot_product(a, b, size);
+}
+
+int32_t int8_dot_product_dispatch(const int8_t *a, const int8_t *b, size_t size) {
+    return embedding_kernels()->int8_dot_product(a, b, size);
+}
+
+void int8_dot_product_rows_dispatch(const int8_t *query, const int8_t *rows,
+                                    size_t nrows, size_t size, int32_t *out) {
+    embedding_kernels()->int8_dot_product_rows(query, rows, nrows, size, out);
+}
+
+int64_t int16_dot_product_dispatch(const int16_t *a, const int16_t *b, size_t size) {
+    return embedding_kernels()->int16_dot_product(a, b, size);
+}
+
+void int8_from_floats_dispatch(const float *input, size_t size, int8_t *output) {
+    embedding_kernels()->int8_from_floats(input, size, output);
+}
+
+void int8_from_int16s_dispatch(const int16_t *input, size_t size, int8_t *output) {
+    embedding_kernels()->int8_from_int16s(input, size, output);
+}
+
+void int8_to_floats_dispatch(const int8_t *input, size_t size, float *output, float scale_factor) {
+    embedding_kernels()->int8_to_floats(input, size, output, scale_factor);
+}
+
+void int16_from_floats_dispatch(const float *input, size_t size, int16_t *output) {
+    embedding_kernels()->int16_from_floats(input, size, output);
+}
+
+void int16_to_floats_dispatch(const int16_t *input, size_t size, float *output, float scale_factor) {
+    embedding_kernels()->int16_to_floats(input, size, output, scale_factor);
+}
+
+float int8_from_floats_scaled_dispatch(const float *input, size_t size, int8_t *output) {
+    const embedding_kernels_t *k = embedding_kernels();
+    float max_abs = k->float_max_abs(input, size);
+    if (max_abs == 0.0f) max_abs = 1.0f;
+    k->int8_scale_floats(input, size, 127.0f / max_abs, output);
+    return max_abs / 127.0f;
+}
@@ -0,0 +1,170 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "embedding-library/embedding_allocator.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static void *heap_alloc(void *ctx, size_t size, size_t alignment) {
+    (void)ctx;
+    void *p = NULL;
+#if defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200112L
+    if (alignment < sizeof(void *)) alignment = sizeof(void *);
+    if (posix_memalign(&p, alignment, size) != 0) p = NULL;
+#else
+    (void)alignment;
+    p = malloc(size);
+#endif
+    return p;
+}
+
+static void heap_free(void *ctx, void *p, size_t size) {
+    (void)ctx;
+    (void)size;
+    free(p);
+}
+
+const embedding_allocator_t embedding_heap_allocator = { heap_alloc, heap_free, NULL };
+
+#define ARENA_ALIGN        64u
+#define ARENA_CHUNK        (16u * 1024u * 1024u)
+#define ARENA_SIZE_CLASSES 16u
+
+typedef struct chunk_s {
+    struct chunk_s *next;
+} chunk_t;
+
+/* header space at the start of each chunk, keeping pieces 64-byte aligned */
+#define CHUNK_HEADER ((sizeof(chunk_t) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+typedef struct {
+    size_t size;
+    void *head;          /* freed pieces, linked through their first word */
+} size_class_t;
+
+struct embedding_arena_s {
+    pthread_mutex_t lock;
+    size_t chunk_bytes;
+    chunk_t *chunks;
+    char *cur;           /* bump pointer into the newest shared chunk */
+    size_t left;
+    size_class_t classes[ARENA_SIZE_CLASSES];
+    size_t num_classes;
+    size_t reserved;
+    size_t used;
+};
+
+embedding_arena_t *embedding_arena_init(size_t chunk_bytes) {
+    embedding_arena_t *a = (embedding_arena_t *)calloc(1, sizeof(*a));
+    if (!a) return NULL;
+    pthread_mutex_init(&a->lock, NULL);
+    a->chunk_bytes = chunk_bytes ? chunk_bytes : ARENA_CHUNK;
+    return a;
+}
+
+void embedding_arena_destroy(embedding_arena_t *a) {
+    if (!a) return;
+    chunk_t *c = a->chunks;
+    while (c) {
+        chunk_t *next = c->next;
+        free(c);
+        c = next;
+    }
+    pthread_mutex_destroy(&a->lock);
+    free(a);
+}
+
+static size_class_t *size_class(embedding_arena_t *a, size_t size, int create) {
+    for (size_t i = 0; i < a->num_classes; i++)
+        if (a->classes[i].size == size) return &a->classes[i];
+    if (!create || a->num_classes == ARENA_SIZE_CLASSES) return NULL;
+    size_class_t *c = &a->classes[a->num_classes++];
+    c->size = size;
+    c->head = NULL;
+    return c;
+}
+
+/* a new chunk with room for at least size bytes; NULL if out of memory */
+static char *new_chunk(embedding_arena_t *a, size_t bytes) {
+    void *mem = heap_alloc(NULL, bytes, ARENA_ALIGN);
+    if (!mem) return NULL;
+    chunk_t *c = (chunk_t *)mem;
+    c->next = a->chunks;
+    a->chunks = c;
+    a->reserved += bytes;
+    return (char *)mem + CHUNK_HEADER;
+}
+
+static void *arena_alloc(void *ctx, size_t size, size_t alignment) {
+    embedding_arena_t *a = (embedding_arena_t *)ctx;
+    if (alignment > ARENA_ALIGN || size == 0) return NULL;
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    pthread_mutex_lock(&a->lock);
+    void *p = NULL;
+    size_class_t *c = size_class(a, size, 0);
+    if (c && c->head) {
+        p = c->head;
+        c->head = *(void **)p;
+    } else if (size + CHUNK_HEADER > a->chunk_bytes) {
+        p = new_chunk(a, size + CHUNK_HEADER);       /* oversized: a chunk of its own */
+    } else {
+        if (size > a->left) {
+            /* the old chunk's tail is abandoned */
+            char *mem = new_chunk(a, a->chunk_bytes);
+            if (mem) {
+                a->cur = mem;
+                a->left = a->chunk_bytes - CHUNK_HEADER;
+            }
+        }
+        if (size <= a->left) {
+            p = a->cur;
+            a->cur += size;
+            a->left -= size;
+        }
+    }
+    if (p) a->used += size;
+    pthread_mutex_unlock(&a->lock);
+    if (!p) fprintf(stderr, "embedding_arena_alloc: out of memory\n");
+    return p;
+}
+
+static void arena_free(void *ctx, void *p, size_t size) {
+    embedding_arena_t *a = (embedding_arena_t *)ctx;
+    if (!p) return;
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+
+    pthread_mutex_lock(&a->lock);
+    /* with every size class taken the piece stays unused until destroy() */
+    size_class_t *c = size_class(a, size, 1);
+    if (c) {
+        *(void **)p = c->head;
+        c->head = p;
+    }
+    a->used -= size;
+    pthread_mutex_unlock(&a->lock);
+}
+
+embedding_allocator_t embedding_arena_allocator(embedding_arena_t *a) {
+    embedding_allocator_t r = { arena_alloc, arena_free, a };
+    return r;
+}
+
+size_t embedding_arena_reserved(const embedding_arena_t *a) {
+    embedding_arena_t *m = (embedding_arena_t *)a;
+    pthread_mutex_lock(&m->lock);
+    size_t r = m->reserved;
+    pthread_mutex_unlock(&m->lock);
+    return r;
+}
+
+size_t embedding_arena_used(const embedding_arena_t *a) {
+    embedding_arena_t *m = (embedding_arena_t *)a;
+    pthread_mutex_lock(&m->lock);
+    size_t r = m->used;
+    pthread_mutex_unlock(&m->lock);
+    return r;
+}
@@ -0,0 +1,138 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "embedding-library/embedding_filter.h"
+#include "embedding_node.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef _Atomic(embedding_bitmap_block_t *) block_slot_t;
+
+embedding_bitmap_t *embedding_bitmap_init(void) {
+    return (embedding_bitmap_t *)calloc(1, sizeof(embedding_bitmap_t));
+}
+
+void embedding_bitmap_destroy(embedding_bitmap_t *b) {
+    if (!b) return;
+    block_slot_t *blocks = atomic_load_explicit(&b->blocks, memory_order_relaxed);
+    size_t n = atomic_load_explicit(&b->num_blocks, memory_order_relaxed);
+    for (size_t i = 0; i < n; i++) free(atomic_load_explicit(&blocks[i], memory_order_relaxed));
+    free(blocks);
+    for (size_t i = 0; i < b->num_retired; i++) free(b->retired[i]);
+    free(b->retired);
+    free(b);
+}
+
+/* Make slot node addressable.  A larger slot array replaces the old one,
+ * which is kept until destroy() for readers that loaded it.
+ */
+static int reserve_slots(embedding_bitmap_t *b, size_t node) {
+    size_t n = atomic_load_explicit(&b->num_blocks, memory_order_relaxed);
+    if (node < n) return 0;
+    block_slot_t *blocks = atomic_load_explicit(&b->blocks, memory_order_relaxed);
+    if (node >= b->capacity) {
+        size_t capacity = b->capacity ? b->capacity : 64;
+        while (capacity <= node) capacity *= 2;
+        void **retired = (void **)realloc(b->retired, (b->num_retired + 1) * sizeof(*retired));
+        if (!retired) return -1;
+        b->retired = retired;
+        block_slot_t *grown = (block_slot_t *)malloc(capacity * sizeof(*grown));
+        if (!grown) return -1;
+        for (size_t i = 0; i < n; i++)
+            atomic_init(&grown[i], atomic_load_explicit(&blocks[i], memory_order_relaxed));
+        for (size_t i = n; i < capacity; i++) atomic_init(&grown[i], NULL);
+        atomic_store_explicit(&b->blocks, grown, memory_order_release);
+        if (blocks) b->retired[b->num_retired++] = blocks;
+        b->capacity = capacity;
+    }
+    atomic_store_explicit(&b->num_blocks, node + 1, memory_order_release);
+    return 0;
+}
+
+int embedding_bitmap_set(embedding_bitmap_t *b, size_t id) {
+    if (!b) return -1;
+    size_t node = id >> NODE_SHIFT;
+    if (reserve_slots(b, node) != 0) {
+        fprintf(stderr, "embedding_bitmap_set: out of memory\n");
+        return -1;
+    }
+    block_slot_t *blocks = atomic_load_explicit(&b->blocks, memory_order_relaxed);
+    embedding_bitmap_block_t *blk = atomic_load_explicit(&blocks[node], memory_order_relaxed);
+    if (!blk) {
+        blk = (embedding_bitmap_block_t *)calloc(1, sizeof(*blk));
+        if (!blk) {
+            fprintf(stderr, "embedding_bitmap_set: out of memory\n");
+            return -1;
+        }
+        atomic_store_explicit(&blocks[node], blk, memory_order_release);
+    }
+    uint64_t bit = (uint64_t)1 << (id & 63);
+    uint64_t old = atomic_fetch_or_explicit(&blk->words[(id & (NODE_CAPACITY - 1)) >> 6], bit,
+                                            memory_order_relaxed);
+    if (!(old & bit)) atomic_fetch_add_explicit(&b->count, 1, memory_order_relaxed);
+    return 0;
+}
+
+void embedding_bitmap_clear(embedding_bitmap_t *b, size_t id) {
+    if (!b) return;
+    const embedding_bitmap_block_t *c = embedding_bitmap_block(b, id >> NODE_SHIFT);
+    if (!c) return;
+    embedding_bitmap_block_t *blk = (embedding_bitmap_block_t *)c;
+    uint64_t bit = (uint64_t)1 << (id & 63);
+    uint64_t old = atomic_fetch_and_explicit(&blk->words[(id & (NODE_CAPACITY - 1)) >> 6], ~bit,
+                                             memory_order_relaxed);
+    if (old & bit) atomic_fetch_sub_explicit(&b->count, 1, memory_order_relaxed);
+}
+
+/* a op b block by block; a block with no bits left is not allocated */
+static embedding_bitmap_t *combine(const embedding_bitmap_t *a, const embedding_bitmap_t *b,
+                                   int both) {
+    if (!a || !b) return NULL;
+    embedding_bitmap_t *out = embedding_bitmap_init();
+    if (!out) return NULL;
+    size_t na = atomic_load_explicit(&((embedding_bitmap_t *)a)->num_blocks, memory_order_acquire);
+    size_t nb = atomic_load_explicit(&((embedding_bitmap_t *)b)->num_blocks, memory_order_acquire);
+    size_t n = both ? (na < nb ? na : nb) : (na > nb ? na : nb);
+    for (size_t i = 0; i < n; i++) {
+        const embedding_bitmap_block_t *x = embedding_bitmap_block(a, i);
+        const embedding_bitmap_block_t *y = embedding_bitmap_block(b, i);
+        if (both ? (!x || !y) : (!x && !y)) continue;
+        uint64_t words[EMBEDDING_BITMAP_BLOCK_WORDS];
+        uint64_t any = 0;
+        for (size_t w = 0; w < EMBEDDING_BITMAP_BLOCK_WORDS; w++) {
+            uint64_t xw = x ? atomic_load_explicit(&x->words[w], memory_order_relaxed) : 0;
+            uint64_t yw = y ? atomic_load_explicit(&y->words[w], memory_order_relaxed) : 0;
+            words[w] = both ? xw & yw : xw | yw;
+            any |= words[w];
+        }
+        if (!any) continue;
+        if (reserve_slots(out, i) != 0) {
+            embedding_bitmap_destroy(out);
+            return NULL;
+        }
+        embedding_bitmap_block_t *blk = (embedding_bitmap_block_t *)calloc(1, sizeof(*blk));
+        if (!blk) {
+            embedding_bitmap_destroy(out);
+            return NULL;
+        }
+        size_t count = 0;
+        for (size_t w = 0; w < EMBEDDING_BITMAP_BLOCK_WORDS; w++) {
+            atomic_init(&blk->words[w], words[w]);
+            count += embedding_popcount64(words[w]);
+        }
+        block_slot_t *blocks = atomic_load_explicit(&out->blocks, memory_order_relaxed);
+        atomic_store_explicit(&blocks[i], blk, memory_order_release);
+        atomic_fetch_add_explicit(&out->count, count, memory_order_relaxed);
+    }
+    return out;
+}
+
+embedding_bitmap_t *embedding_bitmap_and(const embedding_bitmap_t *a, const embedding_bitmap_t *b) {
+    return combine(a, b, 1);
+}
+
+embedding_bitmap_t *embedding_bitmap_or(const embedding_bitmap_t *a, const embedding_bitmap_t *b) {
+    return combine(a, b, 0);
+}
@@ -0,0 +1,254 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "embedding_slab.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define SLAB_MIN_BLOCKS 32u
+#define MAX_NUMA_NODES  64u   /* one word of node mask */
+
+/* Parse a sysfs list such as "0-3,8,10-11", calling fn for every id in it. */
+static void parse_list(const char *s, void (*fn)(void *ctx, size_t id), void *ctx) {
+    while (*s && *s != '\n') {
+        char *end;
+        unsigned long lo = strtoul(s, &end, 10), hi = lo;
+        if (end == s) return;
+        s = end;
+        if (*s == '-') {
+            hi = strtoul(s + 1, &end, 10);
+            if (end == s + 1) return;
+            s = end;
+        }
+        for (unsigned long i = lo; i <= hi; i++) fn(ctx, (size_t)i);
+        if (*s == ',') s++;
+    }
+}
+
+static int read_sysfs(const char *path, char *buf, size_t size) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    size_t n = fread(buf, 1, size - 1, fp);
+    fclose(fp);
+    buf[n] = 0;
+    return n ? 0 : -1;
+}
+
+static void count_max(void *ctx, size_t id) {
+    size_t *max = (size_t *)ctx;
+    if (id + 1 > *max) *max = id + 1;
+}
+
+static size_t probe_numa_nodes(void) {
+    char buf[256];
+    size_t n = 0;
+    if (read_sysfs("/sys/devices/system/node/online", buf, sizeof(buf)) == 0)
+        parse_list(buf, count_max, &n);
+    if (n == 0) n = 1;
+    if (n > MAX_NUMA_NODES) n = MAX_NUMA_NODES;
+    return n;
+}
+
+static size_t numa_nodes;
+static pthread_once_t numa_once = PTHREAD_ONCE_INIT;
+
+static void numa_init(void) {
+    numa_nodes = probe_numa_nodes();
+}
+
+size_t embedding_numa_nodes(void) {
+    pthread_once(&numa_once, numa_init);
+    return numa_nodes;
+}
+
+typedef struct {
+    int *cpus;
+    size_t max;
+    size_t n;
+} cpu_list_t;
+
+static void add_cpu(void *ctx, size_t id) {
+    cpu_list_t *l = (cpu_list_t *)ctx;
+    if (l->n < l->max) l->cpus[l->n] = (int)id;
+    l->n++;
+}
+
+size_t embedding_numa_node_cpus(size_t node, int *cpus, size_t max) {
+    char path[64], buf[1024];
+    cpu_list_t l = { cpus, cpus ? max : 0, 0 };
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%zu/cpulist", node);
+    if (read_sysfs(path, buf, sizeof(buf)) == 0) {
+        parse_list(buf, add_cpu, &l);
+    } else if (node == 0 && embedding_numa_nodes() == 1) {
+        /* no NUMA information: every CPU counts as node 0 */
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long i = 0; i < n; i++) add_cpu(&l, (size_t)i);
+    }
+    return l.n;
+}
+
+/* mbind(2) without a libnuma dependency; placement is best effort */
+#if defined(__linux__) && defined(SYS_mbind)
+#define SLAB_MPOL_PREFERRED  1
+#define SLAB_MPOL_INTERLEAVE 3
+static void slab_mbind(void *addr, size_t len, int mode, unsigned long mask) {
+    syscall(SYS_mbind, addr, len, mode, &mask, (unsigned long)MAX_NUMA_NODES + 1, 0u);
+}
+#endif
+
+typedef struct {
+    void *base;
+    size_t bytes;
+} slab_map_t;
+
+struct embedding_slab_s {
+    pthread_mutex_t lock;
+    size_t block_bytes;
+    size_t slab_bytes;
+    size_t blocks_per_slab;
+    uint32_t flags;
+    size_t numa_nodes;
+
+    slab_map_t *slabs;
+    size_t num_slabs;
+    size_t slabs_size;
+    size_t next_block;   /* first never-used block of the newest slab */
+    void *free_list;     /* freed blocks, linked through their first word */
+};
+
+embedding_slab_t *embedding_slab_init(size_t block_bytes, uint32_t flags) {
+    const uint32_t known = EMBEDDING_MEMORY_HUGEPAGES | EMBEDDING_MEMORY_HUGETLB |
+                           EMBEDDING_MEMORY_NUMA_INTERLEAVE | EMBEDDING_MEMORY_NUMA_SPREAD;
+    if (block_bytes == 0 || (flags & ~known)) return NULL;
+    if ((flags & EMBEDDING_MEMORY_NUMA_INTERLEAVE) && (flags & EMBEDDING_MEMORY_NUMA_SPREAD))
+        return NULL;
+
+    embedding_slab_t *s = (embedding_slab_t *)calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    pthread_mutex_init(&s->lock, NULL);
+    s->block_bytes = (block_bytes + 63) & ~(size_t)63;
+    s->slab_bytes = s->block_bytes * SLAB_MIN_BLOCKS;
+    s->slab_bytes = (s->slab_bytes + EMBEDDING_MEMORY_SLAB_ALIGN - 1) &
+                    ~(size_t)(EMBEDDING_MEMORY_SLAB_ALIGN - 1);
+    s->blocks_per_slab = s->slab_bytes / s->block_bytes;
+    s->next_block = s->blocks_per_slab;    /* no slab yet */
+    s->flags = flags;
+    s->numa_nodes = embedding_numa_nodes();
+    return s;
+}
+
+void embedding_slab_destroy(embedding_slab_t *s) {
+    if (!s) return;
+    for (size_t i = 0; i < s->num_slabs; i++)
+        munmap(s->slabs[i].base, s->slabs[i].bytes);
+    free(s->slabs);
+    pthread_mutex_destroy(&s->lock);
+    free(s);
+}
+
+/* NUMA node slab i is placed on */
+static uint32_t slab_numa(const embedding_slab_t *s, size_t i) {
+    return (s->flags & EMBEDDING_MEMORY_NUMA_SPREAD) ? (uint32_t)(i % s->numa_nodes) : 0;
+}
+
+/* map one 2 MiB-aligned slab and set its policy before any page is touched */
+static void *map_slab(const embedding_slab_t *s, size_t index) {
+    const size_t align = EMBEDDING_MEMORY_SLAB_ALIGN;
+    void *base = NULL;
+#if defined(MAP_HUGETLB)
+    if (s->flags & EMBEDDING_MEMORY_HUGETLB) {
+        void *p = mmap(NULL, s->slab_bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) base = p;
+    }
+#endif
+    if (!base) {
+        /* over-map by one alignment, then trim to an aligned window */
+        char *p = (char *)mmap(NULL, s->slab_bytes + align, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == (char *)MAP_FAILED) return NULL;
+        size_t head = (align - ((uintptr_t)p & (align - 1))) & (align - 1);
+        if (head) munmap(p, head);
+        if (align - head) munmap(p + head + s->slab_bytes, align - head);
+        base = p + head;
+#if defined(MADV_HUGEPAGE)
+        if (s->flags & (EMBEDDING_MEMORY_HUGEPAGES | EMBEDDING_MEMORY_HUGETLB))
+            madvise(base, s->slab_bytes, MADV_HUGEPAGE);
+#endif
+    }
+#if defined(SLAB_MPOL_PREFERRED)
+    if (s->numa_nodes > 1) {
+        if (s->flags & EMBEDDING_MEMORY_NUMA_INTERLEAVE) {
+            unsigned long all = s->numa_nodes == MAX_NUMA_NODES
+                                    ? ~0ul : (1ul << s->numa_nodes) - 1;
+            slab_mbind(base, s->slab_bytes, SLAB_MPOL_INTERLEAVE, all);
+        } else if (s->flags & EMBEDDING_MEMORY_NUMA_SPREAD) {
+            slab_mbind(base, s->slab_bytes, SLAB_MPOL_PREFERRED, 1ul << slab_numa(s, index));
+        }
+    }
+#else
+    (void)index;
+#endif
+    return base;
+}
+
+void *embedding_slab_alloc(embedding_slab_t *s, uint32_t *numa) {
+    pthread_mutex_lock(&s->lock);
+    void *block = s->free_list;
+    if (block) {
+        s->free_list = *(void **)block;
+        /* the block's slab: linear, but reuse only follows a failed batch */
+        size_t i = 0;
+        while ((char *)block < (char *)s->slabs[i].base ||
+               (char *)block >= (char *)s->slabs[i].base + s->slabs[i].bytes)
+            i++;
+        if (numa) *numa = slab_numa(s, i);
+        pthread_mutex_unlock(&s->lock);
+        memset(block, 0, s->block_bytes);
+        return block;
+    }
+    if (s->next_block == s->blocks_per_slab) {
+        if (s->num_slabs == s->slabs_size) {
+            size_t n = s->slabs_size ? s->slabs_size * 2 : 16;
+            slab_map_t *p = (slab_map_t *)realloc(s->slabs, n * sizeof(*p));
+            if (!p) {
+                pthread_mutex_unlock(&s->lock);
+                return NULL;
+            }
+            s->slabs = p;
+            s->slabs_size = n;
+        }
+        void *base = map_slab(s, s->num_slabs);
+        if (!base) {
+            perror("embedding_slab_alloc: mmap");
+            pthread_mutex_unlock(&s->lock);
+            return NULL;
+        }
+        s->slabs[s->num_slabs].base = base;
+        s->slabs[s->num_slabs].bytes = s->slab_bytes;
+        s->num_slabs++;
+        s->next_block = 0;
+    }
+    /* fresh anonymous memory is already zero */
+    block = (char *)s->slabs[s->num_slabs - 1].base + s->next_block * s->block_bytes;
+    s->next_block++;
+    if (numa) *numa = slab_numa(s, s->num_slabs - 1);
+    pthread_mutex_unlock(&s->lock);
+    return block;
+}
+
+void embedding_slab_free(embedding_slab_t *s, void *block) {
+    if (!s || !block) return;
+    pthread_mutex_lock(&s->lock);
+    *(void **)block = s->free_list;
+    s->free_list = block;
+    pthread_mutex_unlock(&s->lock);
+}
@@ -0,0 +1,133 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_node_H
+#define _embed_node_H
+
+/* Node block layout shared by the int8 / int16 / float tables; not installed.
+ *
+ * Every table stores rows in nodes of 512.  A node's block is
+ *   [512 norms | per-row extras | 512 rows of dim elements | padding]
+ * padded to whole pages, so blocks can be written and mapped verbatim.  The
+ * table's EMBEDDING_TABLE_LAYOUT_* bits (see
+ * embedding-library/embedding_table_file.h) give the norms' width and the
+ * per-row extras present.
+ */
+
+#include "embedding-library/embedding_table_file.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EMBEDDING_DIM     512u      /* default dim, and the only one legacy files hold */
+#define EMBEDDING_MAX_DIM 65536u    /* keeps 127 * 127 * dim inside an int32 */
+#define NODE_CAPACITY     512u      /* a node stores 512 embeddings */
+#define NODE_SHIFT        9u        /* log2(NODE_CAPACITY) */
+#define NODE_PAGE         4096u
+#define NODE_DELETED_WORDS (NODE_CAPACITY / 64u)  /* uint64 tombstone words per node */
+
+/* bytes of a block's norms: 512 doubles, 512 floats (1/norm) or none */
+static inline size_t embedding_node_norms_bytes(uint32_t layout) {
+    if (layout & EMBEDDING_TABLE_LAYOUT_NORMALIZED) return 0;
+    if (layout & EMBEDDING_TABLE_LAYOUT_INV_NORMS) return (size_t)NODE_CAPACITY * sizeof(float);
+    return (size_t)NODE_CAPACITY * sizeof(double);
+}
+
+/* byte offset of the per-row scales in a block (when the layout has them) */
+static inline size_t embedding_node_scales_offset(uint32_t layout) {
+    return embedding_node_norms_bytes(layout);
+}
+
+/* byte offset of the first row in a block (a multiple of 64) */
+static inline size_t embedding_node_data_offset(uint32_t layout) {
+    size_t offset = embedding_node_norms_bytes(layout);
+    if (layout & EMBEDDING_TABLE_LAYOUT_ROW_SCALES) offset += (size_t)NODE_CAPACITY * sizeof(float);
+    return offset;
+}
+
+/* bytes of one block of dim-element rows (no padding for multiples of 8 bytes) */
+static inline size_t embedding_node_bytes(size_t dim, size_t elem_size, uint32_t layout) {
+    size_t bytes = embedding_node_data_offset(layout) + (size_t)NODE_CAPACITY * dim * elem_size;
+    return (bytes + NODE_PAGE - 1) & ~(size_t)(NODE_PAGE - 1);
+}
+
+/* Zero the padding after a block's last row, so its checksum only depends
+ * on its rows.
+ */
+static inline void embedding_node_block_clear_padding(void *block, size_t dim, size_t elem_size,
+                                                      uint32_t layout) {
+    size_t used = embedding_node_data_offset(layout) + (size_t)NODE_CAPACITY * dim * elem_size;
+    memset((char *)block + used, 0, embedding_node_bytes(dim, elem_size, layout) - used);
+}
+
+/* Allocate one block with its padding cleared.  returns NULL on failure */
+static inline double *embedding_node_block_alloc(size_t dim, size_t elem_size, uint32_t layout) {
+    const size_t bytes = embedding_node_bytes(dim, elem_size, layout);
+
+    void *mem = NULL;
+#if defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200112L
+    if (posix_memalign(&mem, 64, bytes) != 0) {
+        mem = NULL; /* fall through to malloc */
+    }
+#endif
+    if (!mem) {
+        mem = malloc(bytes);
+        if (!mem) return NULL;
+    }
+    embedding_node_block_clear_padding(mem, dim, elem_size, layout);
+    return (double *)mem;
+}
+
+static inline size_t embedding_nodes_for_rows(size_t rows) {
+    return (rows + NODE_CAPACITY - 1) >> NODE_SHIFT;
+}
+
+/* Bits of the rows among a node's first `count` that fall in tombstone word w,
+ * i.e. rows [64 * w, 64 * w + 64)
+ */
+static inline uint64_t embedding_node_rows_mask(uint32_t count, uint32_t w) {
+    uint32_t left = count > w * 64u ? count - w * 64u : 0;
+    return left >= 64u ? ~(uint64_t)0 : (((uint64_t)1 << left) - 1);
+}
+
+/* index of the lowest set bit of a non-zero word */
+static inline unsigned embedding_ctz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(x);
+#else
+    unsigned n = 0;
+    while (!(x & 1u)) {
+        x >>= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+/* number of leading zero bits of a non-zero word */
+static inline unsigned embedding_clz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_clzll(x);
+#else
+    unsigned n = 0;
+    while (!(x & (1ull << 63))) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static inline unsigned embedding_popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(x);
+#else
+    unsigned n = 0;
+    for (; x; x &= x - 1) n++;
+    return n;
+#endif
+}
+
+#endif // _embed_node_H
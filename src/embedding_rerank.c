@@ -0,0 +1,184 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "embedding-library/embedding_rerank.h"
+#include "embedding-library/dispatch.h"
+#include "embedding_topk.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_ids(const void *a, const void *b) {
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Stage one: the int8 top-(k * oversample) of coarse, sorted by id so stage
+ * two walks the fine table (possibly a cold mapping) front to back.
+ * returns a malloc'd array of *count ids, or NULL
+ */
+static size_t *scan_candidates(int8_embedding_table_t *coarse, embedding_thread_pool_t *pool,
+                               const int8_t *query8, size_t k, size_t oversample,
+                               size_t *count) {
+    if (oversample == 0) oversample = EMBEDDING_RERANK_DEFAULT_OVERSAMPLE;
+    size_t total = int8_embedding_table_size(coarse);
+    size_t n = k > total / oversample ? total : k * oversample;
+    *count = 0;
+    if (n == 0) return NULL;
+
+    size_t *ids = (size_t *)malloc(n * sizeof(*ids));
+    if (!ids) return NULL;
+    n = int8_embedding_table_topk_parallel(coarse, pool, query8, -1.0, n, ids, NULL);
+    qsort(ids, n, sizeof(*ids), cmp_ids);
+    *count = n;
+    return ids;
+}
+
+/* Stage two plumbing shared by both fine types: ids in, best k out */
+typedef struct {
+    embedding_topk_entry_t *storage;
+    embedding_topk_t h;
+} rerank_heap_t;
+
+static int rerank_heap_init(rerank_heap_t *r, size_t k) {
+    r->storage = (embedding_topk_entry_t *)malloc((k ? k : 1) * sizeof(*r->storage));
+    if (!r->storage) return -1;
+    embedding_topk_init(&r->h, r->storage, k);
+    return 0;
+}
+
+static size_t rerank_heap_finish(rerank_heap_t *r, size_t *out_ids, double *out_scores) {
+    size_t n = embedding_topk_drain(&r->h, out_ids, out_scores);
+    free(r->storage);
+    return n;
+}
+
+static void stats_set(embedding_rerank_stats_t *stats, size_t candidates,
+                      uint64_t t0, uint64_t t1, uint64_t t2) {
+    if (!stats) return;
+    stats->candidates = candidates;
+    stats->scan_ns = t1 - t0;
+    stats->rerank_ns = t2 - t1;
+}
+
+/* Row id of fine scored exactly as float_embedding_table_topk() scores it
+ * (the node's norms, inverse norms or neither), so a rerank over every row is
+ * that scan
+ */
+static double fine_float_score(float_embedding_table_t *fine, embedding_dot_product_cb dot,
+                               const float *query, double query_norm, size_t id) {
+    const float_embedding_node_t *n = fine->table[id >> 9];
+    size_t slot = id & 0x1FF;
+    double dp = dot(query, n->data + slot * fine->dim, fine->dim);
+    if (n->norms) return dp / (query_norm * n->norms[slot]);
+    double score = dp * (1.0 / query_norm);
+    return n->inv_norms ? score * n->inv_norms[slot] : score;
+}
+
+size_t embedding_rerank_float(int8_embedding_table_t *coarse, float_embedding_table_t *fine,
+                              embedding_thread_pool_t *pool,
+                              const float *query, double query_norm, const int8_t *query8,
+                              size_t k, size_t oversample,
+                              size_t *out_ids, double *out_scores,
+                              embedding_rerank_stats_t *stats) {
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (!coarse || !fine || !query || k == 0 || coarse->dim != fine->dim) return 0;
+    size_t dim = fine->dim;
+
+    if (query_norm < 0.0) {
+        double dp = dot_product_dispatch(query, query, dim);
+        query_norm = dp > 0.0 ? sqrt(dp) : 0.0;
+    }
+    if (query_norm == 0.0) return 0;
+
+    int8_t *scratch = NULL;
+    if (!query8) {
+        if (!(scratch = (int8_t *)malloc(dim))) return 0;
+        int8_from_floats_dispatch(query, dim, scratch);
+        query8 = scratch;
+    }
+
+    uint64_t t0 = now_ns();
+    size_t count;
+    size_t *ids = scan_candidates(coarse, pool, query8, k, oversample, &count);
+    free(scratch);
+    uint64_t t1 = now_ns();
+    if (!ids) return 0;
+
+    rerank_heap_t r;
+    if (rerank_heap_init(&r, k < count ? k : count) != 0) {
+        free(ids);
+        return 0;
+    }
+    embedding_dot_product_cb dot = embedding_kernels()->dot_product;
+    size_t fine_rows = float_embedding_table_size(fine);
+    for (size_t i = 0; i < count; i++) {
+        if (ids[i] >= fine_rows) continue;   /* row missing from the fine table */
+        double score = fine_float_score(fine, dot, query, query_norm, ids[i]);
+        if (embedding_topk_accepts(&r.h, score))
+            embedding_topk_push(&r.h, score, ids[i]);
+    }
+    free(ids);
+    size_t n = rerank_heap_finish(&r, out_ids, out_scores);
+    stats_set(stats, count, t0, t1, now_ns());
+    return n;
+}
+
+size_t embedding_rerank_int16(int8_embedding_table_t *coarse, int16_embedding_table_t *fine,
+                              embedding_thread_pool_t *pool,
+                              const int16_t *query, double query_norm, const int8_t *query8,
+                              size_t k, size_t oversample,
+                              size_t *out_ids, double *out_scores,
+                              embedding_rerank_stats_t *stats) {
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (!coarse || !fine || !query || k == 0 || coarse->dim != fine->dim) return 0;
+    size_t dim = fine->dim;
+
+    if (query_norm < 0.0) {
+        int64_t dp = int16_dot_product_dispatch(query, query, dim);
+        query_norm = dp > 0 ? sqrt((double)dp) : 0.0;
+    }
+    if (query_norm == 0.0) return 0;
+
+    int8_t *scratch = NULL;
+    if (!query8) {
+        if (!(scratch = (int8_t *)malloc(dim))) return 0;
+        int8_from_int16s_dispatch(query, dim, scratch);
+        query8 = scratch;
+    }
+
+    uint64_t t0 = now_ns();
+    size_t count;
+    size_t *ids = scan_candidates(coarse, pool, query8, k, oversample, &count);
+    free(scratch);
+    uint64_t t1 = now_ns();
+    if (!ids) return 0;
+
+    rerank_heap_t r;
+    if (rerank_heap_init(&r, k < count ? k : count) != 0) {
+        free(ids);
+        return 0;
+    }
+    embedding_int16_dot_product_cb dot = embedding_kernels()->int16_dot_product;
+    size_t fine_rows = int16_embedding_table_size(fine);
+    for (size_t i = 0; i < count; i++) {
+        if (ids[i] >= fine_rows) continue;   /* row missing from the fine table */
+        const int16_t *row = int16_embedding_table_embedding(fine, ids[i]);
+        double norm = int16_embedding_table_norm(fine, ids[i]);
+        double score = (double)dot(query, row, dim) / (query_norm * norm);
+        if (embedding_topk_accepts(&r.h, score))
+            embedding_topk_push(&r.h, score, ids[i]);
+    }
+    free(ids);
+    size_t n = rerank_heap_finish(&r, out_ids, out_scores);
+    stats_set(stats, count, t0, t1, now_ns());
+    return n;
+}
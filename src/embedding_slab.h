@@ -0,0 +1,35 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_slab_H
+#define _embed_slab_H
+
+/* Fixed-size node blocks carved out of 2 MiB-aligned slabs placed according
+ * to an EMBEDDING_MEMORY_* mode (see embedding-library/embedding_memory.h).
+ * Allocation and free are mutex-protected, since parallel batch ingest
+ * allocates from several threads.  Not installed.
+ */
+
+#include "embedding-library/embedding_memory.h"
+#include <stdint.h>
+#include <stddef.h>
+
+struct embedding_slab_s;
+typedef struct embedding_slab_s embedding_slab_t;
+
+/* block_bytes is rounded up to 64; NULL on failure or for unknown bits */
+embedding_slab_t *embedding_slab_init(size_t block_bytes, uint32_t flags);
+
+/* unmaps every slab, including blocks still handed out */
+void embedding_slab_destroy(embedding_slab_t *s);
+
+/* A zeroed block; *numa receives the NUMA node it was placed on
+ * (0 without EMBEDDING_MEMORY_NUMA_SPREAD).  NULL if out of memory.
+ */
+void *embedding_slab_alloc(embedding_slab_t *s, uint32_t *numa);
+
+/* return a block for reuse by a later alloc */
+void embedding_slab_free(embedding_slab_t *s, void *block);
+
+#endif // _embed_slab_H
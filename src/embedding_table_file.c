@@ -0,0 +1,1191 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "embedding_table_file.h"
+#include "crc32c.h"
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <limits.h>
+
+#if defined(IOV_MAX)
+#define EMBEDDING_IOV_MAX IOV_MAX
+#else
+#define EMBEDDING_IOV_MAX 1024
+#endif
+
+#define FILE_MAGIC       "I8EMBTBL"
+#define FILE_VERSION     6u         /* newest version, the one files are written with */
+#define FILE_HEADER_SIZE 4096u      /* one page, so node blocks stay page aligned */
+#define FILE_NORM_F64    1u         /* double norm per row */
+#define FILE_NORM_F32_INV 2u        /* float 1/norm per row */
+#define FILE_NORM_NONE   3u         /* normalized rows, no norms */
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint32_t dim;
+    uint32_t node_capacity;
+    uint64_t node_bytes;
+    uint64_t num_rows;
+    uint64_t num_nodes;
+    /* version 2; zero in version 1 files */
+    uint32_t elem_type;        /* EMBEDDING_ELEM_* */
+    uint32_t norm_type;        /* FILE_NORM_*, implied by the layout */
+    uint32_t norms_offset;     /* byte offsets inside a node block */
+    uint32_t data_offset;
+    uint64_t crc_offset;       /* num_nodes uint32 CRC32C, one per node block */
+    uint32_t crc_table_crc;    /* CRC32C of that table */
+    uint32_t header_crc;       /* CRC32C of the header (up to here before version 3)
+                                  with header_crc = 0 */
+    /* version 3; zero before */
+    uint32_t layout;           /* EMBEDDING_TABLE_LAYOUT_* bits */
+    uint32_t scales_offset;    /* per-row scales inside a node block, 0 if none */
+    uint32_t channel_crc;      /* CRC32C of the channel section */
+    uint32_t deleted_crc;      /* version 4: CRC32C of the deleted section */
+    uint64_t channel_offset;   /* 2 * dim floats behind the CRC table, 0 if none */
+    /* version 4; zero before */
+    uint64_t deleted_offset;   /* NODE_DELETED_WORDS uint64 tombstone words per
+                                  node behind the channel section (or CRC table),
+                                  0 if no row is deleted */
+    /* version 5; zero before */
+    uint64_t table_id;         /* identity of the table the rows were written from */
+    /* version 6; zero before */
+    uint64_t generation;       /* new on every write: which commit the file holds */
+} file_header_t;
+
+#define FILE_HEADER_V2_BYTES offsetof(file_header_t, layout)
+#define FILE_HEADER_V3_BYTES offsetof(file_header_t, deleted_offset)
+#define FILE_HEADER_V4_BYTES offsetof(file_header_t, table_id)
+#define FILE_HEADER_V5_BYTES offsetof(file_header_t, generation)
+#define FILE_KNOWN_LAYOUT    (EMBEDDING_TABLE_LAYOUT_ROW_SCALES | EMBEDDING_TABLE_LAYOUT_INV_NORMS | \
+                              EMBEDDING_TABLE_LAYOUT_NORMALIZED)
+
+size_t embedding_elem_size(uint32_t elem_type) {
+    switch (elem_type) {
+    case EMBEDDING_ELEM_INT8:  return sizeof(int8_t);
+    case EMBEDDING_ELEM_FLOAT: return sizeof(float);
+    case EMBEDDING_ELEM_INT16: return sizeof(int16_t);
+    default:                   return 0;
+    }
+}
+
+/* version 1 files predate the field and only hold int8 rows */
+static uint32_t elem_type_of(const file_header_t *h) {
+    return h->version == 1u ? EMBEDDING_ELEM_INT8 : h->elem_type;
+}
+
+static uint32_t layout_of(const file_header_t *h) {
+    return h->version >= 3u ? h->layout : 0;
+}
+
+static uint64_t table_id_of(const file_header_t *h) {
+    return h->version >= 5u ? h->table_id : 0;
+}
+
+static uint64_t generation_of(const file_header_t *h) {
+    return h->version >= 6u ? h->generation : 0;
+}
+
+uint64_t embedding_table_new_id(void) {
+    /* clock, process and a per-process counter through splitmix64: unique
+     * enough to tell tables apart, no entropy source needed
+     */
+    static atomic_uint_fast64_t counter;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t x = (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+    x ^= (uint64_t)getpid() << 40;
+    x += (atomic_fetch_add(&counter, 1) + 1) * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    x ^= x >> 31;
+    return x ? x : 1;
+}
+
+static uint32_t norm_type_of(uint32_t layout) {
+    if (layout & EMBEDDING_TABLE_LAYOUT_NORMALIZED) return FILE_NORM_NONE;
+    if (layout & EMBEDDING_TABLE_LAYOUT_INV_NORMS) return FILE_NORM_F32_INV;
+    return FILE_NORM_F64;
+}
+
+static uint32_t header_crc(const file_header_t *h) {
+    file_header_t tmp = *h;
+    tmp.header_crc = 0;
+    size_t bytes = h->version >= 6u ? sizeof(tmp)
+                 : h->version == 5u ? FILE_HEADER_V5_BYTES
+                 : h->version == 4u ? FILE_HEADER_V4_BYTES
+                 : h->version == 3u ? FILE_HEADER_V3_BYTES : FILE_HEADER_V2_BYTES;
+    return embedding_crc32c(0, &tmp, bytes);
+}
+
+/* Check a header read from a file of `file_size` bytes.
+ * returns 0 if it describes a table this build can load, -1 otherwise
+ */
+static int check_header(const file_header_t *h, size_t file_size) {
+    if (file_size < FILE_HEADER_SIZE) return -1;
+    if (memcmp(h->magic, FILE_MAGIC, sizeof(h->magic)) != 0) return -1;
+    if (h->version < 1u || h->version > FILE_VERSION) return -1;
+    if (h->version >= 2u && h->header_crc != header_crc(h)) return -1;
+    if (h->header_size != FILE_HEADER_SIZE) return -1;
+    size_t elem_size = embedding_elem_size(elem_type_of(h));
+    if (elem_size == 0) return -1;
+    if (h->dim == 0 || h->dim > EMBEDDING_MAX_DIM) return -1;
+    if (h->version == 1u && h->dim != EMBEDDING_DIM) return -1;
+    if (h->node_capacity != NODE_CAPACITY) return -1;
+    uint32_t layout = layout_of(h);
+    if (layout & ~FILE_KNOWN_LAYOUT) return -1;
+    if ((layout & EMBEDDING_TABLE_LAYOUT_INV_NORMS) &&
+        (layout & EMBEDDING_TABLE_LAYOUT_NORMALIZED)) return -1;
+    if (h->node_bytes != embedding_node_bytes(h->dim, elem_size, layout)) return -1;
+    if (h->num_nodes != embedding_nodes_for_rows(h->num_rows)) return -1;
+    if (h->num_nodes > (file_size - FILE_HEADER_SIZE) / h->node_bytes) return -1;
+    if (h->version == 1u) return 0;
+
+    if (h->norm_type != norm_type_of(layout)) return -1;
+    if (h->norms_offset != 0 ||
+        h->data_offset != embedding_node_data_offset(layout)) return -1;
+    if (h->scales_offset != ((layout & EMBEDDING_TABLE_LAYOUT_ROW_SCALES)
+                                 ? embedding_node_scales_offset(layout) : 0)) return -1;
+    if (h->crc_offset != FILE_HEADER_SIZE + h->num_nodes * h->node_bytes) return -1;
+    if (h->num_nodes * sizeof(uint32_t) > file_size - h->crc_offset) return -1;
+    if (h->channel_offset != 0) {
+        if (h->channel_offset != h->crc_offset + h->num_nodes * sizeof(uint32_t)) return -1;
+        if (2u * h->dim * sizeof(float) > file_size - h->channel_offset) return -1;
+    }
+    if (h->version >= 4u && h->deleted_offset != 0) {
+        size_t at = h->crc_offset + h->num_nodes * sizeof(uint32_t);
+        if (h->channel_offset) at += 2u * h->dim * sizeof(float);
+        if (h->deleted_offset != at) return -1;
+        if (h->num_nodes * NODE_DELETED_WORDS * sizeof(uint64_t) > file_size - at) return -1;
+    }
+    return 0;
+}
+
+/* Read and check the header of an open file; returns 0 if it is loadable */
+static int read_header(int fd, file_header_t *h, size_t *file_size) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < FILE_HEADER_SIZE) return -1;
+    if (pread(fd, h, sizeof(*h), 0) != (ssize_t)sizeof(*h)) return -1;
+    *file_size = (size_t)st.st_size;
+    return check_header(h, *file_size);
+}
+
+/* Read and check the per-node CRC table of a version 2 file.
+ * returns a malloc'd array of h->num_nodes entries, or NULL
+ */
+static uint32_t *read_crcs(int fd, const file_header_t *h) {
+    size_t bytes = (size_t)h->num_nodes * sizeof(uint32_t);
+    uint32_t *crcs = (uint32_t *)malloc(bytes + sizeof(uint32_t));
+    if (!crcs) return NULL;
+    if (pread(fd, crcs, bytes, (off_t)h->crc_offset) != (ssize_t)bytes ||
+        embedding_crc32c(0, crcs, bytes) != h->crc_table_crc) {
+        free(crcs);
+        return NULL;
+    }
+    return crcs;
+}
+
+/* Read and check the channel section of a file that has one (else *out is
+ * NULL).  returns 0 on success, -1 if it is unreadable or corrupt
+ */
+static int read_channel(int fd, const file_header_t *h, float **out) {
+    *out = NULL;
+    if (h->version < 3u || h->channel_offset == 0) return 0;
+    size_t bytes = 2u * h->dim * sizeof(float);
+    float *channel = (float *)malloc(bytes);
+    if (!channel) return -1;
+    if (pread(fd, channel, bytes, (off_t)h->channel_offset) != (ssize_t)bytes ||
+        embedding_crc32c(0, channel, bytes) != h->channel_crc) {
+        free(channel);
+        return -1;
+    }
+    *out = channel;
+    return 0;
+}
+
+/* Read and check the deleted section of a file that has one (else *out is
+ * NULL).  returns 0 on success, -1 if it is unreadable or corrupt
+ */
+static int read_deleted(int fd, const file_header_t *h, uint64_t **out) {
+    *out = NULL;
+    if (h->version < 4u || h->deleted_offset == 0) return 0;
+    size_t bytes = (size_t)h->num_nodes * NODE_DELETED_WORDS * sizeof(uint64_t);
+    uint64_t *deleted = (uint64_t *)malloc(bytes + sizeof(uint64_t));
+    if (!deleted) return -1;
+    if (pread(fd, deleted, bytes, (off_t)h->deleted_offset) != (ssize_t)bytes ||
+        embedding_crc32c(0, deleted, bytes) != h->deleted_crc) {
+        free(deleted);
+        return -1;
+    }
+    *out = deleted;
+    return 0;
+}
+
+/* rows held by node i of a table with num_rows rows */
+static uint32_t node_rows(size_t num_rows, size_t i) {
+    size_t rows = num_rows - (i << NODE_SHIFT);
+    return rows < NODE_CAPACITY ? (uint32_t)rows : NODE_CAPACITY;
+}
+
+/* record `node` as failed, keeping the lowest failing node */
+static void note_bad(atomic_size_t *first_bad, size_t node) {
+    size_t cur = atomic_load_explicit(first_bad, memory_order_relaxed);
+    while (node < cur &&
+           !atomic_compare_exchange_weak_explicit(first_bad, &cur, node,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+/* a few contiguous runs of nodes per pool thread */
+static size_t split_nodes(embedding_thread_pool_t *pool, size_t num_nodes,
+                          size_t *nodes_per_part) {
+    size_t parts = embedding_thread_pool_size(pool) * 4;
+    if (parts > num_nodes) parts = num_nodes;
+    *nodes_per_part = parts ? (num_nodes + parts - 1) / parts : 0;
+    return parts ? (num_nodes + *nodes_per_part - 1) / *nodes_per_part : 0;
+}
+
+/* ---- writing ------------------------------------------------------------- */
+
+#define WRITE_SPAN_NODES 16u       /* nodes per write: ~4 MiB per syscall */
+#define COPY_CHUNK       (1u << 20)
+#define JOURNAL_MAGIC    "I8EMBJNL"
+
+/* An undo journal, filename + ".journal": what a commit is about to
+ * overwrite.  [this header, padded to a page | the file's header page |
+ * bytes [offset, file_size) of the file]
+ */
+typedef struct {
+    char     magic[8];
+    uint64_t file_size;        /* size of the file when the commit began */
+    uint64_t offset;           /* start of the saved bytes (a node boundary) */
+    uint32_t data_crc;         /* CRC32C of the saved header page and bytes */
+    uint32_t crc;              /* CRC32C of this struct with crc = 0 */
+} journal_header_t;
+
+static uint32_t journal_crc(const journal_header_t *j) {
+    journal_header_t tmp = *j;
+    tmp.crc = 0;
+    return embedding_crc32c(0, &tmp, sizeof(tmp));
+}
+
+static char *path_with(const char *filename, const char *suffix) {
+    size_t n = strlen(filename), m = strlen(suffix);
+    char *p = (char *)malloc(n + m + 1);
+    if (!p) return NULL;
+    memcpy(p, filename, n);
+    memcpy(p + n, suffix, m + 1);
+    return p;
+}
+
+static int sync_fd(int fd) {
+#if defined(__linux__)
+    return fdatasync(fd);
+#else
+    return fsync(fd);
+#endif
+}
+
+/* make a create, rename or unlink in filename's directory durable */
+static void sync_dir(const char *filename) {
+    const char *slash = strrchr(filename, '/');
+    char *dir = slash ? (char *)malloc((size_t)(slash - filename) + 2) : NULL;
+    if (slash && !dir) return;
+    if (dir) {
+        size_t n = slash == filename ? 1 : (size_t)(slash - filename);
+        memcpy(dir, filename, n);
+        dir[n] = 0;
+    }
+    int fd = open(dir ? dir : ".", O_RDONLY);
+    free(dir);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+static int pwrite_full(int fd, const void *buf, size_t bytes, off_t off) {
+    const char *p = (const char *)buf;
+    while (bytes > 0) {
+        ssize_t n = pwrite(fd, p, bytes, off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        p += n;
+        bytes -= (size_t)n;
+        off += n;
+    }
+    return 0;
+}
+
+/* pwritev() until every byte is written; iov is consumed */
+static int pwritev_full(int fd, struct iovec *iov, int cnt, off_t off) {
+    for (;;) {
+        while (cnt > 0 && iov->iov_len == 0) {
+            iov++;
+            cnt--;
+        }
+        if (cnt == 0) return 0;
+        ssize_t n = pwritev(fd, iov, cnt < EMBEDDING_IOV_MAX ? cnt : EMBEDDING_IOV_MAX, off);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return -1;
+        off += n;
+        while ((size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov->iov_len = 0;
+            if (--cnt == 0) return 0;
+            iov++;
+        }
+        iov->iov_base = (char *)iov->iov_base + n;
+        iov->iov_len -= (size_t)n;
+    }
+}
+
+/* copy bytes [from, from + bytes) of src to dst at dst_off, accumulating their CRC32C */
+static int copy_range(int src, off_t from, int dst, off_t dst_off, size_t bytes,
+                      uint32_t *crc) {
+    unsigned char *buf = (unsigned char *)malloc(COPY_CHUNK);
+    if (!buf) return -1;
+    int rc = 0;
+    while (bytes > 0 && rc == 0) {
+        size_t n = bytes < COPY_CHUNK ? bytes : COPY_CHUNK;
+        if (pread(src, buf, n, from) != (ssize_t)n) {
+            rc = -1;
+            break;
+        }
+        if (crc) *crc = embedding_crc32c(*crc, buf, n);
+        if (dst >= 0) rc = pwrite_full(dst, buf, n, dst_off);
+        from += (off_t)n;
+        dst_off += (off_t)n;
+        bytes -= n;
+    }
+    free(buf);
+    return rc;
+}
+
+/* Save what a commit starting at `offset` will overwrite in the journal and
+ * make it durable.  returns 0 on success, -1 on failure
+ */
+static int journal_save(const char *jpath, int fd, size_t offset, size_t file_size) {
+    unsigned char page[FILE_HEADER_SIZE];
+    if (pread(fd, page, sizeof(page), 0) != (ssize_t)sizeof(page)) return -1;
+    int jfd = open(jpath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (jfd < 0) return -1;
+
+    journal_header_t j;
+    memset(&j, 0, sizeof(j));
+    memcpy(j.magic, JOURNAL_MAGIC, sizeof(j.magic));
+    j.file_size = file_size;
+    j.offset = offset;
+    j.data_crc = embedding_crc32c(0, page, sizeof(page));
+    size_t bytes = file_size > offset ? file_size - offset : 0;
+    int rc = pwrite_full(jfd, page, sizeof(page), FILE_HEADER_SIZE);
+    if (rc == 0)
+        rc = copy_range(fd, (off_t)offset, jfd, 2 * FILE_HEADER_SIZE, bytes, &j.data_crc);
+    j.crc = journal_crc(&j);
+    if (rc == 0) rc = pwrite_full(jfd, &j, sizeof(j), 0);
+    if (rc == 0) rc = sync_fd(jfd);
+    close(jfd);
+    if (rc == 0) sync_dir(jpath);
+    return rc;
+}
+
+/* true if the file's header describes a complete commit: every section it
+ * points at is present and intact
+ */
+static int committed(int fd) {
+    file_header_t h;
+    size_t file_size;
+    if (read_header(fd, &h, &file_size) != 0) return 0;
+    uint32_t *crcs = h.version >= 2u ? read_crcs(fd, &h) : NULL;
+    if (h.version >= 2u && !crcs) return 0;
+    free(crcs);
+    float *channel = NULL;
+    uint64_t *deleted = NULL;
+    int ok = read_channel(fd, &h, &channel) == 0 && read_deleted(fd, &h, &deleted) == 0;
+    free(channel);
+    free(deleted);
+    return ok;
+}
+
+/* Finish what a crash interrupted: a commit whose header made it to disk is
+ * kept, anything else is rolled back from the journal.  fd is the table
+ * file, open read-write and locked.  returns 0 on success (or with no
+ * journal), -1 on failure
+ */
+static int journal_recover(int fd, const char *jpath, const char *who) {
+    int jfd = open(jpath, O_RDONLY);
+    if (jfd < 0) return errno == ENOENT ? 0 : -1;
+
+    journal_header_t j;
+    unsigned char page[FILE_HEADER_SIZE], cur[FILE_HEADER_SIZE];
+    struct stat st;
+    uint32_t crc = 0;
+    int valid = fstat(jfd, &st) == 0 &&
+                pread(jfd, &j, sizeof(j), 0) == (ssize_t)sizeof(j) &&
+                memcmp(j.magic, JOURNAL_MAGIC, sizeof(j.magic)) == 0 &&
+                j.crc == journal_crc(&j) && j.offset <= j.file_size &&
+                (size_t)st.st_size == 2 * FILE_HEADER_SIZE + (j.file_size - j.offset) &&
+                pread(jfd, page, sizeof(page), FILE_HEADER_SIZE) == (ssize_t)sizeof(page);
+    if (valid) {
+        crc = embedding_crc32c(0, page, sizeof(page));
+        valid = copy_range(jfd, 2 * FILE_HEADER_SIZE, -1, 0, j.file_size - j.offset, &crc) == 0 &&
+                crc == j.data_crc;
+    }
+    /* an incomplete journal means the commit never touched the file */
+    int rc = 0;
+    if (valid && !(pread(fd, cur, sizeof(cur), 0) == (ssize_t)sizeof(cur) &&
+                   memcmp(cur, page, sizeof(page)) != 0 && committed(fd))) {
+        rc = copy_range(jfd, 2 * FILE_HEADER_SIZE, fd, (off_t)j.offset, j.file_size - j.offset,
+                        NULL);
+        if (rc == 0) rc = pwrite_full(fd, page, sizeof(page), 0);
+        if (rc == 0) rc = ftruncate(fd, (off_t)j.file_size);
+        if (rc == 0) rc = sync_fd(fd);
+        if (rc != 0) fprintf(stderr, "%s: journal rollback: %s\n", who, strerror(errno));
+    }
+    close(jfd);
+    if (rc == 0) {
+        unlink(jpath);
+        sync_dir(jpath);
+    }
+    return rc;
+}
+
+/* true if fd is still the file at filename: a writer that replaced it
+ * renamed a new file over it while fd waited for its lock
+ */
+static int still_linked(int fd, const char *filename) {
+    struct stat a, b;
+    return fstat(fd, &a) == 0 && stat(filename, &b) == 0 &&
+           a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+}
+
+/* Open filename for a writer: read-write, created if missing, with the
+ * exclusive lock held.  returns the descriptor, or -1 on failure
+ */
+static int open_locked(const char *filename, const char *who) {
+    for (;;) {
+        int fd = open(filename, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            fprintf(stderr, "%s: open: %s\n", who, strerror(errno));
+            return -1;
+        }
+        if (flock(fd, LOCK_EX) != 0) {
+            fprintf(stderr, "%s: flock: %s\n", who, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        if (still_linked(fd, filename)) return fd;
+        close(fd);
+    }
+}
+
+/* Open filename for a reader, with a shared lock held until close(), so no
+ * writer runs while it is read.  A journal seen under that lock was left by
+ * a writer that crashed: the file is rolled back first (if this process may
+ * write it).  returns the descriptor, or -1 on failure
+ */
+static int open_shared(const char *filename, const char *who) {
+    char *jpath = path_with(filename, ".journal");
+    int recovered = !jpath;
+    for (;;) {
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) {
+            fprintf(stderr, "%s: open: %s\n", who, strerror(errno));
+            free(jpath);
+            return -1;
+        }
+        if (flock(fd, LOCK_SH) != 0) {
+            fprintf(stderr, "%s: flock: %s\n", who, strerror(errno));
+            close(fd);
+            free(jpath);
+            return -1;
+        }
+        int linked = still_linked(fd, filename);
+        if (linked && (recovered || access(jpath, F_OK) != 0)) {
+            free(jpath);
+            return fd;
+        }
+        close(fd);
+        if (linked) {
+            /* the shared lock is dropped first: flock() does not upgrade */
+            int wfd = open(filename, O_RDWR);
+            if (wfd >= 0 && flock(wfd, LOCK_EX) == 0) journal_recover(wfd, jpath, who);
+            if (wfd >= 0) close(wfd);
+            recovered = 1;
+        }
+    }
+}
+
+/* The header for rows rows of t (with t's channel and deleted sections, if
+ * any, behind the CRC table), as the page written to the file.
+ */
+static void build_header(unsigned char *page, const embedding_table_blocks_t *t, size_t rows,
+                         const uint32_t *crcs) {
+    file_header_t h;
+    memset(page, 0, FILE_HEADER_SIZE);
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, FILE_MAGIC, sizeof(h.magic));
+    h.version       = FILE_VERSION;
+    h.header_size   = FILE_HEADER_SIZE;
+    h.dim           = (uint32_t)t->dim;
+    h.node_capacity = NODE_CAPACITY;
+    h.node_bytes    = embedding_node_bytes(t->dim, embedding_elem_size(t->elem_type), t->layout);
+    h.num_rows      = rows;
+    h.num_nodes     = embedding_nodes_for_rows(rows);
+    h.elem_type     = t->elem_type;
+    h.norm_type     = norm_type_of(t->layout);
+    h.norms_offset  = 0;
+    h.data_offset   = (uint32_t)embedding_node_data_offset(t->layout);
+    h.crc_offset    = FILE_HEADER_SIZE + h.num_nodes * h.node_bytes;
+    h.crc_table_crc = embedding_crc32c(0, crcs, h.num_nodes * sizeof(uint32_t));
+    h.layout        = t->layout;
+    if (t->layout & EMBEDDING_TABLE_LAYOUT_ROW_SCALES)
+        h.scales_offset = (uint32_t)embedding_node_scales_offset(t->layout);
+    if (t->channel) {
+        h.channel_offset = h.crc_offset + h.num_nodes * sizeof(uint32_t);
+        h.channel_crc = embedding_crc32c(0, t->channel, 2u * t->dim * sizeof(float));
+    }
+    if (t->deleted && rows) {
+        h.deleted_offset = h.crc_offset + h.num_nodes * sizeof(uint32_t) +
+                           (t->channel ? 2u * t->dim * sizeof(float) : 0);
+        h.deleted_crc = embedding_crc32c(0, t->deleted,
+                                         h.num_nodes * NODE_DELETED_WORDS * sizeof(uint64_t));
+    }
+    h.table_id      = t->table_id;
+    h.generation    = t->generation;
+    h.header_crc    = header_crc(&h);
+    memcpy(page, &h, sizeof(h));
+}
+
+/* Build a partial node's block in scratch from its first `rows` rows only:
+ * the slots behind them may be filled by an append running alongside, and
+ * are written as zeros.
+ */
+static void stage_block(unsigned char *scratch, const double *block, uint32_t layout,
+                        uint32_t rows, size_t row_bytes, size_t node_bytes) {
+    const unsigned char *base = (const unsigned char *)block;
+    size_t norm_width = embedding_node_norms_bytes(layout) / NODE_CAPACITY;
+    memset(scratch, 0, node_bytes);
+    memcpy(scratch, base, (size_t)rows * norm_width);
+    if (layout & EMBEDDING_TABLE_LAYOUT_ROW_SCALES) {
+        size_t off = embedding_node_scales_offset(layout);
+        memcpy(scratch + off, base + off, (size_t)rows * sizeof(float));
+    }
+    size_t data_offset = embedding_node_data_offset(layout);
+    memcpy(scratch + data_offset, base + data_offset, (size_t)rows * row_bytes);
+}
+
+/* Write nodes [first, t->num_nodes) at their offsets with one pwritev() per
+ * WRITE_SPAN_NODES nodes; full blocks go straight from memory and a partial
+ * last node through a staged copy.  Each block's CRC32C goes to crcs[i].
+ */
+static int write_nodes(int fd, const embedding_table_blocks_t *t, size_t first,
+                       uint32_t *crcs) {
+    size_t row_bytes = t->dim * embedding_elem_size(t->elem_type);
+    size_t node_bytes = embedding_node_bytes(t->dim, embedding_elem_size(t->elem_type), t->layout);
+    unsigned char *scratch = NULL;
+    struct iovec iov[WRITE_SPAN_NODES];
+    for (size_t i = first; i < t->num_nodes; i += WRITE_SPAN_NODES) {
+        size_t end = i + WRITE_SPAN_NODES < t->num_nodes ? i + WRITE_SPAN_NODES : t->num_nodes;
+        for (size_t j = i; j < end; j++) {
+            const void *block = t->blocks[j];
+            uint32_t rows = node_rows(t->num_rows, j);
+            if (rows < NODE_CAPACITY) {
+                if (!scratch &&
+                    !(scratch = (unsigned char *)embedding_node_block_alloc(
+                          t->dim, embedding_elem_size(t->elem_type), t->layout)))
+                    return -1;
+                stage_block(scratch, t->blocks[j], t->layout, rows, row_bytes, node_bytes);
+                block = scratch;
+            }
+            crcs[j] = embedding_crc32c(0, block, node_bytes);
+            iov[j - i].iov_base = (void *)block;
+            iov[j - i].iov_len = node_bytes;
+        }
+        if (pwritev_full(fd, iov, (int)(end - i), (off_t)(FILE_HEADER_SIZE + i * node_bytes)) != 0) {
+            free(scratch);
+            return -1;
+        }
+    }
+    free(scratch);
+    return 0;
+}
+
+/* Write the CRC table and the channel and deleted sections behind the nodes.
+ * returns the end of the file, or 0 on failure
+ */
+static size_t write_trailer(int fd, const embedding_table_blocks_t *t, uint32_t *crcs) {
+    size_t node_bytes = embedding_node_bytes(t->dim, embedding_elem_size(t->elem_type), t->layout);
+    size_t end = FILE_HEADER_SIZE + t->num_nodes * node_bytes;
+    struct iovec iov[3];
+    int n = 0;
+    iov[n].iov_base = crcs;
+    iov[n++].iov_len = t->num_nodes * sizeof(uint32_t);
+    if (t->channel) {
+        iov[n].iov_base = t->channel;
+        iov[n++].iov_len = 2u * t->dim * sizeof(float);
+    }
+    if (t->deleted && t->num_rows) {
+        iov[n].iov_base = t->deleted;
+        iov[n++].iov_len = t->num_nodes * NODE_DELETED_WORDS * sizeof(uint64_t);
+    }
+    size_t bytes = 0;
+    for (int i = 0; i < n; i++) bytes += iov[i].iov_len;
+    if (pwritev_full(fd, iov, n, (off_t)end) != 0) return 0;
+    return end + bytes;
+}
+
+/* Nodes from `first` on, the trailer, a sync, then the header and another
+ * sync: the header only ever points at data that is already on disk.
+ */
+static int write_commit(int fd, const embedding_table_blocks_t *t, size_t first, uint32_t *crcs,
+                        const char *who) {
+    unsigned char page[FILE_HEADER_SIZE];
+    if (write_nodes(fd, t, first, crcs) != 0) {
+        fprintf(stderr, "%s: write(node): %s\n", who, strerror(errno));
+        return -1;
+    }
+    size_t end = write_trailer(fd, t, crcs);
+    if (end == 0) {
+        fprintf(stderr, "%s: write(crc): %s\n", who, strerror(errno));
+        return -1;
+    }
+    if (sync_fd(fd) != 0) {
+        fprintf(stderr, "%s: fsync: %s\n", who, strerror(errno));
+        return -1;
+    }
+    build_header(page, t, t->num_rows, crcs);
+    if (pwrite_full(fd, page, sizeof(page), 0) != 0 || sync_fd(fd) != 0) {
+        fprintf(stderr, "%s: write(header): %s\n", who, strerror(errno));
+        return -1;
+    }
+    /* anything past the new end is no longer referenced */
+    if (ftruncate(fd, (off_t)end) != 0) {
+        fprintf(stderr, "%s: ftruncate: %s\n", who, strerror(errno));
+    }
+    return 0;
+}
+
+/* Write t into a new file next to filename and rename it into place, so the
+ * old file stays whole until the new one is complete.
+ */
+static int write_replace(const char *filename, const embedding_table_blocks_t *t,
+                         uint32_t *crcs, const char *who) {
+    char *tmp = path_with(filename, ".tmp");
+    if (!tmp) return -1;
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "%s: open(%s): %s\n", who, tmp, strerror(errno));
+        free(tmp);
+        return -1;
+    }
+    int rc = write_commit(fd, t, 0, crcs, who);
+    close(fd);
+    if (rc == 0 && rename(tmp, filename) != 0) {
+        fprintf(stderr, "%s: rename: %s\n", who, strerror(errno));
+        rc = -1;
+    }
+    if (rc != 0) unlink(tmp);
+    else sync_dir(filename);
+    free(tmp);
+    return rc;
+}
+
+int embedding_file_replace(const char *filename, struct iovec *iov, int cnt,
+                           const char *who) {
+    char *tmp = path_with(filename, ".tmp");
+    if (!tmp) return -1;
+    int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "%s: open(%s): %s\n", who, tmp, strerror(errno));
+        free(tmp);
+        return -1;
+    }
+    int rc = 0;
+    if (pwritev_full(fd, iov, cnt, 0) != 0) {
+        fprintf(stderr, "%s: write: %s\n", who, strerror(errno));
+        rc = -1;
+    } else if (sync_fd(fd) != 0) {
+        fprintf(stderr, "%s: fsync: %s\n", who, strerror(errno));
+        rc = -1;
+    }
+    close(fd);
+    if (rc == 0 && rename(tmp, filename) != 0) {
+        fprintf(stderr, "%s: rename: %s\n", who, strerror(errno));
+        rc = -1;
+    }
+    if (rc != 0) unlink(tmp);
+    else sync_dir(filename);
+    free(tmp);
+    return rc;
+}
+
+int embedding_table_file_write(const char *filename, embedding_table_blocks_t *t,
+                               const char *who) {
+    /* one writer per file, and no reader while it writes */
+    int fd = open_locked(filename, who);
+    if (fd < 0) return -1;
+    char *jpath = path_with(filename, ".journal");
+    uint32_t *crcs = (uint32_t *)malloc((t->num_nodes + 1) * sizeof(uint32_t));
+    if (!jpath || !crcs || journal_recover(fd, jpath, who) != 0) {
+        if (!jpath || !crcs) fprintf(stderr, "%s: malloc: %s\n", who, strerror(errno));
+        free(crcs);
+        free(jpath);
+        close(fd);
+        return -1;
+    }
+
+    struct stat st;
+    size_t file_size = fstat(fd, &st) == 0 ? (size_t)st.st_size : 0;
+    size_t node_bytes = embedding_node_bytes(t->dim, embedding_elem_size(t->elem_type), t->layout);
+
+    /* Keep the rows of the file if it is still the commit this table last
+     * wrote or loaded (same table, same generation): they are a prefix of the
+     * table.  Anything else (legacy record file, another table, such as the
+     * one this was compacted from, or a commit since made by another copy
+     * loaded from the same file) is written from scratch to a new file that
+     * replaces it.
+     */
+    file_header_t h;
+    int rc;
+    uint64_t last = t->generation;
+    t->generation = embedding_table_new_id();
+    if (file_size >= FILE_HEADER_SIZE &&
+        pread(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h) &&
+        check_header(&h, file_size) == 0 &&
+        elem_type_of(&h) == t->elem_type && layout_of(&h) == t->layout && h.dim == t->dim &&
+        table_id_of(&h) != 0 && table_id_of(&h) == t->table_id &&
+        generation_of(&h) != 0 && generation_of(&h) == last && h.num_rows <= t->num_rows) {
+        size_t first_node = (size_t)h.num_rows >> NODE_SHIFT;
+        /* checksums of the kept (full) nodes: from the file if it has them */
+        uint32_t *old = h.version >= 2u ? read_crcs(fd, &h) : NULL;
+        for (size_t i = 0; i < first_node; i++)
+            crcs[i] = old ? old[i] : embedding_crc32c(0, t->blocks[i], node_bytes);
+        free(old);
+
+        /* Rewrite from the (possibly partial) last node on, after saving what
+         * that overwrites (the last node and the trailer) in the journal.
+         */
+        size_t from = FILE_HEADER_SIZE + first_node * node_bytes;
+        rc = journal_save(jpath, fd, from, file_size);
+        if (rc != 0) fprintf(stderr, "%s: journal: %s\n", who, strerror(errno));
+        if (rc == 0) rc = write_commit(fd, t, first_node, crcs, who);
+        if (rc == 0) unlink(jpath);
+    } else {
+        rc = write_replace(filename, t, crcs, who);
+    }
+    if (rc != 0) t->generation = last;
+    free(crcs);
+    free(jpath);
+    close(fd);
+    return rc;
+}
+
+/* ---- loading ------------------------------------------------------------- */
+
+#define LEGACY_RECORD_SIZE (sizeof(double) + EMBEDDING_DIM * sizeof(int8_t))
+#define LOAD_SPAN_NODES    16u      /* nodes per read: ~4 MiB per syscall */
+
+typedef struct {
+    int fd;
+    int legacy;                    /* headerless [double | 512 int8] records */
+    uint32_t layout;
+    size_t dim;
+    size_t elem_size;
+    size_t node_bytes;
+    size_t num_rows;
+    size_t num_nodes;
+    size_t nodes_per_part;
+    const uint32_t *crcs;          /* per-node CRC32C, NULL before version 2 */
+    double **blocks;
+    atomic_size_t first_bad;       /* lowest failing node, SIZE_MAX if none */
+} load_t;
+
+/* Read nodes [begin, end) straight into freshly allocated blocks. */
+static int load_span(load_t *w, size_t begin, size_t end, unsigned char *scratch) {
+    struct iovec iov[LOAD_SPAN_NODES];
+    for (size_t i = begin; i < end; i++) {
+        double *block = embedding_node_block_alloc(w->dim, w->elem_size, w->layout);
+        if (!block) return -1;
+        w->blocks[i] = block;
+        iov[i - begin].iov_base = block;
+        iov[i - begin].iov_len = w->node_bytes;
+    }
+
+    if (!w->legacy) {
+        off_t off = (off_t)(FILE_HEADER_SIZE + begin * w->node_bytes);
+        ssize_t want = (ssize_t)((end - begin) * w->node_bytes);
+        return preadv(w->fd, iov, (int)(end - begin), off) == want ? 0 : -1;
+    }
+
+    /* legacy records interleave norm and row; read the span, then split it */
+    size_t first_row = begin << NODE_SHIFT;
+    size_t rows = (end << NODE_SHIFT) < w->num_rows ? (end << NODE_SHIFT) - first_row
+                                                     : w->num_rows - first_row;
+    size_t bytes = rows * LEGACY_RECORD_SIZE;
+    if (pread(w->fd, scratch, bytes, (off_t)(first_row * LEGACY_RECORD_SIZE)) !=
+        (ssize_t)bytes) {
+        return -1;
+    }
+    const unsigned char *rec = scratch;
+    for (size_t r = 0; r < rows; r++, rec += LEGACY_RECORD_SIZE) {
+        double *block = w->blocks[begin + (r >> NODE_SHIFT)];
+        size_t slot = r & (NODE_CAPACITY - 1);
+        int8_t *data = (int8_t *)(block + NODE_CAPACITY);
+        memcpy(&block[slot], rec, sizeof(double));
+        memcpy(data + slot * EMBEDDING_DIM, rec + sizeof(double), EMBEDDING_DIM);
+    }
+    return 0;
+}
+
+/* a loaded node is usable if its block matches its CRC and every norm (or
+ * inverse norm) is a positive finite number
+ */
+static int check_block(const load_t *w, size_t i) {
+    const double *block = w->blocks[i];
+    if (w->crcs && embedding_crc32c(0, block, w->node_bytes) != w->crcs[i]) return -1;
+    uint32_t rows = node_rows(w->num_rows, i);
+    if (w->layout & EMBEDDING_TABLE_LAYOUT_NORMALIZED) return 0;
+    if (w->layout & EMBEDDING_TABLE_LAYOUT_INV_NORMS) {
+        const float *inv = (const float *)block;
+        for (uint32_t r = 0; r < rows; r++) {
+            if (!(inv[r] > 0.0f) || !isfinite(inv[r])) return -1;
+        }
+        return 0;
+    }
+    for (uint32_t r = 0; r < rows; r++) {
+        if (!(block[r] > 0.0) || !isfinite(block[r])) return -1;
+    }
+    return 0;
+}
+
+static void load_part(void *arg, size_t part) {
+    load_t *w = (load_t *)arg;
+    size_t begin = part * w->nodes_per_part;
+    size_t end = begin + w->nodes_per_part;
+    if (end > w->num_nodes) end = w->num_nodes;
+
+    unsigned char *scratch = NULL;
+    if (w->legacy) {
+        scratch = (unsigned char *)malloc(LOAD_SPAN_NODES * NODE_CAPACITY * LEGACY_RECORD_SIZE);
+        if (!scratch) {
+            note_bad(&w->first_bad, begin);
+            return;
+        }
+    }
+    for (size_t i = begin; i < end; i += LOAD_SPAN_NODES) {
+        size_t span_end = i + LOAD_SPAN_NODES < end ? i + LOAD_SPAN_NODES : end;
+        if (load_span(w, i, span_end, scratch) != 0) {
+            note_bad(&w->first_bad, i);
+            break;
+        }
+        for (size_t j = i; j < span_end; j++) {
+            if (check_block(w, j) != 0) note_bad(&w->first_bad, j);
+        }
+    }
+    free(scratch);
+}
+
+int embedding_table_file_read(const char *filename, uint32_t elem_type,
+                              embedding_thread_pool_t *pool,
+                              embedding_table_blocks_t *out, const char *who) {
+    memset(out, 0, sizeof(*out));
+
+    int fd = open_shared(filename, who);
+    if (fd < 0) return -1;
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    size_t file_size = (size_t)st.st_size;
+
+    load_t w;
+    memset(&w, 0, sizeof(w));
+    w.fd = fd;
+    w.elem_size = embedding_elem_size(elem_type);
+    uint32_t *crcs = NULL;
+    float *channel = NULL;
+    uint64_t *deleted = NULL;
+
+    file_header_t h;
+    if (file_size >= FILE_HEADER_SIZE &&
+        pread(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h) &&
+        memcmp(h.magic, FILE_MAGIC, sizeof(h.magic)) == 0) {
+        if (check_header(&h, file_size) != 0 || elem_type_of(&h) != elem_type) {
+            close(fd);
+            return -1;
+        }
+        if (h.version >= 2u && !(crcs = read_crcs(fd, &h))) {
+            fprintf(stderr, "%s: bad checksum table\n", who);
+            close(fd);
+            return -1;
+        }
+        if (read_channel(fd, &h, &channel) != 0) {
+            fprintf(stderr, "%s: bad channel section\n", who);
+            free(crcs);
+            close(fd);
+            return -1;
+        }
+        if (read_deleted(fd, &h, &deleted) != 0) {
+            fprintf(stderr, "%s: bad deleted section\n", who);
+            free(channel);
+            free(crcs);
+            close(fd);
+            return -1;
+        }
+        w.layout = layout_of(&h);
+        w.dim = h.dim;
+        w.num_rows = (size_t)h.num_rows;
+        out->table_id = table_id_of(&h);
+        out->generation = generation_of(&h);
+    } else {
+        if (elem_type != EMBEDDING_ELEM_INT8 || file_size % LEGACY_RECORD_SIZE != 0) {
+            /* partial/corrupt file */
+            close(fd);
+            return -1;
+        }
+        w.legacy = 1;
+        w.dim = EMBEDDING_DIM;
+        w.num_rows = file_size / LEGACY_RECORD_SIZE;
+    }
+    w.node_bytes = embedding_node_bytes(w.dim, w.elem_size, w.layout);
+    w.num_nodes = embedding_nodes_for_rows(w.num_rows);
+    w.crcs = crcs;
+    w.blocks = (double **)calloc(w.num_nodes + 1, sizeof(*w.blocks));
+    if (!w.blocks) {
+        free(deleted);
+        free(channel);
+        free(crcs);
+        close(fd);
+        return -1;
+    }
+
+    size_t parts = split_nodes(pool, w.num_nodes, &w.nodes_per_part);
+    atomic_init(&w.first_bad, SIZE_MAX);
+    embedding_thread_pool_run(pool, load_part, &w, parts);
+    free(crcs);
+    close(fd);
+
+    size_t bad = atomic_load(&w.first_bad);
+    if (bad != SIZE_MAX) {
+        fprintf(stderr, "%s: node %zu is unreadable or corrupt\n", who, bad);
+        for (size_t i = 0; i < w.num_nodes; i++) free(w.blocks[i]);
+        free(w.blocks);
+        free(deleted);
+        free(channel);
+        return -1;
+    }
+
+    out->elem_type = elem_type;
+    out->layout = w.layout;
+    out->channel = channel;
+    out->deleted = deleted;
+    out->dim = w.dim;
+    out->num_rows = w.num_rows;
+    out->num_nodes = w.num_nodes;
+    out->blocks = w.blocks;
+    return 0;
+}
+
+/* ---- checksum verification ----------------------------------------------- */
+
+typedef struct {
+    int fd;
+    const unsigned char *blocks;   /* mapped node blocks, or NULL to pread them */
+    size_t node_bytes;
+    const uint32_t *crcs;
+    size_t num_nodes;
+    size_t nodes_per_part;
+    atomic_size_t first_bad;       /* lowest failing node, SIZE_MAX if none */
+} verify_t;
+
+static void verify_part(void *arg, size_t part) {
+    verify_t *v = (verify_t *)arg;
+    size_t begin = part * v->nodes_per_part;
+    size_t end = begin + v->nodes_per_part;
+    if (end > v->num_nodes) end = v->num_nodes;
+
+    unsigned char *buf = v->blocks ? NULL : (unsigned char *)malloc(v->node_bytes);
+    if (!v->blocks && !buf) {
+        note_bad(&v->first_bad, begin);
+        return;
+    }
+    for (size_t i = begin; i < end; i++) {
+        const unsigned char *block;
+        if (v->blocks) {
+            block = v->blocks + i * v->node_bytes;
+        } else {
+            off_t off = (off_t)(FILE_HEADER_SIZE + i * v->node_bytes);
+            if (pread(v->fd, buf, v->node_bytes, off) != (ssize_t)v->node_bytes) {
+                note_bad(&v->first_bad, i);
+                break;
+            }
+            block = buf;
+        }
+        if (embedding_crc32c(0, block, v->node_bytes) != v->crcs[i])
+            note_bad(&v->first_bad, i);
+    }
+    free(buf);
+}
+
+/* Check every node block of a version 2 file against its CRC; blocks is the
+ * mapped node area or NULL to read through fd.  returns 0 if all match
+ */
+static int verify_nodes(int fd, const unsigned char *blocks, const file_header_t *h,
+                        embedding_thread_pool_t *pool, const char *who) {
+    uint32_t *crcs = read_crcs(fd, h);
+    if (!crcs) {
+        fprintf(stderr, "%s: bad checksum table\n", who);
+        return -1;
+    }
+    verify_t v;
+    v.fd = fd;
+    v.blocks = blocks;
+    v.node_bytes = (size_t)h->node_bytes;
+    v.crcs = crcs;
+    v.num_nodes = (size_t)h->num_nodes;
+    size_t parts = split_nodes(pool, v.num_nodes, &v.nodes_per_part);
+    atomic_init(&v.first_bad, SIZE_MAX);
+    embedding_thread_pool_run(pool, verify_part, &v, parts);
+    free(crcs);
+
+    size_t bad = atomic_load(&v.first_bad);
+    if (bad != SIZE_MAX) {
+        fprintf(stderr, "%s: checksum mismatch in node %zu\n", who, bad);
+        return -1;
+    }
+    return 0;
+}
+
+int embedding_table_verify(const char *filename, embedding_thread_pool_t *pool) {
+    if (!filename) return -1;
+
+    int fd = open_shared(filename, "embedding_table_verify");
+    if (fd < 0) return -1;
+
+    file_header_t h;
+    size_t file_size;
+    int rc = -1;
+    if (read_header(fd, &h, &file_size) == 0) {
+        rc = h.version >= 2u ? verify_nodes(fd, NULL, &h, pool, "embedding_table_verify") : 0;
+        float *channel = NULL;
+        uint64_t *deleted = NULL;
+        if (rc == 0 && read_channel(fd, &h, &channel) != 0) {
+            fprintf(stderr, "embedding_table_verify: bad channel section\n");
+            rc = -1;
+        }
+        if (rc == 0 && read_deleted(fd, &h, &deleted) != 0) {
+            fprintf(stderr, "embedding_table_verify: bad deleted section\n");
+            rc = -1;
+        }
+        free(deleted);
+        free(channel);
+    }
+    close(fd);
+    return rc;
+}
+
+/* ---- mapping ------------------------------------------------------------- */
+
+int embedding_table_file_map(const char *filename, uint32_t elem_type, uint32_t flags,
+                             embedding_table_blocks_t *out, const char *who) {
+    memset(out, 0, sizeof(*out));
+
+    int fd = open_shared(filename, who);
+    if (fd < 0) return -1;
+
+    file_header_t h;
+    size_t file_size;
+    if (read_header(fd, &h, &file_size) != 0 || elem_type_of(&h) != elem_type) {
+        close(fd);
+        return -1;
+    }
+
+    size_t num_nodes = (size_t)h.num_nodes;
+    size_t node_bytes = (size_t)h.node_bytes;
+    size_t map_size = FILE_HEADER_SIZE + num_nodes * node_bytes;
+
+    int map_flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+    if (flags & EMBEDDING_TABLE_MMAP_POPULATE) map_flags |= MAP_POPULATE;
+#endif
+    void *map = mmap(NULL, map_size, PROT_READ, map_flags, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: mmap: %s\n", who, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if ((flags & EMBEDDING_TABLE_MMAP_VERIFY) && h.version >= 2u &&
+        verify_nodes(fd, (const unsigned char *)map + FILE_HEADER_SIZE, &h, NULL, who) != 0) {
+        munmap(map, map_size);
+        close(fd);
+        return -1;
+    }
+    /* the channel and deleted sections are small; they are copied rather than
+     * mapped (tombstones stay writable that way)
+     */
+    float *channel = NULL;
+    uint64_t *deleted = NULL;
+    if (read_channel(fd, &h, &channel) != 0) {
+        fprintf(stderr, "%s: bad channel section\n", who);
+        munmap(map, map_size);
+        close(fd);
+        return -1;
+    }
+    if (read_deleted(fd, &h, &deleted) != 0) {
+        fprintf(stderr, "%s: bad deleted section\n", who);
+        free(channel);
+        munmap(map, map_size);
+        close(fd);
+        return -1;
+    }
+    close(fd);  /* the mapping keeps the file referenced */
+
+    if (flags & EMBEDDING_TABLE_MMAP_SEQUENTIAL) madvise(map, map_size, MADV_SEQUENTIAL);
+    if (flags & EMBEDDING_TABLE_MMAP_RANDOM)     madvise(map, map_size, MADV_RANDOM);
+    if (flags & EMBEDDING_TABLE_MMAP_WILLNEED)   madvise(map, map_size, MADV_WILLNEED);
+
+    double **blocks = (double **)malloc((num_nodes + 1) * sizeof(*blocks));
+    if (!blocks) {
+        free(deleted);
+        free(channel);
+        munmap(map, map_size);
+        return -1;
+    }
+    unsigned char *block = (unsigned char *)map + FILE_HEADER_SIZE;
+    for (size_t i = 0; i < num_nodes; i++, block += node_bytes)
+        blocks[i] = (double *)block;
+
+    out->elem_type = elem_type;
+    out->layout = layout_of(&h);
+    out->table_id = table_id_of(&h);
+    out->generation = generation_of(&h);
+    out->channel = channel;
+    out->deleted = deleted;
+    out->dim = h.dim;
+    out->num_rows = (size_t)h.num_rows;
+    out->num_nodes = num_nodes;
+    out->blocks = blocks;
+    out->map = map;
+    out->map_size = map_size;
+    return 0;
+}
@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_table_file_H
+#define _embed_table_file_H
+
+/* Reading and writing the shared table format (see
+ * embedding-library/embedding_table_file.h) in terms of node blocks, so the
+ * typed tables only convert between their nodes and blocks; not installed.
+ */
+
+#include "embedding_node.h"
+#include "embedding-library/embedding_table_file.h"
+#include <sys/uio.h>
+
+/* element types recorded in the header */
+#define EMBEDDING_ELEM_INT8  1u
+#define EMBEDDING_ELEM_FLOAT 2u
+#define EMBEDDING_ELEM_INT16 3u
+
+typedef struct {
+    uint32_t elem_type;       /* EMBEDDING_ELEM_* */
+    uint32_t layout;          /* EMBEDDING_TABLE_LAYOUT_* bits of the blocks */
+    uint64_t table_id;        /* embedding_table_new_id() of the table the rows
+                                 belong to; 0 if read from an older file */
+    uint64_t generation;      /* the commit the table last wrote or loaded (0 if
+                                 none); set to the new one by a write */
+    size_t dim;
+    size_t num_rows;
+    size_t num_nodes;
+    double **blocks;          /* num_nodes node blocks; rows fill them in order */
+    float *channel;           /* 2 * dim floats (scales, zero points), or NULL */
+    uint64_t *deleted;        /* NODE_DELETED_WORDS tombstone words per node, or NULL */
+    void *map;                /* mapping the blocks point into, or NULL */
+    size_t map_size;
+} embedding_table_blocks_t;
+
+size_t embedding_elem_size(uint32_t elem_type);
+
+/* A new, non-zero identity: every table gets one when it is created and
+ * keeps the one in its file when it is loaded, so a file is only ever
+ * extended by the table it was written from.  Each write takes one as its
+ * generation too.
+ */
+uint64_t embedding_table_new_id(void);
+
+/* Write (or incrementally extend) filename from t->blocks.  Only a file
+ * still holding the commit t->generation names, of the same table (same
+ * table_id), is extended; any other is written anew beside it and renamed
+ * over it.  An extension is journaled first, so a crash at any point leaves
+ * the file readable with either the old or the new rows.  On success
+ * t->generation is the new commit's.  `who` prefixes error messages.
+ * returns 0 on success, -1 on failure
+ */
+int embedding_table_file_write(const char *filename, embedding_table_blocks_t *t,
+                               const char *who);
+
+/* Load a file of elem_type into freshly allocated blocks, split across pool
+ * (may be NULL), under a shared flock().  returns 0 on success, -1 on
+ * failure; on success the caller owns out->blocks, each block, out->channel
+ * and out->deleted.
+ */
+int embedding_table_file_read(const char *filename, uint32_t elem_type,
+                              embedding_thread_pool_t *pool,
+                              embedding_table_blocks_t *out, const char *who);
+
+/* Map a file of elem_type read-only (checked under a shared flock());
+ * out->blocks point into out->map.  returns 0 on success, -1 on failure;
+ * the caller owns out->blocks, out->channel and out->deleted (heap copies)
+ * and the mapping.
+ */
+int embedding_table_file_map(const char *filename, uint32_t elem_type, uint32_t flags,
+                             embedding_table_blocks_t *out, const char *who);
+
+/* Write the cnt buffers of iov (consumed) back to back to a new file beside
+ * filename, sync it and rename it over filename, for side files kept with a
+ * table.  returns 0 on success, -1 on failure
+ */
+int embedding_file_replace(const char *filename, struct iovec *iov, int cnt,
+                           const char *who);
+
+#endif // _embed_table_file_H
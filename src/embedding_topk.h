@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_topk_H
+#define _embed_topk_H
+
+/* Bounded min-heap used by the table scans.  The root is always the weakest
+ * of the k entries kept so far, so a candidate only costs a compare against
+ * heap[0] unless it actually displaces something.
+ */
+
+#include <stddef.h>
+
+typedef struct {
+    double score;
+    size_t id;
+} embedding_topk_entry_t;
+
+typedef struct {
+    embedding_topk_entry_t *heap;
+    size_t size;
+    size_t k;
+} embedding_topk_t;
+
+/* a ranks below b: lower score, ties broken toward the smaller id */
+static inline int embedding_topk_worse(const embedding_topk_entry_t *a,
+                                       const embedding_topk_entry_t *b) {
+    if (a->score != b->score) return a->score < b->score;
+    return a->id > b->id;
+}
+
+static inline void embedding_topk_init(embedding_topk_t *h,
+                                       embedding_topk_entry_t *storage, size_t k) {
+    h->heap = storage;
+    h->size = 0;
+    h->k = k;
+}
+
+static inline void embedding_topk_sift_down(embedding_topk_t *h, size_t i) {
+    embedding_topk_entry_t *e = h->heap;
+    embedding_topk_entry_t v = e[i];
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= h->size) break;
+        if (c + 1 < h->size && embedding_topk_worse(&e[c + 1], &e[c])) c++;
+        if (!embedding_topk_worse(&e[c], &v)) break;
+        e[i] = e[c];
+        i = c;
+    }
+    e[i] = v;
+}
+
+static inline void embedding_topk_push(embedding_topk_t *h, double score, size_t id) {
+    embedding_topk_entry_t v = { score, id };
+    embedding_topk_entry_t *e = h->heap;
+    if (h->size < h->k) {
+        size_t i = h->size++;
+        while (i > 0) {
+            size_t p = (i - 1) >> 1;
+            if (!embedding_topk_worse(&v, &e[p])) break;
+            e[i] = e[p];
+            i = p;
+        }
+        e[i] = v;
+        return;
+    }
+    if (h->k == 0 || !embedding_topk_worse(&e[0], &v)) return;
+    e[0] = v;
+    embedding_topk_sift_down(h, 0);
+}
+
+/* true if a candidate with this score could enter the heap */
+static inline int embedding_topk_accepts(const embedding_topk_t *h, double score) {
+    return h->size < h->k || score >= h->heap[0].score;
+}
+
+/* Pop everything out best-first.  Returns the number of entries written;
+ * the heap is empty afterwards.
+ */
+static inline size_t embedding_topk_drain(embedding_topk_t *h,
+                                          size_t *out_ids, double *out_scores) {
+    size_t n = h->size;
+    while (h->size > 0) {
+        size_t last = --h->size;
+        embedding_topk_entry_t worst = h->heap[0];
+        h->heap[0] = h->heap[last];
+        if (h->size > 0) embedding_topk_sift_down(h, 0);
+        if (out_ids) out_ids[last] = worst.id;
+        if (out_scores) out_scores[last] = worst.score;
+    }
+    return n;
+}
+
+#endif // _embed_topk_H
@@ -0,0 +1,319 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "embedding-library/int16_embedding_table.h"
+#include "embedding-library/dispatch.h"
+#include "embedding_node.h"
+#include "embedding_table_file.h"
+#include "embedding_topk.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/mman.h>
+
+/* allocate a node struct over block: [512 doubles | 512 * dim int16 | padding] */
+static int16_embedding_node_t *node_wrap(void *block, uint32_t size, uint32_t flags) {
+    int16_embedding_node_t *n = (int16_embedding_node_t *)malloc(sizeof(*n));
+    if (!n) return NULL;
+    n->norms = (double *)block;
+    n->data  = (int16_t *)(n->norms + NODE_CAPACITY);
+    n->size  = size;
+    n->flags = flags;
+    return n;
+}
+
+static int16_embedding_node_t *node_alloc(size_t dim) {
+    double *block = embedding_node_block_alloc(dim, sizeof(int16_t), 0);
+    if (!block) return NULL;
+    int16_embedding_node_t *n = node_wrap(block, 0, 0);
+    if (!n) free(block);
+    return n;
+}
+
+static void node_free(int16_embedding_node_t *n) {
+    if (!n) return;
+    if (!(n->flags & INT16_EMBEDDING_NODE_MAPPED)) free(n->norms);
+    free(n);
+}
+
+/* A mapped node is read-only; give it a private heap copy before writing. */
+static int own_node(const int16_embedding_table_t *t, int16_embedding_node_t *n) {
+    if (!(n->flags & INT16_EMBEDDING_NODE_MAPPED)) return 0;
+    double *block = embedding_node_block_alloc(t->dim, sizeof(int16_t), 0);
+    if (!block) return -1;
+    memcpy(block, n->norms, t->node_bytes);
+    n->norms = block;
+    n->data  = (int16_t *)(block + NODE_CAPACITY);
+    n->flags &= ~(uint32_t)INT16_EMBEDDING_NODE_MAPPED;
+    return 0;
+}
+
+static int table_grow(int16_embedding_table_t *t) {
+    if (t->index < t->size) return 0;
+    size_t new_size = (t->size == 0) ? 16u : (t->size * 2u);
+    int16_embedding_node_t **p =
+        (int16_embedding_node_t **)realloc(t->table, new_size * sizeof(*t->table));
+    if (!p) return -1;
+    t->table = p;
+    t->size  = new_size;
+    return 0;
+}
+
+/* the caller's norm, or sqrt(v.v) if it passed a negative one; 0.0 if unusable */
+static double norm_of(const int16_t *v, size_t dim, double norm) {
+    if (norm < 0.0) {
+        int64_t dp = int16_dot_product_dispatch(v, v, dim);
+        norm = (dp > 0) ? sqrt((double)dp) : 0.0;
+    }
+    return norm;
+}
+
+ssize_t int16_embedding_table_add_embedding(int16_embedding_table_t *t, const int16_t *embedding,
+                                            double norm) {
+    if (!t || !embedding) return -1;
+
+    norm = norm_of(embedding, t->dim, norm);
+    if (norm == 0.0) return -1;
+
+    /* append to the last node if it has room, else start a new one */
+    int16_embedding_node_t *n = t->index > 0 ? t->table[t->index - 1] : NULL;
+    if (n && n->size < NODE_CAPACITY) {
+        if (own_node(t, n) != 0) return -1;
+    } else {
+        if (table_grow(t) != 0) return -1;
+        if (!(n = node_alloc(t->dim))) return -1;
+        t->table[t->index++] = n;
+    }
+
+    memcpy(n->data + (size_t)n->size * t->dim, embedding, t->dim * sizeof(int16_t));
+    n->norms[n->size] = norm;
+    n->size++;
+    return (ssize_t)(((t->index - 1) << NODE_SHIFT) + (n->size - 1));
+}
+
+int16_embedding_table_t *int16_embedding_table_init(size_t dim, size_t size) {
+    if (dim == 0 || dim > EMBEDDING_MAX_DIM) return NULL;
+    int16_embedding_table_t *t = (int16_embedding_table_t *)calloc(1, sizeof(*t));
+    if (!t) return NULL;
+
+    /* size == 0: the node array is allocated with the first node */
+    if (size && !(t->table = (int16_embedding_node_t **)calloc(size, sizeof(*t->table)))) {
+        free(t);
+        return NULL;
+    }
+    t->size  = size;
+    t->index = 0;
+    t->dim   = dim;
+    t->node_bytes = embedding_node_bytes(dim, sizeof(int16_t), 0);
+    t->table_id = embedding_table_new_id();
+    return t;
+}
+
+void int16_embedding_table_destroy(int16_embedding_table_t *t) {
+    if (!t) return;
+    for (size_t i = 0; i < t->index; i++)
+        node_free(t->table[i]);
+    if (t->map) munmap(t->map, t->map_size);
+    free(t->table);
+    free(t);
+}
+
+/* Score every row of node `n` (global ids start at `base`) into the heap */
+static void scan_node(embedding_int16_dot_product_cb dot, size_t dim,
+                      const int16_embedding_node_t *n, size_t base,
+                      const int16_t *query, double query_norm, embedding_topk_t *h) {
+    const int16_t *row = n->data;
+    for (uint32_t i = 0; i < n->size; i++, row += dim) {
+        double score = (double)dot(query, row, dim) / (query_norm * n->norms[i]);
+        if (embedding_topk_accepts(h, score))
+            embedding_topk_push(h, score, base + i);
+    }
+}
+
+size_t int16_embedding_table_topk(int16_embedding_table_t *t,
+                                  const int16_t *query, double query_norm,
+                                  size_t k, size_t *out_ids, double *out_scores) {
+    if (!t || !query || k == 0) return 0;
+
+    query_norm = norm_of(query, t->dim, query_norm);
+    if (query_norm == 0.0) return 0;
+
+    size_t total = int16_embedding_table_size(t);
+    if (k > total) k = total;
+    if (k == 0) return 0;
+
+    embedding_topk_entry_t *storage =
+        (embedding_topk_entry_t *)malloc(k * sizeof(*storage));
+    if (!storage) return 0;
+
+    embedding_int16_dot_product_cb dot = embedding_kernels()->int16_dot_product;
+    embedding_topk_t h;
+    embedding_topk_init(&h, storage, k);
+    for (size_t i = 0; i < t->index; i++)
+        scan_node(dot, t->dim, t->table[i], i << NODE_SHIFT, query, query_norm, &h);
+
+    size_t n = embedding_topk_drain(&h, out_ids, out_scores);
+    free(storage);
+    return n;
+}
+
+/* One partition of a parallel scan: a contiguous run of nodes and a private heap */
+typedef struct {
+    embedding_int16_dot_product_cb dot;
+    int16_embedding_table_t *t;
+    const int16_t *query;
+    double query_norm;
+    size_t nodes_per_part;
+    embedding_topk_t *heaps;
+} topk_parallel_t;
+
+static void topk_parallel_part(void *arg, size_t part) {
+    topk_parallel_t *w = (topk_parallel_t *)arg;
+    size_t begin = part * w->nodes_per_part;
+    size_t end = begin + w->nodes_per_part;
+    if (end > w->t->index) end = w->t->index;
+    for (size_t i = begin; i < end; i++)
+        scan_node(w->dot, w->t->dim, w->t->table[i], i << NODE_SHIFT, w->query,
+                  w->query_norm, &w->heaps[part]);
+}
+
+size_t int16_embedding_table_topk_parallel(int16_embedding_table_t *t,
+                                           embedding_thread_pool_t *pool,
+                                           const int16_t *query, double query_norm,
+                                           size_t k, size_t *out_ids, double *out_scores) {
+    size_t threads = embedding_thread_pool_size(pool);
+    if (!t || threads < 2 || t->index < 2)
+        return int16_embedding_table_topk(t, query, query_norm, k, out_ids, out_scores);
+    if (!query || k == 0) return 0;
+
+    query_norm = norm_of(query, t->dim, query_norm);
+    if (query_norm == 0.0) return 0;
+
+    size_t total = int16_embedding_table_size(t);
+    if (k > total) k = total;
+
+    size_t parts = threads * 4;
+    if (parts > t->index) parts = t->index;
+    size_t nodes_per_part = (t->index + parts - 1) / parts;
+    parts = (t->index + nodes_per_part - 1) / nodes_per_part;
+
+    embedding_topk_entry_t *storage =
+        (embedding_topk_entry_t *)malloc((parts + 1) * k * sizeof(*storage));
+    embedding_topk_t *heaps = (embedding_topk_t *)malloc(parts * sizeof(*heaps));
+    if (!storage || !heaps) {
+        free(storage);
+        free(heaps);
+        return 0;
+    }
+    for (size_t i = 0; i < parts; i++)
+        embedding_topk_init(&heaps[i], storage + (i + 1) * k, k);
+
+    topk_parallel_t w = { embedding_kernels()->int16_dot_product, t, query, query_norm,
+                          nodes_per_part, heaps };
+    embedding_thread_pool_run(pool, topk_parallel_part, &w, parts);
+
+    embedding_topk_t h;
+    embedding_topk_init(&h, storage, k);
+    for (size_t i = 0; i < parts; i++) {
+        for (size_t j = 0; j < heaps[i].size; j++) {
+            const embedding_topk_entry_t *e = &heaps[i].heap[j];
+            embedding_topk_push(&h, e->score, e->id);
+        }
+    }
+
+    size_t n = embedding_topk_drain(&h, out_ids, out_scores);
+    free(heaps);
+    free(storage);
+    return n;
+}
+
+void int16_embedding_table_serialize(int16_embedding_table_t *t, const char *filename) {
+    if (!t || !filename) return;
+
+    embedding_table_blocks_t b;
+    b.elem_type = EMBEDDING_ELEM_INT16;
+    b.dim = t->dim;
+    b.num_rows = int16_embedding_table_size(t);
+    b.num_nodes = t->index;
+    b.layout = 0;
+    b.table_id = t->table_id;
+    b.generation = t->file_generation;
+    b.channel = NULL;
+    b.deleted = NULL;
+    b.map = NULL;
+    b.map_size = 0;
+    b.blocks = (double **)malloc((t->index + 1) * sizeof(*b.blocks));
+    if (!b.blocks) {
+        perror("int16_embedding_table_serialize: malloc");
+        return;
+    }
+    for (size_t i = 0; i < t->index; i++)
+        b.blocks[i] = t->table[i]->norms;
+
+    embedding_table_file_write(filename, &b, "int16_embedding_table_serialize");
+    t->file_generation = b.generation;
+    free(b.blocks);
+}
+
+/* Build a table whose nodes wrap the loaded (or mapped) blocks of b; files
+ * with any layout bits or deleted rows are rejected.
+ */
+static int16_embedding_table_t *table_from_blocks(embedding_table_blocks_t *b) {
+    uint32_t flags = b->map ? INT16_EMBEDDING_NODE_MAPPED : 0;
+    int16_embedding_table_t *table =
+        (b->layout || b->deleted) ? NULL
+                                  : int16_embedding_table_init(b->dim, b->num_nodes);
+    size_t i = 0;
+    if (table) {
+        if (b->table_id) table->table_id = b->table_id;
+        table->file_generation = b->generation;
+        table->map = b->map;
+        table->map_size = b->map_size;
+        b->map = NULL;
+        size_t remaining = b->num_rows;
+        for (; i < b->num_nodes; i++) {
+            uint32_t size = remaining < NODE_CAPACITY ? (uint32_t)remaining : NODE_CAPACITY;
+            int16_embedding_node_t *node = node_wrap(b->blocks[i], size, flags);
+            if (!node) break;
+            table->table[table->index++] = node;
+            remaining -= size;
+        }
+    }
+    if (!table || i < b->num_nodes) {
+        if (!flags) {
+            for (; i < b->num_nodes; i++) free(b->blocks[i]);
+        }
+        if (b->map) munmap(b->map, b->map_size);
+        int16_embedding_table_destroy(table);
+        table = NULL;
+    }
+    free(b->blocks);
+    free(b->channel);
+    free(b->deleted);
+    return table;
+}
+
+int16_embedding_table_t *int16_embedding_table_deserialize_parallel(const char *filename,
+                                                                    embedding_thread_pool_t *pool) {
+    if (!filename) return NULL;
+    embedding_table_blocks_t b;
+    if (embedding_table_file_read(filename, EMBEDDING_ELEM_INT16, pool, &b,
+                                  "int16_embedding_table_deserialize") != 0)
+        return NULL;
+    return table_from_blocks(&b);
+}
+
+int16_embedding_table_t *int16_embedding_table_deserialize(const char *filename) {
+    return int16_embedding_table_deserialize_parallel(filename, NULL);
+}
+
+int16_embedding_table_t *int16_embedding_table_mmap(const char *filename, uint32_t flags) {
+    if (!filename) return NULL;
+    embedding_table_blocks_t b;
+    if (embedding_table_file_map(filename, EMBEDDING_ELEM_INT16, flags, &b,
+                                 "int16_embedding_table_mmap") != 0)
+        return NULL;
+    return table_from_blocks(&b);
+}
@@ -0,0 +1,85 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "embedding-library/int8_channel_quantizer.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int8_channel_quantizer_t *quantizer_alloc(size_t dim) {
+    if (dim == 0) return NULL;
+    /* one allocation: the struct, then scale[dim], then zero_point[dim] */
+    int8_channel_quantizer_t *q =
+        (int8_channel_quantizer_t *)malloc(sizeof(*q) + 2u * dim * sizeof(float));
+    if (!q) return NULL;
+    q->dim = dim;
+    q->scale = (float *)(q + 1);
+    q->zero_point = q->scale + dim;
+    return q;
+}
+
+int8_channel_quantizer_t *int8_channel_quantizer_init(size_t dim, const float *scale,
+                                                      const float *zero_point) {
+    if (!scale || !zero_point) return NULL;
+    int8_channel_quantizer_t *q = quantizer_alloc(dim);
+    if (!q) return NULL;
+    memcpy(q->scale, scale, dim * sizeof(float));
+    memcpy(q->zero_point, zero_point, dim * sizeof(float));
+    return q;
+}
+
+int8_channel_quantizer_t *int8_channel_quantizer_train(const float *sample, size_t rows,
+                                                       size_t dim) {
+    if (!sample || rows == 0) return NULL;
+    int8_channel_quantizer_t *q = quantizer_alloc(dim);
+    if (!q) return NULL;
+
+    /* min in scale[], max in zero_point[] while scanning */
+    float *lo = q->scale, *hi = q->zero_point;
+    for (size_t j = 0; j < dim; j++) {
+        lo[j] = FLT_MAX;
+        hi[j] = -FLT_MAX;
+    }
+    for (size_t r = 0; r < rows; r++) {
+        const float *row = sample + r * dim;
+        for (size_t j = 0; j < dim; j++) {
+            if (row[j] < lo[j]) lo[j] = row[j];
+            if (row[j] > hi[j]) hi[j] = row[j];
+        }
+    }
+    for (size_t j = 0; j < dim; j++) {
+        float range = hi[j] - lo[j];
+        float scale = range > 0.0f ? range / 255.0f : 1.0f;
+        q->zero_point[j] = -128.0f - lo[j] / scale;
+        q->scale[j] = scale;
+    }
+    return q;
+}
+
+void int8_channel_quantizer_destroy(int8_channel_quantizer_t *q) {
+    free(q);
+}
+
+void int8_channel_quantizer_encode(const int8_channel_quantizer_t *q, const float *input,
+                                   int8_t *output) {
+    for (size_t j = 0; j < q->dim; j++) {
+        float x = roundf(input[j] / q->scale[j] + q->zero_point[j]);
+        if (x >  127.0f) x =  127.0f;
+        if (x < -128.0f) x = -128.0f;
+        output[j] = (int8_t)x;
+    }
+}
+
+void int8_channel_quantizer_decode(const int8_channel_quantizer_t *q, const int8_t *input,
+                                   float *output) {
+    for (size_t j = 0; j < q->dim; j++)
+        output[j] = ((float)input[j] - q->zero_point[j]) * q->scale[j];
+}
+
+void int8_channel_quantizer_query(const int8_channel_quantizer_t *q, const float *query,
+                                  float *output) {
+    for (size_t j = 0; j < q->dim; j++)
+        output[j] = query[j] * q->scale[j];
+}
@@ -2,68 +2,146 @@
 // SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
 // SPDX-License-Identifier: Apache-2.0
 
-#include "embedding-library/int8_embedding_table.h"
+#include "int8_embedding_table_internal.h"
 #include "embedding-library/int8.h"
+#include "embedding-library/dispatch.h"
+#include "embedding-library/thread_pool.h"
+#include "embedding_table_file.h"
+#include "embedding_topk.h"
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <sys/mman.h>
 
-#define EMBEDDING_DIM 512u          /* each embedding has 512 int8 elements */
-#define NODE_CAPACITY 512u          /* a node stores 512 embeddings */
-#define NODE_SHIFT    9u            /* log2(NODE_CAPACITY) */
+/* point n's fields at block:
+ * layout: [512 doubles, or 512 floats (1/norm) with INV_NORMS |
+ *          512 floats if ROW_SCALES | 512 * dim int8 | padding]
+ */
+static void node_init(int8_embedding_node_t *n, void *block, uint32_t size,
+                      uint32_t flags, uint32_t layout) {
+    n->block  = block;
+    n->norms  = (layout & EMBEDDING_TABLE_LAYOUT_INV_NORMS) ? NULL : (double *)block;
+    n->inv_norms = (layout & EMBEDDING_TABLE_LAYOUT_INV_NORMS) ? (float *)block : NULL;
+    n->scales = (layout & EMBEDDING_TABLE_LAYOUT_ROW_SCALES)
+                    ? (float *)((char *)block + embedding_node_scales_offset(layout))
+                    : NULL;
+    n->data   = (int8_t *)((char *)block + embedding_node_data_offset(layout));
+    n->size  = size;
+    n->flags = flags;
+    n->numa  = 0;
+    atomic_init(&n->num_deleted, 0);
+    for (uint32_t w = 0; w < NODE_DELETED_WORDS; w++) atomic_init(&n->deleted[w], 0);
+}
 
-/* internal helper to allocate one node:
- * layout: [512 doubles | 512 * 512 int8]
+/* internal helper to allocate one node: the node itself, then its block
  * returns 0 on success, -1 on failure
  */
-static int alloc_node(int8_embedding_node_t **out_node) {
+int int8_embedding_node_alloc(int8_embedding_node_t **out_node, const int8_embedding_table_t *t) {
     *out_node = NULL;
 
-    const size_t norms_count = NODE_CAPACITY;
-    const size_t bytes =
-        norms_count * sizeof(double) +
-        (size_t)NODE_CAPACITY * (size_t)EMBEDDING_DIM * sizeof(int8_t);
-
-    void *mem = NULL;
-#if defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200112L
-    if (posix_memalign(&mem, 64, bytes) != 0) {
-        mem = NULL; /* fall through to malloc */
-    }
-#endif
-    if (!mem) {
-        mem = malloc(bytes);
-        if (!mem) {
-            return -1;
-        }
-    }
+    uint32_t numa = 0;
+    void *mem = t->slab ? embedding_slab_alloc(t->slab, &numa)
+                        : t->allocator.alloc(t->allocator.ctx,
+                                             INT8_EMBEDDING_NODE_HEADER + t->node_bytes, 64);
+    if (!mem) return -1;
+
+    int8_embedding_node_t *n = (int8_embedding_node_t *)mem;
+    void *block = (char *)mem + INT8_EMBEDDING_NODE_HEADER;
+    node_init(n, block, 0,
+              INT8_EMBEDDING_NODE_INLINE | (t->slab ? INT8_EMBEDDING_NODE_SLAB : 0), t->layout);
+    n->numa = numa;
+    embedding_node_block_clear_padding(block, t->dim, sizeof(int8_t), t->layout);
 
+    *out_node = n;
+    return 0;
+}
+
+int8_embedding_node_t *int8_embedding_node_wrap(void *block, uint32_t size,
+                                                uint32_t flags, uint32_t layout) {
     int8_embedding_node_t *n = (int8_embedding_node_t *)malloc(sizeof(*n));
-    if (!n) {
-        free(mem);
-        return -1;
-    }
+    if (!n) return NULL;
+    node_init(n, block, size, flags, layout);
+    return n;
+}
 
-    n->norms = (double *)mem;
-    n->data  = (int8_t *)(n->norms + norms_count);
-    n->size  = 0;
+void int8_embedding_node_free(const int8_embedding_table_t *t, int8_embedding_node_t *n) {
+    if (!n) return;
+    if (n->flags & INT8_EMBEDDING_NODE_SLAB) {
+        embedding_slab_free(t->slab, n);
+    } else if (n->flags & INT8_EMBEDDING_NODE_INLINE) {
+        t->allocator.free(t->allocator.ctx, n, INT8_EMBEDDING_NODE_HEADER + t->node_bytes);
+    } else {
+        /* a wrapped block: loaded (heap) or part of a mapping */
+        if (!(n->flags & INT8_EMBEDDING_NODE_MAPPED)) free(n->block);
+        free(n);
+    }
+}
 
-    *out_node = n;
+/* Keep p (a node array a reader may still be using) until destroy();
+ * returns 0 on success, -1 on failure.
+ */
+static int retire(int8_embedding_table_t *t, void *p) {
+    if (!p) return 0;
+    size_t n = t->num_retired;
+    if ((n & (n - 1)) == 0) {    /* grow at powers of two */
+        void **r = (void **)realloc(t->retired, (n ? n * 2 : 4) * sizeof(*r));
+        if (!r) return -1;
+        t->retired = r;
+    }
+    t->retired[t->num_retired++] = p;
     return 0;
 }
 
-/* ensure table has room for another node; returns 0 on success, -1 on failure */
-static int ensure_table_capacity(int8_embedding_table_t *t) {
-    if (t->index < t->size) return 0;
-    size_t new_size = (t->size == 0) ? (1024u * NODE_CAPACITY) : (t->size * 2u);
-    int8_embedding_node_t **p =
-        (int8_embedding_node_t **)realloc(t->table, new_size * sizeof(*t->table));
+/* Ensure the node array can hold `nodes` nodes; returns 0 on success, -1 on
+ * failure.  Readers may be scanning the current array, so a larger one is
+ * published in its place instead of realloc()ing it.
+ */
+static int reserve_nodes(int8_embedding_table_t *t, size_t nodes) {
+    if (nodes <= t->size) return 0;
+    /* start small: most tables never need the array of a large one */
+    size_t new_size = t->size ? t->size : 16u;
+    while (new_size < nodes) new_size *= 2u;
+    int8_embedding_node_t **old = t->table;
+    int8_embedding_node_t **p = (int8_embedding_node_t **)malloc(new_size * sizeof(*p));
     if (!p) return -1;
-    t->table = p;
+    if (retire(t, old) != 0) {
+        free(p);
+        return -1;
+    }
+    if (t->index) memcpy(p, old, t->index * sizeof(*p));
+    atomic_store_explicit(&t->table, p, memory_order_release);
     t->size  = new_size;
     return 0;
 }
 
+/* ensure table has room for another node; returns 0 on success, -1 on failure */
+int int8_embedding_table_grow(int8_embedding_table_t *t) {
+    return reserve_nodes(t, t->index + 1);
+}
+
+/* The node the next row goes into: the last one if it has room, else a new
+ * node put in the array (readers do not look at it before the row count
+ * covers it).  NULL on failure.
+ */
+static int8_embedding_node_t *writable_node(int8_embedding_table_t *t) {
+    if (t->index > 0) {
+        int8_embedding_node_t *n = t->table[t->index - 1];
+        if (n && n->size < NODE_CAPACITY) return n;
+    }
+    int8_embedding_node_t *n = NULL;
+    if (int8_embedding_table_grow(t) != 0 || int8_embedding_node_alloc(&n, t) != 0) return NULL;
+    t->table[t->index++] = n;
+    return n;
+}
+
+/* record row `slot`'s norm in whichever form the layout keeps */
+static inline void node_set_norm(int8_embedding_node_t *n, size_t slot, double norm) {
+    if (n->norms) n->norms[slot] = norm;
+    else n->inv_norms[slot] = (float)(1.0 / norm);
+}
+
 /* Add an embedding to the table.
  * If norm < 0.0, recompute as sqrt(dot(e,e)).
  * Returns global index (>=0) on success, or -1 on failure.
@@ -71,220 +149,841 @@ static int ensure_table_capacity(int8_embedding_table_t *t) {
 ssize_t int8_embedding_table_add_embedding(int8_embedding_table_t *t,
                                            const int8_t *embedding,
                                            double norm) {
+    return int8_embedding_table_add_embedding_scaled(t, embedding, norm, 1.0f);
+}
+
+ssize_t int8_embedding_table_add_embedding_scaled(int8_embedding_table_t *t,
+                                                  const int8_t *embedding, double norm,
+                                                  float scale) {
     if (!t || !embedding) return -1;
 
     if (norm < 0.0) {
         /* int8_dot_product returns signed int32; sum of squares is non-negative */
-        int32_t dp32 = int8_dot_product(embedding, embedding, EMBEDDING_DIM);
+        int32_t dp32 = int8_dot_product_dispatch(embedding, embedding, t->dim);
         if (dp32 <= 0) return -1;
         norm = sqrt((double)dp32);
     }
     if (norm == 0.0) return -1;
 
-    /* try to append to the last (not-full) node */
-    if (t->index > 0) {
-        int8_embedding_node_t *n = t->table[t->index - 1];
-        if (n && n->size < NODE_CAPACITY) {
-            int8_t *dst = n->data + ((size_t)n->size * EMBEDDING_DIM);
-            memcpy(dst, embedding, EMBEDDING_DIM);
-            n->norms[n->size] = norm;
-            n->size++;
-            /* global index = all-full-nodes * 512 + (n->size - 1) */
-            return (ssize_t)(((t->index - 1) << NODE_SHIFT) + (n->size - 1));
-        }
+    int8_embedding_node_t *n = writable_node(t);
+    if (!n) return -1;
+    uint32_t slot = n->size;
+    memcpy(n->data + (size_t)slot * t->dim, embedding, t->dim);
+    node_set_norm(n, slot, norm);
+    if (n->scales) n->scales[slot] = scale;
+    n->size++;
+
+    /* global index = all-full-nodes * 512 + slot */
+    size_t id = ((t->index - 1) << NODE_SHIFT) + slot;
+    atomic_store_explicit(&t->rows, id + 1, memory_order_release);
+    return (ssize_t)id;
+}
+
+ssize_t int8_embedding_table_append_rows(int8_embedding_table_t *t,
+                                         const int8_embedding_node_t *src,
+                                         uint32_t slot, uint32_t count) {
+    ssize_t first = (ssize_t)int8_embedding_table_size(t);
+    while (count > 0) {
+        int8_embedding_node_t *n = writable_node(t);
+        if (!n) return -1;
+        uint32_t m = NODE_CAPACITY - n->size;
+        if (m > count) m = count;
+        uint32_t d = n->size;
+        memcpy(n->data + (size_t)d * t->dim, src->data + (size_t)slot * t->dim, (size_t)m * t->dim);
+        if (n->norms) memcpy(n->norms + d, src->norms + slot, m * sizeof(double));
+        else memcpy(n->inv_norms + d, src->inv_norms + slot, m * sizeof(float));
+        if (n->scales) memcpy(n->scales + d, src->scales + slot, m * sizeof(float));
+        n->size += m;
+        slot += m;
+        count -= m;
+        atomic_store_explicit(&t->rows, ((t->index - 1) << NODE_SHIFT) + n->size,
+                              memory_order_release);
     }
+    return first;
+}
 
-    /* need a new node */
-    if (ensure_table_capacity(t) != 0) return -1;
+int int8_embedding_table_delete(int8_embedding_table_t *t, size_t index) {
+    if (!t || index >= int8_embedding_table_size(t)) return -1;
+    int8_embedding_node_t *n = t->table[index >> NODE_SHIFT];
+    uint64_t bit = (uint64_t)1 << (index & 63);
+    _Atomic(uint64_t) *word = &n->deleted[(index & (NODE_CAPACITY - 1)) >> 6];
+    if (atomic_fetch_or_explicit(word, bit, memory_order_relaxed) & bit) return -1;
+    atomic_fetch_add_explicit(&n->num_deleted, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&t->num_deleted, 1, memory_order_relaxed);
+    return 0;
+}
 
-    int8_embedding_node_t *n = NULL;
-    if (alloc_node(&n) != 0) return -1;
+ssize_t int8_embedding_table_update(int8_embedding_table_t *t, size_t index,
+                                    const int8_t *embedding, double norm, float scale) {
+    if (!t || int8_embedding_table_is_deleted(t, index)) return -1;
+    /* append first, so a failure leaves the old row in place */
+    ssize_t id = int8_embedding_table_add_embedding_scaled(t, embedding, norm, scale);
+    if (id >= 0) int8_embedding_table_delete(t, index);
+    return id;
+}
 
-    memcpy(n->data, embedding, EMBEDDING_DIM);
-    n->norms[0] = norm;
-    n->size = 1;
+/* A batch append: rows [first, first + n) of the table come from floats, and
+ * each part fills a contiguous run of whole nodes.
+ */
+typedef struct {
+    int8_embedding_table_t *t;
+    const float *floats;
+    size_t first;                  /* global id of floats' first row */
+    size_t n;
+    size_t first_node;
+    size_t num_nodes;
+    size_t nodes_per_part;
+    embedding_float_max_abs_cb max_abs;
+    embedding_int8_scale_floats_cb scale_floats;
+    embedding_int8_dot_product_cb dot;
+    atomic_int failed;
+} add_batch_t;
+
+static void add_batch_part(void *arg, size_t part) {
+    add_batch_t *w = (add_batch_t *)arg;
+    int8_embedding_table_t *t = w->t;
+    size_t dim = t->dim;
+    size_t begin = w->first_node + part * w->nodes_per_part;
+    size_t end = begin + w->nodes_per_part;
+    if (end > w->first_node + w->num_nodes) end = w->first_node + w->num_nodes;
+
+    for (size_t j = begin; j < end; j++) {
+        if (!t->table[j] && int8_embedding_node_alloc(&t->table[j], t) != 0) {
+            atomic_store_explicit(&w->failed, 1, memory_order_relaxed);
+            return;
+        }
+        int8_embedding_node_t *node = t->table[j];
+        size_t row = j << NODE_SHIFT;
+        size_t lo = row > w->first ? row : w->first;
+        size_t hi = row + NODE_CAPACITY < w->first + w->n ? row + NODE_CAPACITY
+                                                          : w->first + w->n;
+        /* quantize straight into the slot, then take the norm while it is in L1 */
+        for (size_t r = lo; r < hi; r++) {
+            size_t slot = r - row;
+            int8_t *dst = node->data + slot * dim;
+            const float *src = w->floats + (r - w->first) * dim;
+            float scale = 1.0f;
+            if (t->channel) {
+                int8_channel_quantizer_encode(t->channel, src, dst);
+            } else {
+                /* int8_from_floats_scaled() through the kernel table */
+                float max_abs = w->max_abs(src, dim);
+                if (max_abs == 0.0f) max_abs = 1.0f;
+                w->scale_floats(src, dim, 127.0f / max_abs, dst);
+                scale = max_abs / 127.0f;
+            }
+            if (node->scales) node->scales[slot] = scale;
+            int32_t dp = w->dot(dst, dst, dim);
+            if (dp <= 0) {
+                atomic_store_explicit(&w->failed, 1, memory_order_relaxed);
+                return;
+            }
+            node_set_norm(node, slot, sqrt((double)dp));
+        }
+        node->size = (uint32_t)(hi - row);
+    }
+}
 
-    t->table[t->index] = n;
-    t->index++;
+ssize_t int8_embedding_table_add_floats_batch_parallel(int8_embedding_table_t *t,
+                                                       embedding_thread_pool_t *pool,
+                                                       const float *floats, size_t n) {
+    if (!t || (!floats && n)) return -1;
+    size_t first = int8_embedding_table_size(t);
+    if (n == 0) return (ssize_t)first;
+
+    size_t old_index = t->index;
+    uint32_t old_last_size = old_index ? t->table[old_index - 1]->size : 0;
+    size_t first_node = first >> NODE_SHIFT;
+    size_t end_node = ((first + n - 1) >> NODE_SHIFT) + 1;
+
+    /* reserve every node first so the parts only touch their own slots */
+    if (reserve_nodes(t, end_node) != 0) return -1;
+    for (size_t j = old_index; j < end_node; j++) t->table[j] = NULL;
+
+    add_batch_t w;
+    w.t = t;
+    w.floats = floats;
+    w.first = first;
+    w.n = n;
+    w.first_node = first_node;
+    w.num_nodes = end_node - first_node;
+    w.max_abs = embedding_kernels()->float_max_abs;
+    w.scale_floats = embedding_kernels()->int8_scale_floats;
+    w.dot = embedding_kernels()->int8_dot_product;
+    atomic_init(&w.failed, 0);
+
+    size_t parts = embedding_thread_pool_size(pool) * 4;
+    if (parts > w.num_nodes) parts = w.num_nodes;
+    w.nodes_per_part = (w.num_nodes + parts - 1) / parts;
+    parts = (w.num_nodes + w.nodes_per_part - 1) / w.nodes_per_part;
+    embedding_thread_pool_run(pool, add_batch_part, &w, parts);
+
+    if (atomic_load(&w.failed)) {
+        /* all-zero row or out of memory: leave the table as it was */
+        for (size_t j = old_index; j < end_node; j++) {
+            int8_embedding_node_free(t, t->table[j]);
+            t->table[j] = NULL;
+        }
+        if (old_index) t->table[old_index - 1]->size = old_last_size;
+        return -1;
+    }
+    t->index = end_node;
+    atomic_store_explicit(&t->rows, first + n, memory_order_release);
+    return (ssize_t)first;
+}
 
-    return (ssize_t)(((t->index - 1) << NODE_SHIFT) + (n->size - 1));
+ssize_t int8_embedding_table_add_floats_batch(int8_embedding_table_t *t,
+                                              const float *floats, size_t n) {
+    return int8_embedding_table_add_floats_batch_parallel(t, NULL, floats, n);
 }
 
 int8_embedding_table_t *int8_embedding_table_init(size_t size) {
-    if (size == 0) {
-        size = 1024u * NODE_CAPACITY; /* default ~268M embeddings capacity */
-    }
+    return int8_embedding_table_init_dim(EMBEDDING_DIM, size);
+}
+
+int8_embedding_table_t *int8_embedding_table_init_dim(size_t dim, size_t size) {
+    return int8_embedding_table_init_layout(dim, size, 0);
+}
+
+int8_embedding_table_t *int8_embedding_table_init_layout(size_t dim, size_t size,
+                                                         uint32_t layout) {
+    if (dim == 0 || dim > EMBEDDING_MAX_DIM) return NULL;
+    if (layout & ~(uint32_t)(EMBEDDING_TABLE_LAYOUT_ROW_SCALES | EMBEDDING_TABLE_LAYOUT_INV_NORMS))
+        return NULL;
     int8_embedding_table_t *t =
         (int8_embedding_table_t *)calloc(1, sizeof(*t));
     if (!t) return NULL;
 
-    t->table = (int8_embedding_node_t **)calloc(size, sizeof(*t->table));
-    if (!t->table) {
+    /* size == 0: the node array is allocated with the first node */
+    int8_embedding_node_t **table = NULL;
+    if (size && !(table = (int8_embedding_node_t **)calloc(size, sizeof(*table)))) {
         free(t);
         return NULL;
     }
+    atomic_init(&t->table, table);
+    atomic_init(&t->rows, 0);
     t->size  = size;
     t->index = 0;
+    t->dim   = dim;
+    t->layout = layout;
+    t->node_bytes = int8_embedding_node_bytes(dim, layout);
+    t->table_id = embedding_table_new_id();
+    t->allocator = embedding_heap_allocator;
     return t;
 }
 
+int int8_embedding_table_set_memory(int8_embedding_table_t *t, uint32_t flags) {
+    if (!t || t->index != 0) return -1;
+    embedding_slab_t *slab = NULL;
+    if (flags && !(slab = embedding_slab_init(INT8_EMBEDDING_NODE_HEADER + t->node_bytes, flags)))
+        return -1;
+    embedding_slab_destroy(t->slab);
+    t->slab = slab;
+    t->memory = flags;
+    return 0;
+}
+
+int int8_embedding_table_set_allocator(int8_embedding_table_t *t,
+                                       const embedding_allocator_t *a) {
+    if (!t || t->index != 0) return -1;
+    if (a && (!a->alloc || !a->free)) return -1;
+    embedding_slab_destroy(t->slab);
+    t->slab = NULL;
+    t->memory = 0;
+    t->allocator = a ? *a : embedding_heap_allocator;
+    return 0;
+}
+
+int int8_embedding_table_set_channel_quantizer(int8_embedding_table_t *t,
+                                               const int8_channel_quantizer_t *q) {
+    if (!t || int8_embedding_table_size(t) != 0) return -1;
+    if (q && q->dim != t->dim) return -1;
+    int8_channel_quantizer_t *copy = NULL;
+    if (q && !(copy = int8_channel_quantizer_init(q->dim, q->scale, q->zero_point))) return -1;
+    int8_channel_quantizer_destroy(t->channel);
+    t->channel = copy;
+    return 0;
+}
+
 void int8_embedding_table_destroy(int8_embedding_table_t *t) {
     if (!t) return;
-    for (size_t i = 0; i < t->index; i++) {
-        if (t->table[i]) {
-            /* single allocation starting at norms */
-            free(t->table[i]->norms);
-            free(t->table[i]);
-        }
-    }
+    for (size_t i = 0; i < t->index; i++)
+        int8_embedding_node_free(t, t->table[i]);
+    embedding_slab_destroy(t->slab);
+    if (t->map) munmap(t->map, t->map_size);
+    int8_channel_quantizer_destroy(t->channel);
+    for (size_t i = 0; i < t->num_retired; i++) free(t->retired[i]);
+    free(t->retired);
     free(t->table);
     free(t);
 }
 
-void int8_embedding_table_serialize(int8_embedding_table_t *t, const char *filename) {
-    if (!t || !filename) return;
+/* What a reader scans: the rows published when it started, and a node array
+ * holding them.  Node sizes are the writer's; readers go by the snapshot.
+ */
+typedef struct {
+    int8_embedding_node_t *const *nodes;
+    size_t rows;
+    size_t num_nodes;
+} snapshot_t;
+
+static inline void snapshot_take(int8_embedding_table_t *t, snapshot_t *s) {
+    /* the count first: the array loaded after it holds every published node */
+    s->rows = atomic_load_explicit(&t->rows, memory_order_acquire);
+    s->nodes = atomic_load_explicit(&t->table, memory_order_acquire);
+    s->num_nodes = embedding_nodes_for_rows(s->rows);
+}
 
-    FILE *file = fopen(filename, "ab+");
-    if (!file) {
-        perror("int8_embedding_table_serialize: fopen");
-        return;
-    }
+/* rows of node i in the snapshot */
+static inline uint32_t snapshot_count(const snapshot_t *s, size_t i) {
+    size_t left = s->rows - (i << NODE_SHIFT);
+    return left < NODE_CAPACITY ? (uint32_t)left : NODE_CAPACITY;
+}
+
+/* a full node whose every row is deleted is not worth scoring */
+static inline int node_all_deleted(const int8_embedding_node_t *n) {
+    return atomic_load_explicit(&n->num_deleted, memory_order_relaxed) == NODE_CAPACITY;
+}
+
+/* tombstone word w of n as a mask of the live rows among its first count */
+static inline uint64_t node_live(const int8_embedding_node_t *n, uint32_t count, uint32_t w) {
+    uint64_t deleted = atomic_load_explicit(&n->deleted[w], memory_order_relaxed);
+    return ~deleted & embedding_node_rows_mask(count, w);
+}
 
-    /* Determine current file size */
-    if (fseek(file, 0, SEEK_END) != 0) {
-        perror("int8_embedding_table_serialize: fseek");
-        fclose(file);
+/* Offer a node's dot products to the heap as cosine scores; with inverse
+ * norms that is a multiply per row instead of a divide.  A node with deleted
+ * rows walks its tombstone words instead, 64 rows per mask, so deleted rows
+ * never reach the heap and a run of them costs one load.
+ */
+static inline void push_cosines(const int8_embedding_node_t *n, uint32_t count, size_t base,
+                                const int32_t *dots, double query_norm, embedding_topk_t *h) {
+    if (atomic_load_explicit(&n->num_deleted, memory_order_relaxed)) {
+        const double inv_q = 1.0 / query_norm;
+        for (uint32_t w = 0; w * 64u < count; w++) {
+            for (uint64_t live = node_live(n, count, w); live; live &= live - 1) {
+                uint32_t i = w * 64u + embedding_ctz64(live);
+                double score = n->inv_norms ? dots[i] * (inv_q * n->inv_norms[i])
+                                            : dots[i] / (query_norm * n->norms[i]);
+                if (embedding_topk_accepts(h, score))
+                    embedding_topk_push(h, score, base + i);
+            }
+        }
         return;
     }
-    long file_size = ftell(file);
-    if (file_size < 0) {
-        perror("int8_embedding_table_serialize: ftell");
-        fclose(file);
+    if (n->inv_norms) {
+        const double inv_q = 1.0 / query_norm;
+        for (uint32_t i = 0; i < count; i++) {
+            double score = dots[i] * (inv_q * n->inv_norms[i]);
+            if (embedding_topk_accepts(h, score))
+                embedding_topk_push(h, score, base + i);
+        }
         return;
     }
+    for (uint32_t i = 0; i < count; i++) {
+        double score = dots[i] / (query_norm * n->norms[i]);
+        if (embedding_topk_accepts(h, score))
+            embedding_topk_push(h, score, base + i);
+    }
+}
 
-    const size_t record_size = sizeof(double) + EMBEDDING_DIM * sizeof(int8_t);
-    if ((size_t)file_size % record_size != 0) {
-        /* partial/corrupt file: truncate */
-        fclose(file);
-        file = fopen(filename, "wb");
-        if (!file) {
-            perror("int8_embedding_table_serialize: reopen wb");
-            return;
+/* Score the first `count` rows of node `n` (global ids start at `base`)
+ * against the query and offer the results to the heap.  The dot products for
+ * the whole node are computed in one pass over its contiguous rows before any
+ * heap work.
+ */
+static void scan_node(embedding_int8_dot_product_rows_cb rows, size_t dim,
+                      const int8_embedding_node_t *n, uint32_t count, size_t base,
+                      const int8_t *query, double query_norm,
+                      embedding_topk_t *h) {
+    int32_t dots[NODE_CAPACITY];
+    if (node_all_deleted(n)) return;
+    rows(query, n->data, count, dim, dots);
+    push_cosines(n, count, base, dots, query_norm, h);
+}
+
+/* A filtered node runs the rows kernel over its rows up to the last one that
+ * passes once at least 1 / FILTER_DENSE_SHARE of them pass; below that each
+ * passing row gets its own dot product, which reads only those rows (faster
+ * up to about a third of the node at 768 dims, slower past a half).
+ */
+#define FILTER_DENSE_SHARE 2u
+
+/* The rows among node i's first count that filter lets through, as one mask
+ * per tombstone word; returns how many there are.
+ */
+static uint32_t filter_node(const embedding_filter_t *filter, const int8_embedding_node_t *n,
+                            size_t i, uint32_t count, uint64_t *pass) {
+    const embedding_bitmap_block_t *b = NULL;
+    if (filter->rows && !(b = embedding_bitmap_block(filter->rows, i))) return 0;
+    uint32_t total = 0;
+    for (uint32_t w = 0; w < NODE_DELETED_WORDS; w++) {
+        uint64_t m = w * 64u < count ? node_live(n, count, w) : 0;
+        if (b && m) m &= atomic_load_explicit(&b->words[w], memory_order_relaxed);
+        if (filter->match) {
+            for (uint64_t bits = m; bits; bits &= bits - 1) {
+                unsigned bit = embedding_ctz64(bits);
+                if (!filter->match(filter->arg, (i << NODE_SHIFT) + w * 64u + bit))
+                    m &= ~((uint64_t)1 << bit);
+            }
         }
-        file_size = 0;
+        pass[w] = m;
+        total += embedding_popcount64(m);
     }
+    return total;
+}
 
-    size_t existing_records = (size_t)file_size / record_size;
-    size_t total_records    = int8_embedding_table_size(t);
-
-    /* If file has more records than table, truncate to table size */
-    if (existing_records > total_records) {
-        fclose(file);
-        file = fopen(filename, "wb");
-        if (!file) {
-            perror("int8_embedding_table_serialize: truncate wb");
-            return;
+/* scan_node() for the rows filter lets through; node i of the table */
+static void scan_node_filtered(embedding_int8_dot_product_rows_cb rows,
+                               embedding_int8_dot_product_cb dot, size_t dim,
+                               const int8_embedding_node_t *n, uint32_t count, size_t i,
+                               const int8_t *query, double query_norm,
+                               const embedding_filter_t *filter, embedding_topk_t *h) {
+    uint64_t pass[NODE_DELETED_WORDS];
+    if (node_all_deleted(n)) return;
+    uint32_t selected = filter_node(filter, n, i, count, pass);
+    if (selected == 0) return;
+
+    int32_t dots[NODE_CAPACITY];
+    if (selected * FILTER_DENSE_SHARE >= count) {
+        uint32_t end = 0;
+        for (uint32_t w = 0; w < NODE_DELETED_WORDS; w++)
+            if (pass[w]) end = w * 64u + 64u - embedding_clz64(pass[w]);
+        rows(query, n->data, end, dim, dots);
+    }
+    const double inv_q = 1.0 / query_norm;
+    size_t base = i << NODE_SHIFT;
+    for (uint32_t w = 0; w < NODE_DELETED_WORDS; w++) {
+        for (uint64_t bits = pass[w]; bits; bits &= bits - 1) {
+            uint32_t r = w * 64u + embedding_ctz64(bits);
+            int32_t d = selected * FILTER_DENSE_SHARE >= count
+                            ? dots[r] : dot(query, n->data + (size_t)r * dim, dim);
+            double score = n->inv_norms ? d * (inv_q * n->inv_norms[r])
+                                        : d / (query_norm * n->norms[r]);
+            if (embedding_topk_accepts(h, score))
+                embedding_topk_push(h, score, base + r);
         }
-        existing_records = 0;
     }
+}
 
-    /* Append new records */
-    for (size_t i = existing_records; i < total_records; i++) {
-        double  norm = int8_embedding_table_norm(t, i);
-        int8_t *vec  = int8_embedding_table_embedding(t, i);
-        if (!vec) break;
+/* the caller's norm, or sqrt(q.q) if it passed a negative one; 0.0 if unusable */
+static double query_norm_of(const int8_t *query, size_t dim, double norm) {
+    if (norm < 0.0) {
+        int32_t dp32 = int8_dot_product_dispatch(query, query, dim);
+        norm = (dp32 > 0) ? sqrt((double)dp32) : 0.0;
+    }
+    return norm;
+}
 
-        if (fwrite(&norm, sizeof(double), 1, file) != 1) {
-            perror("int8_embedding_table_serialize: fwrite(norm)");
-            break;
-        }
-        if (fwrite(vec, sizeof(int8_t), EMBEDDING_DIM, file) != EMBEDDING_DIM) {
-            perror("int8_embedding_table_serialize: fwrite(vec)");
-            break;
-        }
+/* topk() and topk_filtered(); filter may be NULL */
+static size_t topk_serial(int8_embedding_table_t *t,
+                          const int8_t *query, double query_norm,
+                          const embedding_filter_t *filter,
+                          size_t k, size_t *out_ids, double *out_scores) {
+    if (!t || !query || k == 0) return 0;
+
+    query_norm = query_norm_of(query, t->dim, query_norm);
+    if (query_norm == 0.0) return 0;
+
+    snapshot_t snap;
+    snapshot_take(t, &snap);
+    if (k > snap.rows) k = snap.rows;
+    if (k == 0) return 0;
+
+    embedding_topk_entry_t *storage =
+        (embedding_topk_entry_t *)malloc(k * sizeof(*storage));
+    if (!storage) return 0;
+
+    embedding_int8_dot_product_rows_cb rows = embedding_int8_rows_kernel(embedding_kernels(), t->dim);
+    embedding_int8_dot_product_cb dot = embedding_kernels()->int8_dot_product;
+    embedding_topk_t h;
+    embedding_topk_init(&h, storage, k);
+    for (size_t i = 0; i < snap.num_nodes; i++) {
+        if (filter)
+            scan_node_filtered(rows, dot, t->dim, snap.nodes[i], snapshot_count(&snap, i), i,
+                               query, query_norm, filter, &h);
+        else
+            scan_node(rows, t->dim, snap.nodes[i], snapshot_count(&snap, i), i << NODE_SHIFT,
+                      query, query_norm, &h);
     }
 
-    fflush(file);
-    fclose(file);
+    size_t n = embedding_topk_drain(&h, out_ids, out_scores);
+    free(storage);
+    return n;
+}
+
+size_t int8_embedding_table_topk(int8_embedding_table_t *t,
+                                 const int8_t *query, double query_norm,
+                                 size_t k, size_t *out_ids, double *out_scores) {
+    return topk_serial(t, query, query_norm, NULL, k, out_ids, out_scores);
 }
 
-int8_embedding_table_t *int8_embedding_table_deserialize(const char *filename) {
-    if (!filename) return NULL;
+size_t int8_embedding_table_topk_filtered(int8_embedding_table_t *t,
+                                          const int8_t *query, double query_norm,
+                                          const embedding_filter_t *filter,
+                                          size_t k, size_t *out_ids, double *out_scores) {
+    return topk_serial(t, query, query_norm, filter, k, out_ids, out_scores);
+}
 
-    FILE *file = fopen(filename, "rb");
-    if (!file) {
-        perror("int8_embedding_table_deserialize: fopen");
-        return NULL;
+/* A float query prepared for inner-product scoring: quantized once, with the
+ * channel scales folded in and the zero points reduced to one offset.
+ */
+typedef struct {
+    int8_t *q8;
+    double scale;      /* query dequantization scale */
+    double offset;     /* dot(q8, zero_point); 0.0 without a channel quantizer */
+} ip_query_t;
+
+static int ip_query_init(ip_query_t *q, const int8_embedding_table_t *t, const float *query) {
+    size_t dim = t->dim;
+    q->q8 = (int8_t *)malloc(dim);
+    if (!q->q8) return -1;
+    q->offset = 0.0;
+    if (!t->channel) {
+        q->scale = int8_from_floats_scaled_dispatch(query, dim, q->q8);
+        return 0;
+    }
+    float *folded = (float *)malloc(dim * sizeof(float));
+    if (!folded) {
+        free(q->q8);
+        return -1;
     }
+    int8_channel_quantizer_query(t->channel, query, folded);
+    q->scale = int8_from_floats_scaled_dispatch(folded, dim, q->q8);
+    free(folded);
+    for (size_t j = 0; j < dim; j++)
+        q->offset += (double)q->q8[j] * t->channel->zero_point[j];
+    return 0;
+}
 
-    if (fseek(file, 0, SEEK_END) != 0) {
-        perror("int8_embedding_table_deserialize: fseek");
-        fclose(file);
-        return NULL;
+static double ip_score(const ip_query_t *q, int32_t dot, const int8_embedding_node_t *n,
+                       uint32_t slot) {
+    double score = q->scale * ((double)dot - q->offset);
+    return n->scales ? score * n->scales[slot] : score;
+}
+
+/* scan_node() for inner-product scores */
+static void scan_node_ip(embedding_int8_dot_product_rows_cb rows, size_t dim,
+                         const int8_embedding_node_t *n, uint32_t count, size_t base,
+                         const ip_query_t *q, embedding_topk_t *h) {
+    int32_t dots[NODE_CAPACITY];
+    if (node_all_deleted(n)) return;
+    rows(q->q8, n->data, count, dim, dots);
+    if (atomic_load_explicit(&n->num_deleted, memory_order_relaxed)) {
+        for (uint32_t w = 0; w * 64u < count; w++) {
+            for (uint64_t live = node_live(n, count, w); live; live &= live - 1) {
+                uint32_t i = w * 64u + embedding_ctz64(live);
+                double score = ip_score(q, dots[i], n, i);
+                if (embedding_topk_accepts(h, score))
+                    embedding_topk_push(h, score, base + i);
+            }
+        }
+        return;
     }
-    long file_size = ftell(file);
-    if (file_size <= 0) {
-        fclose(file);
-        return NULL;
+    for (uint32_t i = 0; i < count; i++) {
+        double score = ip_score(q, dots[i], n, i);
+        if (embedding_topk_accepts(h, score))
+            embedding_topk_push(h, score, base + i);
     }
-    if (fseek(file, 0, SEEK_SET) != 0) {
-        perror("int8_embedding_table_deserialize: rewind");
-        fclose(file);
-        return NULL;
+}
+
+/* One partition of a parallel scan: a contiguous run of nodes and a private heap */
+typedef struct {
+    embedding_int8_dot_product_rows_cb rows;
+    int8_embedding_table_t *t;
+    const snapshot_t *snap;
+    const int8_t *query;
+    double query_norm;
+    const ip_query_t *ip;          /* inner-product scan if set */
+    const embedding_filter_t *filter;  /* cosine scan of these rows if set */
+    embedding_int8_dot_product_cb dot;
+    size_t nodes_per_part;
+    embedding_topk_t *heaps;
+    const size_t *order;           /* node ids grouped by NUMA node, or NULL */
+    const size_t *bounds;          /* with order: part p scans order[bounds[p], bounds[p + 1]) */
+} topk_parallel_t;
+
+static void topk_parallel_part(void *arg, size_t part) {
+    topk_parallel_t *w = (topk_parallel_t *)arg;
+    size_t begin, end;
+    if (w->order) {
+        begin = w->bounds[part];
+        end = w->bounds[part + 1];
+    } else {
+        begin = part * w->nodes_per_part;
+        end = begin + w->nodes_per_part;
+        if (end > w->snap->num_nodes) end = w->snap->num_nodes;
     }
+    for (size_t pos = begin; pos < end; pos++) {
+        size_t i = w->order ? w->order[pos] : pos;
+        const int8_embedding_node_t *n = w->snap->nodes[i];
+        uint32_t count = snapshot_count(w->snap, i);
+        if (w->ip)
+            scan_node_ip(w->rows, w->t->dim, n, count, i << NODE_SHIFT, w->ip, &w->heaps[part]);
+        else if (w->filter)
+            scan_node_filtered(w->rows, w->dot, w->t->dim, n, count, i, w->query,
+                               w->query_norm, w->filter, &w->heaps[part]);
+        else
+            scan_node(w->rows, w->t->dim, n, count, i << NODE_SHIFT, w->query, w->query_norm,
+                      &w->heaps[part]);
+    }
+}
 
-    const size_t record_size = sizeof(double) + EMBEDDING_DIM * sizeof(int8_t);
-    if ((size_t)file_size % record_size != 0) {
-        /* partial/corrupt file */
-        fclose(file);
-        return NULL;
+/* NUMA-grouped partitions: order lists the node ids group by group (group g
+ * is NUMA node g), and every group is split into parts of at most
+ * nodes_per_part nodes, bounds[] holding each part's start in order.
+ * group_parts[g] receives the number of parts of group g.  Returns the number
+ * of parts, or 0 if out of memory.
+ */
+static size_t numa_partition(const snapshot_t *snap, size_t groups,
+                             size_t nodes_per_part, size_t **out_order, size_t **out_bounds,
+                             size_t *group_parts) {
+    size_t num_nodes = snap->num_nodes;
+    size_t *order = (size_t *)malloc(num_nodes * sizeof(*order));
+    size_t *bounds = (size_t *)malloc((num_nodes + groups + 1) * sizeof(*bounds));
+    size_t *fill = (size_t *)calloc(groups + 1, sizeof(*fill));
+    if (!order || !bounds || !fill) {
+        free(order);
+        free(bounds);
+        free(fill);
+        return 0;
+    }
+    /* counting sort of the nodes by their NUMA node (mapped/heap nodes are 0) */
+    for (size_t i = 0; i < num_nodes; i++) fill[snap->nodes[i]->numa % groups + 1]++;
+    for (size_t g = 0; g < groups; g++) fill[g + 1] += fill[g];
+    size_t parts = 0;
+    for (size_t g = 0; g < groups; g++) {
+        size_t count = fill[g + 1] - fill[g];
+        group_parts[g] = (count + nodes_per_part - 1) / nodes_per_part;
+        for (size_t p = 0; p < group_parts[g]; p++) bounds[parts++] = fill[g] + p * nodes_per_part;
     }
+    bounds[parts] = num_nodes;
+    for (size_t i = 0; i < num_nodes; i++) order[fill[snap->nodes[i]->numa % groups]++] = i;
+    free(fill);
+    *out_order = order;
+    *out_bounds = bounds;
+    return parts;
+}
 
-    size_t num_records = (size_t)file_size / record_size;
+/* Partition the nodes across the pool, then merge the per-part heaps. */
+static size_t topk_parallel_run(int8_embedding_table_t *t, embedding_thread_pool_t *pool,
+                                const int8_t *query, double query_norm,
+                                const ip_query_t *ip, const embedding_filter_t *filter,
+                                size_t k, size_t *out_ids, double *out_scores) {
+    size_t threads = embedding_thread_pool_size(pool);
+    snapshot_t snap;
+    snapshot_take(t, &snap);
+    if (k > snap.rows) k = snap.rows;
+    if (k == 0) return 0;
+
+    /* a few partitions per thread so a slow thread does not hold up the merge */
+    size_t parts = threads * 4;
+    if (parts > snap.num_nodes) parts = snap.num_nodes;
+    size_t nodes_per_part = (snap.num_nodes + parts - 1) / parts;
+    parts = (snap.num_nodes + nodes_per_part - 1) / nodes_per_part;
+
+    size_t *order = NULL, *bounds = NULL, *group_parts = NULL;
+    size_t groups = embedding_numa_nodes();
+    if ((t->memory & EMBEDDING_MEMORY_NUMA_SPREAD) &&
+        (!(group_parts = (size_t *)malloc(groups * sizeof(*group_parts))) ||
+         !(parts = numa_partition(&snap, groups, nodes_per_part, &order, &bounds, group_parts)))) {
+        free(group_parts);
+        return 0;
+    }
 
-    int8_embedding_table_t *table = int8_embedding_table_init(0);
-    if (!table) {
-        fclose(file);
-        return NULL;
+    embedding_topk_entry_t *storage =
+        (embedding_topk_entry_t *)malloc((parts + 1) * k * sizeof(*storage));
+    embedding_topk_t *heaps = (embedding_topk_t *)malloc(parts * sizeof(*heaps));
+    if (!storage || !heaps) {
+        free(storage);
+        free(heaps);
+        free(group_parts);
+        free(bounds);
+        free(order);
+        return 0;
+    }
+    for (size_t i = 0; i < parts; i++)
+        embedding_topk_init(&heaps[i], storage + (i + 1) * k, k);
+
+    topk_parallel_t w = { embedding_int8_rows_kernel(embedding_kernels(), t->dim),
+                          t, &snap, query, query_norm, ip, filter,
+                          embedding_kernels()->int8_dot_product, nodes_per_part, heaps, order,
+                          bounds };
+    if (order)
+        embedding_thread_pool_run_grouped(pool, topk_parallel_part, &w, group_parts, groups);
+    else
+        embedding_thread_pool_run(pool, topk_parallel_part, &w, parts);
+    free(group_parts);
+    free(bounds);
+    free(order);
+
+    embedding_topk_t h;
+    embedding_topk_init(&h, storage, k);
+    for (size_t i = 0; i < parts; i++) {
+        for (size_t j = 0; j < heaps[i].size; j++) {
+            const embedding_topk_entry_t *e = &heaps[i].heap[j];
+            embedding_topk_push(&h, e->score, e->id);
+        }
     }
 
-    for (size_t i = 0; i < num_records; i++) {
-        size_t node_index = i >> NODE_SHIFT;  /* i / 512 */
-        size_t offset     = i & (NODE_CAPACITY - 1); /* i % 512 */
+    size_t n = embedding_topk_drain(&h, out_ids, out_scores);
+    free(heaps);
+    free(storage);
+    return n;
+}
 
-        if (node_index >= table->index) {
-            if (ensure_table_capacity(table) != 0) {
-                int8_embedding_table_destroy(table);
-                fclose(file);
-                return NULL;
-            }
-            int8_embedding_node_t *node = NULL;
-            if (alloc_node(&node) != 0) {
-                int8_embedding_table_destroy(table);
-                fclose(file);
-                return NULL;
-            }
-            table->table[table->index++] = node;
-        }
+size_t int8_embedding_table_topk_parallel(int8_embedding_table_t *t,
+                                          embedding_thread_pool_t *pool,
+                                          const int8_t *query, double query_norm,
+                                          size_t k, size_t *out_ids, double *out_scores) {
+    size_t threads = embedding_thread_pool_size(pool);
+    if (!t || threads < 2 || int8_embedding_table_size(t) <= NODE_CAPACITY)
+        return int8_embedding_table_topk(t, query, query_norm, k, out_ids, out_scores);
+    if (!query || k == 0) return 0;
+
+    query_norm = query_norm_of(query, t->dim, query_norm);
+    if (query_norm == 0.0) return 0;
+    return topk_parallel_run(t, pool, query, query_norm, NULL, NULL, k, out_ids, out_scores);
+}
 
-        int8_embedding_node_t *node = table->table[node_index];
+size_t int8_embedding_table_topk_filtered_parallel(int8_embedding_table_t *t,
+                                                   embedding_thread_pool_t *pool,
+                                                   const int8_t *query, double query_norm,
+                                                   const embedding_filter_t *filter,
+                                                   size_t k, size_t *out_ids,
+                                                   double *out_scores) {
+    size_t threads = embedding_thread_pool_size(pool);
+    if (!t || threads < 2 || int8_embedding_table_size(t) <= NODE_CAPACITY)
+        return topk_serial(t, query, query_norm, filter, k, out_ids, out_scores);
+    if (!query || k == 0) return 0;
+
+    query_norm = query_norm_of(query, t->dim, query_norm);
+    if (query_norm == 0.0) return 0;
+    return topk_parallel_run(t, pool, query, query_norm, NULL, filter, k, out_ids, out_scores);
+}
 
-        if (fread(&node->norms[offset], sizeof(double), 1, file) != 1) {
-            int8_embedding_table_destroy(table);
-            fclose(file);
-            return NULL;
-        }
-        if (fread(node->data + (offset * EMBEDDING_DIM),
-                  sizeof(int8_t), EMBEDDING_DIM, file) != EMBEDDING_DIM) {
-            int8_embedding_table_destroy(table);
-            fclose(file);
-            return NULL;
+size_t int8_embedding_table_topk_ip(int8_embedding_table_t *t, const float *query,
+                                    size_t k, size_t *out_ids, double *out_scores) {
+    if (!t || !query || k == 0) return 0;
+
+    snapshot_t snap;
+    snapshot_take(t, &snap);
+    if (k > snap.rows) k = snap.rows;
+    if (k == 0) return 0;
+
+    ip_query_t q;
+    if (ip_query_init(&q, t, query) != 0) return 0;
+    embedding_topk_entry_t *storage =
+        (embedding_topk_entry_t *)malloc(k * sizeof(*storage));
+    if (!storage) {
+        free(q.q8);
+        return 0;
+    }
+
+    embedding_int8_dot_product_rows_cb rows = embedding_int8_rows_kernel(embedding_kernels(), t->dim);
+    embedding_topk_t h;
+    embedding_topk_init(&h, storage, k);
+    for (size_t i = 0; i < snap.num_nodes; i++)
+        scan_node_ip(rows, t->dim, snap.nodes[i], snapshot_count(&snap, i), i << NODE_SHIFT,
+                     &q, &h);
+
+    size_t n = embedding_topk_drain(&h, out_ids, out_scores);
+    free(storage);
+    free(q.q8);
+    return n;
+}
+
+size_t int8_embedding_table_topk_ip_parallel(int8_embedding_table_t *t,
+                                             embedding_thread_pool_t *pool,
+                                             const float *query, size_t k,
+                                             size_t *out_ids, double *out_scores) {
+    size_t threads = embedding_thread_pool_size(pool);
+    if (!t || threads < 2 || int8_embedding_table_size(t) <= NODE_CAPACITY)
+        return int8_embedding_table_topk_ip(t, query, k, out_ids, out_scores);
+    if (!query || k == 0) return 0;
+
+    ip_query_t q;
+    if (ip_query_init(&q, t, query) != 0) return 0;
+    size_t n = topk_parallel_run(t, pool, NULL, 0.0, &q, NULL, k, out_ids, out_scores);
+    free(q.q8);
+    return n;
+}
+
+double int8_embedding_table_inner_product(int8_embedding_table_t *t, const float *query,
+                                          size_t index) {
+    if (!t || !query || index >= int8_embedding_table_size(t)) return 0.0;
+    ip_query_t q;
+    if (ip_query_init(&q, t, query) != 0) return 0.0;
+    const int8_embedding_node_t *n = int8_embedding_table_node(t, index >> NODE_SHIFT);
+    uint32_t slot = (uint32_t)(index & (NODE_CAPACITY - 1));
+    int32_t dot = int8_dot_product_dispatch(q.q8, n->data + (size_t)slot * t->dim, t->dim);
+    double score = ip_score(&q, dot, n, slot);
+    free(q.q8);
+    return score;
+}
+
+size_t int8_embedding_table_topk_batch(int8_embedding_table_t *t,
+                                       const int8_t *queries, const double *query_norms,
+                                       size_t num_queries, size_t k,
+                                       size_t *out_ids, double *out_scores) {
+    if (!t || !queries || num_queries == 0 || k == 0) return 0;
+
+    snapshot_t snap;
+    snapshot_take(t, &snap);
+    size_t kk = (k < snap.rows) ? k : snap.rows;
+    if (kk == 0) return 0;
+
+    double *norms = (double *)malloc(num_queries * sizeof(*norms));
+    int32_t *dots = (int32_t *)malloc(num_queries * NODE_CAPACITY * sizeof(*dots));
+    embedding_topk_entry_t *storage =
+        (embedding_topk_entry_t *)malloc(num_queries * kk * sizeof(*storage));
+    embedding_topk_t *heaps = (embedding_topk_t *)malloc(num_queries * sizeof(*heaps));
+    if (!norms || !dots || !storage || !heaps) {
+        free(norms);
+        free(dots);
+        free(storage);
+        free(heaps);
+        return 0;
+    }
+
+    for (size_t q = 0; q < num_queries; q++) {
+        const int8_t *query = queries + q * t->dim;
+        double norm = query_norm_of(query, t->dim, query_norms ? query_norms[q] : -1.0);
+        norms[q] = norm;
+        /* a zero query matches nothing; an empty heap keeps it that way */
+        embedding_topk_init(&heaps[q], storage + q * kk, norm == 0.0 ? 0 : kk);
+    }
+
+    embedding_int8_dot_product_rows_cb rows = embedding_int8_rows_kernel(embedding_kernels(), t->dim);
+    for (size_t i = 0; i < snap.num_nodes; i++) {
+        const int8_embedding_node_t *n = snap.nodes[i];
+        uint32_t count = snapshot_count(&snap, i);
+        size_t base = i << NODE_SHIFT;
+        if (node_all_deleted(n)) continue;
+        int8_dot_product_matrix_with(rows, queries, num_queries, n->data, count, t->dim, dots);
+        for (size_t q = 0; q < num_queries; q++) {
+            embedding_topk_t *h = &heaps[q];
+            if (h->k == 0) continue;
+            push_cosines(n, count, base, dots + q * count, norms[q], h);
         }
+    }
 
-        node->size++;
+    for (size_t q = 0; q < num_queries; q++) {
+        size_t got = embedding_topk_drain(&heaps[q],
+                                          out_ids ? out_ids + q * k : NULL,
+                                          out_scores ? out_scores + q * k : NULL);
+        /* pad queries left short (a zero norm, or too few live rows) so each
+         * fills the same kk slots
+         */
+        for (size_t j = got; j < kk; j++) {
+            if (out_ids) out_ids[q * k + j] = (size_t)-1;
+            if (out_scores) out_scores[q * k + j] = 0.0;
+        }
     }
 
-    fclose(file);
-    return table;
+    free(heaps);
+    free(storage);
+    free(dots);
+    free(norms);
+    return kk;
 }
@@ -0,0 +1,166 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "int8_embedding_table_internal.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct int8_embedding_table_compaction_s {
+    int8_embedding_table_t *src;
+    int8_embedding_table_t *dst;
+    size_t next;        /* first source row not copied yet */
+    size_t *remap;      /* new id (or (size_t)-1) of every source row below next */
+    size_t remap_size;
+};
+
+int8_embedding_table_compaction_t *int8_embedding_table_compact_begin(int8_embedding_table_t *t) {
+    if (!t) return NULL;
+    int8_embedding_table_compaction_t *c =
+        (int8_embedding_table_compaction_t *)calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->src = t;
+    c->dst = int8_embedding_table_init_layout(t->dim, 0, t->layout);
+    if (!c->dst ||
+        (t->channel && int8_embedding_table_set_channel_quantizer(c->dst, t->channel) != 0) ||
+        (t->memory ? int8_embedding_table_set_memory(c->dst, t->memory)
+                   : int8_embedding_table_set_allocator(c->dst, &t->allocator)) != 0) {
+        int8_embedding_table_destroy(c->dst);
+        free(c);
+        return NULL;
+    }
+    return c;
+}
+
+void int8_embedding_table_compact_abort(int8_embedding_table_compaction_t *c) {
+    if (!c) return;
+    int8_embedding_table_destroy(c->dst);
+    free(c->remap);
+    free(c);
+}
+
+/* Copy the live source rows [c->next, end) (end <= published rows) to the new
+ * table, a run of consecutive live rows at a time.  returns 0 on success, -1
+ * on failure
+ */
+static int copy_rows(int8_embedding_table_compaction_t *c, size_t end) {
+    if (end > c->remap_size) {
+        size_t n = c->remap_size ? c->remap_size : NODE_CAPACITY;
+        while (n < end) n *= 2;
+        size_t *p = (size_t *)realloc(c->remap, n * sizeof(*p));
+        if (!p) return -1;
+        c->remap = p;
+        c->remap_size = n;
+    }
+    int8_embedding_node_t *const *nodes =
+        atomic_load_explicit(&c->src->table, memory_order_acquire);
+    while (c->next < end) {
+        size_t i = c->next >> NODE_SHIFT;
+        const int8_embedding_node_t *n = nodes[i];
+        size_t base = i << NODE_SHIFT;
+        uint32_t count = end - base < NODE_CAPACITY ? (uint32_t)(end - base) : NODE_CAPACITY;
+        uint32_t r = (uint32_t)(c->next - base);
+        while (r < count) {
+            uint32_t w = r >> 6;
+            uint64_t live = ~atomic_load_explicit(&n->deleted[w], memory_order_relaxed) &
+                            embedding_node_rows_mask(count, w) & (~(uint64_t)0 << (r & 63));
+            if (!live) {
+                /* the rest of this word is deleted */
+                uint32_t next = (w + 1) << 6;
+                if (next > count) next = count;
+                for (; r < next; r++) c->remap[base + r] = (size_t)-1;
+                continue;
+            }
+            uint32_t first = (w << 6) + embedding_ctz64(live);
+            for (; r < first; r++) c->remap[base + r] = (size_t)-1;
+            /* extend the run of live rows across words */
+            uint32_t last = first;
+            while (last < count) {
+                uint32_t lw = last >> 6;
+                uint64_t dead = atomic_load_explicit(&n->deleted[lw], memory_order_relaxed) |
+                                ~embedding_node_rows_mask(count, lw);
+                dead &= ~(uint64_t)0 << (last & 63);
+                if (dead) {
+                    last = (lw << 6) + embedding_ctz64(dead);
+                    break;
+                }
+                last = (lw + 1) << 6;
+            }
+            if (last > count) last = count;
+            ssize_t id = int8_embedding_table_append_rows(c->dst, n, first, last - first);
+            if (id < 0) return -1;
+            for (; r < last; r++) c->remap[base + r] = (size_t)id + (r - first);
+        }
+        c->next = base + count;
+    }
+    return 0;
+}
+
+int int8_embedding_table_compact_step(int8_embedding_table_compaction_t *c, size_t max_nodes) {
+    if (!c) return -1;
+    size_t rows = int8_embedding_table_size(c->src);
+    size_t end = ((c->next >> NODE_SHIFT) + max_nodes) << NODE_SHIFT;
+    if (end > rows || max_nodes == 0) end = rows;
+    if (copy_rows(c, end) != 0) {
+        fprintf(stderr, "int8_embedding_table_compact_step: out of memory\n");
+        return -1;
+    }
+    return c->next == rows ? 1 : 0;
+}
+
+int8_embedding_table_t *int8_embedding_table_compact_finish(int8_embedding_table_compaction_t *c,
+                                                            size_t **remap) {
+    if (remap) *remap = NULL;
+    if (!c) return NULL;
+    int8_embedding_table_t *src = c->src;
+    size_t rows = int8_embedding_table_size(src);
+    if (copy_rows(c, rows) != 0) {
+        fprintf(stderr, "int8_embedding_table_compact_finish: out of memory\n");
+        int8_embedding_table_compact_abort(c);
+        return NULL;
+    }
+    /* an empty source copied nothing; the caller still gets a remap to free */
+    if (!c->remap && !(c->remap = (size_t *)malloc(sizeof(*c->remap)))) {
+        fprintf(stderr, "int8_embedding_table_compact_finish: out of memory\n");
+        int8_embedding_table_compact_abort(c);
+        return NULL;
+    }
+
+    /* rows deleted after they were copied are deleted in the copy too */
+    int8_embedding_node_t *const *nodes = atomic_load_explicit(&src->table, memory_order_acquire);
+    for (size_t i = 0; i < embedding_nodes_for_rows(rows); i++) {
+        const int8_embedding_node_t *n = nodes[i];
+        if (atomic_load_explicit(&n->num_deleted, memory_order_relaxed) == 0) continue;
+        size_t base = i << NODE_SHIFT;
+        uint32_t count = rows - base < NODE_CAPACITY ? (uint32_t)(rows - base) : NODE_CAPACITY;
+        for (uint32_t w = 0; w * 64u < count; w++) {
+            uint64_t dead = atomic_load_explicit(&n->deleted[w], memory_order_relaxed) &
+                            embedding_node_rows_mask(count, w);
+            for (; dead; dead &= dead - 1) {
+                size_t r = base + (w << 6) + embedding_ctz64(dead);
+                if (c->remap[r] == (size_t)-1) continue;
+                int8_embedding_table_delete(c->dst, c->remap[r]);
+                c->remap[r] = (size_t)-1;
+            }
+        }
+    }
+
+    int8_embedding_table_t *dst = c->dst;
+    if (remap) *remap = c->remap;
+    else free(c->remap);
+    free(c);
+    return dst;
+}
+
+int8_embedding_table_t *int8_embedding_table_compact(int8_embedding_table_t *t, size_t **remap) {
+    int8_embedding_table_compaction_t *c = int8_embedding_table_compact_begin(t);
+    if (!c) return NULL;
+    if (int8_embedding_table_compact_step(c, 0) < 0) {
+        int8_embedding_table_compact_abort(c);
+        if (remap) *remap = NULL;
+        return NULL;
+    }
+    return int8_embedding_table_compact_finish(c, remap);
+}
@@ -0,0 +1,46 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_int8_embedding_table_internal_H
+#define _embed_int8_embedding_table_internal_H
+
+/* Shared between the int8_embedding_table_*.c translation units; not installed. */
+
+#include "embedding-library/int8_embedding_table.h"
+#include "embedding_node.h"
+#include "embedding_slab.h"
+#include <stddef.h>
+
+static inline size_t int8_embedding_node_bytes(size_t dim, uint32_t layout) {
+    return embedding_node_bytes(dim, sizeof(int8_t), layout);
+}
+
+/* bytes in front of an INLINE node's block: the node, rounded up to 64 */
+#define INT8_EMBEDDING_NODE_HEADER \
+    ((sizeof(int8_embedding_node_t) + 63) & ~(size_t)63)
+
+/* allocate one INLINE node for t's rows (block padding zeroed) from t's slab
+ * or allocator; returns 0 on success, -1 on failure
+ */
+int int8_embedding_node_alloc(int8_embedding_node_t **out_node, const int8_embedding_table_t *t);
+
+/* allocate a node struct whose block lives elsewhere (e.g. in a mapping) */
+int8_embedding_node_t *int8_embedding_node_wrap(void *block, uint32_t size,
+                                                uint32_t flags, uint32_t layout);
+
+/* free a node of t, whichever way it was allocated */
+void int8_embedding_node_free(const int8_embedding_table_t *t, int8_embedding_node_t *n);
+
+/* ensure the table has room for another node; returns 0 on success, -1 on failure */
+int int8_embedding_table_grow(int8_embedding_table_t *t);
+
+/* Append rows [slot, slot + count) of src, a node of a table with t's dim and
+ * layout, with their norms and scales, and publish them.  Returns the id of
+ * the first, or -1 on failure (rows copied before it stay in t).
+ */
+ssize_t int8_embedding_table_append_rows(int8_embedding_table_t *t,
+                                         const int8_embedding_node_t *src,
+                                         uint32_t slot, uint32_t count);
+
+#endif // _embed_int8_embedding_table_internal_H
@@ -0,0 +1,287 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "int8_embedding_table_internal.h"
+#include "embedding_table_file.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+
+/* serialize() returning 0 on success, -1 on failure */
+static int write_table(int8_embedding_table_t *t, const char *filename, const char *who) {
+    /* the rows published now; an append running alongside is not included */
+    embedding_table_blocks_t b;
+    b.elem_type = EMBEDDING_ELEM_INT8;
+    b.dim = t->dim;
+    b.num_rows = int8_embedding_table_size(t);
+    b.num_nodes = embedding_nodes_for_rows(b.num_rows);
+    b.layout = t->layout;
+    b.table_id = t->table_id;
+    b.generation = atomic_load_explicit(&t->file_generation, memory_order_relaxed);
+    b.channel = t->channel ? t->channel->scale : NULL;  /* scale then zero_point */
+    b.deleted = NULL;
+    b.map = NULL;
+    b.map_size = 0;
+    b.blocks = (double **)malloc((b.num_nodes + 1) * sizeof(*b.blocks));
+    if (!b.blocks) {
+        fprintf(stderr, "%s: malloc failed\n", who);
+        return -1;
+    }
+    int8_embedding_node_t **nodes = atomic_load_explicit(&t->table, memory_order_acquire);
+    for (size_t i = 0; i < b.num_nodes; i++)
+        b.blocks[i] = (double *)nodes[i]->block;
+
+    /* tombstones of the rows being written, if any row is deleted */
+    if (b.num_rows && int8_embedding_table_num_deleted(t)) {
+        b.deleted = (uint64_t *)malloc(b.num_nodes * NODE_DELETED_WORDS * sizeof(uint64_t));
+        if (!b.deleted) {
+            fprintf(stderr, "%s: malloc failed\n", who);
+            free(b.blocks);
+            return -1;
+        }
+        for (size_t i = 0; i < b.num_nodes; i++) {
+            size_t left = b.num_rows - (i << NODE_SHIFT);
+            uint32_t count = left < NODE_CAPACITY ? (uint32_t)left : NODE_CAPACITY;
+            for (uint32_t w = 0; w < NODE_DELETED_WORDS; w++)
+                b.deleted[i * NODE_DELETED_WORDS + w] =
+                    atomic_load_explicit(&nodes[i]->deleted[w], memory_order_relaxed) &
+                    embedding_node_rows_mask(count, w);
+        }
+    }
+
+    int rc = embedding_table_file_write(filename, &b, who);
+    atomic_store_explicit(&t->file_generation, b.generation, memory_order_relaxed);
+    free(b.deleted);
+    free(b.blocks);
+    return rc;
+}
+
+void int8_embedding_table_serialize(int8_embedding_table_t *t, const char *filename) {
+    if (!t || !filename) return;
+    write_table(t, filename, "int8_embedding_table_serialize");
+}
+
+struct int8_embedding_table_flusher_s {
+    int8_embedding_table_t *t;
+    char *filename;
+    unsigned interval_ms;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint64_t requested;    /* flushes asked for */
+    uint64_t done;         /* requests covered by a finished flush */
+    int status;            /* result of the last flush */
+    int stop;
+    size_t rows;           /* rows and deletions in the file, to skip idle flushes */
+    size_t deleted;
+    int written;
+};
+
+/* serialize the table if it changed since the last flush */
+static int flush_changes(int8_embedding_table_flusher_t *f) {
+    size_t rows = int8_embedding_table_size(f->t);
+    size_t deleted = int8_embedding_table_num_deleted(f->t);
+    if (f->written && rows == f->rows && deleted == f->deleted) return 0;
+    if (write_table(f->t, f->filename, "int8_embedding_table_flusher") != 0) return -1;
+    f->rows = rows;
+    f->deleted = deleted;
+    f->written = 1;
+    return 0;
+}
+
+static void *flusher_main(void *arg) {
+    int8_embedding_table_flusher_t *f = (int8_embedding_table_flusher_t *)arg;
+    pthread_mutex_lock(&f->lock);
+    for (;;) {
+        if (f->requested == f->done && !f->stop) {
+            if (f->interval_ms) {
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+                ts.tv_sec += f->interval_ms / 1000;
+                ts.tv_nsec += (long)(f->interval_ms % 1000) * 1000000L;
+                if (ts.tv_nsec >= 1000000000L) {
+                    ts.tv_sec++;
+                    ts.tv_nsec -= 1000000000L;
+                }
+                pthread_cond_timedwait(&f->cond, &f->lock, &ts);
+            } else {
+                pthread_cond_wait(&f->cond, &f->lock);
+            }
+        }
+        uint64_t requested = f->requested;
+        int stop = f->stop;
+        pthread_mutex_unlock(&f->lock);
+
+        /* appends go on meanwhile; the flush takes the rows published now */
+        int status = flush_changes(f);
+
+        pthread_mutex_lock(&f->lock);
+        f->status = status;
+        f->done = requested;
+        pthread_cond_broadcast(&f->cond);
+        if (stop) break;
+    }
+    pthread_mutex_unlock(&f->lock);
+    return NULL;
+}
+
+int8_embedding_table_flusher_t *int8_embedding_table_flusher_init(int8_embedding_table_t *t,
+                                                                  const char *filename,
+                                                                  unsigned interval_ms) {
+    if (!t || !filename) return NULL;
+    int8_embedding_table_flusher_t *f =
+        (int8_embedding_table_flusher_t *)calloc(1, sizeof(*f));
+    if (!f) return NULL;
+    f->filename = strdup(filename);
+    if (!f->filename) {
+        free(f);
+        return NULL;
+    }
+    f->t = t;
+    f->interval_ms = interval_ms;
+    pthread_mutex_init(&f->lock, NULL);
+    pthread_cond_init(&f->cond, NULL);
+    if (pthread_create(&f->thread, NULL, flusher_main, f) != 0) {
+        perror("int8_embedding_table_flusher_init: pthread_create");
+        pthread_cond_destroy(&f->cond);
+        pthread_mutex_destroy(&f->lock);
+        free(f->filename);
+        free(f);
+        return NULL;
+    }
+    return f;
+}
+
+int int8_embedding_table_flusher_flush(int8_embedding_table_flusher_t *f) {
+    if (!f) return -1;
+    pthread_mutex_lock(&f->lock);
+    uint64_t mine = ++f->requested;
+    pthread_cond_broadcast(&f->cond);
+    while (f->done < mine) pthread_cond_wait(&f->cond, &f->lock);
+    int status = f->status;
+    pthread_mutex_unlock(&f->lock);
+    return status;
+}
+
+void int8_embedding_table_flusher_destroy(int8_embedding_table_flusher_t *f) {
+    if (!f) return;
+    pthread_mutex_lock(&f->lock);
+    f->stop = 1;
+    f->requested++;
+    pthread_cond_broadcast(&f->cond);
+    pthread_mutex_unlock(&f->lock);
+    pthread_join(f->thread, NULL);
+    pthread_cond_destroy(&f->cond);
+    pthread_mutex_destroy(&f->lock);
+    free(f->filename);
+    free(f);
+}
+
+/* set the loaded tombstones on the table's nodes (bits past the rows are ignored) */
+static void apply_deleted(int8_embedding_table_t *t, const uint64_t *deleted) {
+    size_t total = 0;
+    for (size_t i = 0; i < t->index; i++) {
+        int8_embedding_node_t *n = t->table[i];
+        uint32_t count = 0;
+        for (uint32_t w = 0; w < NODE_DELETED_WORDS; w++) {
+            uint64_t bits = deleted[i * NODE_DELETED_WORDS + w] &
+                            embedding_node_rows_mask(n->size, w);
+            atomic_store_explicit(&n->deleted[w], bits, memory_order_relaxed);
+            count += embedding_popcount64(bits);
+        }
+        atomic_store_explicit(&n->num_deleted, count, memory_order_relaxed);
+        total += count;
+    }
+    atomic_store_explicit(&t->num_deleted, total, memory_order_relaxed);
+}
+
+/* Build a table whose nodes wrap the loaded (or mapped) blocks of b. */
+static int8_embedding_table_t *table_from_blocks(embedding_table_blocks_t *b) {
+    uint32_t flags = b->map ? INT8_EMBEDDING_NODE_MAPPED : 0;
+    int8_embedding_table_t *table =
+        int8_embedding_table_init_layout(b->dim, b->num_nodes, b->layout);
+    if (table && b->channel &&
+        !(table->channel = int8_channel_quantizer_init(b->dim, b->channel, b->channel + b->dim))) {
+        int8_embedding_table_destroy(table);
+        table = NULL;
+    }
+    size_t i = 0;
+    int failed = 0;
+    if (table) {
+        /* the loaded rows are the file's table; an older file gets a new id */
+        if (b->table_id) table->table_id = b->table_id;
+        atomic_store_explicit(&table->file_generation, b->generation, memory_order_relaxed);
+        table->map = b->map;
+        table->map_size = b->map_size;
+        b->map = NULL;
+        size_t remaining = b->num_rows;
+        for (; i < b->num_nodes; i++) {
+            uint32_t size = remaining < NODE_CAPACITY ? (uint32_t)remaining : NODE_CAPACITY;
+            int8_embedding_node_t *node = int8_embedding_node_wrap(b->blocks[i], size, flags, b->layout);
+            if (!node) break;
+            table->table[table->index++] = node;
+            remaining -= size;
+        }
+        /* A partial last node would be appended to, and mapped blocks are
+         * read-only: give it a heap copy now, while no reader can see it.
+         */
+        int8_embedding_node_t *last = table->index ? table->table[table->index - 1] : NULL;
+        if (i == b->num_nodes && last && (last->flags & INT8_EMBEDDING_NODE_MAPPED) &&
+            last->size < NODE_CAPACITY) {
+            int8_embedding_node_t *copy = NULL;
+            if (int8_embedding_node_alloc(&copy, table) == 0) {
+                memcpy(copy->block, last->block, table->node_bytes);
+                copy->size = last->size;
+                table->table[table->index - 1] = copy;
+                free(last);
+            } else {
+                failed = 1;
+            }
+        }
+        if (b->deleted && !failed && i == b->num_nodes) apply_deleted(table, b->deleted);
+        atomic_store_explicit(&table->rows, b->num_rows - remaining, memory_order_release);
+    }
+    if (!table || failed || i < b->num_nodes) {
+        if (!flags) {
+            for (; i < b->num_nodes; i++) free(b->blocks[i]);
+        }
+        if (b->map) munmap(b->map, b->map_size);
+        int8_embedding_table_destroy(table);
+        table = NULL;
+    }
+    free(b->blocks);
+    free(b->channel);
+    free(b->deleted);
+    return table;
+}
+
+int8_embedding_table_t *int8_embedding_table_deserialize_parallel(const char *filename,
+                                                                  embedding_thread_pool_t *pool) {
+    if (!filename) return NULL;
+    embedding_table_blocks_t b;
+    if (embedding_table_file_read(filename, EMBEDDING_ELEM_INT8, pool, &b,
+                                  "int8_embedding_table_deserialize") != 0)
+        return NULL;
+    return table_from_blocks(&b);
+}
+
+int8_embedding_table_t *int8_embedding_table_deserialize(const char *filename) {
+    return int8_embedding_table_deserialize_parallel(filename, NULL);
+}
+
+int int8_embedding_table_verify(const char *filename, embedding_thread_pool_t *pool) {
+    return embedding_table_verify(filename, pool);
+}
+
+int8_embedding_table_t *int8_embedding_table_mmap(const char *filename, uint32_t flags) {
+    if (!filename) return NULL;
+    embedding_table_blocks_t b;
+    if (embedding_table_file_map(filename, EMBEDDING_ELEM_INT8, flags, &b,
+                                 "int8_embedding_table_mmap") != 0)
+        return NULL;
+    return table_from_blocks(&b);
+}
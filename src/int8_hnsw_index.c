@@ -0,0 +1,1044 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "embedding-library/int8_hnsw_index.h"
+#include "embedding-library/dispatch.h"
+#include "embedding_table_file.h"
+#include "embedding_topk.h"
+#include "crc32c.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CHUNK_SHIFT       12
+#define CHUNK_SLOTS       (1u << CHUNK_SHIFT)    /* slots per chunk */
+#define LOCK_STRIPES      4096u                  /* row locks, by id */
+#define MAX_LEVEL         16
+#define MAX_M             255u
+#define SYNC_CHUNK        256u                   /* rows per sync() task */
+
+/* level-0 slot, in 32-bit words; the links follow */
+#define SLOT_LEVEL        0    /* level + 1; 0 while the row is not in the graph */
+#define SLOT_UPPER        1    /* first of its upper slots (level of them) */
+#define SLOT_COUNT        2
+#define SLOT_LINKS        4
+/* upper slot: count, then links */
+#define UPPER_LINKS       1
+
+#define HNSW_FILE_MAGIC   "I8EMBHNS"
+#define HNSW_FILE_VERSION 2u     /* 2: table_id */
+#define HNSW_HEADER_SIZE  4096u  /* one page, so the chunks map page aligned */
+
+typedef _Atomic(uint32_t) link_t;
+
+static const uint8_t zeros[HNSW_HEADER_SIZE];     /* file padding */
+
+/* A growable array of fixed-size slots in CHUNK_SLOTS chunks.  Readers load
+ * the chunk directory once per access; a full directory is replaced, never
+ * moved, and the old one kept until destroy().
+ */
+typedef struct {
+    _Atomic(char **) dir;
+    size_t dir_size;
+    size_t num_chunks;
+    atomic_size_t capacity;     /* slots covered by chunks */
+    size_t slot_bytes;
+    size_t mapped;              /* leading chunks that point into the mapping */
+} chunks_t;
+
+/* scratch of one search or insert, pooled */
+typedef struct {
+    uint16_t *tags;             /* visited marks, one per row */
+    size_t tags_size;
+    uint16_t epoch;
+    embedding_topk_entry_t *cand;       /* candidates, a max-heap */
+    size_t cand_size;
+    size_t cand_capacity;
+    embedding_topk_entry_t *best;       /* the ef best found (embedding_topk_t) */
+    size_t *ids;                        /* those, best first */
+    double *scores;
+    size_t ef_capacity;
+    uint32_t *batch;            /* unvisited neighbours of one row */
+    size_t *pick;               /* neighbour selection */
+    double *pick_scores;
+} search_ctx_t;
+
+struct int8_hnsw_index_s {
+    int8_embedding_table_t *t;
+    size_t dim;
+    size_t m;                   /* links per upper level */
+    size_t m0;                  /* links on level 0 */
+    size_t ef_construction;
+    double level_mult;          /* 1 / ln(m) */
+    int inv;                    /* the table keeps 1/norm */
+    embedding_int8_dot_product_cb dot;   /* rows are scored one at a time */
+    chunks_t level0;
+    chunks_t upper;
+    atomic_size_t upper_used;
+    _Atomic(uint64_t) entry;    /* (level + 1) << 32 | id; 0 while empty */
+    atomic_size_t count;        /* rows in the graph */
+    atomic_size_t rows;         /* one past the highest id in the graph */
+    size_t synced;              /* rows sync() has gone through */
+    pthread_mutex_t grow_lock;
+    pthread_mutex_t entry_lock;
+    pthread_mutex_t sync_lock;
+    pthread_rwlock_t save_lock; /* inserts read, save() writes */
+    pthread_mutex_t locks[LOCK_STRIPES];
+    pthread_mutex_t ctx_lock;
+    search_ctx_t **ctxs;
+    size_t num_ctxs;
+    size_t ctxs_size;
+    void **retired;             /* superseded chunk directories */
+    size_t num_retired;
+    size_t retired_size;
+    void *map;
+    size_t map_size;
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t dim;
+    uint32_t m;
+    uint32_t m0;
+    uint32_t ef_construction;
+    uint32_t slot_bytes;
+    uint32_t upper_bytes;
+    uint32_t reserved;
+    uint64_t rows;              /* level-0 slots saved */
+    uint64_t upper;             /* upper slots saved */
+    uint64_t count;             /* rows in the graph */
+    uint64_t entry;
+    uint64_t level0_offset;
+    uint64_t upper_offset;
+    uint64_t table_id;          /* the table's, as in its file header */
+    uint32_t data_crc;          /* level-0 slots, padding, upper slots */
+    uint32_t header_crc;        /* the header up to this field */
+} hnsw_file_header_t;
+
+/* ---- chunked slots ------------------------------------------------------- */
+
+static inline link_t *slot_at(const chunks_t *c, size_t i) {
+    char **dir = atomic_load_explicit(&((chunks_t *)c)->dir, memory_order_acquire);
+    return (link_t *)(dir[i >> CHUNK_SHIFT] + (i & (CHUNK_SLOTS - 1)) * c->slot_bytes);
+}
+
+static char *chunk_alloc(size_t bytes) {
+    void *p = NULL;
+    if (posix_memalign(&p, 64, bytes) != 0) return NULL;
+    memset(p, 0, bytes);
+    return (char *)p;
+}
+
+/* add chunk p (called with grow_lock held, or before the index is shared) */
+static int chunks_push(int8_hnsw_index_t *h, chunks_t *c, char *p) {
+    char **dir = atomic_load_explicit(&c->dir, memory_order_relaxed);
+    if (c->num_chunks == c->dir_size) {
+        size_t n = c->dir_size ? c->dir_size * 2 : 16;
+        char **d = (char **)malloc(n * sizeof(*d));
+        if (!d) return -1;
+        if (dir && h->num_retired == h->retired_size) {
+            size_t r = h->retired_size ? h->retired_size * 2 : 16;
+            void **p2 = (void **)realloc(h->retired, r * sizeof(*p2));
+            if (!p2) {
+                free(d);
+                return -1;
+            }
+            h->retired = p2;
+            h->retired_size = r;
+        }
+        if (c->num_chunks) memcpy(d, dir, c->num_chunks * sizeof(*d));
+        if (dir) h->retired[h->num_retired++] = dir;
+        c->dir_size = n;
+        atomic_store_explicit(&c->dir, d, memory_order_release);
+        dir = d;
+    }
+    dir[c->num_chunks++] = p;
+    atomic_store_explicit(&c->capacity, c->num_chunks << CHUNK_SHIFT, memory_order_release);
+    return 0;
+}
+
+/* make room for slots [0, n) */
+static int chunks_reserve(int8_hnsw_index_t *h, chunks_t *c, size_t n) {
+    if (atomic_load_explicit(&c->capacity, memory_order_acquire) >= n) return 0;
+    int rc = 0;
+    pthread_mutex_lock(&h->grow_lock);
+    while (rc == 0 && (c->num_chunks << CHUNK_SHIFT) < n) {
+        char *p = chunk_alloc(CHUNK_SLOTS * c->slot_bytes);
+        if (!p || chunks_push(h, c, p) != 0) {
+            free(p);
+            rc = -1;
+        }
+    }
+    pthread_mutex_unlock(&h->grow_lock);
+    return rc;
+}
+
+static void chunks_free(chunks_t *c) {
+    char **dir = atomic_load_explicit(&c->dir, memory_order_relaxed);
+    for (size_t i = c->mapped; i < c->num_chunks; i++) free(dir[i]);
+    free(dir);
+}
+
+/* ---- rows and scores ----------------------------------------------------- */
+
+typedef struct {
+    const int8_t *v;
+    double norm;
+    double inv;
+} query_t;
+
+/* the table's norm of row id: its norm, or 1/norm with INV_NORMS */
+static inline const int8_t *row_of(const int8_hnsw_index_t *h, size_t id, double *norm) {
+    const int8_embedding_node_t *n = int8_embedding_table_node(h->t, id >> NODE_SHIFT);
+    size_t slot = id & (NODE_CAPACITY - 1);
+    *norm = n->norms ? n->norms[slot] : (double)n->inv_norms[slot];
+    return n->data + slot * h->dim;
+}
+
+static inline void query_of_row(const int8_hnsw_index_t *h, size_t id, query_t *q) {
+    double norm;
+    q->v = row_of(h, id, &norm);
+    q->norm = h->inv ? 1.0 / norm : norm;
+    q->inv = h->inv ? norm : 1.0 / norm;
+}
+
+/* the cosine score int8_embedding_table_topk() gives row id */
+static inline double score(const int8_hnsw_index_t *h, const query_t *q, size_t id) {
+    double norm;
+    const int8_t *row = row_of(h, id, &norm);
+    int32_t dot = h->dot(q->v, row, h->dim);
+    return h->inv ? dot * (q->inv * norm) : dot / (q->norm * norm);
+}
+
+static inline void prefetch_row(const int8_hnsw_index_t *h, size_t id) {
+    double norm;
+    const int8_t *row = row_of(h, id, &norm);
+    for (size_t off = 0; off < h->dim; off += 64) __builtin_prefetch(row + off);
+}
+
+/* ---- graph --------------------------------------------------------------- */
+
+static inline link_t *level0_slot(const int8_hnsw_index_t *h, size_t id) {
+    return slot_at(&h->level0, id);
+}
+
+/* level of row id + 1; 0 if it is not in the graph */
+static inline uint32_t row_level(const int8_hnsw_index_t *h, size_t id) {
+    return atomic_load_explicit(&level0_slot(h, id)[SLOT_LEVEL], memory_order_acquire);
+}
+
+/* the link list of row id on level lc: its count word, then *cap links */
+static inline link_t *links_of(const int8_hnsw_index_t *h, size_t id, size_t lc, size_t *cap) {
+    link_t *s = level0_slot(h, id);
+    if (lc == 0) {
+        *cap = h->m0;
+        return s + SLOT_COUNT;
+    }
+    *cap = h->m;
+    size_t first = atomic_load_explicit(&s[SLOT_UPPER], memory_order_acquire);
+    return slot_at(&h->upper, first + lc - 1);
+}
+
+static inline link_t *links_begin(link_t *list, size_t lc) {
+    return list + (lc == 0 ? SLOT_LINKS - SLOT_COUNT : UPPER_LINKS);
+}
+
+static inline pthread_mutex_t *row_lock(int8_hnsw_index_t *h, size_t id) {
+    return &h->locks[id & (LOCK_STRIPES - 1)];
+}
+
+static uint32_t random_level(const int8_hnsw_index_t *h, size_t id) {
+    /* splitmix64 of the id, so a row's level does not depend on insert order */
+    uint64_t x = (uint64_t)id + 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    double u = ((double)(x >> 11) + 1.0) * (1.0 / 9007199254740992.0);
+    double level = -log(u) * h->level_mult;
+    return level >= MAX_LEVEL ? MAX_LEVEL : (uint32_t)level;
+}
+
+/* ---- search scratch ------------------------------------------------------ */
+
+static void ctx_free(search_ctx_t *c) {
+    if (!c) return;
+    free(c->tags);
+    free(c->cand);
+    free(c->best);
+    free(c->ids);
+    free(c->scores);
+    free(c->batch);
+    free(c->pick);
+    free(c->pick_scores);
+    free(c);
+}
+
+static search_ctx_t *ctx_get(int8_hnsw_index_t *h) {
+    search_ctx_t *c = NULL;
+    pthread_mutex_lock(&h->ctx_lock);
+    if (h->num_ctxs) c = h->ctxs[--h->num_ctxs];
+    pthread_mutex_unlock(&h->ctx_lock);
+    if (c) return c;
+    c = (search_ctx_t *)calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->batch = (uint32_t *)malloc((h->m0 + 1) * sizeof(*c->batch));
+    c->pick = (size_t *)malloc((h->m0 + 1) * sizeof(*c->pick));
+    c->pick_scores = (double *)malloc((h->m0 + 1) * sizeof(*c->pick_scores));
+    if (!c->batch || !c->pick || !c->pick_scores) {
+        ctx_free(c);
+        return NULL;
+    }
+    return c;
+}
+
+static void ctx_put(int8_hnsw_index_t *h, search_ctx_t *c) {
+    pthread_mutex_lock(&h->ctx_lock);
+    if (h->num_ctxs == h->ctxs_size) {
+        size_t n = h->ctxs_size ? h->ctxs_size * 2 : 8;
+        search_ctx_t **p = (search_ctx_t **)realloc(h->ctxs, n * sizeof(*p));
+        if (p) {
+            h->ctxs = p;
+            h->ctxs_size = n;
+        }
+    }
+    if (h->num_ctxs < h->ctxs_size) {
+        h->ctxs[h->num_ctxs++] = c;
+        c = NULL;
+    }
+    pthread_mutex_unlock(&h->ctx_lock);
+    ctx_free(c);
+}
+
+/* room for ef results; returns 0 on success, -1 on failure */
+static int ctx_reserve(search_ctx_t *c, size_t ef) {
+    if (ef <= c->ef_capacity) return 0;
+    embedding_topk_entry_t *best = (embedding_topk_entry_t *)realloc(c->best, ef * sizeof(*best));
+    if (best) c->best = best;
+    size_t *ids = (size_t *)realloc(c->ids, ef * sizeof(*ids));
+    if (ids) c->ids = ids;
+    double *scores = (double *)realloc(c->scores, ef * sizeof(*scores));
+    if (scores) c->scores = scores;
+    if (!best || !ids || !scores) return -1;
+    c->ef_capacity = ef;
+    return 0;
+}
+
+static void ctx_new_search(search_ctx_t *c) {
+    if (++c->epoch == 0) {
+        memset(c->tags, 0, c->tags_size * sizeof(*c->tags));
+        c->epoch = 1;
+    }
+    c->cand_size = 0;
+}
+
+/* mark id visited; returns 1 if it already was, -1 on failure */
+static int visit(const int8_hnsw_index_t *h, search_ctx_t *c, size_t id) {
+    if (id >= c->tags_size) {
+        size_t n = atomic_load_explicit(&((int8_hnsw_index_t *)h)->level0.capacity,
+                                        memory_order_acquire);
+        if (n <= id) n = id + 1;
+        uint16_t *p = (uint16_t *)realloc(c->tags, n * sizeof(*p));
+        if (!p) return -1;
+        memset(p + c->tags_size, 0, (n - c->tags_size) * sizeof(*p));
+        c->tags = p;
+        c->tags_size = n;
+    }
+    if (c->tags[id] == c->epoch) return 1;
+    c->tags[id] = c->epoch;
+    return 0;
+}
+
+/* candidates: a max-heap, best first */
+static int cand_push(search_ctx_t *c, double s, size_t id) {
+    if (c->cand_size == c->cand_capacity) {
+        size_t n = c->cand_capacity ? c->cand_capacity * 2 : 256;
+        embedding_topk_entry_t *p = (embedding_topk_entry_t *)realloc(c->cand, n * sizeof(*p));
+        if (!p) return -1;
+        c->cand = p;
+        c->cand_capacity = n;
+    }
+    embedding_topk_entry_t v = { s, id };
+    size_t i = c->cand_size++;
+    while (i > 0) {
+        size_t p = (i - 1) >> 1;
+        if (!embedding_topk_worse(&c->cand[p], &v)) break;
+        c->cand[i] = c->cand[p];
+        i = p;
+    }
+    c->cand[i] = v;
+    return 0;
+}
+
+static embedding_topk_entry_t cand_pop(search_ctx_t *c) {
+    embedding_topk_entry_t *e = c->cand;
+    embedding_topk_entry_t top = e[0];
+    embedding_topk_entry_t v = e[--c->cand_size];
+    size_t n = c->cand_size, i = 0;
+    for (;;) {
+        size_t k = 2 * i + 1;
+        if (k >= n) break;
+        if (k + 1 < n && embedding_topk_worse(&e[k], &e[k + 1])) k++;
+        if (!embedding_topk_worse(&v, &e[k])) break;
+        e[i] = e[k];
+        i = k;
+    }
+    if (n) e[i] = v;
+    return top;
+}
+
+/* Greedy walk on level lc: move to the best neighbour while one beats the
+ * current row.
+ */
+static size_t greedy(const int8_hnsw_index_t *h, const query_t *q, size_t cur, double *cur_score,
+                     size_t lc) {
+    for (int changed = 1; changed;) {
+        changed = 0;
+        size_t cap;
+        link_t *list = links_of(h, cur, lc, &cap);
+        size_t cnt = atomic_load_explicit(list, memory_order_acquire);
+        if (cnt > cap) cnt = cap;
+        link_t *links = links_begin(list, lc);
+        for (size_t j = 0; j < cnt; j++) {
+            size_t n = atomic_load_explicit(&links[j], memory_order_acquire);
+            double s = score(h, q, n);
+            if (s > *cur_score) {
+                *cur_score = s;
+                cur = n;
+                changed = 1;
+            }
+        }
+    }
+    return cur;
+}
+
+/* Best-first search of level lc from ep, keeping the ef best rows; leaves
+ * them best first in c->ids / c->scores.  returns their number, or
+ * (size_t)-1 on failure
+ */
+static size_t search_layer(const int8_hnsw_index_t *h, search_ctx_t *c, const query_t *q,
+                           size_t ep, double ep_score, size_t ef, size_t lc) {
+    if (ctx_reserve(c, ef) != 0) return (size_t)-1;
+    ctx_new_search(c);
+    embedding_topk_t best;
+    embedding_topk_init(&best, c->best, ef);
+    if (visit(h, c, ep) < 0 || cand_push(c, ep_score, ep) != 0) return (size_t)-1;
+    embedding_topk_push(&best, ep_score, ep);
+
+    while (c->cand_size) {
+        embedding_topk_entry_t cur = cand_pop(c);
+        if (best.size == ef && cur.score < best.heap[0].score) break;
+        size_t cap;
+        link_t *list = links_of(h, cur.id, lc, &cap);
+        size_t cnt = atomic_load_explicit(list, memory_order_acquire);
+        if (cnt > cap) cnt = cap;
+        link_t *links = links_begin(list, lc);
+        /* gather the unvisited neighbours and start their rows loading */
+        size_t nb = 0;
+        for (size_t j = 0; j < cnt; j++) {
+            uint32_t n = atomic_load_explicit(&links[j], memory_order_acquire);
+            int seen = visit(h, c, n);
+            if (seen < 0) return (size_t)-1;
+            if (seen) continue;
+            prefetch_row(h, n);
+            c->batch[nb++] = n;
+        }
+        for (size_t j = 0; j < nb; j++) {
+            double s = score(h, q, c->batch[j]);
+            if (best.size < ef || s > best.heap[0].score) {
+                if (cand_push(c, s, c->batch[j]) != 0) return (size_t)-1;
+                embedding_topk_push(&best, s, c->batch[j]);
+            }
+        }
+    }
+    return embedding_topk_drain(&best, c->ids, c->scores);
+}
+
+/* cosine of two rows of the table */
+static double pair_score(const int8_hnsw_index_t *h, size_t a, size_t b) {
+    query_t q;
+    query_of_row(h, a, &q);
+    return score(h, &q, b);
+}
+
+/* The heuristic of the HNSW paper: walk the candidates best first and keep
+ * one only if it is closer to the new row than to every one kept so far, so
+ * links spread out instead of bunching in one direction.  ids / scores are
+ * best first; returns how many (at most max) positions in ids were written
+ * to kept.
+ */
+static size_t select_neighbors(const int8_hnsw_index_t *h, const size_t *ids,
+                               const double *scores, size_t n, size_t max, size_t *kept) {
+    size_t k = 0;
+    for (size_t i = 0; i < n && k < max; i++) {
+        int good = 1;
+        for (size_t j = 0; j < k && good; j++)
+            if (pair_score(h, ids[i], ids[kept[j]]) > scores[i]) good = 0;
+        if (good) kept[k++] = i;
+    }
+    return k;
+}
+
+/* make ids[kept[0..n)] the list (count word first) */
+static void store_links(link_t *list, size_t lc, const size_t *ids, const size_t *kept,
+                        size_t n) {
+    link_t *links = links_begin(list, lc);
+    for (size_t i = 0; i < n; i++)
+        atomic_store_explicit(&links[i], (uint32_t)ids[kept[i]], memory_order_release);
+    atomic_store_explicit(list, (uint32_t)n, memory_order_release);
+}
+
+/* Add a link from row n to row id on level lc; a full list is re-pruned with
+ * the heuristic over its links and id.
+ */
+static void link_back(int8_hnsw_index_t *h, search_ctx_t *c, size_t n, size_t id,
+                      double s, size_t lc) {
+    pthread_mutex_t *lock = row_lock(h, n);
+    pthread_mutex_lock(lock);
+    size_t cap;
+    link_t *list = links_of(h, n, lc, &cap);
+    size_t cnt = atomic_load_explicit(list, memory_order_relaxed);
+    link_t *links = links_begin(list, lc);
+    if (cnt < cap) {
+        atomic_store_explicit(&links[cnt], (uint32_t)id, memory_order_release);
+        atomic_store_explicit(list, (uint32_t)(cnt + 1), memory_order_release);
+        pthread_mutex_unlock(lock);
+        return;
+    }
+    /* candidates sorted best first (insertion sort; at most m0 + 1) */
+    size_t *ids = c->pick;
+    double *scores = c->pick_scores;
+    size_t num = 0;
+    for (size_t j = 0; j <= cnt; j++) {
+        size_t x = j < cnt ? atomic_load_explicit(&links[j], memory_order_relaxed) : id;
+        double sx = j < cnt ? pair_score(h, n, x) : s;
+        size_t i = num++;
+        while (i > 0 && scores[i - 1] < sx) {
+            ids[i] = ids[i - 1];
+            scores[i] = scores[i - 1];
+            i--;
+        }
+        ids[i] = x;
+        scores[i] = sx;
+    }
+    size_t kept[MAX_M * 2];
+    size_t k = select_neighbors(h, ids, scores, num, cap, kept);
+    store_links(list, lc, ids, kept, k);
+    pthread_mutex_unlock(lock);
+}
+
+static void note_row(int8_hnsw_index_t *h, size_t id) {
+    size_t end = atomic_load_explicit(&h->rows, memory_order_relaxed);
+    while (end <= id &&
+           !atomic_compare_exchange_weak_explicit(&h->rows, &end, id + 1, memory_order_release,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+static int insert(int8_hnsw_index_t *h, search_ctx_t *c, size_t id) {
+    if (chunks_reserve(h, &h->level0, id + 1) != 0) return -1;
+    link_t *slot = level0_slot(h, id);
+    uint32_t level = random_level(h, id);
+
+    /* claim the row; its upper slots are set before anything links to it */
+    uint32_t none = 0;
+    if (atomic_load_explicit(&slot[SLOT_LEVEL], memory_order_relaxed) != 0 ||
+        !atomic_compare_exchange_strong(&slot[SLOT_LEVEL], &none, level + 1))
+        return 0;
+    if (level > 0) {
+        size_t first = atomic_fetch_add(&h->upper_used, level);
+        if (chunks_reserve(h, &h->upper, first + level) != 0) {
+            atomic_store(&slot[SLOT_LEVEL], 0);
+            return -1;
+        }
+        atomic_store_explicit(&slot[SLOT_UPPER], (uint32_t)first, memory_order_release);
+    }
+
+    int rc = 0;
+    query_t q;
+    query_of_row(h, id, &q);
+    uint64_t entry = atomic_load_explicit(&h->entry, memory_order_acquire);
+    if (entry == 0) {
+        pthread_mutex_lock(&h->entry_lock);
+        entry = atomic_load_explicit(&h->entry, memory_order_acquire);
+        if (entry == 0)
+            atomic_store_explicit(&h->entry, ((uint64_t)(level + 1) << 32) | id,
+                                  memory_order_release);
+        pthread_mutex_unlock(&h->entry_lock);
+        if (entry == 0) goto done;
+    }
+
+    size_t cur = (uint32_t)entry;
+    size_t top = (size_t)(entry >> 32) - 1;
+    double cur_score = score(h, &q, cur);
+    for (size_t lc = top; lc > level; lc--) cur = greedy(h, &q, cur, &cur_score, lc);
+
+    for (size_t lc = (level < top ? level : top) + 1; lc-- > 0;) {
+        size_t n = search_layer(h, c, &q, cur, cur_score, h->ef_construction, lc);
+        if (n == (size_t)-1) {
+            /* the row stays in the graph with the links it has so far */
+            rc = -1;
+            break;
+        }
+        /* another insert may have linked the row already */
+        size_t w = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (c->ids[i] == id) continue;
+            c->ids[w] = c->ids[i];
+            c->scores[w++] = c->scores[i];
+        }
+        size_t kept[MAX_M * 2];
+        size_t k = select_neighbors(h, c->ids, c->scores, w, h->m, kept);
+        size_t cap;
+        pthread_mutex_lock(row_lock(h, id));
+        store_links(links_of(h, id, lc, &cap), lc, c->ids, kept, k);
+        pthread_mutex_unlock(row_lock(h, id));
+        for (size_t i = 0; i < k; i++)
+            link_back(h, c, c->ids[kept[i]], id, c->scores[kept[i]], lc);
+        if (w) {
+            cur = c->ids[0];
+            cur_score = c->scores[0];
+        }
+    }
+
+    if (level > top) {
+        pthread_mutex_lock(&h->entry_lock);
+        entry = atomic_load_explicit(&h->entry, memory_order_relaxed);
+        if (level + 1 > (uint32_t)(entry >> 32))
+            atomic_store_explicit(&h->entry, ((uint64_t)(level + 1) << 32) | id,
+                                  memory_order_release);
+        pthread_mutex_unlock(&h->entry_lock);
+    }
+done:
+    note_row(h, id);
+    atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+    return rc;
+}
+
+int int8_hnsw_index_add(int8_hnsw_index_t *h, size_t id) {
+    if (!h || id >= int8_embedding_table_size(h->t) || id >= UINT32_MAX) return -1;
+    search_ctx_t *c = ctx_get(h);
+    if (!c) return -1;
+    pthread_rwlock_rdlock(&h->save_lock);
+    int rc = insert(h, c, id);
+    pthread_rwlock_unlock(&h->save_lock);
+    ctx_put(h, c);
+    if (rc != 0) fprintf(stderr, "int8_hnsw_index_add: out of memory\n");
+    return rc;
+}
+
+typedef struct {
+    int8_hnsw_index_t *h;
+    size_t first;
+    size_t end;
+    atomic_int failed;
+} sync_t;
+
+static void sync_part(void *arg, size_t part) {
+    sync_t *s = (sync_t *)arg;
+    size_t from = s->first + part * SYNC_CHUNK;
+    size_t to = from + SYNC_CHUNK < s->end ? from + SYNC_CHUNK : s->end;
+    for (size_t id = from; id < to && !atomic_load(&s->failed); id++) {
+        if (int8_embedding_table_is_deleted(s->h->t, id)) continue;
+        if (int8_hnsw_index_add(s->h, id) != 0) atomic_store(&s->failed, 1);
+    }
+}
+
+int int8_hnsw_index_sync(int8_hnsw_index_t *h, embedding_thread_pool_t *pool) {
+    if (!h) return -1;
+    pthread_mutex_lock(&h->sync_lock);
+    size_t end = int8_embedding_table_size(h->t);
+    if (end >= UINT32_MAX) end = UINT32_MAX - 1;
+    sync_t s = { h, h->synced, end, 0 };
+    if (end > s.first)
+        embedding_thread_pool_run(pool, sync_part, &s, (end - s.first + SYNC_CHUNK - 1) / SYNC_CHUNK);
+    int rc = atomic_load(&s.failed) ? -1 : 0;
+    if (rc == 0) h->synced = end;
+    pthread_mutex_unlock(&h->sync_lock);
+    return rc;
+}
+
+size_t int8_hnsw_index_size(const int8_hnsw_index_t *h) {
+    return h ? atomic_load_explicit(&((int8_hnsw_index_t *)h)->count, memory_order_relaxed) : 0;
+}
+
+size_t int8_hnsw_index_topk(int8_hnsw_index_t *h, const int8_t *query, double query_norm,
+                            size_t ef, size_t k, size_t *out_ids, double *out_scores) {
+    if (!h || !query || k == 0) return 0;
+    if (query_norm < 0.0) {
+        int32_t dp = int8_dot_product_dispatch(query, query, h->dim);
+        query_norm = dp > 0 ? sqrt((double)dp) : 0.0;
+    }
+    if (query_norm == 0.0) return 0;
+    uint64_t entry = atomic_load_explicit(&h->entry, memory_order_acquire);
+    if (entry == 0) return 0;
+    if (ef < k) ef = k;
+
+    query_t q = { query, query_norm, 1.0 / query_norm };
+    size_t cur = (uint32_t)entry;
+    double cur_score = score(h, &q, cur);
+    for (size_t lc = (size_t)(entry >> 32) - 1; lc > 0; lc--)
+        cur = greedy(h, &q, cur, &cur_score, lc);
+
+    search_ctx_t *c = ctx_get(h);
+    if (!c) return 0;
+    size_t n = search_layer(h, c, &q, cur, cur_score, ef, 0);
+    size_t written = 0;
+    int check_deleted = int8_embedding_table_num_deleted(h->t) != 0;
+    for (size_t i = 0; n != (size_t)-1 && i < n && written < k; i++) {
+        if (check_deleted && int8_embedding_table_is_deleted(h->t, c->ids[i])) continue;
+        if (out_ids) out_ids[written] = c->ids[i];
+        if (out_scores) out_scores[written] = c->scores[i];
+        written++;
+    }
+    ctx_put(h, c);
+    return written;
+}
+
+/* ---- lifetime ------------------------------------------------------------ */
+
+static int8_hnsw_index_t *hnsw_alloc(int8_embedding_table_t *t, size_t m, size_t ef_construction) {
+    int8_hnsw_index_t *h = (int8_hnsw_index_t *)calloc(1, sizeof(*h));
+    if (!h) return NULL;
+    h->t = t;
+    h->dim = t->dim;
+    h->m = m;
+    h->m0 = 2 * m;
+    h->ef_construction = ef_construction;
+    h->level_mult = 1.0 / log((double)(m > 1 ? m : 2));
+    h->inv = (t->layout & EMBEDDING_TABLE_LAYOUT_INV_NORMS) != 0;
+    h->dot = embedding_kernels()->int8_dot_product;
+    h->level0.slot_bytes = ((SLOT_LINKS + h->m0) * sizeof(uint32_t) + 63) & ~(size_t)63;
+    h->upper.slot_bytes = ((UPPER_LINKS + h->m) * sizeof(uint32_t) + 63) & ~(size_t)63;
+    pthread_mutex_init(&h->grow_lock, NULL);
+    pthread_mutex_init(&h->entry_lock, NULL);
+    pthread_mutex_init(&h->sync_lock, NULL);
+    pthread_rwlock_init(&h->save_lock, NULL);
+    for (size_t i = 0; i < LOCK_STRIPES; i++) pthread_mutex_init(&h->locks[i], NULL);
+    pthread_mutex_init(&h->ctx_lock, NULL);
+    return h;
+}
+
+int8_hnsw_index_t *int8_hnsw_index_init(int8_embedding_table_t *t, size_t m,
+                                        size_t ef_construction) {
+    if (!t) return NULL;
+    if (m == 0) m = INT8_HNSW_INDEX_DEFAULT_M;
+    if (ef_construction == 0) ef_construction = INT8_HNSW_INDEX_DEFAULT_EF_CONSTRUCTION;
+    if (m > MAX_M) return NULL;
+    return hnsw_alloc(t, m, ef_construction);
+}
+
+void int8_hnsw_index_destroy(int8_hnsw_index_t *h) {
+    if (!h) return;
+    chunks_free(&h->level0);
+    chunks_free(&h->upper);
+    for (size_t i = 0; i < h->num_retired; i++) free(h->retired[i]);
+    free(h->retired);
+    for (size_t i = 0; i < h->num_ctxs; i++) ctx_free(h->ctxs[i]);
+    free(h->ctxs);
+    if (h->map) munmap(h->map, h->map_size);
+    pthread_mutex_destroy(&h->grow_lock);
+    pthread_mutex_destroy(&h->entry_lock);
+    pthread_mutex_destroy(&h->sync_lock);
+    pthread_rwlock_destroy(&h->save_lock);
+    for (size_t i = 0; i < LOCK_STRIPES; i++) pthread_mutex_destroy(&h->locks[i]);
+    pthread_mutex_destroy(&h->ctx_lock);
+    free(h);
+}
+
+/* ---- files --------------------------------------------------------------- */
+
+static size_t page_round(size_t bytes) {
+    return (bytes + HNSW_HEADER_SIZE - 1) & ~(size_t)(HNSW_HEADER_SIZE - 1);
+}
+
+/* iovecs over slots [0, n) of c, one per chunk; returns how many */
+static int chunk_iov(const chunks_t *c, size_t n, struct iovec *iov) {
+    char **dir = atomic_load_explicit(&((chunks_t *)c)->dir, memory_order_acquire);
+    int k = 0;
+    for (size_t i = 0; i < n; i += CHUNK_SLOTS, k++) {
+        size_t slots = n - i < CHUNK_SLOTS ? n - i : CHUNK_SLOTS;
+        iov[k].iov_base = dir[i >> CHUNK_SHIFT];
+        iov[k].iov_len = slots * c->slot_bytes;
+    }
+    return k;
+}
+
+int int8_hnsw_index_save(int8_hnsw_index_t *h, const char *filename) {
+    if (!h || !filename) return -1;
+    pthread_rwlock_wrlock(&h->save_lock);
+    size_t rows = atomic_load(&h->rows);
+    size_t upper = atomic_load(&h->upper_used);
+    size_t level0_bytes = rows * h->level0.slot_bytes;
+    size_t pad = page_round(level0_bytes) - level0_bytes;
+    int chunks = (int)(((rows + CHUNK_SLOTS - 1) >> CHUNK_SHIFT) +
+                       ((upper + CHUNK_SLOTS - 1) >> CHUNK_SHIFT));
+    struct iovec *iov = (struct iovec *)malloc((size_t)(chunks + 2) * sizeof(*iov));
+    uint8_t *page = (uint8_t *)calloc(1, HNSW_HEADER_SIZE);
+    int rc = -1;
+    if (iov && page) {
+        int n = 1;
+        n += chunk_iov(&h->level0, rows, iov + n);
+        iov[n].iov_base = (void *)zeros;
+        iov[n++].iov_len = pad;
+        n += chunk_iov(&h->upper, upper, iov + n);
+        uint32_t crc = 0;
+        for (int i = 1; i < n; i++) crc = embedding_crc32c(crc, iov[i].iov_base, iov[i].iov_len);
+
+        hnsw_file_header_t hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, HNSW_FILE_MAGIC, sizeof(hdr.magic));
+        hdr.version = HNSW_FILE_VERSION;
+        hdr.header_size = HNSW_HEADER_SIZE;
+        hdr.dim = h->dim;
+        hdr.m = (uint32_t)h->m;
+        hdr.m0 = (uint32_t)h->m0;
+        hdr.ef_construction = (uint32_t)h->ef_construction;
+        hdr.slot_bytes = (uint32_t)h->level0.slot_bytes;
+        hdr.upper_bytes = (uint32_t)h->upper.slot_bytes;
+        hdr.rows = rows;
+        hdr.upper = upper;
+        hdr.count = atomic_load(&h->count);
+        hdr.entry = atomic_load(&h->entry);
+        hdr.level0_offset = HNSW_HEADER_SIZE;
+        hdr.upper_offset = HNSW_HEADER_SIZE + level0_bytes + pad;
+        hdr.table_id = h->t->table_id;
+        hdr.data_crc = crc;
+        hdr.header_crc = embedding_crc32c(0, &hdr, offsetof(hnsw_file_header_t, header_crc));
+        memcpy(page, &hdr, sizeof(hdr));
+        iov[0].iov_base = page;
+        iov[0].iov_len = HNSW_HEADER_SIZE;
+        rc = embedding_file_replace(filename, iov, n, "int8_hnsw_index_save");
+    } else {
+        fprintf(stderr, "int8_hnsw_index_save: out of memory\n");
+    }
+    pthread_rwlock_unlock(&h->save_lock);
+    free(iov);
+    free(page);
+    return rc;
+}
+
+/* the header of a graph file for t; returns 0 if it fits, -1 otherwise */
+static int check_header(const hnsw_file_header_t *hdr, const int8_embedding_table_t *t,
+                        size_t file_size, const char *who) {
+    if (memcmp(hdr->magic, HNSW_FILE_MAGIC, sizeof(hdr->magic)) ||
+        hdr->version != HNSW_FILE_VERSION || hdr->header_size != HNSW_HEADER_SIZE ||
+        hdr->header_crc != embedding_crc32c(0, hdr, offsetof(hnsw_file_header_t, header_crc))) {
+        fprintf(stderr, "%s: not a graph file\n", who);
+        return -1;
+    }
+    size_t slot = ((SLOT_LINKS + (size_t)hdr->m0) * sizeof(uint32_t) + 63) & ~(size_t)63;
+    size_t upper = ((UPPER_LINKS + (size_t)hdr->m) * sizeof(uint32_t) + 63) & ~(size_t)63;
+    size_t level0_end = HNSW_HEADER_SIZE + hdr->rows * slot;
+    if (hdr->dim != t->dim || hdr->m == 0 || hdr->m > MAX_M || hdr->m0 != 2 * hdr->m ||
+        hdr->slot_bytes != slot || hdr->upper_bytes != upper ||
+        hdr->rows > int8_embedding_table_size((int8_embedding_table_t *)t) ||
+        hdr->rows >= UINT32_MAX || hdr->count > hdr->rows || hdr->upper >= UINT32_MAX ||
+        hdr->level0_offset != HNSW_HEADER_SIZE || hdr->upper_offset != page_round(level0_end) ||
+        file_size != hdr->upper_offset + hdr->upper * upper) {
+        fprintf(stderr, "%s: graph does not fit the table\n", who);
+        return -1;
+    }
+    /* the same rows under the same ids: not a table compacted (or rebuilt) since */
+    if (hdr->table_id != t->table_id) {
+        fprintf(stderr, "%s: graph was built on another table\n", who);
+        return -1;
+    }
+    return 0;
+}
+
+/* every level, upper slot and link in range, and the entry point on top */
+static int check_graph(const int8_hnsw_index_t *h, const char *who) {
+    size_t rows = atomic_load(&((int8_hnsw_index_t *)h)->rows);
+    size_t upper = atomic_load(&((int8_hnsw_index_t *)h)->upper_used);
+    uint64_t entry = atomic_load(&((int8_hnsw_index_t *)h)->entry);
+    size_t count = 0;
+    for (size_t id = 0; id < rows; id++) {
+        link_t *s = level0_slot(h, id);
+        uint32_t level = atomic_load_explicit(&s[SLOT_LEVEL], memory_order_relaxed);
+        if (level == 0) {
+            if (atomic_load_explicit(&s[SLOT_COUNT], memory_order_relaxed) == 0) continue;
+            goto bad;
+        }
+        if (level > MAX_LEVEL + 1) goto bad;
+        count++;
+        if (level > 1 && (size_t)atomic_load_explicit(&s[SLOT_UPPER], memory_order_relaxed) +
+                                 level - 1 > upper)
+            goto bad;
+        for (size_t lc = 0; lc < level; lc++) {
+            size_t cap;
+            link_t *list = links_of(h, id, lc, &cap);
+            size_t cnt = atomic_load_explicit(list, memory_order_relaxed);
+            if (cnt > cap) goto bad;
+            link_t *links = links_begin(list, lc);
+            for (size_t j = 0; j < cnt; j++) {
+                size_t n = atomic_load_explicit(&links[j], memory_order_relaxed);
+                if (n >= rows || row_level(h, n) <= lc) goto bad;
+            }
+        }
+    }
+    if (count != atomic_load(&((int8_hnsw_index_t *)h)->count)) goto bad;
+    if (count && (entry == 0 || (uint32_t)entry >= rows ||
+                  row_level(h, (uint32_t)entry) != (uint32_t)(entry >> 32)))
+        goto bad;
+    if (!count && entry) goto bad;
+    return 0;
+bad:
+    fprintf(stderr, "%s: damaged graph\n", who);
+    return -1;
+}
+
+static void set_from_header(int8_hnsw_index_t *h, const hnsw_file_header_t *hdr) {
+    atomic_store(&h->rows, hdr->rows);
+    atomic_store(&h->upper_used, hdr->upper);
+    atomic_store(&h->count, hdr->count);
+    atomic_store(&h->entry, hdr->entry);
+}
+
+int8_hnsw_index_t *int8_hnsw_index_load(int8_embedding_table_t *t, const char *filename) {
+    static const char *who = "int8_hnsw_index_load";
+    if (!t || !filename) return NULL;
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        perror("int8_hnsw_index_load: fopen");
+        return NULL;
+    }
+    struct stat st;
+    hnsw_file_header_t hdr;
+    if (fstat(fileno(fp), &st) != 0 || fread(&hdr, 1, sizeof(hdr), fp) != sizeof(hdr) ||
+        check_header(&hdr, t, (size_t)st.st_size, who) != 0) {
+        fclose(fp);
+        return NULL;
+    }
+    int8_hnsw_index_t *h = hnsw_alloc(t, hdr.m, hdr.ef_construction);
+    const char *err = NULL;
+    if (!h || chunks_reserve(h, &h->level0, hdr.rows) != 0 ||
+        chunks_reserve(h, &h->upper, hdr.upper) != 0) {
+        err = "out of memory";
+    } else {
+        uint32_t crc = 0;
+        char **dir = atomic_load(&h->level0.dir);
+        fseek(fp, (long)hdr.level0_offset, SEEK_SET);
+        for (size_t i = 0; !err && i < hdr.rows; i += CHUNK_SLOTS) {
+            size_t bytes = (hdr.rows - i < CHUNK_SLOTS ? hdr.rows - i : CHUNK_SLOTS) *
+                           h->level0.slot_bytes;
+            if (fread(dir[i >> CHUNK_SHIFT], 1, bytes, fp) != bytes) err = "short file";
+            else crc = embedding_crc32c(crc, dir[i >> CHUNK_SHIFT], bytes);
+        }
+        size_t pad = hdr.upper_offset - hdr.level0_offset - hdr.rows * h->level0.slot_bytes;
+        crc = embedding_crc32c(crc, zeros, pad);
+        fseek(fp, (long)hdr.upper_offset, SEEK_SET);
+        dir = atomic_load(&h->upper.dir);
+        for (size_t i = 0; !err && i < hdr.upper; i += CHUNK_SLOTS) {
+            size_t bytes = (hdr.upper - i < CHUNK_SLOTS ? hdr.upper - i : CHUNK_SLOTS) *
+                           h->upper.slot_bytes;
+            if (fread(dir[i >> CHUNK_SHIFT], 1, bytes, fp) != bytes) err = "short file";
+            else crc = embedding_crc32c(crc, dir[i >> CHUNK_SHIFT], bytes);
+        }
+        if (!err && crc != hdr.data_crc) err = "checksum mismatch";
+    }
+    fclose(fp);
+    if (err) {
+        fprintf(stderr, "%s: %s\n", who, err);
+        int8_hnsw_index_destroy(h);
+        return NULL;
+    }
+    set_from_header(h, &hdr);
+    if (check_graph(h, who) != 0) {
+        int8_hnsw_index_destroy(h);
+        return NULL;
+    }
+    return h;
+}
+
+/* point c's chunks at the n slots mapped at base, copying a partial last
+ * chunk to the heap so inserts can fill it
+ */
+static int map_chunks(int8_hnsw_index_t *h, chunks_t *c, char *base, size_t n) {
+    size_t bytes = (size_t)CHUNK_SLOTS * c->slot_bytes;
+    for (size_t i = 0; i < n; i += CHUNK_SLOTS) {
+        char *p = base + (i >> CHUNK_SHIFT) * bytes;
+        if (n - i < CHUNK_SLOTS) {
+            char *copy = chunk_alloc(bytes);
+            if (!copy) return -1;
+            memcpy(copy, p, (n - i) * c->slot_bytes);
+            if (chunks_push(h, c, copy) != 0) {
+                free(copy);
+                return -1;
+            }
+            break;
+        }
+        if (chunks_push(h, c, p) != 0) return -1;
+        c->mapped++;
+    }
+    return 0;
+}
+
+int8_hnsw_index_t *int8_hnsw_index_mmap(int8_embedding_table_t *t, const char *filename,
+                                        uint32_t flags) {
+    static const char *who = "int8_hnsw_index_mmap";
+    if (!t || !filename) return NULL;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "%s: open: %s\n", who, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    hnsw_file_header_t hdr;
+    if (fstat(fd, &st) != 0 || pread(fd, &hdr, sizeof(hdr), 0) != (ssize_t)sizeof(hdr) ||
+        check_header(&hdr, t, (size_t)st.st_size, who) != 0) {
+        close(fd);
+        return NULL;
+    }
+    int map_flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+    if (flags & EMBEDDING_TABLE_MMAP_POPULATE) map_flags |= MAP_POPULATE;
+#endif
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, map_flags, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: mmap: %s\n", who, strerror(errno));
+        return NULL;
+    }
+    if (flags & EMBEDDING_TABLE_MMAP_SEQUENTIAL) madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+    if (flags & EMBEDDING_TABLE_MMAP_RANDOM)     madvise(map, (size_t)st.st_size, MADV_RANDOM);
+    if (flags & EMBEDDING_TABLE_MMAP_WILLNEED)   madvise(map, (size_t)st.st_size, MADV_WILLNEED);
+
+    int8_hnsw_index_t *h = hnsw_alloc(t, hdr.m, hdr.ef_construction);
+    if (!h) {
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    h->map = map;
+    h->map_size = (size_t)st.st_size;
+    if (map_chunks(h, &h->level0, (char *)map + hdr.level0_offset, hdr.rows) != 0 ||
+        map_chunks(h, &h->upper, (char *)map + hdr.upper_offset, hdr.upper) != 0) {
+        fprintf(stderr, "%s: out of memory\n", who);
+        int8_hnsw_index_destroy(h);
+        return NULL;
+    }
+    set_from_header(h, &hdr);
+    if (flags & EMBEDDING_TABLE_MMAP_VERIFY) {
+        const char *data = (const char *)map + hdr.level0_offset;
+        if (embedding_crc32c(0, data, h->map_size - hdr.level0_offset) != hdr.data_crc) {
+            fprintf(stderr, "%s: checksum mismatch\n", who);
+            int8_hnsw_index_destroy(h);
+            return NULL;
+        }
+        if (check_graph(h, who) != 0) {
+            int8_hnsw_index_destroy(h);
+            return NULL;
+        }
+    }
+    return h;
+}
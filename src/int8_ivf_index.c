@@ -0,0 +1,696 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "embedding-library/int8_ivf_index.h"
+#include "embedding-library/dispatch.h"
+#include "embedding_table_file.h"
+#include "embedding_topk.h"
+#include "crc32c.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#define IVF_FILE_MAGIC   "I8EMBIVF"
+#define IVF_FILE_VERSION 2u      /* 2: table_id */
+#define ASSIGN_CHUNK     1024u   /* rows per assignment task */
+#define SCAN_CHUNK       512u    /* COPY_ROWS rows scored per kernel call */
+#define PREFETCH_AHEAD   8u      /* rows fetched ahead of the one being scored */
+
+typedef struct {
+    size_t *ids;        /* ascending */
+    int8_t *rows;       /* with COPY_ROWS: the rows of ids, back to back */
+    double *norms;      /* with COPY_ROWS: each row's norm, or 1/norm for
+                           an INV_NORMS table (what the table keeps) */
+    size_t size;
+    size_t capacity;
+} ivf_list_t;
+
+struct int8_ivf_index_s {
+    int8_embedding_table_t *t;
+    size_t dim;
+    size_t nlist;
+    uint32_t flags;
+    int8_t *centroids;          /* nlist * dim, each a unit vector quantized */
+    double *inv_centroid_norms;
+    ivf_list_t *lists;
+    size_t rows;                /* table rows filed (or skipped as deleted) */
+    embedding_int8_dot_product_rows_cb kernel;
+    embedding_int8_dot_product_cb dot;  /* one row (the rows kernel sums the query per call) */
+    pthread_rwlock_t lock;      /* searches read, sync() / remap() write */
+    pthread_mutex_t sync_lock;  /* one sync() / remap() at a time */
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t dim;
+    uint64_t nlist;
+    uint64_t num_rows;          /* rows the index covered */
+    uint64_t num_ids;           /* ids over all lists */
+    uint64_t table_id;          /* the table's, as in its file header */
+    uint32_t flags;
+    uint32_t data_crc;          /* centroids, list sizes, ids */
+    uint32_t reserved;
+    uint32_t header_crc;        /* the header up to this field */
+} ivf_file_header_t;
+
+/* what the table keeps for a row: its norm, or 1/norm with INV_NORMS */
+static inline double row_norm(const int8_embedding_node_t *n, size_t slot) {
+    return n->norms ? n->norms[slot] : (double)n->inv_norms[slot];
+}
+
+/* the cosine score int8_embedding_table_topk() gives the row */
+static inline double row_score(int32_t dot, double query_norm, double inv_q,
+                               int inv, double norm) {
+    return inv ? dot * (inv_q * norm) : dot / (query_norm * norm);
+}
+
+static inline int table_inv_norms(const int8_embedding_table_t *t) {
+    return (t->layout & EMBEDDING_TABLE_LAYOUT_INV_NORMS) != 0;
+}
+
+static int8_ivf_index_t *ivf_alloc(int8_embedding_table_t *t, size_t nlist, uint32_t flags) {
+    int8_ivf_index_t *ivf = (int8_ivf_index_t *)calloc(1, sizeof(*ivf));
+    if (!ivf) return NULL;
+    ivf->t = t;
+    ivf->dim = t->dim;
+    ivf->nlist = nlist;
+    ivf->flags = flags;
+    ivf->kernel = embedding_int8_rows_kernel(embedding_kernels(), t->dim);
+    ivf->dot = embedding_kernels()->int8_dot_product;
+    ivf->centroids = (int8_t *)malloc(nlist * t->dim);
+    ivf->inv_centroid_norms = (double *)malloc(nlist * sizeof(double));
+    ivf->lists = (ivf_list_t *)calloc(nlist, sizeof(ivf_list_t));
+    if (!ivf->centroids || !ivf->inv_centroid_norms || !ivf->lists) {
+        free(ivf->centroids);
+        free(ivf->inv_centroid_norms);
+        free(ivf->lists);
+        free(ivf);
+        return NULL;
+    }
+    pthread_rwlock_init(&ivf->lock, NULL);
+    pthread_mutex_init(&ivf->sync_lock, NULL);
+    return ivf;
+}
+
+void int8_ivf_index_destroy(int8_ivf_index_t *ivf) {
+    if (!ivf) return;
+    for (size_t i = 0; i < ivf->nlist; i++) {
+        free(ivf->lists[i].ids);
+        free(ivf->lists[i].rows);
+        free(ivf->lists[i].norms);
+    }
+    free(ivf->lists);
+    free(ivf->centroids);
+    free(ivf->inv_centroid_norms);
+    pthread_rwlock_destroy(&ivf->lock);
+    pthread_mutex_destroy(&ivf->sync_lock);
+    free(ivf);
+}
+
+static void centroid_norm(int8_ivf_index_t *ivf, size_t i) {
+    const int8_t *c8 = ivf->centroids + i * ivf->dim;
+    int32_t dp = int8_dot_product_dispatch(c8, c8, ivf->dim);
+    ivf->inv_centroid_norms[i] = dp > 0 ? 1.0 / sqrt((double)dp) : 0.0;
+}
+
+/* quantize unit centroid c (dim floats) into slot i */
+static void set_centroid(int8_ivf_index_t *ivf, size_t i, const float *c) {
+    int8_from_floats_dispatch(c, ivf->dim, ivf->centroids + i * ivf->dim);
+    centroid_norm(ivf, i);
+}
+
+/* the list whose centroid is closest to row by cosine; dots holds nlist */
+static uint32_t nearest(const int8_ivf_index_t *ivf, const int8_t *row, int32_t *dots) {
+    ivf->kernel(row, ivf->centroids, ivf->nlist, ivf->dim, dots);
+    uint32_t best = 0;
+    double best_score = -INFINITY;
+    for (size_t c = 0; c < ivf->nlist; c++) {
+        double score = dots[c] * ivf->inv_centroid_norms[c];
+        if (score > best_score) {
+            best_score = score;
+            best = (uint32_t)c;
+        }
+    }
+    return best;
+}
+
+/* Nearest list of count rows, ASSIGN_CHUNK per task: rows [first, first +
+ * count) of the table, or of `rows` (contiguous) if it is set.  Deleted table
+ * rows get UINT32_MAX.
+ */
+typedef struct {
+    const int8_ivf_index_t *ivf;
+    const int8_t *rows;
+    size_t first;
+    size_t count;
+    uint32_t *out;
+    atomic_int failed;
+} assign_t;
+
+static void assign_part(void *arg, size_t part) {
+    assign_t *a = (assign_t *)arg;
+    const int8_ivf_index_t *ivf = a->ivf;
+    int32_t *dots = (int32_t *)malloc(ivf->nlist * sizeof(*dots));
+    if (!dots) {
+        atomic_store(&a->failed, 1);
+        return;
+    }
+    size_t from = part * ASSIGN_CHUNK;
+    size_t to = from + ASSIGN_CHUNK < a->count ? from + ASSIGN_CHUNK : a->count;
+    for (size_t i = from; i < to; i++) {
+        if (a->rows) {
+            a->out[i] = nearest(ivf, a->rows + i * ivf->dim, dots);
+            continue;
+        }
+        size_t id = a->first + i;
+        a->out[i] = int8_embedding_table_is_deleted(ivf->t, id)
+                        ? UINT32_MAX
+                        : nearest(ivf, int8_embedding_table_embedding(ivf->t, id), dots);
+    }
+    free(dots);
+}
+
+static int assign(const int8_ivf_index_t *ivf, const int8_t *rows, size_t first, size_t count,
+                  uint32_t *out, embedding_thread_pool_t *pool) {
+    assign_t a = { ivf, rows, first, count, out, 0 };
+    embedding_thread_pool_run(pool, assign_part, &a, (count + ASSIGN_CHUNK - 1) / ASSIGN_CHUNK);
+    return atomic_load(&a.failed) ? -1 : 0;
+}
+
+static int list_reserve(const int8_ivf_index_t *ivf, ivf_list_t *l, size_t capacity) {
+    if (capacity <= l->capacity) return 0;
+    size_t n = l->capacity ? l->capacity : 16;
+    while (n < capacity) n *= 2;
+    size_t *ids = (size_t *)realloc(l->ids, n * sizeof(*ids));
+    if (!ids) return -1;
+    l->ids = ids;
+    if (ivf->flags & INT8_IVF_INDEX_COPY_ROWS) {
+        int8_t *rows = (int8_t *)realloc(l->rows, n * ivf->dim);
+        if (!rows) return -1;
+        l->rows = rows;
+        double *norms = (double *)realloc(l->norms, n * sizeof(*norms));
+        if (!norms) return -1;
+        l->norms = norms;
+    }
+    l->capacity = n;
+    return 0;
+}
+
+static void list_push(const int8_ivf_index_t *ivf, ivf_list_t *l, size_t id) {
+    if (ivf->flags & INT8_IVF_INDEX_COPY_ROWS) {
+        const int8_embedding_node_t *n = int8_embedding_table_node(ivf->t, id >> NODE_SHIFT);
+        size_t slot = id & (NODE_CAPACITY - 1);
+        memcpy(l->rows + l->size * ivf->dim, n->data + slot * ivf->dim, ivf->dim);
+        l->norms[l->size] = row_norm(n, slot);
+    }
+    l->ids[l->size++] = id;
+}
+
+/* File rows [first, first + count) of the table with their lists in out
+ * (UINT32_MAX: skip).  Room is made in every list first, so on failure no
+ * list has changed.  Called with the write lock held.
+ */
+static int file_rows(int8_ivf_index_t *ivf, size_t first, size_t count, const uint32_t *out) {
+    size_t *add = (size_t *)calloc(ivf->nlist, sizeof(*add));
+    if (!add) return -1;
+    for (size_t i = 0; i < count; i++)
+        if (out[i] != UINT32_MAX) add[out[i]]++;
+    for (size_t c = 0; c < ivf->nlist; c++) {
+        if (add[c] && list_reserve(ivf, &ivf->lists[c], ivf->lists[c].size + add[c]) != 0) {
+            free(add);
+            return -1;
+        }
+    }
+    free(add);
+    for (size_t i = 0; i < count; i++)
+        if (out[i] != UINT32_MAX) list_push(ivf, &ivf->lists[out[i]], first + i);
+    return 0;
+}
+
+int int8_ivf_index_sync(int8_ivf_index_t *ivf, embedding_thread_pool_t *pool) {
+    if (!ivf) return -1;
+    pthread_mutex_lock(&ivf->sync_lock);
+    size_t first = ivf->rows;
+    size_t end = int8_embedding_table_size(ivf->t);
+    int rc = 0;
+    if (end > first) {
+        /* the centroids never change, so rows are assigned outside the lock */
+        uint32_t *out = (uint32_t *)malloc((end - first) * sizeof(*out));
+        rc = out ? assign(ivf, NULL, first, end - first, out, pool) : -1;
+        if (rc == 0) {
+            pthread_rwlock_wrlock(&ivf->lock);
+            rc = file_rows(ivf, first, end - first, out);
+            if (rc == 0) ivf->rows = end;
+            pthread_rwlock_unlock(&ivf->lock);
+        }
+        free(out);
+        if (rc != 0) fprintf(stderr, "int8_ivf_index_sync: out of memory\n");
+    }
+    pthread_mutex_unlock(&ivf->sync_lock);
+    return rc;
+}
+
+/* xorshift64*, for sampling */
+static uint64_t next_random(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+static int cmp_ids(const void *a, const void *b) {
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* A uniform sample of *count live rows of t (reservoir sampling), in id
+ * order.  Rows deleted since *count was sized from the live count can leave
+ * fewer; *count is set to the number sampled.
+ * returns a malloc'd array, or NULL
+ */
+static size_t *sample_rows(int8_embedding_table_t *t, size_t rows, size_t *count_inout) {
+    size_t count = *count_inout;
+    size_t *ids = (size_t *)malloc(count * sizeof(*ids));
+    if (!ids) return NULL;
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    size_t seen = 0;
+    for (size_t id = 0; id < rows; id++) {
+        if (int8_embedding_table_is_deleted(t, id)) continue;
+        if (seen < count) {
+            ids[seen++] = id;
+            continue;
+        }
+        uint64_t j = next_random(&state) % (uint64_t)++seen;
+        if (j < count) ids[j] = id;
+    }
+    if (seen < count) count = seen;
+    qsort(ids, count, sizeof(*ids), cmp_ids);
+    *count_inout = count;
+    return ids;
+}
+
+/* Spherical k-means over the sample rows: each centroid becomes the
+ * normalized mean of the unit rows assigned to it; an empty one takes a
+ * random sample row.  Leaves the final centroids in ivf.
+ */
+static int kmeans(int8_ivf_index_t *ivf, const int8_t *rows, const double *inv_norms,
+                  size_t count, unsigned iterations, embedding_thread_pool_t *pool) {
+    size_t dim = ivf->dim, nlist = ivf->nlist;
+    float *sums = (float *)malloc(nlist * dim * sizeof(*sums));
+    size_t *sizes = (size_t *)malloc(nlist * sizeof(*sizes));
+    uint32_t *out = (uint32_t *)malloc(count * sizeof(*out));
+    int rc = -1;
+    uint64_t state = 0xD1B54A32D192ED03ULL;
+    if (!sums || !sizes || !out) goto done;
+
+    /* start from nlist sample rows spread over the (random) sample */
+    for (size_t c = 0; c < nlist; c++) {
+        size_t j = c * count / nlist;
+        for (size_t d = 0; d < dim; d++)
+            sums[c * dim + d] = (float)(rows[j * dim + d] * inv_norms[j]);
+        set_centroid(ivf, c, sums + c * dim);
+    }
+
+    for (unsigned it = 0; it < iterations; it++) {
+        if (assign(ivf, rows, 0, count, out, pool) != 0) goto done;
+        memset(sums, 0, nlist * dim * sizeof(*sums));
+        memset(sizes, 0, nlist * sizeof(*sizes));
+        for (size_t j = 0; j < count; j++) {
+            float *s = sums + (size_t)out[j] * dim;
+            const int8_t *r = rows + j * dim;
+            float w = (float)inv_norms[j];
+            for (size_t d = 0; d < dim; d++) s[d] += r[d] * w;
+            sizes[out[j]]++;
+        }
+        for (size_t c = 0; c < nlist; c++) {
+            float *s = sums + c * dim;
+            if (sizes[c] == 0) {
+                size_t j = (size_t)(next_random(&state) % count);
+                for (size_t d = 0; d < dim; d++)
+                    s[d] = (float)(rows[j * dim + d] * inv_norms[j]);
+            }
+            float len = sqrtf(dot_product_dispatch(s, s, dim));
+            if (len > 0.0f)
+                for (size_t d = 0; d < dim; d++) s[d] /= len;
+            set_centroid(ivf, c, s);
+        }
+    }
+    rc = 0;
+done:
+    free(sums);
+    free(sizes);
+    free(out);
+    return rc;
+}
+
+int8_ivf_index_t *int8_ivf_index_train(int8_embedding_table_t *t, size_t nlist,
+                                       size_t sample, unsigned iterations,
+                                       uint32_t flags, embedding_thread_pool_t *pool) {
+    if (!t || nlist == 0 || nlist >= UINT32_MAX || (flags & ~INT8_IVF_INDEX_COPY_ROWS)) return NULL;
+    size_t rows = int8_embedding_table_size(t);
+    size_t live = rows - int8_embedding_table_num_deleted(t);
+    if (live < nlist) {
+        fprintf(stderr, "int8_ivf_index_train: %zu live rows for %zu lists\n", live, nlist);
+        return NULL;
+    }
+    if (sample == 0) sample = nlist * INT8_IVF_INDEX_DEFAULT_SAMPLE_PER_LIST;
+    if (sample > live) sample = live;
+    if (sample < nlist) sample = nlist;
+    if (iterations == 0) iterations = INT8_IVF_INDEX_DEFAULT_ITERATIONS;
+
+    int8_ivf_index_t *ivf = ivf_alloc(t, nlist, flags);
+    if (!ivf) return NULL;
+    int8_t *buf = (int8_t *)malloc(sample * t->dim);
+    double *inv_norms = (double *)malloc(sample * sizeof(*inv_norms));
+    size_t *ids = sample_rows(t, rows, &sample);
+    if (ids && sample < nlist) {
+        /* rows were deleted while the sample was taken */
+        fprintf(stderr, "int8_ivf_index_train: %zu live rows for %zu lists\n", sample, nlist);
+        free(ids);
+        free(buf);
+        free(inv_norms);
+        int8_ivf_index_destroy(ivf);
+        return NULL;
+    }
+    int rc = -1;
+    if (ids && buf && inv_norms) {
+        for (size_t j = 0; j < sample; j++) {
+            const int8_embedding_node_t *n = int8_embedding_table_node(t, ids[j] >> NODE_SHIFT);
+            size_t slot = ids[j] & (NODE_CAPACITY - 1);
+            memcpy(buf + j * t->dim, n->data + slot * t->dim, t->dim);
+            inv_norms[j] = n->norms ? 1.0 / n->norms[slot] : (double)n->inv_norms[slot];
+        }
+        rc = kmeans(ivf, buf, inv_norms, sample, iterations, pool);
+    }
+    free(ids);
+    free(buf);
+    free(inv_norms);
+    if (rc != 0 || int8_ivf_index_sync(ivf, pool) != 0) {
+        fprintf(stderr, "int8_ivf_index_train: out of memory\n");
+        int8_ivf_index_destroy(ivf);
+        return NULL;
+    }
+    return ivf;
+}
+
+int int8_ivf_index_remap(int8_ivf_index_t *ivf, int8_embedding_table_t *t,
+                         const size_t *remap) {
+    if (!ivf || !t || !remap || t->dim != ivf->dim) return -1;
+    pthread_mutex_lock(&ivf->sync_lock);
+    pthread_rwlock_wrlock(&ivf->lock);
+    /* compaction keeps the order of rows, so lists stay sorted and the rows
+     * filed so far are exactly the new ids below the first one of a row that
+     * was not
+     */
+    size_t covered = 0;
+    for (size_t i = ivf->rows; i-- > 0;) {
+        if (remap[i] != (size_t)-1) {
+            covered = remap[i] + 1;
+            break;
+        }
+    }
+    for (size_t c = 0; c < ivf->nlist; c++) {
+        ivf_list_t *l = &ivf->lists[c];
+        size_t kept = 0;
+        for (size_t i = 0; i < l->size; i++) {
+            size_t id = remap[l->ids[i]];
+            if (id == (size_t)-1) continue;
+            if (l->rows && kept != i) {
+                memmove(l->rows + kept * ivf->dim, l->rows + i * ivf->dim, ivf->dim);
+                l->norms[kept] = l->norms[i];
+            }
+            l->ids[kept++] = id;
+        }
+        l->size = kept;
+    }
+    ivf->t = t;
+    ivf->rows = covered;
+    pthread_rwlock_unlock(&ivf->lock);
+    pthread_mutex_unlock(&ivf->sync_lock);
+    return 0;
+}
+
+size_t int8_ivf_index_nlist(const int8_ivf_index_t *ivf) {
+    return ivf ? ivf->nlist : 0;
+}
+
+size_t int8_ivf_index_size(const int8_ivf_index_t *ivf) {
+    if (!ivf) return 0;
+    int8_ivf_index_t *m = (int8_ivf_index_t *)ivf;
+    pthread_rwlock_rdlock(&m->lock);
+    size_t r = m->rows;
+    pthread_rwlock_unlock(&m->lock);
+    return r;
+}
+
+size_t int8_ivf_index_list_size(const int8_ivf_index_t *ivf, size_t list) {
+    if (!ivf || list >= ivf->nlist) return 0;
+    int8_ivf_index_t *m = (int8_ivf_index_t *)ivf;
+    pthread_rwlock_rdlock(&m->lock);
+    size_t r = m->lists[list].size;
+    pthread_rwlock_unlock(&m->lock);
+    return r;
+}
+
+/* Offer the rows of list l to the heap.  COPY_ROWS lists are scored
+ * SCAN_CHUNK rows per rows-kernel call; otherwise each row is read from the
+ * table and scored with the dispatched dot product (this file is not built
+ * for the host's ISA).  With check_deleted, rows deleted in the table are skipped.
+ */
+static void scan_list(const int8_ivf_index_t *ivf, const ivf_list_t *l, const int8_t *query,
+                      double query_norm, int check_deleted, int32_t *dots,
+                      embedding_topk_t *h) {
+    int8_embedding_table_t *t = ivf->t;
+    size_t dim = ivf->dim;
+    int inv = table_inv_norms(t);
+    double inv_q = 1.0 / query_norm;
+    if (l->rows) {
+        for (size_t from = 0; from < l->size; from += SCAN_CHUNK) {
+            size_t n = l->size - from < SCAN_CHUNK ? l->size - from : SCAN_CHUNK;
+            ivf->kernel(query, l->rows + from * dim, n, dim, dots);
+            for (size_t i = 0; i < n; i++) {
+                double score = row_score(dots[i], query_norm, inv_q, inv, l->norms[from + i]);
+                size_t id = l->ids[from + i];
+                if (embedding_topk_accepts(h, score) &&
+                    !(check_deleted && int8_embedding_table_is_deleted(t, id)))
+                    embedding_topk_push(h, score, id);
+            }
+        }
+        return;
+    }
+    for (size_t i = 0; i < l->size; i++) {
+        size_t id = l->ids[i];
+        if (i + PREFETCH_AHEAD < l->size) {
+            /* rows of a list are scattered over the table; pull in one a few ahead */
+            size_t next = l->ids[i + PREFETCH_AHEAD];
+            const int8_t *p = int8_embedding_table_node(t, next >> NODE_SHIFT)->data +
+                              (next & (NODE_CAPACITY - 1)) * dim;
+            for (size_t off = 0; off < dim; off += 64) __builtin_prefetch(p + off);
+        }
+        if (check_deleted && int8_embedding_table_is_deleted(t, id)) continue;
+        const int8_embedding_node_t *n = int8_embedding_table_node(t, id >> NODE_SHIFT);
+        size_t slot = id & (NODE_CAPACITY - 1);
+        int32_t dot = ivf->dot(query, n->data + slot * dim, dim);
+        double score = row_score(dot, query_norm, inv_q, inv, row_norm(n, slot));
+        if (embedding_topk_accepts(h, score)) embedding_topk_push(h, score, id);
+    }
+}
+
+size_t int8_ivf_index_topk(int8_ivf_index_t *ivf, const int8_t *query, double query_norm,
+                           size_t nprobe, size_t k, size_t *out_ids, double *out_scores) {
+    if (!ivf || !query || k == 0 || nprobe == 0) return 0;
+    if (query_norm < 0.0) {
+        int32_t dp = int8_dot_product_dispatch(query, query, ivf->dim);
+        query_norm = dp > 0 ? sqrt((double)dp) : 0.0;
+    }
+    if (query_norm == 0.0) return 0;
+    if (nprobe > ivf->nlist) nprobe = ivf->nlist;
+
+    pthread_rwlock_rdlock(&ivf->lock);
+    if (k > ivf->rows) k = ivf->rows;
+    size_t ndots = ivf->nlist > SCAN_CHUNK ? ivf->nlist : SCAN_CHUNK;
+    int32_t *dots = (int32_t *)malloc(ndots * sizeof(*dots));
+    size_t *probe = (size_t *)malloc(nprobe * sizeof(*probe));
+    embedding_topk_entry_t *storage =
+        (embedding_topk_entry_t *)malloc((nprobe > k ? nprobe : k) * sizeof(*storage));
+    size_t n = 0;
+    if (k > 0 && dots && probe && storage) {
+        /* the nprobe lists with the best centroids */
+        embedding_topk_t h;
+        embedding_topk_init(&h, storage, nprobe);
+        ivf->kernel(query, ivf->centroids, ivf->nlist, ivf->dim, dots);
+        for (size_t c = 0; c < ivf->nlist; c++)
+            embedding_topk_push(&h, dots[c] * ivf->inv_centroid_norms[c], c);
+        nprobe = embedding_topk_drain(&h, probe, NULL);
+
+        int check_deleted = int8_embedding_table_num_deleted(ivf->t) != 0;
+        embedding_topk_init(&h, storage, k);
+        for (size_t p = 0; p < nprobe; p++)
+            scan_list(ivf, &ivf->lists[probe[p]], query, query_norm, check_deleted, dots, &h);
+        n = embedding_topk_drain(&h, out_ids, out_scores);
+    }
+    pthread_rwlock_unlock(&ivf->lock);
+    free(dots);
+    free(probe);
+    free(storage);
+    return n;
+}
+
+static size_t centroid_bytes(size_t nlist, size_t dim) {
+    return (nlist * dim + 7) & ~(size_t)7;
+}
+
+int int8_ivf_index_save(int8_ivf_index_t *ivf, const char *filename) {
+    if (!ivf || !filename) return -1;
+    pthread_rwlock_rdlock(&ivf->lock);
+    size_t num_ids = 0;
+    for (size_t c = 0; c < ivf->nlist; c++) num_ids += ivf->lists[c].size;
+    size_t cbytes = centroid_bytes(ivf->nlist, ivf->dim);
+    uint8_t *centroids = (uint8_t *)calloc(1, cbytes);
+    uint64_t *sizes = (uint64_t *)malloc(ivf->nlist * sizeof(*sizes));
+    uint64_t *ids = (uint64_t *)malloc((num_ids ? num_ids : 1) * sizeof(*ids));
+    int rc = -1;
+    if (centroids && sizes && ids) {
+        memcpy(centroids, ivf->centroids, ivf->nlist * ivf->dim);
+        size_t k = 0;
+        for (size_t c = 0; c < ivf->nlist; c++) {
+            const ivf_list_t *l = &ivf->lists[c];
+            sizes[c] = l->size;
+            for (size_t i = 0; i < l->size; i++) ids[k++] = l->ids[i];
+        }
+        ivf_file_header_t h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, IVF_FILE_MAGIC, sizeof(h.magic));
+        h.version = IVF_FILE_VERSION;
+        h.header_size = sizeof(h);
+        h.dim = ivf->dim;
+        h.nlist = ivf->nlist;
+        h.num_rows = ivf->rows;
+        h.num_ids = num_ids;
+        h.table_id = ivf->t->table_id;
+        h.flags = ivf->flags;
+        uint32_t crc = embedding_crc32c(0, centroids, cbytes);
+        crc = embedding_crc32c(crc, sizes, ivf->nlist * sizeof(*sizes));
+        h.data_crc = embedding_crc32c(crc, ids, num_ids * sizeof(*ids));
+        h.header_crc = embedding_crc32c(0, &h, offsetof(ivf_file_header_t, header_crc));
+
+        struct iovec iov[4] = {
+            { &h, sizeof(h) },
+            { centroids, cbytes },
+            { sizes, ivf->nlist * sizeof(*sizes) },
+            { ids, num_ids * sizeof(*ids) },
+        };
+        rc = embedding_file_replace(filename, iov, 4, "int8_ivf_index_save");
+    } else {
+        fprintf(stderr, "int8_ivf_index_save: out of memory\n");
+    }
+    pthread_rwlock_unlock(&ivf->lock);
+    free(centroids);
+    free(sizes);
+    free(ids);
+    return rc;
+}
+
+static int read_full(FILE *fp, void *buf, size_t bytes) {
+    return bytes == 0 || fread(buf, 1, bytes, fp) == bytes ? 0 : -1;
+}
+
+int8_ivf_index_t *int8_ivf_index_load(int8_embedding_table_t *t, const char *filename,
+                                      embedding_thread_pool_t *pool) {
+    if (!t || !filename) return NULL;
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) {
+        perror("int8_ivf_index_load: fopen");
+        return NULL;
+    }
+    size_t rows = int8_embedding_table_size(t);
+    ivf_file_header_t h;
+    if (read_full(fp, &h, sizeof(h)) != 0 || memcmp(h.magic, IVF_FILE_MAGIC, sizeof(h.magic)) ||
+        h.version != IVF_FILE_VERSION || h.header_size != sizeof(h) ||
+        h.header_crc != embedding_crc32c(0, &h, offsetof(ivf_file_header_t, header_crc))) {
+        fprintf(stderr, "int8_ivf_index_load: not an index file\n");
+        fclose(fp);
+        return NULL;
+    }
+    if (h.dim != t->dim || h.nlist == 0 || h.nlist >= UINT32_MAX || h.num_rows > rows ||
+        h.num_ids > h.num_rows || (h.flags & ~INT8_IVF_INDEX_COPY_ROWS)) {
+        fprintf(stderr, "int8_ivf_index_load: index does not fit the table\n");
+        fclose(fp);
+        return NULL;
+    }
+    /* the same rows under the same ids: not a table compacted (or rebuilt) since */
+    if (h.table_id != t->table_id) {
+        fprintf(stderr, "int8_ivf_index_load: index was built on another table\n");
+        fclose(fp);
+        return NULL;
+    }
+
+    int8_ivf_index_t *ivf = ivf_alloc(t, h.nlist, h.flags);
+    size_t cbytes = centroid_bytes(h.nlist, h.dim);
+    uint8_t *centroids = (uint8_t *)malloc(cbytes);
+    uint64_t *sizes = (uint64_t *)malloc(h.nlist * sizeof(*sizes));
+    uint64_t *ids = (uint64_t *)malloc((h.num_ids ? h.num_ids : 1) * sizeof(*ids));
+    const char *err = NULL;
+    if (!ivf || !centroids || !sizes || !ids) {
+        err = "out of memory";
+    } else if (read_full(fp, centroids, cbytes) != 0 ||
+               read_full(fp, sizes, h.nlist * sizeof(*sizes)) != 0 ||
+               read_full(fp, ids, h.num_ids * sizeof(*ids)) != 0 || fgetc(fp) != EOF) {
+        err = "short or oversized file";
+    } else {
+        uint32_t crc = embedding_crc32c(0, centroids, cbytes);
+        crc = embedding_crc32c(crc, sizes, h.nlist * sizeof(*sizes));
+        if (embedding_crc32c(crc, ids, h.num_ids * sizeof(*ids)) != h.data_crc)
+            err = "checksum mismatch";
+    }
+
+    /* lists: sizes adding up to num_ids, ascending ids below num_rows */
+    size_t k = 0;
+    for (size_t c = 0; !err && c < h.nlist; c++) {
+        if (sizes[c] > h.num_ids - k) {
+            err = "bad list sizes";
+            break;
+        }
+        ivf_list_t *l = &ivf->lists[c];
+        if (sizes[c] && list_reserve(ivf, l, sizes[c]) != 0) {
+            err = "out of memory";
+            break;
+        }
+        for (size_t i = 0; i < sizes[c]; i++, k++) {
+            if (ids[k] >= h.num_rows || (i && ids[k] <= l->ids[i - 1])) {
+                err = "bad row id";
+                break;
+            }
+            list_push(ivf, l, (size_t)ids[k]);
+        }
+    }
+    if (!err && k != h.num_ids) err = "bad list sizes";
+    if (!err) {
+        memcpy(ivf->centroids, centroids, h.nlist * h.dim);
+        for (size_t c = 0; c < h.nlist; c++) centroid_norm(ivf, c);
+        ivf->rows = h.num_rows;
+    }
+    fclose(fp);
+    free(centroids);
+    free(sizes);
+    free(ids);
+    if (err) {
+        fprintf(stderr, "int8_ivf_index_load: %s\n", err);
+        int8_ivf_index_destroy(ivf);
+        return NULL;
+    }
+    if (int8_ivf_index_sync(ivf, pool) != 0) {
+        int8_ivf_index_destroy(ivf);
+        return NULL;
+    }
+    return ivf;
+}
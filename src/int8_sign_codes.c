@@ -0,0 +1,508 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#include "embedding-library/int8_sign_codes.h"
+#include "embedding-library/dispatch.h"
+#include "embedding-library/target.h"
+#include "embedding_node.h"
+#include "embedding_topk.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define BLOCK_SHIFT  16u                    /* rows of codes per block */
+#define BLOCK_ROWS   (1u << BLOCK_SHIFT)
+#define ENCODE_CHUNK 4096u                  /* rows per encoding task */
+#define SCAN_CHUNK   1024u                  /* rows per popcount kernel call */
+
+typedef void (*sign_encode_cb)(const int8_t *row, size_t dim, uint64_t *code);
+typedef void (*sign_distance_rows_cb)(const uint64_t *q, const uint64_t *codes,
+                                      size_t nrows, size_t words, uint32_t *out);
+
+typedef struct {
+    sign_encode_cb encode;
+    sign_distance_rows_cb distance_rows;
+} sign_kernels_t;
+
+struct int8_sign_codes_s {
+    int8_embedding_table_t *t;
+    size_t dim;
+    size_t words;               /* uint64 words per code */
+    uint64_t **blocks;          /* BLOCK_ROWS codes each */
+    size_t num_blocks;
+    size_t rows;                /* table rows encoded */
+    const sign_kernels_t *k;
+    pthread_rwlock_t lock;      /* searches read, sync() writes */
+    pthread_mutex_t sync_lock;  /* one sync() at a time */
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/* ---- kernels ------------------------------------------------------------- */
+
+static void encode_scalar(const int8_t *row, size_t dim, uint64_t *code) {
+    for (size_t i = 0, w = 0; i < dim; i += 64, w++) {
+        size_t n = dim - i < 64 ? dim - i : 64;
+        uint64_t bits = 0;
+        for (size_t j = 0; j < n; j++) bits |= (uint64_t)((uint8_t)row[i + j] >> 7) << j;
+        code[w] = bits;
+    }
+}
+
+static void distance_rows_scalar(const uint64_t *q, const uint64_t *codes,
+                                 size_t nrows, size_t words, uint32_t *out) {
+    for (size_t r = 0; r < nrows; r++, codes += words) {
+        uint32_t d = 0;
+        for (size_t w = 0; w < words; w++) d += embedding_popcount64(q[w] ^ codes[w]);
+        out[r] = d;
+    }
+}
+
+#if defined(__x86_64__) && (EMBED_HAVE_TARGET || defined(__AVX2__))
+#define HAVE_AVX2_ENCODE 1
+/* the sign bits are what movemask collects */
+EMBED_TARGET("avx2")
+static void encode_avx2(const int8_t *row, size_t dim, uint64_t *code) {
+    size_t i = 0, w = 0;
+    for (; i + 64 <= dim; i += 64, w++) {
+        uint32_t lo = (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(row + i)));
+        uint32_t hi = (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i *)(row + i + 32)));
+        code[w] = (uint64_t)lo | ((uint64_t)hi << 32);
+    }
+    if (i < dim) encode_scalar(row + i, dim - i, code + w);
+}
+#endif
+
+#if defined(__x86_64__) && (EMBED_HAVE_TARGET || defined(__POPCNT__))
+#define HAVE_POPCNT 1
+/* the scalar loop again, with popcnt instead of a bit-twiddling popcount */
+EMBED_TARGET("popcnt")
+static void distance_rows_popcnt(const uint64_t *q, const uint64_t *codes,
+                                 size_t nrows, size_t words, uint32_t *out) {
+    for (size_t r = 0; r < nrows; r++, codes += words) {
+        uint64_t d = 0;
+        for (size_t w = 0; w < words; w++) d += (uint64_t)_mm_popcnt_u64(q[w] ^ codes[w]);
+        out[r] = (uint32_t)d;
+    }
+}
+#endif
+
+#if defined(__x86_64__) && (EMBED_HAVE_TARGET || \
+    (defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)))
+#define HAVE_AVX512_POPCNT 1
+/* eight words per vpopcntq, the tail under a mask */
+EMBED_TARGET("avx512f,avx512vpopcntdq")
+static void distance_rows_avx512(const uint64_t *q, const uint64_t *codes,
+                                 size_t nrows, size_t words, uint32_t *out) {
+    size_t full = words & ~(size_t)7;
+    __mmask8 tail = (__mmask8)((1u << (words & 7)) - 1);
+    for (size_t r = 0; r < nrows; r++, codes += words) {
+        __m512i acc = _mm512_setzero_si512();
+        for (size_t w = 0; w < full; w += 8) {
+            __m512i x = _mm512_xor_si512(_mm512_loadu_si512(q + w), _mm512_loadu_si512(codes + w));
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+        }
+        if (tail) {
+            __m512i x = _mm512_xor_si512(_mm512_maskz_loadu_epi64(tail, q + full),
+                                         _mm512_maskz_loadu_epi64(tail, codes + full));
+            acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(x));
+        }
+        out[r] = (uint32_t)_mm512_reduce_add_epi64(acc);
+    }
+}
+#endif
+
+/* candidates best first; the first one the host can run is used */
+static const struct {
+    uint32_t required;
+    sign_distance_rows_cb cb;
+} distance_kernels[] = {
+#if defined(HAVE_AVX512_POPCNT)
+    { EMBEDDING_CPU_AVX512F | EMBEDDING_CPU_AVX512VPOPCNTDQ, distance_rows_avx512 },
+#endif
+#if defined(HAVE_POPCNT)
+    { EMBEDDING_CPU_POPCNT, distance_rows_popcnt },
+#endif
+    { 0, distance_rows_scalar },
+};
+
+static const struct {
+    uint32_t required;
+    sign_encode_cb cb;
+} encode_kernels[] = {
+#if defined(HAVE_AVX2_ENCODE)
+    { EMBEDDING_CPU_AVX | EMBEDDING_CPU_AVX2, encode_avx2 },
+#endif
+    { 0, encode_scalar },
+};
+
+static sign_kernels_t resolved;
+static pthread_once_t resolve_once = PTHREAD_ONCE_INIT;
+
+static void resolve(void) {
+    uint32_t f = embedding_cpu_features();
+    /* EMBEDDING_LIBRARY_KERNELS=scalar caps these too */
+    if (!strcmp(embedding_kernels()->name, "scalar")) f = 0;
+    for (size_t i = 0; i < sizeof(distance_kernels) / sizeof(distance_kernels[0]); i++) {
+        if ((distance_kernels[i].required & f) == distance_kernels[i].required) {
+            resolved.distance_rows = distance_kernels[i].cb;
+            break;
+        }
+    }
+    for (size_t i = 0; i < sizeof(encode_kernels) / sizeof(encode_kernels[0]); i++) {
+        if ((encode_kernels[i].required & f) == encode_kernels[i].required) {
+            resolved.encode = encode_kernels[i].cb;
+            break;
+        }
+    }
+}
+
+static const sign_kernels_t *sign_kernels(void) {
+    pthread_once(&resolve_once, resolve);
+    return &resolved;
+}
+
+void int8_sign_code(const int8_t *row, size_t dim, uint64_t *code) {
+    sign_kernels()->encode(row, dim, code);
+}
+
+uint32_t int8_sign_code_distance(const uint64_t *a, const uint64_t *b, size_t words) {
+    uint32_t d;
+    sign_kernels()->distance_rows(a, b, 1, words, &d);
+    return d;
+}
+
+/* ---- lifetime ------------------------------------------------------------ */
+
+static inline uint64_t *code_at(const int8_sign_codes_t *c, size_t id) {
+    return c->blocks[id >> BLOCK_SHIFT] + (id & (BLOCK_ROWS - 1)) * c->words;
+}
+
+int8_sign_codes_t *int8_sign_codes_init(int8_embedding_table_t *t,
+                                        embedding_thread_pool_t *pool) {
+    if (!t) return NULL;
+    int8_sign_codes_t *c = (int8_sign_codes_t *)calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->t = t;
+    c->dim = t->dim;
+    c->words = int8_sign_code_words(t->dim);
+    c->k = sign_kernels();
+    pthread_rwlock_init(&c->lock, NULL);
+    pthread_mutex_init(&c->sync_lock, NULL);
+    if (int8_sign_codes_sync(c, pool) != 0) {
+        int8_sign_codes_destroy(c);
+        return NULL;
+    }
+    return c;
+}
+
+void int8_sign_codes_destroy(int8_sign_codes_t *c) {
+    if (!c) return;
+    for (size_t i = 0; i < c->num_blocks; i++) free(c->blocks[i]);
+    free(c->blocks);
+    pthread_rwlock_destroy(&c->lock);
+    pthread_mutex_destroy(&c->sync_lock);
+    free(c);
+}
+
+size_t int8_sign_codes_size(const int8_sign_codes_t *c) {
+    if (!c) return 0;
+    int8_sign_codes_t *m = (int8_sign_codes_t *)c;
+    pthread_rwlock_rdlock(&m->lock);
+    size_t r = m->rows;
+    pthread_rwlock_unlock(&m->lock);
+    return r;
+}
+
+size_t int8_sign_codes_bytes_per_row(const int8_sign_codes_t *c) {
+    return c ? c->words * sizeof(uint64_t) : 0;
+}
+
+typedef struct {
+    int8_sign_codes_t *c;
+    size_t first;
+    size_t count;
+} encode_t;
+
+static void encode_part(void *arg, size_t part) {
+    encode_t *e = (encode_t *)arg;
+    int8_sign_codes_t *c = e->c;
+    size_t from = e->first + part * ENCODE_CHUNK;
+    size_t to = from + ENCODE_CHUNK < e->first + e->count ? from + ENCODE_CHUNK
+                                                          : e->first + e->count;
+    for (size_t id = from; id < to; id++) {
+        const int8_embedding_node_t *n = int8_embedding_table_node(c->t, id >> NODE_SHIFT);
+        c->k->encode(n->data + (id & (NODE_CAPACITY - 1)) * c->dim, c->dim, code_at(c, id));
+    }
+}
+
+/* Blocks beyond the encoded rows are only touched here, so rows are encoded
+ * outside the lock and published under it.
+ */
+int int8_sign_codes_sync(int8_sign_codes_t *c, embedding_thread_pool_t *pool) {
+    if (!c) return -1;
+    pthread_mutex_lock(&c->sync_lock);
+    size_t first = c->rows;
+    size_t end = int8_embedding_table_size(c->t);
+    int rc = 0;
+    size_t need = (end + BLOCK_ROWS - 1) >> BLOCK_SHIFT;
+    if (need > c->num_blocks) {
+        uint64_t **blocks = (uint64_t **)malloc(need * sizeof(*blocks));
+        size_t have = c->num_blocks;
+        if (blocks) {
+            if (have) memcpy(blocks, c->blocks, have * sizeof(*blocks));
+            for (; have < need; have++) {
+                blocks[have] = (uint64_t *)malloc((size_t)BLOCK_ROWS * c->words * sizeof(uint64_t));
+                if (!blocks[have]) break;
+            }
+        }
+        if (!blocks || have < need) {
+            if (blocks) {
+                for (size_t i = c->num_blocks; i < have; i++) free(blocks[i]);
+                free(blocks);
+            }
+            fprintf(stderr, "int8_sign_codes_sync: out of memory\n");
+            rc = -1;
+        } else {
+            pthread_rwlock_wrlock(&c->lock);
+            free(c->blocks);
+            c->blocks = blocks;
+            c->num_blocks = need;
+            pthread_rwlock_unlock(&c->lock);
+        }
+    }
+    if (rc == 0 && end > first) {
+        encode_t e = { c, first, end - first };
+        embedding_thread_pool_run(pool, encode_part, &e,
+                                  (end - first + ENCODE_CHUNK - 1) / ENCODE_CHUNK);
+        pthread_rwlock_wrlock(&c->lock);
+        c->rows = end;
+        pthread_rwlock_unlock(&c->lock);
+    }
+    pthread_mutex_unlock(&c->sync_lock);
+    return rc;
+}
+
+/* ---- search -------------------------------------------------------------- */
+
+typedef struct {
+    size_t *ids;        /* ascending */
+    uint32_t *dist;
+    size_t count;
+} candidates_t;
+
+typedef struct {
+    const int8_sign_codes_t *c;
+    const uint64_t *code;
+    size_t rows;
+    size_t rows_per_part;
+    size_t n;
+    int check_deleted;
+    candidates_t *parts;    /* room for 2 * n + SCAN_CHUNK each */
+    atomic_int failed;
+} scan_t;
+
+/* Cut cand down to its n nearest rows.  Distances are small integers, so a
+ * histogram finds the cut-off in one pass; rows at the cut-off distance are
+ * kept in id order, the smaller id winning a tie as in the topk heap.
+ * Returns the distance a later row must beat.  hist holds dim + 1 counters.
+ */
+static uint32_t keep_nearest(candidates_t *cand, size_t n, uint32_t *hist, size_t dim) {
+    memset(hist, 0, (dim + 1) * sizeof(*hist));
+    for (size_t i = 0; i < cand->count; i++) hist[cand->dist[i]]++;
+    uint32_t cut = 0;
+    size_t below = 0;
+    while (below + hist[cut] < n) below += hist[cut++];
+    size_t ties = n - below;
+    size_t kept = 0;
+    for (size_t i = 0; i < cand->count; i++) {
+        uint32_t d = cand->dist[i];
+        if (d > cut) continue;
+        if (d == cut) {
+            if (ties == 0) continue;
+            ties--;
+        }
+        cand->ids[kept] = cand->ids[i];
+        cand->dist[kept++] = d;
+    }
+    cand->count = kept;
+    return cut;
+}
+
+/* A heap push per row costs more than the popcounts once n is in the
+ * hundreds, so rows under the running cut-off are collected and the list is
+ * cut back to n whenever it reaches 2 * n.
+ */
+static void scan_part(void *arg, size_t part) {
+    scan_t *s = (scan_t *)arg;
+    const int8_sign_codes_t *c = s->c;
+    candidates_t *cand = &s->parts[part];
+    uint32_t *hist = (uint32_t *)malloc((c->dim + 1) * sizeof(*hist));
+    if (!hist) {
+        atomic_store(&s->failed, 1);
+        return;
+    }
+    uint32_t dist[SCAN_CHUNK];
+    uint32_t bound = UINT32_MAX;
+    size_t from = part * s->rows_per_part;
+    size_t to = from + s->rows_per_part < s->rows ? from + s->rows_per_part : s->rows;
+    for (size_t id = from; id < to;) {
+        /* parts start on a SCAN_CHUNK boundary, so a chunk never crosses a block */
+        size_t m = to - id < SCAN_CHUNK ? to - id : SCAN_CHUNK;
+        c->k->distance_rows(s->code, code_at(c, id), m, c->words, dist);
+        for (size_t i = 0; i < m; i++) {
+            if (dist[i] >= bound) continue;
+            if (s->check_deleted && int8_embedding_table_is_deleted(c->t, id + i)) continue;
+            cand->ids[cand->count] = id + i;
+            cand->dist[cand->count++] = dist[i];
+        }
+        if (cand->count >= 2 * s->n) bound = keep_nearest(cand, s->n, hist, c->dim);
+        id += m;
+    }
+    if (cand->count > s->n) keep_nearest(cand, s->n, hist, c->dim);
+    free(hist);
+}
+
+size_t int8_sign_codes_scan(int8_sign_codes_t *c, embedding_thread_pool_t *pool,
+                            const uint64_t *code, size_t n,
+                            size_t *out_ids, uint32_t *out_distances) {
+    if (!c || !code || !out_ids || n == 0) return 0;
+    pthread_rwlock_rdlock(&c->lock);
+    size_t rows = c->rows;
+    if (n > rows) n = rows;
+    size_t written = 0;
+    if (n > 0) {
+        /* a few parts per thread so a slow thread does not hold up the merge */
+        size_t chunks = (rows + SCAN_CHUNK - 1) / SCAN_CHUNK;
+        size_t parts = embedding_thread_pool_size(pool) * 4;
+        if (parts == 0) parts = 1;
+        if (parts > chunks) parts = chunks;
+        size_t rows_per_part = (chunks + parts - 1) / parts * SCAN_CHUNK;
+        parts = (rows + rows_per_part - 1) / rows_per_part;
+
+        size_t room = 2 * n + SCAN_CHUNK;
+        scan_t s = { c, code, rows, rows_per_part, n,
+                     int8_embedding_table_num_deleted(c->t) != 0, NULL, 0 };
+        size_t *ids = (size_t *)malloc(parts * room * sizeof(*ids));
+        uint32_t *dist = (uint32_t *)malloc(parts * room * sizeof(*dist));
+        uint32_t *hist = (uint32_t *)malloc((c->dim + 1) * sizeof(*hist));
+        s.parts = (candidates_t *)malloc(parts * sizeof(*s.parts));
+        if (ids && dist && hist && s.parts) {
+            for (size_t p = 0; p < parts; p++)
+                s.parts[p] = (candidates_t){ ids + p * room, dist + p * room, 0 };
+            embedding_thread_pool_run(pool, scan_part, &s, parts);
+        } else {
+            atomic_store(&s.failed, 1);
+        }
+        if (!atomic_load(&s.failed)) {
+            /* parts cover ascending id ranges, so packed together they stay in
+             * id order and one more cut gives the n nearest overall
+             */
+            candidates_t all = { ids, dist, 0 };
+            for (size_t p = 0; p < parts; p++) {
+                memmove(ids + all.count, s.parts[p].ids, s.parts[p].count * sizeof(*ids));
+                memmove(dist + all.count, s.parts[p].dist, s.parts[p].count * sizeof(*dist));
+                all.count += s.parts[p].count;
+            }
+            if (all.count > n) keep_nearest(&all, n, hist, c->dim);
+            /* counting sort by distance; stable, so ties stay in id order */
+            memset(hist, 0, (c->dim + 1) * sizeof(*hist));
+            for (size_t i = 0; i < all.count; i++) hist[all.dist[i]]++;
+            uint32_t at = 0;
+            for (size_t d = 0; d <= c->dim; d++) {
+                uint32_t h = hist[d];
+                hist[d] = at;
+                at += h;
+            }
+            for (size_t i = 0; i < all.count; i++) {
+                uint32_t pos = hist[all.dist[i]]++;
+                out_ids[pos] = all.ids[i];
+                if (out_distances) out_distances[pos] = all.dist[i];
+            }
+            written = all.count;
+        }
+        free(ids);
+        free(dist);
+        free(hist);
+        free(s.parts);
+    }
+    pthread_rwlock_unlock(&c->lock);
+    return written;
+}
+
+static int cmp_ids(const void *a, const void *b) {
+    size_t x = *(const size_t *)a, y = *(const size_t *)b;
+    return (x > y) - (x < y);
+}
+
+size_t int8_sign_codes_topk(int8_sign_codes_t *c, embedding_thread_pool_t *pool,
+                            const int8_t *query, double query_norm,
+                            size_t k, size_t oversample,
+                            size_t *out_ids, double *out_scores,
+                            embedding_rerank_stats_t *stats) {
+    if (stats) memset(stats, 0, sizeof(*stats));
+    if (!c || !query || k == 0) return 0;
+    size_t dim = c->dim;
+    if (query_norm < 0.0) {
+        int32_t dp = int8_dot_product_dispatch(query, query, dim);
+        query_norm = dp > 0 ? sqrt((double)dp) : 0.0;
+    }
+    if (query_norm == 0.0) return 0;
+    if (oversample == 0) oversample = INT8_SIGN_CODES_DEFAULT_OVERSAMPLE;
+    size_t n = k > SIZE_MAX / oversample ? SIZE_MAX : k * oversample;
+    size_t rows = int8_sign_codes_size(c);
+    if (n > rows) n = rows;
+    if (n == 0) return 0;
+
+    uint64_t t0 = now_ns();
+    uint64_t *code = (uint64_t *)malloc(c->words * sizeof(*code));
+    size_t *ids = (size_t *)malloc(n * sizeof(*ids));
+    embedding_topk_entry_t *storage = (embedding_topk_entry_t *)malloc(k * sizeof(*storage));
+    if (!code || !ids || !storage) {
+        free(code);
+        free(ids);
+        free(storage);
+        return 0;
+    }
+    c->k->encode(query, dim, code);
+    size_t count = int8_sign_codes_scan(c, pool, code, n, ids, NULL);
+    /* re-score in id order, so a mapped table is read front to back */
+    qsort(ids, count, sizeof(*ids), cmp_ids);
+    uint64_t t1 = now_ns();
+
+    embedding_int8_dot_product_cb dot = embedding_kernels()->int8_dot_product;
+    embedding_topk_t h;
+    embedding_topk_init(&h, storage, k);
+    double inv_q = 1.0 / query_norm;
+    for (size_t i = 0; i < count; i++) {
+        const int8_embedding_node_t *node = int8_embedding_table_node(c->t, ids[i] >> NODE_SHIFT);
+        size_t slot = ids[i] & (NODE_CAPACITY - 1);
+        double d = (double)dot(query, node->data + slot * dim, dim);
+        double score = node->norms ? d / (query_norm * node->norms[slot])
+                                   : d * (inv_q * node->inv_norms[slot]);
+        if (embedding_topk_accepts(&h, score)) embedding_topk_push(&h, score, ids[i]);
+    }
+    size_t written = embedding_topk_drain(&h, out_ids, out_scores);
+    if (stats) {
+        stats->candidates = count;
+        stats->scan_ns = t1 - t0;
+        stats->rerank_ns = now_ns() - t1;
+    }
+    free(code);
+    free(ids);
+    free(storage);
+    return written;
+}
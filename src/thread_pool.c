@@ -0,0 +1,255 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE     /* pthread_setaffinity_np */
+#endif
+#include "embedding-library/thread_pool.h"
+#include "embedding-library/embedding_memory.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+    pthread_t thread;
+    embedding_thread_pool_t *pool;
+    size_t home;                   /* NUMA node the worker runs on (0 if unpinned) */
+} worker_t;
+
+struct embedding_thread_pool_s {
+    worker_t *workers;
+    size_t num_threads;            /* spawned workers (excludes the caller) */
+
+    pthread_mutex_t run_lock;      /* serializes embedding_thread_pool_run */
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+    pthread_cond_t  done;
+
+    /* current run, published under lock */
+    embedding_thread_pool_cb cb;
+    void *arg;
+    size_t num_tasks;
+    atomic_size_t next_task;
+    size_t num_groups;             /* 0 unless started by run_grouped() */
+    const size_t *group_tasks;
+    atomic_size_t *group_next;     /* per-group cursors of a grouped run */
+    size_t num_nodes;              /* NUMA nodes the workers are spread over */
+    size_t active;                 /* workers still inside the current run */
+    unsigned long generation;
+    int shutdown;
+};
+
+/* drain group g's tasks; first is the id of its first task */
+static void run_group(embedding_thread_pool_t *p, size_t g, size_t first) {
+    for (;;) {
+        size_t task = atomic_fetch_add_explicit(&p->group_next[g], 1, memory_order_relaxed);
+        if (task >= p->group_tasks[g]) break;
+        p->cb(p->arg, first + task);
+    }
+}
+
+static void run_tasks(embedding_thread_pool_t *p, size_t home) {
+    if (p->num_groups) {
+        /* the groups local to this thread's node first, then help the others */
+        for (int pass = 0; pass < 2; pass++) {
+            size_t first = 0;
+            for (size_t g = 0; g < p->num_groups; g++) {
+                if ((g % p->num_nodes == home) == (pass == 0)) run_group(p, g, first);
+                first += p->group_tasks[g];
+            }
+        }
+        return;
+    }
+    for (;;) {
+        size_t task = atomic_fetch_add_explicit(&p->next_task, 1, memory_order_relaxed);
+        if (task >= p->num_tasks) break;
+        p->cb(p->arg, task);
+    }
+}
+
+static void *worker_main(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    embedding_thread_pool_t *p = w->pool;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&p->lock);
+    for (;;) {
+        while (!p->shutdown && p->generation == seen)
+            pthread_cond_wait(&p->wake, &p->lock);
+        if (p->shutdown) break;
+        seen = p->generation;
+        pthread_mutex_unlock(&p->lock);
+
+        run_tasks(p, w->home);
+
+        pthread_mutex_lock(&p->lock);
+        if (--p->active == 0) pthread_cond_signal(&p->done);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+/* Pin the calling thread to the CPUs of NUMA node `node`; best effort. */
+static void pin_to_node(size_t node) {
+#if defined(__linux__)
+    int cpus[CPU_SETSIZE];
+    size_t n = embedding_numa_node_cpus(node, cpus, CPU_SETSIZE);
+    if (n == 0) return;
+    if (n > CPU_SETSIZE) n = CPU_SETSIZE;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < n; i++) CPU_SET(cpus[i], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)node;
+#endif
+}
+
+static void *numa_worker_main(void *arg) {
+    pin_to_node(((worker_t *)arg)->home);
+    return worker_main(arg);
+}
+
+static embedding_thread_pool_t *pool_init(size_t num_threads, size_t num_nodes) {
+    if (num_threads == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = (n > 0) ? (size_t)n : 1;
+    }
+
+    embedding_thread_pool_t *p = (embedding_thread_pool_t *)calloc(1, sizeof(*p));
+    if (!p) return NULL;
+
+    pthread_mutex_init(&p->run_lock, NULL);
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wake, NULL);
+    pthread_cond_init(&p->done, NULL);
+    atomic_init(&p->next_task, 0);
+    p->num_nodes = num_nodes;
+
+    if (num_threads > 1) {
+        p->workers = (worker_t *)calloc(num_threads - 1, sizeof(*p->workers));
+        if (!p->workers) {
+            embedding_thread_pool_destroy(p);
+            return NULL;
+        }
+        for (size_t i = 0; i < num_threads - 1; i++) {
+            worker_t *w = &p->workers[i];
+            w->pool = p;
+            /* the caller stands in for node 0, so worker i takes node i + 1 */
+            w->home = (i + 1) % num_nodes;
+            int err = pthread_create(&w->thread, NULL,
+                                     num_nodes > 1 ? numa_worker_main : worker_main, w);
+            if (err != 0) {
+                fprintf(stderr, "embedding_thread_pool_init: started %zu of %zu threads: %s\n",
+                        p->num_threads + 1, num_threads, strerror(err));
+                embedding_thread_pool_destroy(p);
+                return NULL;
+            }
+            p->num_threads++;
+        }
+    }
+    return p;
+}
+
+embedding_thread_pool_t *embedding_thread_pool_init(size_t num_threads) {
+    return pool_init(num_threads, 1);
+}
+
+embedding_thread_pool_t *embedding_thread_pool_init_numa(size_t num_threads) {
+    return pool_init(num_threads, embedding_numa_nodes());
+}
+
+void embedding_thread_pool_destroy(embedding_thread_pool_t *p) {
+    if (!p) return;
+
+    pthread_mutex_lock(&p->lock);
+    p->shutdown = 1;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+
+    for (size_t i = 0; i < p->num_threads; i++)
+        pthread_join(p->workers[i].thread, NULL);
+
+    pthread_cond_destroy(&p->done);
+    pthread_cond_destroy(&p->wake);
+    pthread_mutex_destroy(&p->lock);
+    pthread_mutex_destroy(&p->run_lock);
+    free(p->workers);
+    free(p);
+}
+
+size_t embedding_thread_pool_size(const embedding_thread_pool_t *p) {
+    return p ? p->num_threads + 1 : 1;
+}
+
+size_t embedding_thread_pool_numa_nodes(const embedding_thread_pool_t *p) {
+    return p ? p->num_nodes : 1;
+}
+
+/* publish a run to the workers, take part in it and wait for it to finish */
+static void run_start(embedding_thread_pool_t *p) {
+    pthread_mutex_lock(&p->lock);
+    atomic_store_explicit(&p->next_task, 0, memory_order_relaxed);
+    p->active = p->num_threads;
+    p->generation++;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+
+    run_tasks(p, 0);
+
+    pthread_mutex_lock(&p->lock);
+    while (p->active > 0)
+        pthread_cond_wait(&p->done, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+}
+
+void embedding_thread_pool_run(embedding_thread_pool_t *p,
+                               embedding_thread_pool_cb cb, void *arg,
+                               size_t num_tasks) {
+    if (num_tasks == 0) return;
+    if (!p || p->num_threads == 0 || num_tasks == 1) {
+        for (size_t i = 0; i < num_tasks; i++) cb(arg, i);
+        return;
+    }
+
+    pthread_mutex_lock(&p->run_lock);
+    p->cb = cb;
+    p->arg = arg;
+    p->num_tasks = num_tasks;
+    p->num_groups = 0;
+    run_start(p);
+    pthread_mutex_unlock(&p->run_lock);
+}
+
+void embedding_thread_pool_run_grouped(embedding_thread_pool_t *p,
+                                       embedding_thread_pool_cb cb, void *arg,
+                                       const size_t *group_tasks, size_t num_groups) {
+    size_t num_tasks = 0;
+    for (size_t g = 0; g < num_groups; g++) num_tasks += group_tasks[g];
+    atomic_size_t *next = NULL;
+    if (p && p->num_threads && num_tasks > 1)
+        next = (atomic_size_t *)malloc(num_groups * sizeof(*next));
+    if (!next) {
+        /* serial (or out of memory): the plain run gives the same results */
+        embedding_thread_pool_run(p, cb, arg, num_tasks);
+        return;
+    }
+    for (size_t g = 0; g < num_groups; g++) atomic_init(&next[g], 0);
+
+    pthread_mutex_lock(&p->run_lock);
+    p->cb = cb;
+    p->arg = arg;
+    p->num_tasks = num_tasks;
+    p->num_groups = num_groups;
+    p->group_tasks = group_tasks;
+    p->group_next = next;
+    run_start(p);
+    p->num_groups = 0;
+    pthread_mutex_unlock(&p->run_lock);
+    free(next);
+}
@@ -0,0 +1,132 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Lock-free readers of an int8 table racing its writer.
+ *
+ * One thread appends rows (single adds and float batches, onto a heap table
+ * and onto a mapped one) while two readers keep checking that the row count
+ * never goes back, that every published row holds what was written, and
+ * that topk / topk_parallel find a published row as its own best match.
+ */
+
+#include "embedding-library/int8_embedding_table.h"
+#include "embedding-library/thread_pool.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIM 64
+#define ROWS 6000
+#define BATCH 500
+#define FILENAME "test_concurrent_reads.tbl"
+
+static int8_embedding_table_t *table;
+static atomic_int done;
+static atomic_int failures;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s (%s:%d)\n", #cond, __FILE__, __LINE__);         \
+            atomic_fetch_add(&failures, 1);                                 \
+        }                                                                   \
+    } while (0)
+
+/* row i: pseudo-random, with one element at 127 so float ingest keeps it */
+static void make_row(size_t i, int8_t *row) {
+    uint32_t x = (uint32_t)i * 2654435761u + 1u;
+    for (size_t d = 0; d < DIM; d++) {
+        x = x * 1103515245u + 12345u;
+        row[d] = (int8_t)((int)((x >> 16) % 255u) - 127);
+    }
+    row[i % DIM] = 127;
+}
+
+static void *reader(void *arg) {
+    (void)arg;
+    embedding_thread_pool_t *pool = embedding_thread_pool_init(3);
+    size_t last = 0, scans = 0;
+    int8_t row[DIM];
+    while (!atomic_load(&done) || scans < 8) {
+        size_t n = int8_embedding_table_size(table);
+        CHECK(n >= last);
+        last = n;
+        if (n == 0) continue;
+
+        size_t q = (scans * 7919u) % n;
+        make_row(q, row);
+        const int8_t *stored = int8_embedding_table_embedding(table, q);
+        CHECK(stored && !memcmp(stored, row, DIM));
+
+        size_t id;
+        double score;
+        size_t found = scans & 1
+            ? int8_embedding_table_topk_parallel(table, pool, row, -1.0, 1, &id, &score)
+            : int8_embedding_table_topk(table, row, -1.0, 1, &id, &score);
+        CHECK(found == 1 && score > 0.9999);
+        scans++;
+    }
+    embedding_thread_pool_destroy(pool);
+    return NULL;
+}
+
+static void write_rows(size_t from, int batches) {
+    int8_t row[DIM];
+    float *floats = (float *)malloc(BATCH * DIM * sizeof(float));
+    for (size_t i = from; i < ROWS;) {
+        if (batches && (i / BATCH) % 2) {
+            size_t n = ROWS - i < BATCH ? ROWS - i : BATCH;
+            for (size_t r = 0; r < n; r++) {
+                make_row(i + r, row);
+                for (size_t d = 0; d < DIM; d++) floats[r * DIM + d] = row[d];
+            }
+            CHECK(int8_embedding_table_add_floats_batch(table, floats, n) == (ssize_t)i);
+            i += n;
+        } else {
+            make_row(i, row);
+            CHECK(int8_embedding_table_add_embedding(table, row, -1.0) == (ssize_t)i);
+            i++;
+        }
+    }
+    free(floats);
+}
+
+static void race(int batches) {
+    size_t start = int8_embedding_table_size(table);
+    pthread_t readers[2];
+    atomic_store(&done, 0);
+    for (int i = 0; i < 2; i++) pthread_create(&readers[i], NULL, reader, NULL);
+    write_rows(start, batches);
+    atomic_store(&done, 1);
+    for (int i = 0; i < 2; i++) pthread_join(readers[i], NULL);
+    CHECK(int8_embedding_table_size(table) == ROWS);
+    int8_embedding_table_destroy(table);
+}
+
+int main(void) {
+    /* heap table, single adds and float batches */
+    table = int8_embedding_table_init_dim(DIM, 0);
+    race(1);
+
+    /* a mapped table with a partial last node, then appends onto it */
+    int8_embedding_table_t *t = int8_embedding_table_init_dim(DIM, 0);
+    int8_t row[DIM];
+    for (size_t i = 0; i < 700; i++) {
+        make_row(i, row);
+        int8_embedding_table_add_embedding(t, row, -1.0);
+    }
+    remove(FILENAME);
+    int8_embedding_table_serialize(t, FILENAME);
+    int8_embedding_table_destroy(t);
+    table = int8_embedding_table_mmap(FILENAME, 0);
+    CHECK(table != NULL);
+    if (table) race(0);
+    remove(FILENAME);
+
+    int n = atomic_load(&failures);
+    printf("%s\n", n ? "FAILED" : "ok");
+    return n ? 1 : 0;
+}
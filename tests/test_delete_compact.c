@@ -0,0 +1,275 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Row deletion, update and compaction of int8 tables: every scan skips
+ * deleted rows, tombstones survive serialize / deserialize / mmap, and a
+ * compacted table (one shot or stepped while rows are added and deleted)
+ * holds exactly the live rows at the ids its remap gives.
+ */
+
+#include "embedding-library/int8_embedding_table.h"
+#include "embedding-library/thread_pool.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIM 128
+#define ROWS 5000
+#define FILENAME "test_delete_compact.tbl"
+#define FILENAME2 "test_delete_compact2.tbl"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s (%s:%d)\n", #cond, __FILE__, __LINE__);         \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static void make_row(size_t i, int8_t *row) {
+    uint32_t x = (uint32_t)i * 2654435761u + 1u;
+    for (size_t d = 0; d < DIM; d++) {
+        x = x * 1103515245u + 12345u;
+        row[d] = (int8_t)((int)((x >> 16) % 255u) - 127);
+    }
+    row[0] = 127;
+}
+
+/* best live row for q by a plain loop */
+static size_t reference_top(int8_embedding_table_t *t, const int8_t *q) {
+    size_t rows = int8_embedding_table_size(t), best_id = (size_t)-1;
+    double qn = sqrt((double)int8_embedding_table_dot(q, q, DIM)), best = -2.0;
+    for (size_t i = 0; i < rows; i++) {
+        if (int8_embedding_table_is_deleted(t, i)) continue;
+        double s = int8_embedding_table_dot(q, int8_embedding_table_embedding(t, i), DIM) /
+                   (qn * int8_embedding_table_norm(t, i));
+        if (s > best) {
+            best = s;
+            best_id = i;
+        }
+    }
+    return best_id;
+}
+
+/* every scan agrees with the reference and returns no deleted row */
+static void check_scans(int8_embedding_table_t *t, embedding_thread_pool_t *pool) {
+    int8_t q[4 * DIM];
+    for (size_t k = 0; k < 4; k++) make_row(7777 + k * 13, q + k * DIM);
+    for (size_t k = 0; k < 4; k++) {
+        size_t ids[10], ids2[10];
+        double scores[10], scores2[10];
+        size_t n = int8_embedding_table_topk(t, q + k * DIM, -1.0, 10, ids, scores);
+        CHECK(n > 0 && ids[0] == reference_top(t, q + k * DIM));
+        for (size_t j = 0; j < n; j++) CHECK(!int8_embedding_table_is_deleted(t, ids[j]));
+        size_t n2 = int8_embedding_table_topk_parallel(t, pool, q + k * DIM, -1.0, 10, ids2,
+                                                       scores2);
+        CHECK(n2 == n && !memcmp(ids, ids2, n * sizeof(size_t)));
+
+        float fq[DIM];
+        for (size_t d = 0; d < DIM; d++) fq[d] = q[k * DIM + d];
+        n = int8_embedding_table_topk_ip(t, fq, 10, ids, scores);
+        for (size_t j = 0; j < n; j++) CHECK(!int8_embedding_table_is_deleted(t, ids[j]));
+        n2 = int8_embedding_table_topk_ip_parallel(t, pool, fq, 10, ids2, scores2);
+        CHECK(n2 == n && !memcmp(ids, ids2, n * sizeof(size_t)));
+    }
+    size_t batch_ids[40];
+    double batch_scores[40];
+    size_t kb = int8_embedding_table_topk_batch(t, q, NULL, 4, 10, batch_ids, batch_scores);
+    for (size_t k = 0; k < 4; k++) {
+        size_t ids[10];
+        size_t n = int8_embedding_table_topk(t, q + k * DIM, -1.0, 10, ids, NULL);
+        CHECK(kb >= n && !memcmp(ids, batch_ids + k * 10, n * sizeof(size_t)));
+    }
+}
+
+/* c holds the live rows of t at remap[id], and nothing at deleted ids */
+static void check_remap(int8_embedding_table_t *t, int8_embedding_table_t *c,
+                        const size_t *remap) {
+    size_t live = int8_embedding_table_size(t) - int8_embedding_table_num_deleted(t);
+    CHECK(int8_embedding_table_size(c) - int8_embedding_table_num_deleted(c) == live);
+    for (size_t i = 0; i < int8_embedding_table_size(t); i++) {
+        if (int8_embedding_table_is_deleted(t, i)) {
+            CHECK(remap[i] == (size_t)-1);
+            continue;
+        }
+        CHECK(remap[i] < int8_embedding_table_size(c));
+        CHECK(!int8_embedding_table_is_deleted(c, remap[i]));
+        CHECK(!memcmp(int8_embedding_table_embedding(c, remap[i]),
+                      int8_embedding_table_embedding(t, i), DIM));
+        CHECK(int8_embedding_table_norm(c, remap[i]) == int8_embedding_table_norm(t, i));
+    }
+}
+
+static void test_delete_and_update(int8_embedding_table_t *t, embedding_thread_pool_t *pool) {
+    int8_t row[DIM];
+    size_t id;
+    double score;
+    for (size_t i = 0; i < ROWS; i += 3) CHECK(int8_embedding_table_delete(t, i) == 0);
+    CHECK(int8_embedding_table_delete(t, 3) == -1);
+    CHECK(int8_embedding_table_delete(t, ROWS) == -1);
+    for (size_t i = 1024; i < 1536; i++) int8_embedding_table_delete(t, i);   /* a whole node */
+    CHECK(int8_embedding_table_num_deleted(t) == (ROWS + 2) / 3 + 512 - 170);
+
+    make_row(9, row);
+    int8_embedding_table_topk(t, row, -1.0, 1, &id, &score);
+    CHECK(id != 9);
+    make_row(10, row);
+    int8_embedding_table_topk(t, row, -1.0, 1, &id, &score);
+    CHECK(id == 10);
+    check_scans(t, pool);
+
+    make_row(123456, row);
+    CHECK(int8_embedding_table_update(t, 10, row, -1.0, 1.0f) == ROWS);
+    CHECK(int8_embedding_table_is_deleted(t, 10));
+    CHECK(int8_embedding_table_update(t, 10, row, -1.0, 1.0f) == -1);
+    int8_embedding_table_topk(t, row, -1.0, 1, &id, &score);
+    CHECK(id == ROWS);
+}
+
+static void test_files(int8_embedding_table_t *t, embedding_thread_pool_t *pool) {
+    size_t deleted = int8_embedding_table_num_deleted(t);
+    remove(FILENAME);
+    int8_embedding_table_serialize(t, FILENAME);
+    CHECK(int8_embedding_table_verify(FILENAME, pool) == 0);
+    int8_embedding_table_t *loaded = int8_embedding_table_deserialize(FILENAME);
+    int8_embedding_table_t *mapped = int8_embedding_table_mmap(FILENAME, 0);
+    CHECK(loaded && mapped);
+    if (!loaded || !mapped) return;
+    CHECK(int8_embedding_table_num_deleted(loaded) == deleted);
+    CHECK(int8_embedding_table_num_deleted(mapped) == deleted);
+    for (size_t i = 0; i < int8_embedding_table_size(t); i++) {
+        CHECK(int8_embedding_table_is_deleted(loaded, i) == int8_embedding_table_is_deleted(t, i));
+        CHECK(int8_embedding_table_is_deleted(mapped, i) == int8_embedding_table_is_deleted(t, i));
+    }
+    check_scans(mapped, pool);
+
+    /* delete in the mapped table, append, serialize it twice elsewhere */
+    int8_t row[DIM];
+    CHECK(int8_embedding_table_delete(mapped, 1) == 0);
+    make_row(42, row);
+    int8_embedding_table_add_embedding(mapped, row, -1.0);
+    remove(FILENAME2);
+    int8_embedding_table_serialize(mapped, FILENAME2);
+    int8_embedding_table_serialize(mapped, FILENAME2);
+    int8_embedding_table_t *again = int8_embedding_table_deserialize(FILENAME2);
+    CHECK(again && int8_embedding_table_is_deleted(again, 1) &&
+          int8_embedding_table_num_deleted(again) == deleted + 1);
+    int8_embedding_table_destroy(again);
+    int8_embedding_table_destroy(mapped);
+    int8_embedding_table_destroy(loaded);
+
+    /* a damaged deleted section is rejected */
+    FILE *f = fopen(FILENAME, "r+b");
+    fseek(f, -8, SEEK_END);
+    fputc(0x55, f);
+    fclose(f);
+    CHECK(int8_embedding_table_verify(FILENAME, NULL) != 0);
+    CHECK(int8_embedding_table_deserialize(FILENAME) == NULL);
+    remove(FILENAME);
+    remove(FILENAME2);
+}
+
+static void test_compact(int8_embedding_table_t *t) {
+    size_t *remap = NULL;
+    int8_embedding_table_t *c = int8_embedding_table_compact(t, &remap);
+    CHECK(c && remap);
+    if (!c || !remap) return;
+    CHECK(int8_embedding_table_num_deleted(c) == 0);
+    check_remap(t, c, remap);
+    int8_t q[DIM];
+    make_row(555, q);
+    size_t a, b;
+    double sa, sb;
+    int8_embedding_table_topk(t, q, -1.0, 1, &a, &sa);
+    int8_embedding_table_topk(c, q, -1.0, 1, &b, &sb);
+    CHECK(remap[a] == b && sa == sb);
+    free(remap);
+    int8_embedding_table_destroy(c);
+
+    /* stepped, with deletes and appends between steps and before finish() */
+    int8_embedding_table_compaction_t *cp = int8_embedding_table_compact_begin(t);
+    int8_t row[DIM];
+    int steps = 0, r;
+    while ((r = int8_embedding_table_compact_step(cp, 2)) == 0) {
+        steps++;
+        int8_embedding_table_delete(t, steps * 500 + 2);
+        make_row(900000 + steps, row);
+        int8_embedding_table_add_embedding(t, row, -1.0);
+    }
+    CHECK(r == 1 && steps > 0);
+    int8_embedding_table_delete(t, ROWS + 3);
+    int8_embedding_table_delete(t, 2);
+    c = int8_embedding_table_compact_finish(cp, &remap);
+    CHECK(c);
+    if (c) check_remap(t, c, remap);
+    free(remap);
+    int8_embedding_table_destroy(c);
+}
+
+static void test_compact_layouts(void) {
+    int8_embedding_table_t *s = int8_embedding_table_init_layout(
+        DIM, 0, EMBEDDING_TABLE_LAYOUT_ROW_SCALES | EMBEDDING_TABLE_LAYOUT_INV_NORMS);
+    float *floats = (float *)malloc(3000 * DIM * sizeof(float));
+    for (size_t i = 0; i < 3000 * DIM; i++) floats[i] = (float)((i * 7919) % 201) - 99.5f;
+    int8_embedding_table_add_floats_batch(s, floats, 3000);
+    for (size_t i = 0; i < 3000; i += 2) int8_embedding_table_delete(s, i);
+
+    size_t *remap;
+    int8_embedding_table_t *c = int8_embedding_table_compact(s, &remap);
+    CHECK(c && int8_embedding_table_size(c) == 1500);
+    for (size_t i = 1; c && i < 3000; i += 2) {
+        CHECK(int8_embedding_table_scale(c, remap[i]) == int8_embedding_table_scale(s, i));
+        CHECK(int8_embedding_table_node(c, remap[i] >> 9)->inv_norms[remap[i] & 511] ==
+              int8_embedding_table_node(s, i >> 9)->inv_norms[i & 511]);
+    }
+    size_t a, b;
+    double sa, sb;
+    int8_embedding_table_topk_ip(s, floats + 7 * DIM, 1, &a, &sa);
+    int8_embedding_table_topk_ip(c, floats + 7 * DIM, 1, &b, &sb);
+    CHECK(remap[a] == b && fabs(sa - sb) < 1e-9);
+    free(remap);
+    free(floats);
+    int8_embedding_table_destroy(c);
+    int8_embedding_table_destroy(s);
+}
+
+static void test_compact_empty(void) {
+    int8_embedding_table_t *t = int8_embedding_table_init_dim(DIM, 0);
+    size_t *remap = NULL;
+    int8_embedding_table_t *c = int8_embedding_table_compact(t, &remap);
+    CHECK(c && remap && int8_embedding_table_size(c) == 0);
+    free(remap);
+    int8_embedding_table_destroy(c);
+
+    remap = NULL;
+    c = int8_embedding_table_compact_finish(int8_embedding_table_compact_begin(t), &remap);
+    CHECK(c && remap);
+    free(remap);
+    int8_embedding_table_destroy(c);
+    int8_embedding_table_destroy(t);
+}
+
+int main(void) {
+    embedding_thread_pool_t *pool = embedding_thread_pool_init(4);
+    int8_embedding_table_t *t = int8_embedding_table_init_dim(DIM, 0);
+    int8_t row[DIM];
+    for (size_t i = 0; i < ROWS; i++) {
+        make_row(i, row);
+        int8_embedding_table_add_embedding(t, row, -1.0);
+    }
+
+    test_delete_and_update(t, pool);
+    test_files(t, pool);
+    test_compact(t);
+    test_compact_layouts();
+    test_compact_empty();
+
+    int8_embedding_table_destroy(t);
+    embedding_thread_pool_destroy(pool);
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Filtered scans of int8 tables: bitmaps set, clear, count and combine like
+ * plain sets, and int8_embedding_table_topk_filtered() (serial and parallel)
+ * returns exactly the ids and scores of the full ranking with the rows the
+ * filter rejects (bitmap, predicate, deleted) taken out.
+ */
+
+#include "embedding-library/int8_embedding_table.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIM 64
+#define ROWS 5000
+#define QUERIES 20
+#define K 10
+
+static float floats[ROWS * DIM];
+static int8_t queries[QUERIES * DIM];
+static size_t all_ids[ROWS];
+static double all_scores[ROWS];
+
+static int not_third(void *arg, size_t id) {
+    (void)arg;
+    return id % 3 != 0;
+}
+
+static void check_bitmap(void) {
+    embedding_bitmap_t *a = embedding_bitmap_init(), *b = embedding_bitmap_init();
+    CHECK(a && b);
+    if (!a || !b) return;
+    CHECK(embedding_bitmap_count(a) == 0);
+    CHECK(!embedding_bitmap_test(a, 5) && !embedding_bitmap_test(a, (size_t)1 << 30));
+    for (size_t i = 0; i < 5000; i += 2) CHECK(embedding_bitmap_set(a, i) == 0);
+    for (size_t i = 0; i < 5000; i += 3) CHECK(embedding_bitmap_set(b, i) == 0);
+    embedding_bitmap_set(a, 2);  /* already set: counted once */
+    CHECK(embedding_bitmap_count(a) == 2500);
+    embedding_bitmap_set(b, 100000);
+
+    embedding_bitmap_t *x = embedding_bitmap_and(a, b), *y = embedding_bitmap_or(a, b);
+    CHECK(x && y);
+    if (x && y) {
+        size_t nx = 0, ny = 0;
+        for (size_t i = 0; i <= 100000; i++) {
+            int p = embedding_bitmap_test(a, i), r = embedding_bitmap_test(b, i);
+            CHECK(embedding_bitmap_test(x, i) == (p && r));
+            CHECK(embedding_bitmap_test(y, i) == (p || r));
+            nx += p && r;
+            ny += p || r;
+        }
+        CHECK(embedding_bitmap_count(x) == nx && embedding_bitmap_count(y) == ny);
+    }
+
+    /* clearing twice, or a row never set, changes nothing more */
+    embedding_bitmap_clear(a, 4);
+    embedding_bitmap_clear(a, 4);
+    embedding_bitmap_clear(a, 99999999);
+    CHECK(!embedding_bitmap_test(a, 4) && embedding_bitmap_count(a) == 2499);
+
+    embedding_bitmap_destroy(y);
+    embedding_bitmap_destroy(x);
+    embedding_bitmap_destroy(b);
+    embedding_bitmap_destroy(a);
+}
+
+/* the top k of the full ranking that f lets through */
+static size_t reference(int8_embedding_table_t *t, const int8_t *query,
+                        const embedding_filter_t *f, size_t *ids, double *scores) {
+    size_t n = int8_embedding_table_topk(t, query, -1.0, ROWS, all_ids, all_scores), found = 0;
+    for (size_t i = 0; i < n && found < K; i++) {
+        if (f->rows && !embedding_bitmap_test(f->rows, all_ids[i])) continue;
+        if (f->match && !f->match(f->arg, all_ids[i])) continue;
+        ids[found] = all_ids[i];
+        scores[found++] = all_scores[i];
+    }
+    return found;
+}
+
+/* both filtered scans give the reference ids and scores for every query */
+static void check_filter(int8_embedding_table_t *t, const embedding_filter_t *f,
+                         embedding_thread_pool_t *pool) {
+    for (size_t q = 0; q < QUERIES; q++) {
+        const int8_t *query = queries + q * DIM;
+        size_t ids[K], want[K];
+        double scores[K], want_scores[K];
+        size_t m = reference(t, query, f, want, want_scores);
+        size_t n = int8_embedding_table_topk_filtered(t, query, -1.0, f, K, ids, scores);
+        CHECK(n == m && !memcmp(ids, want, n * sizeof(*ids)) &&
+              !memcmp(scores, want_scores, n * sizeof(*scores)));
+        n = int8_embedding_table_topk_filtered_parallel(t, pool, query, -1.0, f, K, ids, scores);
+        CHECK(n == m && !memcmp(ids, want, n * sizeof(*ids)) &&
+              !memcmp(scores, want_scores, n * sizeof(*scores)));
+    }
+}
+
+static void check_scans(uint32_t layout, embedding_thread_pool_t *pool) {
+    int8_embedding_table_t *t = int8_embedding_table_init_layout(DIM, 0, layout);
+    int8_embedding_table_add_floats_batch(t, floats, ROWS);
+
+    /* scattered rows, and whole nodes with the others left out */
+    static const double shares[] = { 0.002, 0.05, 0.5, 1.0 };
+    for (size_t s = 0; s < sizeof(shares) / sizeof(shares[0]); s++) {
+        embedding_bitmap_t *scattered = embedding_bitmap_init(), *nodes = embedding_bitmap_init();
+        for (size_t i = 0; i < ROWS; i++) {
+            if (uniform() < shares[s]) embedding_bitmap_set(scattered, i);
+            if ((i / 512) % 3 == s % 3) embedding_bitmap_set(nodes, i);
+        }
+        embedding_filter_t f = { scattered, NULL, NULL };
+        check_filter(t, &f, pool);
+        f.rows = nodes;
+        check_filter(t, &f, pool);
+        embedding_bitmap_destroy(nodes);
+        embedding_bitmap_destroy(scattered);
+    }
+
+    /* bitmap and predicate, predicate alone and no filter, with rows deleted */
+    embedding_bitmap_t *m = embedding_bitmap_init();
+    for (size_t i = 0; i < ROWS; i += 7) embedding_bitmap_set(m, i);
+    for (size_t i = 0; i < ROWS; i += 5) int8_embedding_table_delete(t, i);
+    embedding_filter_t filters[] = { { m, not_third, NULL }, { NULL, not_third, NULL },
+                                     { NULL, NULL, NULL } };
+    for (size_t j = 0; j < sizeof(filters) / sizeof(filters[0]); j++) {
+        check_filter(t, &filters[j], pool);
+        size_t ids[K];
+        size_t n = int8_embedding_table_topk_filtered(t, queries, -1.0, &filters[j], K, ids, NULL);
+        CHECK(n == K);
+        for (size_t i = 0; i < n; i++) CHECK(!int8_embedding_table_is_deleted(t, ids[i]));
+    }
+
+    /* an empty bitmap, or one set only past the table, lets nothing through */
+    embedding_bitmap_t *e = embedding_bitmap_init();
+    embedding_filter_t ef = { e, NULL, NULL };
+    size_t ids[K];
+    CHECK(int8_embedding_table_topk_filtered(t, queries, -1.0, &ef, K, ids, NULL) == 0);
+    embedding_bitmap_set(e, ROWS + 100000);
+    CHECK(int8_embedding_table_topk_filtered_parallel(t, pool, queries, -1.0, &ef, K, ids, NULL) == 0);
+    embedding_bitmap_set(e, 3);
+    CHECK(int8_embedding_table_topk_filtered(t, queries, -1.0, &ef, K, ids, NULL) == 1 && ids[0] == 3);
+
+    embedding_bitmap_destroy(e);
+    embedding_bitmap_destroy(m);
+    int8_embedding_table_destroy(t);
+}
+
+int main(void) {
+    for (size_t i = 0; i < ROWS * DIM; i++) floats[i] = (float)gauss();
+    for (size_t q = 0; q < QUERIES; q++) {
+        float point[DIM];
+        for (size_t d = 0; d < DIM; d++) point[d] = (float)gauss();
+        int8_from_floats(point, DIM, queries + q * DIM);
+    }
+
+    check_bitmap();
+    embedding_thread_pool_t *pool = embedding_thread_pool_init(3);
+    check_scans(0, pool);
+    check_scans(EMBEDDING_TABLE_LAYOUT_INV_NORMS, NULL);
+    embedding_thread_pool_destroy(pool);
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,180 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* HNSW graph over int8 tables: recall against int8_embedding_table_topk()
+ * stays high and grows with ef, results come best first with the table's
+ * scores, and a graph saved and loaded (or mapped) answers exactly as the
+ * one it was saved from, takes appended rows without writing its file and
+ * refuses a table it was not built on.
+ */
+
+#include "embedding-library/int8_hnsw_index.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIM 64
+#define ROWS 2000
+#define CLUSTERS 60
+#define QUERIES 50
+#define K 10
+#define FILENAME "test_hnsw.tbl"
+#define GRAPHNAME "test_hnsw.tbl.hnsw"
+
+static float centers[CLUSTERS * DIM];
+static float floats[ROWS * DIM];
+static int8_t queries[QUERIES * DIM];
+
+/* share of the table's top k found with ef; results must be live rows,
+ * best first, and the ones found scored as the table scores them
+ */
+static double recall(int8_hnsw_index_t *h, int8_embedding_table_t *t, size_t ef) {
+    size_t hits = 0;
+    for (size_t q = 0; q < QUERIES; q++) {
+        const int8_t *query = queries + q * DIM;
+        size_t ids[K], want[K];
+        double scores[K], want_scores[K];
+        size_t n = int8_hnsw_index_topk(h, query, -1.0, ef, K, ids, scores);
+        size_t m = int8_embedding_table_topk(t, query, -1.0, K, want, want_scores);
+        CHECK(n == m);
+        for (size_t i = 0; i < n; i++) {
+            CHECK(!int8_embedding_table_is_deleted(t, ids[i]));
+            CHECK(i == 0 || scores[i] <= scores[i - 1]);
+            for (size_t j = 0; j < m; j++) {
+                if (ids[i] != want[j]) continue;
+                CHECK(scores[i] == want_scores[j]);
+                hits++;
+            }
+        }
+    }
+    return (double)hits / (QUERIES * K);
+}
+
+/* a and b give the same ids and scores */
+static int same_answers(int8_hnsw_index_t *a, int8_hnsw_index_t *b) {
+    for (size_t q = 0; q < QUERIES; q++) {
+        size_t ia[K], ib[K];
+        double sa[K], sb[K];
+        size_t n = int8_hnsw_index_topk(a, queries + q * DIM, -1.0, 32, K, ia, sa);
+        if (int8_hnsw_index_topk(b, queries + q * DIM, -1.0, 32, K, ib, sb) != n ||
+            memcmp(ia, ib, n * sizeof(*ia)) || memcmp(sa, sb, n * sizeof(*sa)))
+            return 0;
+    }
+    return 1;
+}
+
+static long file_bytes(const char *filename, unsigned char **out) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return -1;
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    *out = (unsigned char *)malloc((size_t)size);
+    if (!*out || fread(*out, 1, (size_t)size, fp) != (size_t)size) size = -1;
+    fclose(fp);
+    return size;
+}
+
+static void check_graph(uint32_t layout, embedding_thread_pool_t *pool) {
+    int8_embedding_table_t *t = int8_embedding_table_init_layout(DIM, 0, layout);
+    int8_embedding_table_add_floats_batch(t, floats, ROWS - 500);
+    int8_hnsw_index_t *h = int8_hnsw_index_init(t, 0, 64);
+    CHECK(h != NULL);
+    if (!h) {
+        int8_embedding_table_destroy(t);
+        return;
+    }
+    CHECK(int8_hnsw_index_sync(h, pool) == 0 && int8_hnsw_index_size(h) == ROWS - 500);
+    int8_embedding_table_add_floats_batch(t, floats + (ROWS - 500) * DIM, 500);
+    for (size_t id = ROWS - 500; id < ROWS; id++) CHECK(int8_hnsw_index_add(h, id) == 0);
+    CHECK(int8_hnsw_index_size(h) == ROWS);
+
+    double low = recall(h, t, K), high = recall(h, t, 128);
+    CHECK(high >= 0.95);
+    CHECK(low <= high);
+
+    /* save, then load and map for the table's file */
+    remove(FILENAME);
+    int8_embedding_table_serialize(t, FILENAME);
+    CHECK(int8_hnsw_index_save(h, GRAPHNAME) == 0);
+    int8_embedding_table_t *copy = int8_embedding_table_deserialize(FILENAME);
+    int8_hnsw_index_t *loaded = copy ? int8_hnsw_index_load(copy, GRAPHNAME) : NULL;
+    int8_hnsw_index_t *mapped = copy ? int8_hnsw_index_mmap(copy, GRAPHNAME, 0) : NULL;
+    int8_hnsw_index_t *verified =
+        copy ? int8_hnsw_index_mmap(copy, GRAPHNAME, EMBEDDING_TABLE_MMAP_VERIFY) : NULL;
+    CHECK(loaded && same_answers(h, loaded));
+    CHECK(mapped && same_answers(h, mapped));
+    CHECK(verified && same_answers(h, verified));
+
+    /* rows appended to the copy go into the mapped graph, not its file */
+    unsigned char *before = NULL, *after = NULL;
+    long size = file_bytes(GRAPHNAME, &before);
+    if (copy && mapped) {
+        int8_embedding_table_add_floats_batch(copy, floats, 1000);
+        CHECK(int8_hnsw_index_sync(mapped, pool) == 0);
+        CHECK(int8_hnsw_index_size(mapped) == ROWS + 1000);
+        CHECK(recall(mapped, copy, 128) >= 0.95);
+    }
+    CHECK(size > 0 && file_bytes(GRAPHNAME, &after) == size && !memcmp(before, after, (size_t)size));
+    free(before);
+    free(after);
+
+    /* deleted rows stay out of results */
+    for (size_t q = 0; q < QUERIES; q++) {
+        size_t id;
+        if (int8_embedding_table_topk(t, queries + q * DIM, -1.0, 1, &id, NULL) == 1)
+            int8_embedding_table_delete(t, id);
+    }
+    CHECK(recall(h, t, 128) >= 0.9);
+
+    /* a table that is not the one the graph was built on is refused, the
+     * compacted table included, however many rows it has
+     */
+    int8_embedding_table_t *other = int8_embedding_table_init_layout(DIM, 0, layout);
+    int8_embedding_table_add_floats_batch(other, floats, ROWS);
+    CHECK(int8_hnsw_index_load(other, GRAPHNAME) == NULL);
+    CHECK(int8_hnsw_index_mmap(other, GRAPHNAME, 0) == NULL);
+    int8_embedding_table_destroy(other);
+    size_t *remap = NULL;
+    int8_embedding_table_t *c = int8_embedding_table_compact(t, &remap);
+    if (c) int8_embedding_table_add_floats_batch(c, floats, 100);
+    CHECK(c && int8_hnsw_index_load(c, GRAPHNAME) == NULL);
+    free(remap);
+
+    /* a damaged file is refused */
+    FILE *fp = fopen(GRAPHNAME, "r+b");
+    if (fp) {
+        fseek(fp, 5000, SEEK_SET);
+        int b = fgetc(fp);
+        fseek(fp, 5000, SEEK_SET);
+        fputc(b ^ 0x40, fp);
+        fclose(fp);
+    }
+    CHECK(int8_hnsw_index_load(t, GRAPHNAME) == NULL);
+    CHECK(int8_hnsw_index_mmap(t, GRAPHNAME, EMBEDDING_TABLE_MMAP_VERIFY) == NULL);
+
+    int8_hnsw_index_destroy(verified);
+    int8_hnsw_index_destroy(mapped);
+    int8_hnsw_index_destroy(loaded);
+    int8_hnsw_index_destroy(h);
+    int8_embedding_table_destroy(c);
+    int8_embedding_table_destroy(copy);
+    int8_embedding_table_destroy(t);
+    remove(FILENAME);
+    remove(GRAPHNAME);
+}
+
+int main(void) {
+    make_centers(centers, CLUSTERS, DIM);
+    make_data(centers, CLUSTERS, DIM, 1.5f, floats, ROWS, queries, QUERIES);
+
+    embedding_thread_pool_t *pool = embedding_thread_pool_init(3);
+    check_graph(0, pool);
+    check_graph(EMBEDDING_TABLE_LAYOUT_INV_NORMS, NULL);
+    embedding_thread_pool_destroy(pool);
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
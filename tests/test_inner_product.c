@@ -0,0 +1,190 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Inner-product search of int8 tables: inner_product(), topk_ip() and
+ * topk_ip_parallel() score each row as the float inner product of the query
+ * with the row decoded (by its row scale or the table's channel quantizer),
+ * up to the query's quantization, rank the rows by those scores and agree
+ * with each other exactly.  The channel quantizer round-trips its rows and
+ * its section of the file survives serialize, deserialize and mmap.
+ */
+
+#include "embedding-library/int8_embedding_table.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROWS 3000
+#define QUERIES 20
+#define K 10
+#define MAX_DIM 384
+#define FILENAME "test_inner_product.tbl"
+
+static float floats[ROWS * MAX_DIM];
+static float queries[QUERIES * MAX_DIM];
+static float decoded[ROWS * MAX_DIM];
+static double want[ROWS], got[ROWS];
+
+/* unnormalized rows: every dimension its own offset and spread, and every
+ * row its own length, so row scales and the channel quantizer both matter
+ */
+static void make_rows(size_t dim) {
+    float offset[MAX_DIM], spread[MAX_DIM];
+    for (size_t d = 0; d < dim; d++) {
+        offset[d] = (float)(2.0 * gauss());
+        spread[d] = (float)(0.2 + 3.0 * uniform());
+    }
+    for (size_t i = 0; i < ROWS; i++) {
+        float length = (float)(0.1 + 4.0 * uniform());
+        for (size_t d = 0; d < dim; d++)
+            floats[i * dim + d] = length * (offset[d] + spread[d] * (float)gauss());
+    }
+    for (size_t i = 0; i < QUERIES * dim; i++) queries[i] = (float)gauss();
+}
+
+static double float_dot(const float *a, const float *b, size_t dim) {
+    double sum = 0.0;
+    for (size_t d = 0; d < dim; d++) sum += (double)a[d] * b[d];
+    return sum;
+}
+
+/* the table's rows back as floats: code * row scale, or through the
+ * channel quantizer
+ */
+static void decode_rows(int8_embedding_table_t *t, size_t dim) {
+    for (size_t i = 0; i < ROWS; i++) {
+        const int8_t *code = int8_embedding_table_embedding(t, i);
+        float *out = decoded + i * dim;
+        if (t->channel) {
+            int8_channel_quantizer_decode(t->channel, code, out);
+            continue;
+        }
+        float scale = int8_embedding_table_scale(t, i);
+        for (size_t d = 0; d < dim; d++) out[d] = code[d] * scale;
+    }
+}
+
+/* every score is the decoded inner product to within the query's int8
+ * rounding (a fraction of |query| |row|), topk_ip() keeps the best of them,
+ * and the parallel scan returns exactly the serial one
+ */
+static void check_scores(int8_embedding_table_t *t, size_t dim, embedding_thread_pool_t *pool) {
+    size_t hits = 0;
+    for (size_t q = 0; q < QUERIES; q++) {
+        const float *query = queries + q * dim;
+        double query_len = sqrt(float_dot(query, query, dim));
+        for (size_t i = 0; i < ROWS; i++) {
+            const float *row = decoded + i * dim;
+            want[i] = float_dot(query, row, dim);
+            double tolerance = 0.01 * query_len * sqrt(float_dot(row, row, dim));
+            got[i] = int8_embedding_table_inner_product(t, query, i);
+            CHECK(fabs(got[i] - want[i]) <= tolerance);
+        }
+
+        size_t ids[K], p_ids[K];
+        double scores[K], p_scores[K];
+        size_t n = int8_embedding_table_topk_ip(t, query, K, ids, scores);
+        CHECK(n == K);
+        for (size_t i = 0; i < n; i++) {
+            CHECK(scores[i] == got[ids[i]]);
+            CHECK(i == 0 || scores[i] <= scores[i - 1]);
+        }
+        size_t better = 0;
+        for (size_t i = 0; i < ROWS; i++) better += got[i] > scores[n - 1];
+        CHECK(better < n);
+
+        size_t m = int8_embedding_table_topk_ip_parallel(t, pool, query, K, p_ids, p_scores);
+        CHECK(m == n && !memcmp(p_ids, ids, n * sizeof(*ids)) &&
+              !memcmp(p_scores, scores, n * sizeof(*scores)));
+
+        /* the float ranking of the decoded rows is mostly the same */
+        for (size_t i = 0; i < n; i++) {
+            size_t above = 0;
+            for (size_t r = 0; r < ROWS; r++) above += want[r] > want[ids[i]];
+            hits += above < K;
+        }
+    }
+    CHECK(hits >= QUERIES * K * 9 / 10);
+}
+
+/* the channel quantizer's codes decode to within half a step of the input */
+static void check_quantizer(const int8_channel_quantizer_t *c, size_t dim) {
+    int8_t code[MAX_DIM];
+    float back[MAX_DIM];
+    for (size_t i = 0; i < ROWS; i += 37) {
+        int8_channel_quantizer_encode(c, floats + i * dim, code);
+        int8_channel_quantizer_decode(c, code, back);
+        for (size_t d = 0; d < dim; d++)
+            CHECK(fabsf(back[d] - floats[i * dim + d]) <= 0.5001f * c->scale[d]);
+    }
+}
+
+/* l is t loaded back: same channel section, rows, scales and results */
+static void check_loaded(int8_embedding_table_t *t, int8_embedding_table_t *l, size_t dim) {
+    CHECK(l != NULL);
+    if (!l) return;
+    CHECK(int8_embedding_table_size(l) == ROWS);
+    CHECK((l->channel != NULL) == (t->channel != NULL));
+    if (l->channel && t->channel) {
+        CHECK(l->channel->dim == dim);
+        CHECK(!memcmp(l->channel->scale, t->channel->scale, dim * sizeof(float)));
+        CHECK(!memcmp(l->channel->zero_point, t->channel->zero_point, dim * sizeof(float)));
+    }
+    for (size_t i = 0; i < ROWS; i += 101)
+        CHECK(int8_embedding_table_scale(l, i) == int8_embedding_table_scale(t, i));
+    for (size_t q = 0; q < QUERIES; q++) {
+        size_t ids[K], want_ids[K];
+        double scores[K], want_scores[K];
+        size_t n = int8_embedding_table_topk_ip(l, queries + q * dim, K, ids, scores);
+        size_t m = int8_embedding_table_topk_ip(t, queries + q * dim, K, want_ids, want_scores);
+        CHECK(n == m && !memcmp(ids, want_ids, n * sizeof(*ids)) &&
+              !memcmp(scores, want_scores, n * sizeof(*scores)));
+    }
+}
+
+static void check_table(size_t dim, uint32_t layout, int channel,
+                        embedding_thread_pool_t *pool) {
+    make_rows(dim);
+    int8_embedding_table_t *t = int8_embedding_table_init_layout(dim, 0, layout);
+    CHECK(t != NULL);
+    if (!t) return;
+    if (channel) {
+        int8_channel_quantizer_t *c = int8_channel_quantizer_train(floats, ROWS, dim);
+        CHECK(c != NULL);
+        check_quantizer(c, dim);
+        CHECK(int8_embedding_table_set_channel_quantizer(t, c) == 0);
+        int8_channel_quantizer_destroy(c);
+    }
+    CHECK(int8_embedding_table_add_floats_batch(t, floats, ROWS) == 0);
+    /* the quantizer can only change while the table is empty */
+    if (channel) CHECK(int8_embedding_table_set_channel_quantizer(t, NULL) == -1);
+
+    decode_rows(t, dim);
+    check_scores(t, dim, pool);
+
+    remove(FILENAME);
+    int8_embedding_table_serialize(t, FILENAME);
+    int8_embedding_table_t *l = int8_embedding_table_deserialize(FILENAME);
+    check_loaded(t, l, dim);
+    int8_embedding_table_destroy(l);
+    l = int8_embedding_table_mmap(FILENAME, EMBEDDING_TABLE_MMAP_VERIFY);
+    check_loaded(t, l, dim);
+    int8_embedding_table_destroy(l);
+
+    int8_embedding_table_destroy(t);
+}
+
+int main(void) {
+    embedding_thread_pool_t *pool = embedding_thread_pool_init(3);
+    check_table(96, 0, 0, pool);
+    check_table(384, EMBEDDING_TABLE_LAYOUT_ROW_SCALES, 0, pool);
+    check_table(96, 0, 1, pool);
+    check_table(384, EMBEDDING_TABLE_LAYOUT_ROW_SCALES, 1, NULL);
+    embedding_thread_pool_destroy(pool);
+    remove(FILENAME);
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,176 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* IVF index over int8 tables: probing every list is exact (the ids and
+ * scores of int8_embedding_table_topk()), fewer probes keep most of the
+ * recall, and the index follows the table through appends, deletes,
+ * compaction and save / load, refusing a file saved for another table.
+ */
+
+#include "embedding-library/int8_ivf_index.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIM 64
+#define ROWS 4000
+#define CLUSTERS 40
+#define NLIST 32
+#define QUERIES 50
+#define K 10
+#define FILENAME "test_ivf.tbl"
+#define INDEXNAME "test_ivf.tbl.ivf"
+
+static float centers[CLUSTERS * DIM];
+static float floats[ROWS * DIM];
+static int8_t queries[QUERIES * DIM];
+
+/* probing every list gives exactly the table's top k */
+static void check_exact(int8_ivf_index_t *ivf, int8_embedding_table_t *t) {
+    for (size_t q = 0; q < QUERIES; q++) {
+        size_t ids[K], want_ids[K];
+        double scores[K], want_scores[K];
+        size_t n = int8_ivf_index_topk(ivf, queries + q * DIM, -1.0, NLIST, K, ids, scores);
+        size_t m = int8_embedding_table_topk(t, queries + q * DIM, -1.0, K, want_ids, want_scores);
+        CHECK(n == m);
+        for (size_t i = 0; i < n && i < m; i++) {
+            CHECK(ids[i] == want_ids[i]);
+            CHECK(scores[i] == want_scores[i]);
+        }
+    }
+}
+
+/* share of the table's top k found probing nprobe lists */
+static double recall(int8_ivf_index_t *ivf, int8_embedding_table_t *t, size_t nprobe) {
+    size_t hits = 0;
+    for (size_t q = 0; q < QUERIES; q++) {
+        size_t ids[K], want[K];
+        size_t n = int8_ivf_index_topk(ivf, queries + q * DIM, -1.0, nprobe, K, ids, NULL);
+        size_t m = int8_embedding_table_topk(t, queries + q * DIM, -1.0, K, want, NULL);
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < m; j++)
+                if (ids[i] == want[j]) hits++;
+    }
+    return (double)hits / (QUERIES * K);
+}
+
+static size_t filed(const int8_ivf_index_t *ivf) {
+    size_t total = 0;
+    for (size_t c = 0; c < NLIST; c++) total += int8_ivf_index_list_size(ivf, c);
+    return total;
+}
+
+static void check_index(uint32_t layout, uint32_t flags, embedding_thread_pool_t *pool) {
+    int8_embedding_table_t *t = int8_embedding_table_init_layout(DIM, 0, layout);
+    int8_embedding_table_add_floats_batch(t, floats, ROWS - 500);
+    int8_ivf_index_t *ivf = int8_ivf_index_train(t, NLIST, 0, 0, flags, pool);
+    CHECK(ivf != NULL);
+    if (!ivf) {
+        int8_embedding_table_destroy(t);
+        return;
+    }
+    CHECK(int8_ivf_index_nlist(ivf) == NLIST);
+    CHECK(int8_ivf_index_size(ivf) == ROWS - 500 && filed(ivf) == ROWS - 500);
+
+    /* appended rows are filed by sync() */
+    int8_embedding_table_add_floats_batch(t, floats + (ROWS - 500) * DIM, 500);
+    CHECK(int8_ivf_index_sync(ivf, pool) == 0);
+    CHECK(int8_ivf_index_size(ivf) == ROWS && filed(ivf) == ROWS);
+    check_exact(ivf, t);
+    CHECK(recall(ivf, t, NLIST / 4) >= 0.8);
+    CHECK(recall(ivf, t, 1) <= recall(ivf, t, NLIST / 4));
+
+    /* deleted rows are skipped */
+    for (size_t q = 0; q < QUERIES; q++) {
+        size_t id;
+        if (int8_embedding_table_topk(t, queries + q * DIM, -1.0, 1, &id, NULL) == 1)
+            int8_embedding_table_delete(t, id);
+    }
+    check_exact(ivf, t);
+
+    /* save, then load for a mapped copy of the table with rows appended */
+    remove(FILENAME);
+    int8_embedding_table_serialize(t, FILENAME);
+    CHECK(int8_ivf_index_save(ivf, INDEXNAME) == 0);
+    int8_embedding_table_t *mapped = int8_embedding_table_mmap(FILENAME, 0);
+    CHECK(mapped != NULL);
+    if (mapped) {
+        int8_embedding_table_add_floats_batch(mapped, floats, 300);
+        int8_ivf_index_t *loaded = int8_ivf_index_load(mapped, INDEXNAME, pool);
+        CHECK(loaded && int8_ivf_index_size(loaded) == ROWS + 300);
+        if (loaded) check_exact(loaded, mapped);
+        int8_ivf_index_destroy(loaded);
+        int8_embedding_table_destroy(mapped);
+    }
+
+    /* a table with the same rows that is not the one indexed is refused */
+    int8_embedding_table_t *other = int8_embedding_table_init_layout(DIM, 0, layout);
+    int8_embedding_table_add_floats_batch(other, floats, ROWS);
+    CHECK(int8_ivf_index_load(other, INDEXNAME, NULL) == NULL);
+    int8_embedding_table_destroy(other);
+
+    /* compaction: the old index file does not load for the new table (ids
+     * moved), even with enough rows appended to cover it, and the remapped
+     * index is exact on it
+     */
+    size_t *remap = NULL;
+    int8_embedding_table_t *c = int8_embedding_table_compact(t, &remap);
+    CHECK(c && int8_embedding_table_size(c) == ROWS - int8_embedding_table_num_deleted(t));
+    if (c) {
+        int8_embedding_table_add_floats_batch(c, floats, 200);
+        int8_embedding_table_serialize(c, FILENAME);
+        int8_embedding_table_t *reloaded = int8_embedding_table_deserialize(FILENAME);
+        CHECK(reloaded && int8_ivf_index_load(reloaded, INDEXNAME, NULL) == NULL);
+
+        CHECK(int8_ivf_index_remap(ivf, c, remap) == 0);
+        CHECK(int8_ivf_index_sync(ivf, NULL) == 0);
+        CHECK(int8_ivf_index_size(ivf) == int8_embedding_table_size(c));
+        CHECK(filed(ivf) == int8_embedding_table_size(c));
+        check_exact(ivf, c);
+
+        /* saved again with the table, it loads for the compacted table's file */
+        int8_embedding_table_destroy(reloaded);
+        int8_embedding_table_serialize(c, FILENAME);
+        CHECK(int8_ivf_index_save(ivf, INDEXNAME) == 0);
+        reloaded = int8_embedding_table_deserialize(FILENAME);
+        int8_ivf_index_t *loaded = reloaded ? int8_ivf_index_load(reloaded, INDEXNAME, NULL) : NULL;
+        CHECK(loaded && int8_ivf_index_size(loaded) == int8_embedding_table_size(c));
+        if (loaded) check_exact(loaded, reloaded);
+        int8_ivf_index_destroy(loaded);
+        int8_embedding_table_destroy(reloaded);
+    }
+
+    /* a damaged file is refused */
+    FILE *fp = fopen(INDEXNAME, "r+b");
+    if (fp) {
+        fseek(fp, 200, SEEK_SET);
+        int b = fgetc(fp);
+        fseek(fp, 200, SEEK_SET);
+        fputc(b ^ 0x55, fp);
+        fclose(fp);
+    }
+    CHECK(c == NULL || int8_ivf_index_load(c, INDEXNAME, NULL) == NULL);
+
+    free(remap);
+    int8_ivf_index_destroy(ivf);
+    int8_embedding_table_destroy(c);
+    int8_embedding_table_destroy(t);
+    remove(FILENAME);
+    remove(INDEXNAME);
+}
+
+int main(void) {
+    make_centers(centers, CLUSTERS, DIM);
+    make_data(centers, CLUSTERS, DIM, 0.6f, floats, ROWS, queries, QUERIES);
+
+    embedding_thread_pool_t *pool = embedding_thread_pool_init(3);
+    check_index(0, 0, pool);
+    check_index(0, INT8_IVF_INDEX_COPY_ROWS, NULL);
+    check_index(EMBEDDING_TABLE_LAYOUT_INV_NORMS, INT8_IVF_INDEX_COPY_ROWS, pool);
+    embedding_thread_pool_destroy(pool);
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
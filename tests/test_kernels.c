@@ -0,0 +1,153 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Every int8 dot product kernel of every kernel set the host can run must
+ * give exactly int8_dot_product_scalar(): the single product, the rows
+ * kernel, the rows kernels compiled for fixed sizes and the tiled matrix
+ * over them, at odd lengths and row counts and with every element -128 (the
+ * case the unsigned x signed VNNI instructions need care for).  Outputs are
+ * checked for writes past their end too.  The int16 dot product must give
+ * exactly int16_dot_product_scalar() the same way, up to +-32767 everywhere.
+ */
+
+#include "embedding-library/dispatch.h"
+#include "embedding-library/fallback/int16.h"
+#include "embedding-library/fallback/int8.h"
+#include "embedding-library/int8.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_N 4099
+#define MAX_ROWS 33
+#define GUARD 8
+
+static int failures = 0;
+
+#define CHECK(set, what, n, cond)                                                   \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            printf("FAIL %s %s n=%zu (%s:%d)\n", (set), (what), (size_t)(n),        \
+                   __FILE__, __LINE__);                                             \
+            failures++;                                                             \
+        }                                                                           \
+    } while (0)
+
+static uint64_t seed = 88172645463325252ull;
+
+static int8_t random_int8(void) {
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+    return (int8_t)(seed >> 56);
+}
+
+static int8_t query[MAX_N];
+static int8_t rows[MAX_ROWS * MAX_N];
+static int32_t want[MAX_ROWS + GUARD], got[MAX_ROWS + GUARD];
+static int16_t a16[MAX_N], b16[MAX_N];
+
+/* the rows kernel fills out[0, nrows) with the scalar products and stops */
+static int same_rows(embedding_int8_dot_product_rows_cb kernel, size_t nrows, size_t n) {
+    memset(got, 0x5A, sizeof(got));
+    memset(want, 0x5A, sizeof(want));
+    int8_dot_product_rows_scalar(query, rows, nrows, n, want);
+    kernel(query, rows, nrows, n, got);
+    return !memcmp(got, want, sizeof(got));
+}
+
+/* query and rows[0, MAX_ROWS) of n elements all compared */
+static void check_length(const embedding_kernels_t *k, const char *what, size_t n) {
+    for (size_t r = 0; r < MAX_ROWS; r++)
+        CHECK(k->name, what, n,
+              k->int8_dot_product(query, rows + r * n, n) ==
+              int8_dot_product_scalar(query, rows + r * n, n));
+    static const size_t counts[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 13, 16, 31, 33 };
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+        CHECK(k->name, what, n, same_rows(k->int8_dot_product_rows, counts[c], n));
+
+    static const size_t dims[EMBEDDING_FIXED_DIMS] = EMBEDDING_FIXED_DIM_LIST;
+    for (size_t d = 0; d < EMBEDDING_FIXED_DIMS; d++) {
+        if (dims[d] != n) continue;
+        CHECK(k->name, "fixed", n, k->int8_dot_product_rows_fixed[d] != NULL);
+        if (!k->int8_dot_product_rows_fixed[d]) continue;
+        for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+            CHECK(k->name, "fixed", n, same_rows(k->int8_dot_product_rows_fixed[d], counts[c], n));
+        CHECK(k->name, "rows_kernel", n, embedding_int8_rows_kernel(k, n) ==
+                                         k->int8_dot_product_rows_fixed[d]);
+    }
+}
+
+/* int8_dot_product_matrix_with() the set's rows kernel: 5 queries (the
+ * first rows) against all MAX_ROWS rows, tiled in 4-row steps
+ */
+static void check_matrix(const embedding_kernels_t *k, size_t n) {
+    static int32_t m_want[5 * MAX_ROWS], m_got[5 * MAX_ROWS];
+    for (size_t q = 0; q < 5; q++)
+        for (size_t r = 0; r < MAX_ROWS; r++)
+            m_want[q * MAX_ROWS + r] = int8_dot_product_scalar(rows + q * n, rows + r * n, n);
+    int8_dot_product_matrix_with(embedding_int8_rows_kernel(k, n), rows, 5, rows, MAX_ROWS, n,
+                                 m_got);
+    CHECK(k->name, "matrix", n, !memcmp(m_got, m_want, sizeof(m_got)));
+}
+
+/* a16 . b16 over n elements */
+static void check_int16(const embedding_kernels_t *k, const char *what, size_t n) {
+    CHECK(k->name, what, n,
+          k->int16_dot_product(a16, b16, n) == int16_dot_product_scalar(a16, b16, n));
+}
+
+static void fill(size_t n, int8_t q, int8_t r) {
+    for (size_t i = 0; i < n; i++) query[i] = q;
+    for (size_t i = 0; i < MAX_ROWS * n; i++) rows[i] = r;
+}
+
+static void check_kernels(const embedding_kernels_t *k) {
+    /* every length up to 80, the fixed sizes and a few longer odd ones */
+    static const size_t lengths[] = { 255, 256, 257, 384, 511, 512, 513, 768,
+                                      1000, 1023, 1024, 4099 };
+    for (size_t n = 0; n <= 80 + sizeof(lengths) / sizeof(lengths[0]); n++) {
+        size_t len = n <= 80 ? n : lengths[n - 81];
+        for (size_t i = 0; i < len; i++) query[i] = random_int8();
+        for (size_t i = 0; i < MAX_ROWS * len; i++) rows[i] = random_int8();
+        check_length(k, "random", len);
+        check_matrix(k, len);
+
+        /* the extremes: -128 on both sides, and against the largest positive */
+        fill(len, -128, -128);
+        check_length(k, "-128 x -128", len);
+        fill(len, -128, 127);
+        check_length(k, "-128 x 127", len);
+        fill(len, 127, -128);
+        check_length(k, "127 x -128", len);
+
+        for (size_t i = 0; i < len; i++) {
+            a16[i] = (int16_t)(random_int8() * 256 + (uint8_t)random_int8());
+            b16[i] = (int16_t)(random_int8() * 256 + (uint8_t)random_int8());
+            if (a16[i] == -32768) a16[i] = -32767;
+            if (b16[i] == -32768) b16[i] = -32767;
+        }
+        check_int16(k, "int16 random", len);
+        for (size_t i = 0; i < len; i++) a16[i] = b16[i] = 32767;
+        check_int16(k, "int16 32767 x 32767", len);
+        for (size_t i = 0; i < len; i++) b16[i] = -32767;
+        check_int16(k, "int16 32767 x -32767", len);
+    }
+}
+
+int main(void) {
+    uint32_t features = embedding_cpu_features();
+    size_t tested = 0;
+    for (size_t i = 0; embedding_kernel_set(i); i++) {
+        const embedding_kernels_t *k = embedding_kernel_set(i);
+        if ((k->required & features) != k->required) {
+            printf("skip %s (not supported by this CPU)\n", k->name);
+            continue;
+        }
+        check_kernels(k);
+        printf("checked %s\n", k->name);
+        tested++;
+    }
+    if (tested == 0) failures++;
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,126 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Where node blocks live: tables built in huge page slab mode (with and
+ * without NUMA placement) and from an arena hold the same rows and scan to
+ * the same results as a heap table, serial and split across a pool (by NUMA
+ * node for NUMA_SPREAD); compaction keeps the source's memory mode or
+ * allocator, and destroying the tables hands every arena piece back.  Run it
+ * under AddressSanitizer to check the slab and arena bookkeeping.
+ */
+
+#include "embedding-library/embedding_allocator.h"
+#include "embedding-library/embedding_memory.h"
+#include "embedding-library/int8_embedding_table.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIM 64
+#define ROWS 40000     /* 79 nodes: more than one slab */
+#define QUERIES 10
+#define K 10
+
+static float floats[ROWS * DIM];
+static int8_t queries[QUERIES * DIM];
+
+/* t scans to exactly ref's ids and scores, serial and parallel */
+static void check_same(int8_embedding_table_t *t, int8_embedding_table_t *ref,
+                       embedding_thread_pool_t *pool) {
+    CHECK(int8_embedding_table_size(t) == int8_embedding_table_size(ref));
+    for (size_t i = 0; i < int8_embedding_table_size(ref); i += 333)
+        CHECK(!memcmp(int8_embedding_table_embedding(t, i), int8_embedding_table_embedding(ref, i),
+                      DIM));
+    for (size_t q = 0; q < QUERIES; q++) {
+        const int8_t *query = queries + q * DIM;
+        size_t ids[K], want[K];
+        double scores[K], want_scores[K];
+        size_t m = int8_embedding_table_topk(ref, query, -1.0, K, want, want_scores);
+        size_t n = int8_embedding_table_topk(t, query, -1.0, K, ids, scores);
+        CHECK(n == m && !memcmp(ids, want, n * sizeof(*ids)) &&
+              !memcmp(scores, want_scores, n * sizeof(*scores)));
+        n = int8_embedding_table_topk_parallel(t, pool, query, -1.0, K, ids, scores);
+        CHECK(n == m && !memcmp(ids, want, n * sizeof(*ids)) &&
+              !memcmp(scores, want_scores, n * sizeof(*scores)));
+    }
+}
+
+/* builds, scans and compacts a table whose blocks come from memory mode
+ * `memory` (if nonzero) or allocator a (if not NULL), against a heap table
+ */
+static void check_mode(uint32_t memory, const embedding_allocator_t *a,
+                       embedding_thread_pool_t *pool) {
+    int8_embedding_table_t *ref = int8_embedding_table_init_dim(DIM, 0);
+    int8_embedding_table_t *t = int8_embedding_table_init_dim(DIM, 0);
+    if (memory) CHECK(int8_embedding_table_set_memory(t, memory) == 0);
+    if (a) CHECK(int8_embedding_table_set_allocator(t, a) == 0);
+    CHECK(t->memory == memory);
+
+    /* a batch, then single rows into a partly filled node */
+    CHECK(int8_embedding_table_add_floats_batch(ref, floats, ROWS) == 0);
+    CHECK(int8_embedding_table_add_floats_batch_parallel(t, pool, floats, ROWS - 1000) == 0);
+    int8_t row[DIM];
+    for (size_t i = ROWS - 1000; i < ROWS; i++) {
+        int8_from_floats(floats + i * DIM, DIM, row);
+        int8_embedding_table_add_embedding(t, row, -1.0);
+    }
+    /* the mode can only change while the table has no nodes */
+    CHECK(int8_embedding_table_set_memory(t, EMBEDDING_MEMORY_HUGEPAGES) == -1);
+    CHECK(int8_embedding_table_set_allocator(t, NULL) == -1);
+    check_same(t, ref, pool);
+
+    for (size_t i = 0; i < ROWS; i += 3) {
+        int8_embedding_table_delete(t, i);
+        int8_embedding_table_delete(ref, i);
+    }
+    check_same(t, ref, pool);
+
+    /* compacted copies keep the mode */
+    size_t *remap = NULL, *ref_remap = NULL;
+    int8_embedding_table_t *c = int8_embedding_table_compact(t, &remap);
+    int8_embedding_table_t *rc = int8_embedding_table_compact(ref, &ref_remap);
+    CHECK(c && rc);
+    if (c && rc) {
+        CHECK(c->memory == memory);
+        CHECK(c->allocator.ctx == t->allocator.ctx && c->allocator.alloc == t->allocator.alloc);
+        check_same(c, rc, pool);
+        CHECK(!memcmp(remap, ref_remap, ROWS * sizeof(*remap)));
+    }
+    free(ref_remap);
+    free(remap);
+    int8_embedding_table_destroy(rc);
+    int8_embedding_table_destroy(c);
+    int8_embedding_table_destroy(t);
+    int8_embedding_table_destroy(ref);
+}
+
+int main(void) {
+    for (size_t i = 0; i < ROWS * DIM; i++) floats[i] = (float)gauss();
+    for (size_t q = 0; q < QUERIES; q++)
+        int8_from_floats(floats + (q * 997) * DIM, DIM, queries + q * DIM);
+
+    embedding_thread_pool_t *pool = embedding_thread_pool_init(3);
+    check_mode(EMBEDDING_MEMORY_HUGEPAGES, NULL, pool);
+    check_mode(EMBEDDING_MEMORY_HUGEPAGES | EMBEDDING_MEMORY_NUMA_SPREAD, NULL, pool);
+    check_mode(EMBEDDING_MEMORY_HUGETLB | EMBEDDING_MEMORY_NUMA_INTERLEAVE, NULL, pool);
+    check_mode(EMBEDDING_MEMORY_NUMA_SPREAD, NULL, NULL);
+
+    /* two arenas: one chunk per node, and several nodes per chunk */
+    static const size_t chunks[] = { 1, 0 };
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        embedding_arena_t *arena = embedding_arena_init(chunks[i]);
+        CHECK(arena != NULL);
+        if (!arena) continue;
+        embedding_allocator_t a = embedding_arena_allocator(arena);
+        check_mode(0, &a, pool);
+        CHECK(embedding_arena_used(arena) == 0);
+        CHECK(embedding_arena_reserved(arena) > 0);
+        embedding_arena_destroy(arena);
+    }
+    embedding_thread_pool_destroy(pool);
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
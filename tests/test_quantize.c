@@ -0,0 +1,145 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Every quantization kernel of every kernel set the host can run must give
+ * the same bits as the *_scalar reference: odd lengths, exact .5 ties,
+ * saturation, every int8 and int16 input value.  Outputs are checked for
+ * writes past their end too.
+ */
+
+#include "embedding-library/dispatch.h"
+#include "embedding-library/fallback/int16.h"
+#include "embedding-library/fallback/int8.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GUARD 64
+#define MAX_N 70000
+
+static int failures = 0;
+
+#define CHECK(set, what, n, cond)                                                   \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            printf("FAIL %s %s n=%zu (%s:%d)\n", (set), (what), (size_t)(n),        \
+                   __FILE__, __LINE__);                                             \
+            failures++;                                                             \
+        }                                                                           \
+    } while (0)
+
+static uint64_t seed = 88172645463325252ull;
+
+static float uniform(void) {
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+    return (float)((seed >> 40) * (1.0 / 16777216.0)) * 2.0f - 1.0f;
+}
+
+static float in[MAX_N];
+static int16_t in16[MAX_N];
+static int8_t in8[MAX_N];
+static unsigned char want[MAX_N * 4 + GUARD], got[MAX_N * 4 + GUARD];
+
+static void reset(void) {
+    memset(want, 0xA5, sizeof(want));
+    memset(got, 0xA5, sizeof(got));
+}
+
+/* got matches want over bytes and the guard past them is untouched */
+static int same(size_t bytes) {
+    return !memcmp(got, want, bytes + GUARD);
+}
+
+static void check_floats(const embedding_kernels_t *k, const char *what, size_t n) {
+    reset();
+    int8_from_floats_scalar(in, n, (int8_t *)want);
+    k->int8_from_floats(in, n, (int8_t *)got);
+    CHECK(k->name, what, n, same(n));
+
+    reset();
+    int16_from_floats_scalar(in, n, (int16_t *)want);
+    k->int16_from_floats(in, n, (int16_t *)got);
+    CHECK(k->name, what, n, same(n * sizeof(int16_t)));
+
+    float m = k->float_max_abs(in, n), r = float_max_abs_scalar(in, n);
+    CHECK(k->name, what, n, !memcmp(&m, &r, sizeof(m)));
+
+    static const float scales[] = { 1.0f, 0.5f, 127.0f, 1000.0f, 3.0e5f };
+    for (size_t s = 0; s < sizeof(scales) / sizeof(scales[0]); s++) {
+        reset();
+        int8_scale_floats_scalar(in, n, scales[s], (int8_t *)want);
+        k->int8_scale_floats(in, n, scales[s], (int8_t *)got);
+        CHECK(k->name, what, n, same(n));
+    }
+}
+
+static void check_kernels(const embedding_kernels_t *k) {
+    /* random values at every length up to 80, and a few longer odd ones */
+    static const size_t lengths[] = { 255, 256, 257, 511, 513, 1000, 1023, 4099 };
+    for (size_t n = 0; n <= 80 + sizeof(lengths) / sizeof(lengths[0]); n++) {
+        size_t len = n <= 80 ? n : lengths[n - 81];
+        for (size_t i = 0; i < len; i++) in[i] = uniform() * 3.0f;
+        check_floats(k, "random", len);
+    }
+
+    /* ties: with max |x| 127 (32767) the scale is exactly 1, so x.5 stays a tie */
+    size_t n = 0;
+    for (int v = -127; v < 127; v++) in[n++] = v + 0.5f;
+    in[n++] = -127.0f;
+    check_floats(k, "int8 ties", n);
+    n = 0;
+    for (int v = -2000; v < 2000; v++) in[n++] = v + 0.5f;
+    for (int v = 32000; v < 32767; v++) { in[n++] = v + 0.5f; in[n++] = -v - 0.5f; }
+    in[n++] = 32767.0f;
+    check_floats(k, "int16 ties", n);
+
+    /* saturation: scale_floats pushes most of these past the int8 range */
+    for (size_t i = 0; i < 333; i++) in[i] = (i % 2 ? 1.0f : -1.0f) * (float)i * 0.75f;
+    check_floats(k, "saturation", 333);
+
+    /* all-zero input falls back to a scale of 1 */
+    memset(in, 0, 37 * sizeof(float));
+    check_floats(k, "zeros", 37);
+
+    /* every int16 value, at an odd length */
+    for (size_t i = 0; i < 65536; i++) in16[i] = (int16_t)(i - 32768);
+    in16[65536] = 5;
+    reset();
+    int8_from_int16s_scalar(in16, 65537, (int8_t *)want);
+    k->int8_from_int16s(in16, 65537, (int8_t *)got);
+    CHECK(k->name, "int8_from_int16s", 65537, same(65537));
+
+    static const float scales[] = { 127.0f, 1.0f, 0.1f, 3.0f, 32767.0f, 1.0e-3f };
+    for (size_t s = 0; s < sizeof(scales) / sizeof(scales[0]); s++) {
+        for (size_t len = 0; len < 300; len += 37) {
+            for (size_t i = 0; i < len; i++) in8[i] = (int8_t)(i * 7 - 128);
+            reset();
+            int8_to_floats_scalar(in8, len, (float *)want, scales[s]);
+            k->int8_to_floats(in8, len, (float *)got, scales[s]);
+            CHECK(k->name, "int8_to_floats", len, same(len * sizeof(float)));
+        }
+        reset();
+        int16_to_floats_scalar(in16, 65537, (float *)want, scales[s]);
+        k->int16_to_floats(in16, 65537, (float *)got, scales[s]);
+        CHECK(k->name, "int16_to_floats", 65537, same(65537 * sizeof(float)));
+    }
+}
+
+int main(void) {
+    uint32_t features = embedding_cpu_features();
+    size_t tested = 0;
+    for (size_t i = 0; embedding_kernel_set(i); i++) {
+        const embedding_kernels_t *k = embedding_kernel_set(i);
+        if ((k->required & features) != k->required) {
+            printf("skip %s (not supported by this CPU)\n", k->name);
+            continue;
+        }
+        check_kernels(k);
+        printf("checked %s\n", k->name);
+        tested++;
+    }
+    if (tested == 0) failures++;
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Two-stage search: embedding_rerank_float() and embedding_rerank_int16()
+ * re-score the int8 candidates exactly as the fine table's own scan does, so
+ * with every row a candidate they return float_embedding_table_topk() /
+ * int16_embedding_table_topk(), ids and scores, whatever the fine layout and
+ * even when the fine table holds fewer rows than the coarse one.  The default
+ * oversample keeps most of that top k.
+ */
+
+#include "embedding-library/embedding_rerank.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIM 128
+#define ROWS 3000
+#define SHORT 2300     /* rows of the shorter fine tables */
+#define CLUSTERS 40
+#define QUERIES 20
+#define K 10
+
+static float centers[CLUSTERS * DIM];
+static float floats[ROWS * DIM];
+static int16_t int16s[ROWS * DIM];
+static float queries[QUERIES * DIM];
+static int16_t queries16[QUERIES * DIM];
+static int8_t queries8[QUERIES * DIM];
+
+/* every row a candidate: the reranked top k is the fine table's */
+static size_t everything(int8_embedding_table_t *coarse) {
+    return int8_embedding_table_size(coarse) / K + 1;
+}
+
+static void check_float(int8_embedding_table_t *coarse, float_embedding_table_t *fine,
+                        embedding_thread_pool_t *pool) {
+    size_t hits = 0;
+    for (size_t q = 0; q < QUERIES; q++) {
+        const float *query = queries + q * DIM;
+        size_t ids[K], want[K];
+        double scores[K], want_scores[K];
+        embedding_rerank_stats_t stats;
+        size_t m = float_embedding_table_topk(fine, query, -1.0, K, want, want_scores);
+        CHECK(m == K);
+
+        size_t n = embedding_rerank_float(coarse, fine, pool, query, -1.0, NULL, K,
+                                          everything(coarse), ids, scores, &stats);
+        CHECK(n == m && !memcmp(ids, want, n * sizeof(*ids)) &&
+              !memcmp(scores, want_scores, n * sizeof(*scores)));
+        CHECK(stats.candidates == int8_embedding_table_size(coarse));
+
+        /* the caller's int8 query and norm give the same */
+        double norm = sqrt(dot_product(query, query, DIM));
+        n = embedding_rerank_float(coarse, fine, NULL, query, norm, queries8 + q * DIM, K,
+                                   everything(coarse), ids, NULL, NULL);
+        CHECK(n == m && !memcmp(ids, want, n * sizeof(*ids)));
+
+        /* the default oversample: k * 4 candidates, scored as the scan does */
+        n = embedding_rerank_float(coarse, fine, pool, query, -1.0, NULL, K, 0, ids, scores,
+                                   &stats);
+        CHECK(n == K && stats.candidates == K * EMBEDDING_RERANK_DEFAULT_OVERSAMPLE);
+        for (size_t i = 0; i < n; i++) {
+            CHECK(i == 0 || scores[i] <= scores[i - 1]);
+            CHECK(scores[i] <= want_scores[0]);
+            for (size_t j = 0; j < m; j++) hits += ids[i] == want[j];
+        }
+    }
+    CHECK(hits >= QUERIES * K * 8 / 10);
+}
+
+static void check_int16(int8_embedding_table_t *coarse, int16_embedding_table_t *fine,
+                        embedding_thread_pool_t *pool) {
+    size_t hits = 0;
+    for (size_t q = 0; q < QUERIES; q++) {
+        const int16_t *query = queries16 + q * DIM;
+        size_t ids[K], want[K];
+        double scores[K], want_scores[K];
+        size_t m = int16_embedding_table_topk(fine, query, -1.0, K, want, want_scores);
+        CHECK(m == K);
+
+        size_t n = embedding_rerank_int16(coarse, fine, pool, query, -1.0, NULL, K,
+                                          everything(coarse), ids, scores, NULL);
+        CHECK(n == m && !memcmp(ids, want, n * sizeof(*ids)) &&
+              !memcmp(scores, want_scores, n * sizeof(*scores)));
+
+        n = embedding_rerank_int16(coarse, fine, pool, query, -1.0, NULL, K, 0, ids, scores,
+                                   NULL);
+        CHECK(n == K);
+        for (size_t i = 0; i < n; i++) {
+            CHECK(i == 0 || scores[i] <= scores[i - 1]);
+            for (size_t j = 0; j < m; j++) hits += ids[i] == want[j];
+        }
+    }
+    CHECK(hits >= QUERIES * K * 8 / 10);
+}
+
+static float_embedding_table_t *float_table(uint32_t layout, size_t rows) {
+    float_embedding_table_t *t = float_embedding_table_init_layout(DIM, 0, layout);
+    for (size_t i = 0; i < rows; i++) float_embedding_table_add_embedding(t, floats + i * DIM, -1.0);
+    return t;
+}
+
+static int16_embedding_table_t *int16_table(size_t rows) {
+    int16_embedding_table_t *t = int16_embedding_table_init(DIM, 0);
+    for (size_t i = 0; i < rows; i++) int16_embedding_table_add_embedding(t, int16s + i * DIM, -1.0);
+    return t;
+}
+
+int main(void) {
+    make_centers(centers, CLUSTERS, DIM);
+    make_data(centers, CLUSTERS, DIM, 0.8f, floats, ROWS, NULL, 0);
+    for (size_t q = 0; q < QUERIES; q++) {
+        make_point(centers, CLUSTERS, DIM, 0.8f, queries + q * DIM);
+        int8_from_floats(queries + q * DIM, DIM, queries8 + q * DIM);
+        int16_from_floats(queries + q * DIM, DIM, queries16 + q * DIM);
+    }
+    for (size_t i = 0; i < ROWS; i++) int16_from_floats(floats + i * DIM, DIM, int16s + i * DIM);
+
+    int8_embedding_table_t *coarse = int8_embedding_table_init_dim(DIM, 0);
+    int8_embedding_table_add_floats_batch(coarse, floats, ROWS);
+    embedding_thread_pool_t *pool = embedding_thread_pool_init(3);
+
+    static const uint32_t layouts[] = { 0, EMBEDDING_TABLE_LAYOUT_INV_NORMS,
+                                        EMBEDDING_TABLE_LAYOUT_NORMALIZED };
+    for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+        float_embedding_table_t *fine = float_table(layouts[l], ROWS);
+        check_float(coarse, fine, pool);
+        float_embedding_table_destroy(fine);
+        /* coarse rows past the end of fine are dropped */
+        fine = float_table(layouts[l], SHORT);
+        check_float(coarse, fine, l ? NULL : pool);
+        float_embedding_table_destroy(fine);
+    }
+
+    int16_embedding_table_t *fine16 = int16_table(ROWS);
+    check_int16(coarse, fine16, pool);
+    int16_embedding_table_destroy(fine16);
+    fine16 = int16_table(SHORT);
+    check_int16(coarse, fine16, NULL);
+    int16_embedding_table_destroy(fine16);
+
+    /* tables of different dims are refused */
+    float_embedding_table_t *other = float_embedding_table_init(DIM / 2, 0);
+    float_embedding_table_add_embedding(other, floats, -1.0);
+    size_t id;
+    CHECK(embedding_rerank_float(coarse, other, pool, queries, -1.0, NULL, 1, 0, &id, NULL,
+                                 NULL) == 0);
+    float_embedding_table_destroy(other);
+
+    embedding_thread_pool_destroy(pool);
+    int8_embedding_table_destroy(coarse);
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
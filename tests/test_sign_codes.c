@@ -0,0 +1,179 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* 1-bit sign codes of int8 tables: codes and distances match a plain
+ * per-element reference, scan() returns the reference Hamming top n, topk()
+ * gains recall with oversample and is exactly int8_embedding_table_topk()
+ * once every row is a candidate, and the codes follow appends and deletes.
+ */
+
+#include "embedding-library/int8_sign_codes.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROWS 3000
+#define CLUSTERS 60
+#define QUERIES 40
+#define K 10
+#define MAX_DIM 256
+#define MAX_WORDS (MAX_DIM / 64)
+
+static float centers[CLUSTERS * MAX_DIM];
+static float floats[ROWS * MAX_DIM];
+static int8_t queries[QUERIES * MAX_DIM];
+
+/* code and distance of a few rows against the per-element definition */
+static void check_code(int8_embedding_table_t *t, size_t dim) {
+    size_t words = int8_sign_code_words(dim);
+    uint64_t a[MAX_WORDS], b[MAX_WORDS];
+    for (size_t r = 0; r + 1 < 20; r++) {
+        const int8_t *x = int8_embedding_table_embedding(t, r);
+        const int8_t *y = int8_embedding_table_embedding(t, r + 1);
+        int8_sign_code(x, dim, a);
+        int8_sign_code(y, dim, b);
+        uint32_t want = 0;
+        for (size_t d = 0; d < dim; d++) {
+            CHECK(((a[d / 64] >> (d % 64)) & 1u) == (uint64_t)(x[d] < 0));
+            want += (x[d] < 0) != (y[d] < 0);
+        }
+        if (dim % 64) CHECK((a[words - 1] >> (dim % 64)) == 0);
+        CHECK(int8_sign_code_distance(a, b, words) == want);
+        CHECK(int8_sign_code_distance(a, a, words) == 0);
+    }
+}
+
+/* scan() gives the n nearest codes, nearest first then by id, and their
+ * distances
+ */
+static void check_scan(int8_sign_codes_t *c, int8_embedding_table_t *t, size_t dim,
+                       embedding_thread_pool_t *pool) {
+    size_t words = int8_sign_code_words(dim), rows = int8_embedding_table_size(t);
+    uint32_t *dist = (uint32_t *)malloc(rows * sizeof(*dist));
+    for (size_t q = 0; q < 5; q++) {
+        uint64_t code[MAX_WORDS], row[MAX_WORDS];
+        int8_sign_code(queries + q * dim, dim, code);
+        for (size_t r = 0; r < rows; r++) {
+            int8_sign_code(int8_embedding_table_embedding(t, r), dim, row);
+            dist[r] = int8_sign_code_distance(code, row, words);
+        }
+        size_t ids[100];
+        uint32_t found[100];
+        size_t n = int8_sign_codes_scan(c, pool, code, 100, ids, found);
+        CHECK(n == 100);
+        for (size_t i = 0; i < n; i++) {
+            CHECK(!int8_embedding_table_is_deleted(t, ids[i]));
+            CHECK(found[i] == dist[ids[i]]);
+            CHECK(i == 0 || found[i] > found[i - 1] ||
+                  (found[i] == found[i - 1] && ids[i] > ids[i - 1]));
+        }
+        /* nothing left out is nearer than the last one kept */
+        size_t nearer = 0;
+        for (size_t r = 0; r < rows; r++)
+            if (!int8_embedding_table_is_deleted(t, r) && dist[r] < found[n - 1]) nearer++;
+        CHECK(nearer < n);
+    }
+    free(dist);
+}
+
+/* share of the table's top k found with oversample; the rows found carry
+ * the table's scores
+ */
+static double recall(int8_sign_codes_t *c, int8_embedding_table_t *t, size_t dim,
+                     size_t oversample, embedding_thread_pool_t *pool) {
+    size_t hits = 0;
+    for (size_t q = 0; q < QUERIES; q++) {
+        const int8_t *query = queries + q * dim;
+        size_t ids[K], want[K];
+        double scores[K], want_scores[K];
+        size_t n = int8_sign_codes_topk(c, pool, query, -1.0, K, oversample, ids, scores, NULL);
+        size_t m = int8_embedding_table_topk(t, query, -1.0, K, want, want_scores);
+        CHECK(n == m);
+        for (size_t i = 0; i < n; i++) {
+            CHECK(!int8_embedding_table_is_deleted(t, ids[i]));
+            CHECK(i == 0 || scores[i] <= scores[i - 1]);
+            for (size_t j = 0; j < m; j++) {
+                if (ids[i] != want[j]) continue;
+                CHECK(scores[i] == want_scores[j]);
+                hits++;
+            }
+        }
+    }
+    return (double)hits / (QUERIES * K);
+}
+
+/* with every row a candidate the result is the table's, ids and scores */
+static void check_exact(int8_sign_codes_t *c, int8_embedding_table_t *t, size_t dim,
+                        embedding_thread_pool_t *pool) {
+    size_t oversample = int8_embedding_table_size(t) / K + 1;
+    for (size_t q = 0; q < QUERIES; q++) {
+        size_t ids[K], want[K];
+        double scores[K], want_scores[K];
+        size_t n = int8_sign_codes_topk(c, pool, queries + q * dim, -1.0, K, oversample,
+                                        ids, scores, NULL);
+        size_t m = int8_embedding_table_topk(t, queries + q * dim, -1.0, K, want, want_scores);
+        CHECK(n == m && !memcmp(ids, want, n * sizeof(*ids)) &&
+              !memcmp(scores, want_scores, n * sizeof(*scores)));
+    }
+}
+
+static void check_codes(size_t dim, uint32_t layout, embedding_thread_pool_t *pool) {
+    make_centers(centers, CLUSTERS, dim);
+    make_data(centers, CLUSTERS, dim, 1.5f, floats, ROWS, queries, QUERIES);
+    int8_embedding_table_t *t = int8_embedding_table_init_layout(dim, 0, layout);
+    int8_embedding_table_add_floats_batch(t, floats, ROWS - 700);
+    check_code(t, dim);
+
+    int8_sign_codes_t *c = int8_sign_codes_init(t, pool);
+    CHECK(c != NULL);
+    if (!c) {
+        int8_embedding_table_destroy(t);
+        return;
+    }
+    CHECK(int8_sign_codes_size(c) == ROWS - 700);
+    CHECK(int8_sign_codes_bytes_per_row(c) == int8_sign_code_words(dim) * sizeof(uint64_t));
+
+    /* appended rows are encoded by sync(); a row's own code is at distance 0 */
+    int8_embedding_table_add_floats_batch(t, floats + (ROWS - 700) * dim, 700);
+    CHECK(int8_sign_codes_size(c) == ROWS - 700);
+    CHECK(int8_sign_codes_sync(c, pool) == 0);
+    CHECK(int8_sign_codes_size(c) == ROWS);
+    uint64_t code[MAX_WORDS];
+    int8_sign_code(int8_embedding_table_embedding(t, ROWS - 5), dim, code);
+    size_t id;
+    uint32_t distance = 1;
+    CHECK(int8_sign_codes_scan(c, pool, code, 1, &id, &distance) == 1 && distance == 0);
+
+    check_scan(c, t, dim, pool);
+    double low = recall(c, t, dim, 1, pool), high = recall(c, t, dim, 64, pool);
+    CHECK(high >= 0.95);
+    CHECK(low <= high);
+    check_exact(c, t, dim, pool);
+
+    /* deleted rows are neither scanned nor returned */
+    for (size_t q = 0; q < QUERIES; q++) {
+        size_t best;
+        if (int8_embedding_table_topk(t, queries + q * dim, -1.0, 1, &best, NULL) == 1)
+            int8_embedding_table_delete(t, best);
+    }
+    for (size_t r = 0; r < ROWS; r += 5) int8_embedding_table_delete(t, r);
+    check_scan(c, t, dim, pool);
+    CHECK(recall(c, t, dim, 64, pool) >= 0.95);
+    check_exact(c, t, dim, pool);
+
+    int8_sign_codes_destroy(c);
+    int8_embedding_table_destroy(t);
+}
+
+int main(void) {
+    embedding_thread_pool_t *pool = embedding_thread_pool_init(3);
+    check_codes(256, 0, NULL);
+    check_codes(100, 0, pool);
+    check_codes(200, EMBEDDING_TABLE_LAYOUT_INV_NORMS, pool);
+    embedding_thread_pool_destroy(pool);
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
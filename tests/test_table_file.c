@@ -0,0 +1,294 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Incremental serialize of int8 tables: a file is only extended by the
+ * table that wrote or loaded its last commit (a compacted table, a new one
+ * or a copy the file has moved on from replaces it), a writer killed
+ * mid-commit is rolled back from the journal by the next load, verify or
+ * serialize, and loads racing a writer never see a commit half done.
+ */
+
+#include "embedding-library/int8_embedding_table.h"
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define DIM 64
+#define FILENAME "test_table_file.tbl"
+#define JOURNAL FILENAME ".journal"
+
+static atomic_int failures;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s (%s:%d)\n", #cond, __FILE__, __LINE__);         \
+            atomic_fetch_add(&failures, 1);                                 \
+        }                                                                   \
+    } while (0)
+
+static void make_row(size_t i, int8_t *row) {
+    uint32_t x = (uint32_t)i * 2654435761u + 1u;
+    for (size_t d = 0; d < DIM; d++) {
+        x = x * 1103515245u + 12345u;
+        row[d] = (int8_t)((int)((x >> 16) % 255u) - 127);
+    }
+    row[0] = 127;
+}
+
+/* append rows make_row(from) .. make_row(to - 1) */
+static void add_rows(int8_embedding_table_t *t, size_t from, size_t to) {
+    int8_t row[DIM];
+    for (size_t i = from; i < to; i++) {
+        make_row(i, row);
+        int8_embedding_table_add_embedding(t, row, -1.0);
+    }
+}
+
+/* a and b hold the same rows and tombstones */
+static int same_rows(int8_embedding_table_t *a, int8_embedding_table_t *b) {
+    size_t n = int8_embedding_table_size(a);
+    if (int8_embedding_table_size(b) != n) return 0;
+    for (size_t i = 0; i < n; i++) {
+        if (memcmp(int8_embedding_table_embedding(a, i), int8_embedding_table_embedding(b, i), DIM) ||
+            int8_embedding_table_norm(a, i) != int8_embedding_table_norm(b, i) ||
+            int8_embedding_table_is_deleted(a, i) != int8_embedding_table_is_deleted(b, i))
+            return 0;
+    }
+    return 1;
+}
+
+/* the file loads (and maps) back as t */
+static void check_file(int8_embedding_table_t *t) {
+    CHECK(int8_embedding_table_verify(FILENAME, NULL) == 0);
+    int8_embedding_table_t *l = int8_embedding_table_deserialize(FILENAME);
+    CHECK(l && same_rows(l, t));
+    int8_embedding_table_destroy(l);
+    l = int8_embedding_table_mmap(FILENAME, 0);
+    CHECK(l && same_rows(l, t));
+    int8_embedding_table_destroy(l);
+}
+
+static ino_t file_ino(void) {
+    struct stat st;
+    return stat(FILENAME, &st) == 0 ? st.st_ino : 0;
+}
+
+static void check_incremental(void) {
+    remove(FILENAME);
+    int8_embedding_table_t *t = int8_embedding_table_init_dim(DIM, 0);
+    ino_t ino = 0;
+    for (int round = 0; round < 5; round++) {
+        add_rows(t, int8_embedding_table_size(t), int8_embedding_table_size(t) + 700);
+        if (round == 2) int8_embedding_table_delete(t, 5);
+        int8_embedding_table_serialize(t, FILENAME);
+        if (round == 0) ino = file_ino();
+        CHECK(file_ino() == ino);  /* extended in place, never replaced */
+        check_file(t);
+    }
+    CHECK(access(JOURNAL, F_OK) != 0);
+    CHECK(access(FILENAME ".tmp", F_OK) != 0);
+
+    /* a loaded copy is the same table: it extends the file too */
+    int8_embedding_table_t *l = int8_embedding_table_deserialize(FILENAME);
+    CHECK(l && l->table_id == t->table_id);
+    if (l) {
+        add_rows(l, int8_embedding_table_size(l), int8_embedding_table_size(l) + 300);
+        int8_embedding_table_serialize(l, FILENAME);
+        CHECK(file_ino() == ino);
+        check_file(l);
+        int8_embedding_table_destroy(l);
+    }
+    int8_embedding_table_destroy(t);
+
+    /* another table with fewer rows of its own replaces the file */
+    t = int8_embedding_table_init_dim(DIM, 0);
+    add_rows(t, 100, 5000);
+    int8_embedding_table_serialize(t, FILENAME);
+    CHECK(file_ino() != ino);
+    check_file(t);
+    int8_embedding_table_destroy(t);
+}
+
+/* two copies loaded from one file share its table id but not what they
+ * append: once one has written the file, the other's rows past the load
+ * point differ from it, so the other replaces the file instead of keeping
+ * the first one's nodes
+ */
+static void check_copies(void) {
+    remove(FILENAME);
+    int8_embedding_table_t *t = int8_embedding_table_init_dim(DIM, 0);
+    add_rows(t, 0, 3800);
+    int8_embedding_table_serialize(t, FILENAME);
+    int8_embedding_table_t *a = int8_embedding_table_deserialize(FILENAME);
+    int8_embedding_table_t *b = int8_embedding_table_deserialize(FILENAME);
+    CHECK(a && b);
+    if (a && b) {
+        add_rows(a, 3800, 4800);
+        add_rows(b, 100000, 101200);
+        int8_embedding_table_serialize(a, FILENAME);
+        check_file(a);
+        int8_embedding_table_serialize(b, FILENAME);
+        check_file(b);
+
+        /* the table that wrote last extends the file in place again */
+        ino_t ino = file_ino();
+        add_rows(b, 101200, 101500);
+        int8_embedding_table_serialize(b, FILENAME);
+        CHECK(file_ino() == ino);
+        check_file(b);
+    }
+    int8_embedding_table_destroy(b);
+    int8_embedding_table_destroy(a);
+    int8_embedding_table_destroy(t);
+}
+
+/* a compacted table is a new table: its rows shifted down, so nothing of
+ * the old file may be kept even though it has fewer rows than the new table
+ */
+static void check_compacted(void) {
+    remove(FILENAME);
+    int8_embedding_table_t *t = int8_embedding_table_init_dim(DIM, 0);
+    add_rows(t, 0, 3000);
+    for (size_t i = 0; i < 3000; i += 7) int8_embedding_table_delete(t, i);
+    int8_embedding_table_serialize(t, FILENAME);
+
+    size_t *remap = NULL;
+    int8_embedding_table_t *c = int8_embedding_table_compact(t, &remap);
+    CHECK(c && int8_embedding_table_size(c) == 2571);
+    CHECK(c && c->table_id != t->table_id);
+    if (c) {
+        add_rows(c, 3000, 3000 + 3600 - 2571);
+        int8_embedding_table_serialize(c, FILENAME);
+        check_file(c);
+        int8_embedding_table_destroy(c);
+    }
+    free(remap);
+    int8_embedding_table_destroy(t);
+}
+
+/* serialize t in a child limited to file_limit bytes per file: the commit
+ * dies with SIGXFSZ once it grows the table file past the limit, after the
+ * journal is written and the old last node and trailer are overwritten
+ */
+static void crash_serialize(int8_embedding_table_t *t, size_t file_limit) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        struct rlimit rl = { file_limit, file_limit };
+        setrlimit(RLIMIT_FSIZE, &rl);
+        int8_embedding_table_serialize(t, FILENAME);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGXFSZ);
+    CHECK(access(JOURNAL, F_OK) == 0);
+}
+
+static void check_recovery(void) {
+    remove(FILENAME);
+    remove(JOURNAL);
+    int8_embedding_table_t *t = int8_embedding_table_init_dim(DIM, 0);
+    add_rows(t, 0, 700);
+    int8_embedding_table_delete(t, 3);
+    int8_embedding_table_serialize(t, FILENAME);
+    int8_embedding_table_t *committed = int8_embedding_table_deserialize(FILENAME);
+    struct stat st;
+    stat(FILENAME, &st);
+    size_t limit = (size_t)st.st_size + 4096;
+
+    /* each reader rolls the torn commit back and sees the committed rows */
+    add_rows(t, 700, 3000);
+    crash_serialize(t, limit);
+    int8_embedding_table_t *l = int8_embedding_table_deserialize(FILENAME);
+    CHECK(l && committed && same_rows(l, committed));
+    int8_embedding_table_destroy(l);
+    CHECK(access(JOURNAL, F_OK) != 0);
+
+    crash_serialize(t, limit);
+    l = int8_embedding_table_mmap(FILENAME, EMBEDDING_TABLE_MMAP_VERIFY);
+    CHECK(l && committed && same_rows(l, committed));
+    int8_embedding_table_destroy(l);
+
+    crash_serialize(t, limit);
+    CHECK(int8_embedding_table_verify(FILENAME, NULL) == 0);
+    CHECK(access(JOURNAL, F_OK) != 0);
+
+    /* the next serialize recovers, then extends the file in place */
+    crash_serialize(t, limit);
+    ino_t ino = file_ino();
+    int8_embedding_table_serialize(t, FILENAME);
+    CHECK(file_ino() == ino);
+    CHECK(access(JOURNAL, F_OK) != 0);
+    check_file(t);
+
+    int8_embedding_table_destroy(committed);
+    int8_embedding_table_destroy(t);
+}
+
+/* loads and verifies while a writer appends and serializes */
+static atomic_int writing;
+
+static void *reader(void *arg) {
+    (void)arg;
+    size_t last = 0, loads = 0;
+    int8_t row[DIM];
+    while (atomic_load(&writing) || loads < 4) {
+        int8_embedding_table_t *l = int8_embedding_table_deserialize(FILENAME);
+        CHECK(l != NULL);
+        if (!l) break;
+        size_t n = int8_embedding_table_size(l);
+        CHECK(n >= last);
+        last = n;
+        for (size_t i = 0; i < n; i += 97) {
+            make_row(i, row);
+            CHECK(!memcmp(int8_embedding_table_embedding(l, i), row, DIM));
+        }
+        int8_embedding_table_destroy(l);
+        CHECK(int8_embedding_table_verify(FILENAME, NULL) == 0);
+        loads++;
+    }
+    return NULL;
+}
+
+static void check_readers(void) {
+    remove(FILENAME);
+    int8_embedding_table_t *t = int8_embedding_table_init_dim(DIM, 0);
+    add_rows(t, 0, 300);
+    int8_embedding_table_serialize(t, FILENAME);
+
+    pthread_t readers[2];
+    atomic_store(&writing, 1);
+    for (int i = 0; i < 2; i++) pthread_create(&readers[i], NULL, reader, NULL);
+    for (size_t n = 300; n < 8000; n += 300) {
+        add_rows(t, n, n + 300);
+        int8_embedding_table_serialize(t, FILENAME);
+    }
+    atomic_store(&writing, 0);
+    for (int i = 0; i < 2; i++) pthread_join(readers[i], NULL);
+    check_file(t);
+    int8_embedding_table_destroy(t);
+}
+
+int main(void) {
+    check_incremental();
+    check_copies();
+    check_compacted();
+    check_recovery();
+    check_readers();
+    remove(FILENAME);
+    remove(JOURNAL);
+
+    int n = atomic_load(&failures);
+    printf("%s\n", n ? "FAILED" : "ok");
+    return n ? 1 : 0;
+}
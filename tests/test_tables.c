@@ -0,0 +1,230 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+/* Float and int16 tables: rows append under consecutive ids across nodes,
+ * norms are cached as each layout keeps them (plain, INV_NORMS, NORMALIZED),
+ * topk() and topk_parallel() give the reference cosine ranking, and a table
+ * written to a file comes back the same from deserialize(),
+ * deserialize_parallel() and mmap().
+ */
+
+#include "embedding-library/float_embedding_table.h"
+#include "embedding-library/int16_embedding_table.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DIM 100
+#define ROWS 1300      /* two full nodes and part of a third */
+#define CLUSTERS 30
+#define QUERIES 10
+#define K 10
+#define FILENAME "test_tables.tbl"
+
+static float centers[CLUSTERS * DIM];
+static float floats[ROWS * DIM];
+static int16_t int16s[ROWS * DIM];
+static float queries[QUERIES * DIM];
+static int16_t queries16[QUERIES * DIM];
+static double ref[ROWS];
+
+static int close_to(double a, double b, double tolerance) {
+    return fabs(a - b) <= tolerance * (fabs(b) > 1.0 ? fabs(b) : 1.0);
+}
+
+static double float_dot(const float *a, const float *b) {
+    double sum = 0.0;
+    for (size_t d = 0; d < DIM; d++) sum += (double)a[d] * b[d];
+    return sum;
+}
+
+static double int16_dot(const int16_t *a, const int16_t *b) {
+    int64_t sum = 0;
+    for (size_t d = 0; d < DIM; d++) sum += (int64_t)a[d] * b[d];
+    return (double)sum;
+}
+
+/* ids and scores of topk() are the reference ranking: scores within
+ * tolerance of ref[], best first, and no row left out scores above the last
+ */
+static void check_ranking(const size_t *ids, const double *scores, size_t n, double tolerance) {
+    CHECK(n == K);
+    for (size_t i = 0; i < n; i++) {
+        CHECK(close_to(scores[i], ref[ids[i]], tolerance));
+        CHECK(i == 0 || scores[i] <= scores[i - 1]);
+    }
+    size_t better = 0;
+    for (size_t r = 0; r < ROWS; r++) better += ref[r] > scores[n - 1] + tolerance;
+    CHECK(better < n);
+}
+
+/* a and b hold the same rows, norms and layout */
+static int same_floats(float_embedding_table_t *a, float_embedding_table_t *b) {
+    if (float_embedding_table_size(a) != float_embedding_table_size(b) ||
+        a->layout != b->layout) return 0;
+    for (size_t i = 0; i < float_embedding_table_size(a); i++)
+        if (memcmp(float_embedding_table_embedding(a, i), float_embedding_table_embedding(b, i),
+                   DIM * sizeof(float)) ||
+            float_embedding_table_norm(a, i) != float_embedding_table_norm(b, i))
+            return 0;
+    return 1;
+}
+
+/* l is t loaded back: same rows and the same top k, ids and scores */
+static void check_float_loaded(float_embedding_table_t *t, float_embedding_table_t *l) {
+    CHECK(l && same_floats(l, t));
+    if (!l) return;
+    for (size_t q = 0; q < QUERIES; q++) {
+        size_t ids[K], want[K];
+        double scores[K], want_scores[K];
+        size_t n = float_embedding_table_topk(l, queries + q * DIM, -1.0, K, ids, scores);
+        size_t m = float_embedding_table_topk(t, queries + q * DIM, -1.0, K, want, want_scores);
+        CHECK(n == m && !memcmp(ids, want, n * sizeof(*ids)) &&
+              !memcmp(scores, want_scores, n * sizeof(*scores)));
+    }
+    float_embedding_table_destroy(l);
+}
+
+static void check_float_table(uint32_t layout, embedding_thread_pool_t *pool) {
+    float_embedding_table_t *t = float_embedding_table_init_layout(DIM, 0, layout);
+    CHECK(t != NULL);
+    if (!t) return;
+    for (size_t i = 0; i < ROWS; i++) {
+        /* every fifth row with its norm given */
+        double norm = i % 5 ? -1.0 : sqrt(float_dot(floats + i * DIM, floats + i * DIM));
+        CHECK(float_embedding_table_add_embedding(t, floats + i * DIM, norm) == (ssize_t)i);
+    }
+    float zeros[DIM] = { 0 };
+    CHECK(float_embedding_table_add_embedding(t, zeros, -1.0) == -1);
+    CHECK(float_embedding_table_size(t) == ROWS);
+    CHECK(float_embedding_table_embedding(t, ROWS + 600) == NULL);
+
+    /* norms as the layout keeps them; NORMALIZED rows are unit length */
+    for (size_t i = 0; i < ROWS; i++) {
+        const float *row = float_embedding_table_embedding(t, i);
+        double norm = sqrt(float_dot(floats + i * DIM, floats + i * DIM));
+        if (layout & EMBEDDING_TABLE_LAYOUT_NORMALIZED) {
+            CHECK(float_embedding_table_norm(t, i) == 1.0);
+            CHECK(close_to(float_dot(row, row), 1.0, 1e-5));
+        } else {
+            CHECK(close_to(float_embedding_table_norm(t, i), norm, 1e-5));
+            CHECK(!memcmp(row, floats + i * DIM, DIM * sizeof(float)));
+        }
+    }
+    for (size_t i = 0; i + 7 < ROWS; i += 97) {
+        const float *a = floats + i * DIM, *b = floats + (i + 7) * DIM;
+        double cosine = float_dot(a, b) / sqrt(float_dot(a, a) * float_dot(b, b));
+        CHECK(close_to(float_embedding_table_cosine_similarity(t, i, i + 7), cosine, 1e-5));
+    }
+
+    for (size_t q = 0; q < QUERIES; q++) {
+        const float *query = queries + q * DIM;
+        for (size_t r = 0; r < ROWS; r++) {
+            const float *row = floats + r * DIM;
+            ref[r] = float_dot(query, row) / sqrt(float_dot(query, query) * float_dot(row, row));
+        }
+        size_t ids[K], p_ids[K];
+        double scores[K], p_scores[K];
+        size_t n = float_embedding_table_topk(t, query, -1.0, K, ids, scores);
+        check_ranking(ids, scores, n, 1e-5);
+        size_t m = float_embedding_table_topk_parallel(t, pool, query, -1.0, K, p_ids, p_scores);
+        CHECK(m == n && !memcmp(p_ids, ids, n * sizeof(*ids)) &&
+              !memcmp(p_scores, scores, n * sizeof(*scores)));
+    }
+
+    remove(FILENAME);
+    float_embedding_table_serialize(t, FILENAME);
+    check_float_loaded(t, float_embedding_table_deserialize(FILENAME));
+    check_float_loaded(t, float_embedding_table_deserialize_parallel(FILENAME, pool));
+    check_float_loaded(t, float_embedding_table_mmap(FILENAME, EMBEDDING_TABLE_MMAP_VERIFY));
+    float_embedding_table_destroy(t);
+}
+
+static int same_int16s(int16_embedding_table_t *a, int16_embedding_table_t *b) {
+    if (int16_embedding_table_size(a) != int16_embedding_table_size(b)) return 0;
+    for (size_t i = 0; i < int16_embedding_table_size(a); i++)
+        if (memcmp(int16_embedding_table_embedding(a, i), int16_embedding_table_embedding(b, i),
+                   DIM * sizeof(int16_t)) ||
+            int16_embedding_table_norm(a, i) != int16_embedding_table_norm(b, i))
+            return 0;
+    return 1;
+}
+
+static void check_int16_loaded(int16_embedding_table_t *t, int16_embedding_table_t *l) {
+    CHECK(l && same_int16s(l, t));
+    if (!l) return;
+    for (size_t q = 0; q < QUERIES; q++) {
+        size_t ids[K], want[K];
+        double scores[K], want_scores[K];
+        size_t n = int16_embedding_table_topk(l, queries16 + q * DIM, -1.0, K, ids, scores);
+        size_t m = int16_embedding_table_topk(t, queries16 + q * DIM, -1.0, K, want, want_scores);
+        CHECK(n == m && !memcmp(ids, want, n * sizeof(*ids)) &&
+              !memcmp(scores, want_scores, n * sizeof(*scores)));
+    }
+    int16_embedding_table_destroy(l);
+}
+
+static void check_int16_table(embedding_thread_pool_t *pool) {
+    int16_embedding_table_t *t = int16_embedding_table_init(DIM, 0);
+    CHECK(t != NULL);
+    if (!t) return;
+    for (size_t i = 0; i < ROWS; i++)
+        CHECK(int16_embedding_table_add_embedding(t, int16s + i * DIM, -1.0) == (ssize_t)i);
+    int16_t zeros[DIM] = { 0 };
+    CHECK(int16_embedding_table_add_embedding(t, zeros, -1.0) == -1);
+    CHECK(int16_embedding_table_size(t) == ROWS);
+
+    /* integer dot products: norms and scores are exact to rounding */
+    for (size_t i = 0; i < ROWS; i++)
+        CHECK(int16_embedding_table_norm(t, i) ==
+              sqrt(int16_dot(int16s + i * DIM, int16s + i * DIM)));
+    for (size_t q = 0; q < QUERIES; q++) {
+        const int16_t *query = queries16 + q * DIM;
+        for (size_t r = 0; r < ROWS; r++) {
+            const int16_t *row = int16s + r * DIM;
+            ref[r] = int16_dot(query, row) / (sqrt(int16_dot(query, query)) *
+                                              sqrt(int16_dot(row, row)));
+        }
+        size_t ids[K], p_ids[K];
+        double scores[K], p_scores[K];
+        size_t n = int16_embedding_table_topk(t, query, -1.0, K, ids, scores);
+        check_ranking(ids, scores, n, 1e-12);
+        size_t m = int16_embedding_table_topk_parallel(t, pool, query, -1.0, K, p_ids, p_scores);
+        CHECK(m == n && !memcmp(p_ids, ids, n * sizeof(*ids)) &&
+              !memcmp(p_scores, scores, n * sizeof(*scores)));
+    }
+
+    remove(FILENAME);
+    int16_embedding_table_serialize(t, FILENAME);
+    check_int16_loaded(t, int16_embedding_table_deserialize(FILENAME));
+    check_int16_loaded(t, int16_embedding_table_deserialize_parallel(FILENAME, pool));
+    check_int16_loaded(t, int16_embedding_table_mmap(FILENAME, EMBEDDING_TABLE_MMAP_VERIFY));
+    int16_embedding_table_destroy(t);
+}
+
+int main(void) {
+    make_centers(centers, CLUSTERS, DIM);
+    make_data(centers, CLUSTERS, DIM, 0.8f, floats, ROWS, NULL, 0);
+    for (size_t i = 0; i < ROWS; i++) int16_from_floats(floats + i * DIM, DIM, int16s + i * DIM);
+    for (size_t q = 0; q < QUERIES; q++) {
+        make_point(centers, CLUSTERS, DIM, 0.8f, queries + q * DIM);
+        int16_from_floats(queries + q * DIM, DIM, queries16 + q * DIM);
+    }
+    CHECK(float_embedding_table_init(0, 0) == NULL);
+    CHECK(float_embedding_table_init_layout(DIM, 0, EMBEDDING_TABLE_LAYOUT_ROW_SCALES) == NULL);
+    CHECK(int16_embedding_table_init(65537, 0) == NULL);
+
+    embedding_thread_pool_t *pool = embedding_thread_pool_init(3);
+    check_float_table(0, pool);
+    check_float_table(EMBEDDING_TABLE_LAYOUT_INV_NORMS, pool);
+    check_float_table(EMBEDDING_TABLE_LAYOUT_NORMALIZED, NULL);
+    check_int16_table(pool);
+    check_int16_table(NULL);
+    embedding_thread_pool_destroy(pool);
+    remove(FILENAME);
+
+    printf("%s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+// SPDX-FileCopyrightText: 2025 Andy Curtis <contactandyc@gmail.com>
+// SPDX-FileCopyrightText: 2024–2025 Knode.ai — technical questions: contact Andy (above)
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef _embed_test_util_H
+#define _embed_test_util_H
+
+/* Fixture shared by the single-threaded tests: the CHECK() macro counting
+ * into failures, a seeded xorshift generator (the same numbers every run)
+ * and clustered data, rows and queries drawn around random centers so the
+ * approximate indexes have structure to find.
+ */
+
+#include "embedding-library/int8.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define TEST_MAX_DIM 1024   /* largest dim make_data() takes */
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("FAIL %s (%s:%d)\n", #cond, __FILE__, __LINE__);         \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static uint64_t seed = 88172645463325252ull;
+
+/* uniform in [0, 1) */
+static inline double uniform(void) {
+    seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+    return (double)(seed >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* standard normal (Box-Muller) */
+static inline double gauss(void) {
+    return sqrt(-2.0 * log(uniform() + 1e-12)) * cos(6.283185307179586 * uniform());
+}
+
+/* clusters centers of dim standard normal elements */
+static inline void make_centers(float *centers, size_t clusters, size_t dim) {
+    for (size_t i = 0; i < clusters * dim; i++) centers[i] = (float)gauss();
+}
+
+/* a point near a random one of the centers, noise standard deviations away */
+static inline void make_point(const float *centers, size_t clusters, size_t dim,
+                              float noise, float *out) {
+    size_t c = (size_t)(uniform() * clusters);
+    for (size_t d = 0; d < dim; d++) out[d] = centers[c * dim + d] + noise * (float)gauss();
+}
+
+/* n rows of floats, then n_queries int8 queries, all near the centers */
+static inline void make_data(const float *centers, size_t clusters, size_t dim, float noise,
+                             float *floats, size_t n, int8_t *queries, size_t n_queries) {
+    for (size_t i = 0; i < n; i++) make_point(centers, clusters, dim, noise, floats + i * dim);
+    float point[TEST_MAX_DIM];
+    for (size_t q = 0; q < n_queries; q++) {
+        make_point(centers, clusters, dim, noise, point);
+        int8_from_floats(point, dim, queries + q * dim);
+    }
+}
+
+#endif // _embed_test_util_H